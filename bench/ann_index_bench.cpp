@@ -0,0 +1,154 @@
+#include <benchmark/benchmark.h>
+#include "semantic_fusion.h"
+#include "ann_index.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace aiaudio;
+
+namespace {
+
+constexpr size_t kEntries = 50000;
+constexpr size_t kDimension = 384;
+constexpr size_t kClusters = 200;
+constexpr size_t kQueries = 200;
+constexpr size_t kTopK = 10;
+
+// Hash-seeded embedding with cluster structure, so the benchmark sees the
+// kind of neighbourhoods a real text model produces
+class ClusteredEmbedding : public SemanticEmbedding {
+public:
+    ClusteredEmbedding() : centroids_(kClusters, EmbeddingVector(kDimension)) {
+        std::mt19937 rng(7);
+        std::normal_distribution<double> gauss(0.0, 1.0);
+        for (auto& centroid : centroids_) {
+            for (auto& value : centroid) value = gauss(rng);
+            centroid = normalize(centroid);
+        }
+    }
+    
+    EmbeddingVector encode(const std::string& text) const override {
+        size_t hash = std::hash<std::string>{}(text);
+        std::mt19937 rng(static_cast<unsigned>(hash));
+        std::normal_distribution<double> gauss(0.0, 0.04);
+        EmbeddingVector v = centroids_[hash % kClusters];
+        for (auto& value : v) value += gauss(rng);
+        return normalize(v);
+    }
+    
+    size_t getDimension() const override { return kDimension; }
+    std::string getModelId() const override { return "bench-clustered"; }
+    
+private:
+    std::vector<EmbeddingVector> centroids_;
+};
+
+// Query caches are off: the query set repeats, and every search should
+// rank the index rather than replay an earlier result
+std::unique_ptr<SemanticSearchEngine> buildEngine(size_t entries = kEntries) {
+    auto engine = std::make_unique<SemanticSearchEngine>(
+        std::make_unique<SemanticFusionEngine>(std::make_unique<ClusteredEmbedding>()));
+    engine->setQueryCacheCapacity(0);
+    for (size_t i = 0; i < entries; ++i) {
+        EntryVectorBuilder::EntryData data;
+        data.id = "preset" + std::to_string(i);
+        data.tags = {data.id};
+        data.description = data.id;
+        // LEAD is kept sparse (10%) to exercise filtered probing
+        data.role = i % 10 == 0 ? Role::LEAD : (i % 2 ? Role::BASS : Role::PAD);
+        engine->addEntry(data);
+    }
+    return engine;
+}
+
+// Exact engine is the ground truth; the IVF engine indexes the same entries
+struct SearchFixture {
+    std::unique_ptr<SemanticSearchEngine> exact = buildEngine();
+    std::unique_ptr<SemanticSearchEngine> ivf = buildEngine();
+    std::vector<std::string> queries;
+    
+    SearchFixture() {
+        ivf->setANNIndex(std::make_unique<IVFIndex>());
+        for (size_t q = 0; q < kQueries; ++q) {
+            queries.push_back("query" + std::to_string(q));
+        }
+    }
+    
+    double recall(Role role) {
+        size_t found = 0;
+        for (const auto& query : queries) {
+            auto truth = exact->search(query, role, kTopK);
+            auto hits = ivf->search(query, role, kTopK);
+            for (const auto& hit : hits) {
+                found += std::any_of(truth.begin(), truth.end(), [&](const auto& t) {
+                    return t.entryId == hit.entryId;
+                });
+            }
+        }
+        return static_cast<double>(found) / (queries.size() * kTopK);
+    }
+};
+
+SearchFixture& fixture() {
+    static SearchFixture instance;
+    return instance;
+}
+
+// Exact engines by library size; one is held at a time, since the largest
+// takes about 2 GB
+SemanticSearchEngine& scalingEngine(size_t entries) {
+    static size_t builtFor = 0;
+    static std::unique_ptr<SemanticSearchEngine> engine;
+    if (builtFor != entries) {
+        engine.reset();
+        engine = buildEngine(entries);
+        builtFor = entries;
+    }
+    return *engine;
+}
+
+Role roleFor(const benchmark::State& state, int arg) {
+    return state.range(arg) ? Role::LEAD : Role::UNKNOWN;
+}
+
+void runQueries(benchmark::State& state, const SemanticSearchEngine& engine, Role role) {
+    const auto& queries = fixture().queries;
+    size_t q = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine.search(queries[q], role, kTopK));
+        q = (q + 1) % queries.size();
+    }
+    // items_per_second is the QPS
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+// Arguments: lead-only filter
+static void BM_ExactSearch(benchmark::State& state) {
+    runQueries(state, *fixture().exact, roleFor(state, 0));
+}
+BENCHMARK(BM_ExactSearch)->Arg(0)->Arg(1);
+
+// Arguments: nprobe, lead-only filter
+static void BM_IVFSearch(benchmark::State& state) {
+    SearchFixture& f = fixture();
+    f.ivf->tuneANNIndex([&](ANNIndex& index) {
+        static_cast<IVFIndex&>(index).setNProbe(state.range(0));
+    });
+    Role role = roleFor(state, 1);
+    
+    state.counters["recall@10"] = f.recall(role);
+    runQueries(state, *f.ivf, role);
+}
+BENCHMARK(BM_IVFSearch)->ArgsProduct({{1, 2, 4, 8, 16, 32}, {0, 1}});
+
+// Exact search by library size; argument: entries
+static void BM_SearchScaling(benchmark::State& state) {
+    runQueries(state, scalingEngine(state.range(0)), Role::UNKNOWN);
+}
+BENCHMARK(BM_SearchScaling)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
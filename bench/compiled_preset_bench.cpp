@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+#include "compiled_preset.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace aiaudio;
+
+namespace {
+
+// Eight-stage preset: four oscillator -> filter branches into one envelope
+std::string benchPreset(int variant) {
+    std::string stages, connections;
+    for (int i = 0; i < 4; ++i) {
+        std::string osc = "osc" + std::to_string(i), filter = "filter" + std::to_string(i);
+        stages += "\"" + osc + "\": {\"type\": \"oscillator\", \"parameters\": {\"frequency\": "
+                + std::to_string(110.0 * (i + 1) + variant) + ", \"amplitude\": 0.1, \"waveType\": \"saw\"}},\n"
+                + "\"" + filter + "\": {\"type\": \"filter\", \"parameters\": {\"cutoff\": "
+                + std::to_string(800.0 * (i + 1)) + ", \"resonance\": 0.5}},\n";
+        connections += "{\"source\": \"" + osc + "\", \"destination\": \"" + filter + "\"},\n"
+                     + "{\"source\": \"" + filter + "\", \"destination\": \"env\"},\n";
+    }
+    stages += "\"env\": {\"type\": \"envelope\", \"parameters\": {\"attack\": 0.05}}\n";
+    connections.erase(connections.size() - 2);
+    return "{\"stages\": {\n" + stages + "},\n\"connections\": [\n" + connections + "\n]}\n";
+}
+
+} // namespace
+
+// One preset into a graph; argument: 0 = JSON parse, 1 = compiled
+static void BM_PresetLoad(benchmark::State& state) {
+    const std::string json = benchPreset(0);
+    const std::vector<uint8_t> compiled = compilePresetJSON(json);
+    IRParser parser;
+    
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            benchmark::DoNotOptimize(parser.parsePreset(json));
+        } else {
+            benchmark::DoNotOptimize(loadCompiledPreset(compiled.data(), compiled.size()));
+        }
+    }
+    state.SetLabel(state.range(0) == 0 ? "json" : "compiled");
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PresetLoad)->Arg(0)->Arg(1);
+
+// A 64-preset directory; arguments: warm cache, parallel
+static void BM_PresetLibrary(benchmark::State& state) {
+    namespace fs = std::filesystem;
+    const fs::path directory = fs::temp_directory_path() / "aiaudio_bench_presets";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    for (int i = 0; i < 64; ++i) {
+        std::ofstream(directory / ("preset" + std::to_string(i) + ".json")) << benchPreset(i);
+    }
+    
+    PresetLibrary::Options options;
+    options.useCache = state.range(0) != 0;
+    options.parallel = state.range(1) != 0;
+    PresetLibrary library(options);
+    library.loadDirectory(directory.string());
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(library.loadDirectory(directory.string()));
+    }
+    state.SetLabel(options.useCache ? "cached" : "json");
+    state.SetItemsProcessed(state.iterations() * 64);
+    fs::remove_all(directory);
+}
+BENCHMARK(BM_PresetLibrary)->Args({0, 0})->Args({1, 0})->Args({0, 1})->Args({1, 1})->Unit(benchmark::kMillisecond);
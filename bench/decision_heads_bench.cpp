@@ -0,0 +1,60 @@
+#include <benchmark/benchmark.h>
+#include "decision_heads.h"
+#include <random>
+#include <vector>
+
+using namespace aiaudio;
+
+namespace {
+
+// Shape of the generator's default decision model
+DecisionMLP makeModel(bool quantized) {
+    DecisionMLP model(400, {256, 128}, 20);
+    if (quantized) model.quantizeToInt8();
+    return model;
+}
+
+std::vector<float> randomInputs(size_t n) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> inputs(n);
+    for (auto& value : inputs) value = dist(rng);
+    return inputs;
+}
+
+} // namespace
+
+// Arguments: batch size, int8 weights
+static void BM_DecisionForwardBatch(benchmark::State& state) {
+    const size_t batch = state.range(0);
+    DecisionMLP model = makeModel(state.range(1));
+    std::vector<float> inputs = randomInputs(batch * model.getInputSize());
+    std::vector<float> outputs(batch * model.getOutputSize());
+    
+    for (auto _ : state) {
+        model.forwardBatch(inputs.data(), batch, outputs.data());
+        benchmark::DoNotOptimize(outputs.data());
+    }
+    state.SetLabel(state.range(1) ? "int8" : "float");
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_DecisionForwardBatch)->ArgsProduct({{1, 16, 64, 256}, {0, 1}});
+
+// Arguments: minibatch size. One epoch of streamed rule samples per
+// iteration; items_per_second is training samples per second
+static void BM_DecisionTrainEpoch(benchmark::State& state) {
+    constexpr size_t kSamples = 4096;
+    RuleSampleStream samples(Role::BASS, kSamples, 384);
+    DecisionMLP model(samples.getInputSize(), {256, 128}, samples.getTargetSize());
+    DecisionTrainer trainer;
+    DecisionTrainer::Options options;
+    options.epochs = 1;
+    options.batchSize = state.range(0);
+    options.logInterval = 0;
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(trainer.trainModel(model, samples, options));
+    }
+    state.SetItemsProcessed(state.iterations() * kSamples);
+}
+BENCHMARK(BM_DecisionTrainEpoch)->Arg(32)->Arg(256)->Unit(benchmark::kMillisecond);
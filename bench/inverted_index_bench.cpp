@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include "inverted_index.h"
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace aiaudio;
+
+namespace {
+
+struct Library {
+    std::vector<std::string> keys;
+    std::vector<std::string> texts;
+    std::vector<Role> roles;
+    InvertedIndex index;
+};
+
+// Synthetic preset library: names and descriptions of four words drawn from
+// a 2000-word vocabulary, two tags each
+const Library& library(size_t entries) {
+    static std::map<size_t, Library> libraries;
+    Library& lib = libraries[entries];
+    if (!lib.keys.empty()) return lib;
+    
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> word(0, 1999), tag(0, 99), role(0, 6);
+    for (size_t i = 0; i < entries; ++i) {
+        std::string text;
+        for (int w = 0; w < 4; ++w) text += "word" + std::to_string(word(rng)) + " ";
+        lib.keys.push_back("preset" + std::to_string(i));
+        lib.texts.push_back(text);
+        lib.roles.push_back(static_cast<Role>(role(rng)));
+        lib.index.add(lib.keys.back(), lib.roles.back(),
+                      {"tag" + std::to_string(tag(rng)), "tag" + std::to_string(tag(rng))}, text);
+    }
+    return lib;
+}
+
+} // namespace
+
+// One two-word keyword query with a role filter; arguments: entries, 0 = scan
+// every entry with std::string::find, 1 = index lookup
+static void BM_KeywordSearch(benchmark::State& state) {
+    const Library& lib = library(state.range(0));
+    const bool indexed = state.range(1) != 0;
+    
+    for (auto _ : state) {
+        std::vector<std::string> results;
+        if (indexed) {
+            results = lib.index.searchText("word17 word42", Role::PAD);
+        } else {
+            for (size_t i = 0; i < lib.keys.size(); ++i) {
+                if (lib.roles[i] != Role::PAD) continue;
+                if (lib.texts[i].find("word17 ") != std::string::npos &&
+                    lib.texts[i].find("word42 ") != std::string::npos) {
+                    results.push_back(lib.keys[i]);
+                }
+            }
+        }
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetLabel(indexed ? "index" : "scan");
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_KeywordSearch)->ArgsProduct({{10000, 100000}, {0, 1}})->Unit(benchmark::kMicrosecond);
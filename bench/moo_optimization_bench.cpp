@@ -0,0 +1,159 @@
+#include <benchmark/benchmark.h>
+#include "moo_optimization.h"
+#include "main_app.h"
+#include <cstdio>
+#include <fstream>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace aiaudio;
+
+namespace {
+
+// Uniform scores: with five objectives most points land in the first few
+// fronts, the hard case for front-by-front sorting
+std::vector<MOOOptimizer::ObjectiveRow> randomRows(size_t n) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::vector<MOOOptimizer::ObjectiveRow> rows(n);
+    for (auto& row : rows) {
+        for (double& value : row) value = dist(rng);
+    }
+    return rows;
+}
+
+// Points on the positive unit sphere: mutually non-dominated, so the whole
+// set is the front
+std::vector<MOOOptimizer::ObjectiveRow> sphereFront(size_t n) {
+    std::mt19937 rng(7);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    std::vector<MOOOptimizer::ObjectiveRow> front(n);
+    for (auto& point : front) {
+        double norm = 0.0;
+        for (double& value : point) {
+            value = std::abs(gauss(rng));
+            norm += value * value;
+        }
+        for (double& value : point) value /= std::sqrt(norm);
+    }
+    return front;
+}
+
+MOOOptimizer::SortMethod methodFor(const benchmark::State& state) {
+    return state.range(1) ? MOOOptimizer::SortMethod::EFFICIENT : MOOOptimizer::SortMethod::DOMINANCE;
+}
+
+// A population where half the candidates are hopeless: full-scale squares
+// that clip and near-silent sines, around usable sines near -18 LUFS
+std::vector<DSPGraph> candidatePopulation(size_t n) {
+    std::vector<DSPGraph> candidates;
+    for (size_t i = 0; i < n; ++i) {
+        auto osc = std::make_unique<OscillatorStage>();
+        osc->setParameter("frequency", 110.0 * (1 + i % 7));
+        if (i % 4 == 0) {
+            osc->setParameter("amplitude", 1.0);
+            osc->setParameter("waveType", std::string("square"));
+        } else if (i % 4 == 1) {
+            osc->setParameter("amplitude", 0.005);
+        } else {
+            osc->setParameter("amplitude", 0.15 + 0.01 * (i % 5));
+        }
+        DSPGraph graph;
+        graph.addStage("osc1", std::move(osc));
+        candidates.push_back(std::move(graph));
+    }
+    return candidates;
+}
+
+MOOOptimizer defaultOptimizer() {
+    const std::string path = "bench_metrics.yaml";
+    std::ofstream(path) << "# defaults\n";
+    MOOOptimizer optimizer(path);
+    std::remove(path.c_str());
+    return optimizer;
+}
+
+} // namespace
+
+// Arguments: population size, ENS instead of the dominance matrix
+static void BM_NonDominatedSort(benchmark::State& state) {
+    auto rows = randomRows(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MOOOptimizer::nonDominatedSort(rows, methodFor(state)));
+    }
+    state.SetLabel(state.range(1) ? "ens" : "dominance");
+    state.SetItemsProcessed(state.iterations() * rows.size());
+}
+BENCHMARK(BM_NonDominatedSort)->ArgsProduct({{100, 1000, 4000, 16000}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+// Arguments: population size; keeps half, as NSGA-II does each generation
+static void BM_NSGA2Selection(benchmark::State& state) {
+    auto rows = randomRows(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MOOOptimizer::nsga2SelectIndices(rows, rows.size() / 2));
+    }
+    state.SetItemsProcessed(state.iterations() * rows.size());
+}
+BENCHMARK(BM_NSGA2Selection)->Arg(100)->Arg(1000)->Arg(4000)->Arg(16000)->Unit(benchmark::kMicrosecond);
+
+// Arguments: front size
+static void BM_HypervolumeExact(benchmark::State& state) {
+    auto front = sphereFront(state.range(0));
+    HypervolumeIndicator indicator;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(indicator.computeExact(front));
+    }
+}
+BENCHMARK(BM_HypervolumeExact)->RangeMultiplier(2)->Range(8, 128)->Unit(benchmark::kMicrosecond);
+
+// Arguments: front size; 2^18 samples
+static void BM_HypervolumeMonteCarlo(benchmark::State& state) {
+    auto front = sphereFront(state.range(0));
+    HypervolumeIndicator::Options options;
+    options.monteCarloSamples = 1 << 18;
+    HypervolumeIndicator indicator(options);
+    
+    HypervolumeIndicator::Estimate estimate;
+    for (auto _ : state) {
+        estimate = indicator.estimateMonteCarlo(front);
+        benchmark::DoNotOptimize(estimate);
+    }
+    state.counters["relative_ci"] = (estimate.upper - estimate.lower) / estimate.value;
+}
+BENCHMARK(BM_HypervolumeMonteCarlo)->Arg(64)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// Arguments: front size. Time per add() while the front grows to that size
+static void BM_HypervolumeIncremental(benchmark::State& state) {
+    auto front = sphereFront(state.range(0));
+    for (auto _ : state) {
+        HypervolumeIndicator indicator;
+        for (const auto& point : front) indicator.add(point);
+        benchmark::DoNotOptimize(indicator.getValue());
+    }
+    state.SetItemsProcessed(state.iterations() * front.size());
+}
+BENCHMARK(BM_HypervolumeIncremental)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+// Arguments: pruning on. 8 s candidates checked every 250 ms; reports
+// candidates per second and the share of audio actually rendered
+static void BM_CandidatePipeline(benchmark::State& state) {
+    MOOOptimizer optimizer = defaultOptimizer();
+    CandidatePipeline::Options options;
+    options.enablePruning = state.range(0) != 0;
+    auto candidates = candidatePopulation(16);
+    
+    double candidatesPerSecond = 0.0;
+    double audioSeconds = 0.0;
+    for (auto _ : state) {
+        CandidatePipeline pipeline(optimizer, options);
+        benchmark::DoNotOptimize(pipeline.evaluate(candidates, Role::PAD, MusicalContext{}, AudioConstraints{}));
+        candidatesPerSecond += pipeline.getLastRunStats().candidatesPerSecond;
+        audioSeconds += pipeline.getLastRunStats().audioSeconds;
+    }
+    state.SetLabel(options.enablePruning ? "pruning" : "full");
+    state.counters["candidates_per_second"] = candidatesPerSecond / state.iterations();
+    state.counters["rendered_fraction"] = audioSeconds / (state.iterations() * candidates.size() * options.durationSeconds);
+    state.SetItemsProcessed(state.iterations() * candidates.size());
+}
+BENCHMARK(BM_CandidatePipeline)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
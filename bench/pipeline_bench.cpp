@@ -0,0 +1,317 @@
+#include <benchmark/benchmark.h>
+#include "dsp_ir.h"
+#include "main_app.h"
+#include "metrics.h"
+#include "simd_kernels.h"
+#include "wavetable.h"
+#include <json/json.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef AIAUDIO_SOURCE_DIR
+#define AIAUDIO_SOURCE_DIR "."
+#endif
+#ifndef AIAUDIO_REVISION
+#define AIAUDIO_REVISION "unknown"
+#endif
+
+using namespace aiaudio;
+
+namespace {
+
+constexpr size_t kBlockSize = 512;
+
+// Shipped library files, relative to the source tree
+constexpr std::array<const char*, 3> kLibraryFiles = {"guitar.json", "group.json", "electronic_track.json"};
+
+constexpr std::array<const char*, 5> kStageNames = {"oscillator", "filter", "envelope", "lfo", "wavetable"};
+
+std::unique_ptr<DSPStage> makeStage(int64_t kind) {
+    switch (kind) {
+        case 0: return std::make_unique<OscillatorStage>();
+        case 1: return std::make_unique<FilterStage>();
+        case 2: return std::make_unique<EnvelopeStage>();
+        case 3: return std::make_unique<LFOStage>();
+        default: return std::make_unique<WavetableStage>();
+    }
+}
+
+AudioBuffer noise(size_t n) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+    AudioBuffer buffer(n);
+    for (auto& sample : buffer) sample = dist(rng);
+    return buffer;
+}
+
+// Library values come as numbers, [min, max] ranges (the midpoint is used)
+// or strings with a unit such as "600ms", "3s" or "800Hz"
+double libraryNumber(const Json::Value& value, double fallback) {
+    if (value.isNumeric()) return value.asDouble();
+    if (value.isArray() && value.size() == 2 && value[0].isNumeric() && value[1].isNumeric()) {
+        return 0.5 * (value[0].asDouble() + value[1].asDouble());
+    }
+    if (value.isString()) {
+        try {
+            return std::stod(value.asString());
+        } catch (const std::exception&) {
+        }
+    }
+    return fallback;
+}
+
+// Envelope times: strings carry their unit, bare numbers are milliseconds
+double librarySeconds(const Json::Value& value, double fallback) {
+    const double number = libraryNumber(value, -1.0);
+    if (number < 0.0) return fallback;
+    const std::string text = value.isString() ? value.asString() : "ms";
+    return text.size() >= 2 && text.compare(text.size() - 2, 2, "ms") == 0 ? number / 1000.0 : number;
+}
+
+double libraryHz(const Json::Value& value, double fallback) {
+    const double number = libraryNumber(value, fallback);
+    const bool kilo = value.isString() && value.asString().find("kHz") != std::string::npos;
+    return kilo ? number * 1000.0 : number;
+}
+
+std::string libraryWaveform(const std::string& name) {
+    if (name == "sawtooth" || name == "saw") return "saw";
+    if (name == "square" || name == "pulse") return "square";
+    if (name == "triangle") return "triangle";
+    return "sine";
+}
+
+std::string libraryFilterType(const std::string& name) {
+    if (name.find("high") != std::string::npos) return "highpass";
+    if (name.find("band") != std::string::npos) return "bandpass";
+    return "lowpass";
+}
+
+// Scientific pitch ("E2", "F#3") to Hz
+double noteFrequency(const std::string& note) {
+    static const int semitones[] = {9, 11, 0, 2, 4, 5, 7};  // A B C D E F G
+    if (note.empty() || note[0] < 'A' || note[0] > 'G') return 220.0;
+    int semitone = semitones[note[0] - 'A'];
+    size_t pos = 1;
+    if (pos < note.size() && (note[pos] == '#' || note[pos] == 'b')) {
+        semitone += note[pos] == '#' ? 1 : -1;
+        ++pos;
+    }
+    const int octave = pos < note.size() ? note[pos] - '0' : 3;
+    return midiToFreq((octave + 1) * 12 + semitone).value;
+}
+
+// One library entry as oscillators -> filter -> envelope: an oscillator per
+// listed waveform (or per string of a tuning), the entry's filter and its
+// envelope, with values clamped to the stage ranges
+DSPGraph libraryGraph(const Json::Value& entry) {
+    DSPGraph graph;
+    std::vector<std::pair<std::string, double>> voices;  // Waveform, frequency
+    std::vector<double> levels;
+    
+    const Json::Value& oscillator = entry["oscillator"];
+    if (oscillator.isObject()) {
+        const double detune = libraryNumber(oscillator["detune"], 0.0);
+        for (Json::ArrayIndex i = 0; i < oscillator["types"].size(); ++i) {
+            voices.emplace_back(libraryWaveform(oscillator["types"][i].asString()), 220.0 * (1.0 + detune * i));
+            levels.push_back(libraryNumber(oscillator["mix_ratios"][i], 1.0));
+        }
+    } else {
+        for (const auto& note : entry["strings"]["tuning"]) {
+            voices.emplace_back("triangle", noteFrequency(note.asString()));
+            levels.push_back(1.0);
+        }
+    }
+    if (voices.empty()) {
+        voices.emplace_back("saw", 220.0);
+        levels.push_back(1.0);
+    }
+    
+    const Json::Value& filterSpec = entry["filter"];
+    auto filter = std::make_unique<FilterStage>();
+    filter->setParameter("cutoff", std::clamp(libraryHz(filterSpec["cutoff"], 1000.0), 20.0, 20000.0));
+    filter->setParameter("resonance", std::clamp(libraryNumber(filterSpec["resonance"], 0.1), 0.0, 0.99));
+    filter->setParameter("filterType", libraryFilterType(filterSpec["type"].asString()));
+    graph.addStage("filter", std::move(filter));
+    
+    const Json::Value& envelopeSpec = entry.isMember("envelope") ? entry["envelope"] : entry["adsr"];
+    auto envelope = std::make_unique<EnvelopeStage>();
+    envelope->setParameter("attack", std::clamp(librarySeconds(envelopeSpec["attack"], 0.01), 0.001, 2.0));
+    envelope->setParameter("decay", std::clamp(librarySeconds(envelopeSpec["decay"], 0.1), 0.001, 2.0));
+    envelope->setParameter("sustain", std::clamp(libraryNumber(envelopeSpec["sustain"], 1.0), 0.0, 1.0));
+    envelope->setParameter("release", std::clamp(librarySeconds(envelopeSpec["release"], 0.5), 0.001, 5.0));
+    graph.addStage("env", std::move(envelope));
+    graph.addConnection({"filter", "env"});
+    
+    double total = 0.0;
+    for (double level : levels) total += level;
+    for (size_t i = 0; i < voices.size(); ++i) {
+        auto osc = std::make_unique<OscillatorStage>();
+        osc->setParameter("waveType", voices[i].first);
+        osc->setParameter("frequency", std::clamp(voices[i].second, 20.0, 20000.0));
+        osc->setParameter("amplitude", std::clamp(total > 0.0 ? levels[i] / total : 1.0, 0.0, 1.0));
+        const std::string name = "osc" + std::to_string(i);
+        graph.addStage(name, std::move(osc));
+        graph.addConnection({name, "filter"});
+    }
+    return graph;
+}
+
+// Every object in the file that describes a sound (a filter plus either an
+// oscillator block or a string tuning)
+void collectEntries(const Json::Value& value, std::vector<const Json::Value*>& entries) {
+    if (value.isObject()) {
+        if (value.isMember("filter") && (value.isMember("oscillator") || value.isMember("strings"))) {
+            entries.push_back(&value);
+            return;
+        }
+        for (const auto& name : value.getMemberNames()) collectEntries(value[name], entries);
+    } else if (value.isArray()) {
+        for (const auto& item : value) collectEntries(item, entries);
+    }
+}
+
+std::vector<DSPGraph> loadLibrary(const std::string& file) {
+    std::ifstream stream(std::string(AIAUDIO_SOURCE_DIR) + "/" + file);
+    Json::Value root;
+    Json::CharReaderBuilder reader;
+    std::string errors;
+    if (!stream.is_open() || !Json::parseFromStream(reader, stream, &root, &errors)) {
+        throw AIAudioException("Could not read preset library " + file + ": " + errors);
+    }
+    std::vector<const Json::Value*> entries;
+    collectEntries(root, entries);
+    std::vector<DSPGraph> graphs;
+    for (const auto* entry : entries) graphs.push_back(libraryGraph(*entry));
+    return graphs;
+}
+
+// Build identity in the context block of JSON results, so result files
+// from different releases and machines can be told apart
+const bool kContextAdded = [] {
+    benchmark::AddCustomContext("aiaudio_revision", AIAUDIO_REVISION);
+    benchmark::AddCustomContext("aiaudio_simd", simdLevelName(detectSIMDLevel()));
+    return true;
+}();
+
+AIAudioGenerator& generator() {
+    static AIAudioGenerator instance;
+    return instance;
+}
+
+} // namespace
+
+// One stage on its own; arguments: stage (oscillator, filter, envelope,
+// LFO, wavetable), block size. items_per_second is samples per second.
+static void BM_StageProcess(benchmark::State& state) {
+    auto stage = makeStage(state.range(0));
+    const size_t n = state.range(1);
+    AudioBuffer input = noise(n), output(n);
+    
+    for (auto _ : state) {
+        stage->process(input, output);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetLabel(kStageNames[state.range(0)]);
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_StageProcess)->ArgsProduct({{0, 1, 2, 3, 4}, {64, 512, 4096}});
+
+// Saw -> filter with an LFO sweeping the cutoff, 512-sample blocks;
+// argument: control interval (1 = new coefficients every sample)
+static void BM_ModulatedFilter(benchmark::State& state) {
+    DSPGraph graph;
+    auto osc = std::make_unique<OscillatorStage>();
+    osc->setParameter("waveType", std::string("saw"));
+    osc->setParameter("frequency", 110.0);
+    graph.addStage("osc", std::move(osc));
+    auto filter = std::make_unique<FilterStage>();
+    filter->setParameter("cutoff", 2000.0);
+    graph.addStage("filter", std::move(filter));
+    auto lfo = std::make_unique<LFOStage>();
+    lfo->setParameter("rate", 2.0);
+    graph.addStage("lfo", std::move(lfo));
+    graph.addConnection({"osc", "filter"});
+    graph.addConnection({"lfo", "filter", "cutoff", 3000.0});
+    graph.setControlInterval(state.range(0));
+    
+    AudioBuffer input(512, 0.0f), output(512);
+    for (auto _ : state) {
+        graph.process(input, output);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetItemsProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_ModulatedFilter)->Arg(1)->Arg(8)->Arg(32)->Arg(128);
+
+// Every sound of a shipped library file as a graph, one block each per
+// iteration; argument: file (guitar, group, electronic_track)
+static void BM_LibraryGraphs(benchmark::State& state) {
+    std::vector<DSPGraph> graphs;
+    try {
+        graphs = loadLibrary(kLibraryFiles[state.range(0)]);
+    } catch (const std::exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    AudioBuffer input(kBlockSize, 0.0f), output;
+    size_t stages = 0;
+    for (auto& graph : graphs) {
+        graph.prepare(kBlockSize);
+        stages += graph.getStageNames().size();
+    }
+    
+    for (auto _ : state) {
+        for (auto& graph : graphs) {
+            graph.process(input, output);
+            benchmark::DoNotOptimize(output.data());
+        }
+    }
+    state.SetLabel(std::string(kLibraryFiles[state.range(0)]) + ", " + std::to_string(graphs.size()) + " graphs");
+    state.counters["stages"] = static_cast<double>(stages);
+    state.SetItemsProcessed(state.iterations() * graphs.size() * kBlockSize);
+}
+BENCHMARK(BM_LibraryGraphs)->DenseRange(0, static_cast<int>(kLibraryFiles.size()) - 1);
+
+// End-to-end generate(); arguments: seconds of audio, render cache hit.
+// xRealtime is seconds of audio per second of wall time.
+static void BM_Generate(benchmark::State& state) {
+    AIAudioGenerator::GenerationRequest request;
+    request.prompt = "warm evolving pad";
+    request.role = Role::PAD;
+    request.durationSeconds = static_cast<double>(state.range(0));
+    request.useRenderCache = state.range(1) != 0;
+    if (request.useRenderCache) generator().generate(request);
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(generator().generate(request));
+    }
+    state.SetLabel(request.useRenderCache ? "cached" : "render");
+    state.counters["xRealtime"] = benchmark::Counter(
+        static_cast<double>(state.iterations()) * request.durationSeconds, benchmark::Counter::kIsRate);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Generate)->Args({1, 0})->Args({8, 0})->Args({8, 1})->Unit(benchmark::kMillisecond);
+
+// Cost of one timed scope around an empty body; argument: sampling period
+// (0 = timers off). Compare with BM_StageProcess to size the overhead per block.
+static void BM_ScopedTimer(benchmark::State& state) {
+    MetricsRegistry registry;
+    LatencyHistogram& histogram = registry.histogram("bench_scope_seconds", "Bench scopes");
+    const int64_t period = state.range(0);
+    MetricsRegistry::global().setSamplingRate(period == 0 ? 0.0 : 1.0 / period);
+    
+    for (auto _ : state) {
+        ScopedTimer timer(histogram);
+        benchmark::ClobberMemory();
+    }
+    MetricsRegistry::global().setSamplingRate(1.0);
+    state.SetLabel(period == 0 ? "off" : "1/" + std::to_string(period));
+}
+BENCHMARK(BM_ScopedTimer)->Arg(0)->Arg(1)->Arg(64);
@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include "roles_policies.h"
+#include <random>
+#include <vector>
+
+using namespace aiaudio;
+
+namespace {
+
+// Four oscillator -> filter voices into one envelope
+DSPGraph benchGraph() {
+    DSPGraph graph;
+    graph.addStage("env", std::make_unique<EnvelopeStage>());
+    for (int i = 0; i < 4; ++i) {
+        auto osc = std::make_unique<OscillatorStage>();
+        osc->setParameter("frequency", 220.0 * (i + 1));
+        auto filter = std::make_unique<FilterStage>();
+        filter->setParameter("cutoff", 1500.0 * (i + 1));
+        const std::string oscName = "osc" + std::to_string(i), filterName = "filter" + std::to_string(i);
+        graph.addStage(oscName, std::move(osc));
+        graph.addStage(filterName, std::move(filter));
+        graph.addConnection({oscName, filterName});
+        graph.addConnection({filterName, "env"});
+    }
+    return graph;
+}
+
+RolePolicy benchPolicy() {
+    RolePolicy policy;
+    policy.role = Role::BASS;
+    auto range = [&](const std::string& name, double minVal, double maxVal) {
+        PolicyConstraint constraint;
+        constraint.type = ConstraintType::RANGE;
+        constraint.parameter = name;
+        constraint.range = {minVal, maxVal};
+        policy.constraints[name] = constraint;
+    };
+    range("frequency", 30.0, 600.0);
+    range("amplitude", 0.0, 0.8);
+    range("cutoff", 40.0, 2500.0);
+    range("resonance", 0.0, 0.7);
+    range("attack", 0.001, 0.05);
+    range("release", 0.05, 1.0);
+    return policy;
+}
+
+} // namespace
+
+// Policy score per candidate parameter set; argument: 0 = set the candidate
+// on the graph and score the graph (binding the policy every call),
+// 1 = compiled batch scoring
+static void BM_PolicyScore(benchmark::State& state) {
+    constexpr size_t kCandidates = 1024;
+    DSPGraph graph = benchGraph();
+    RolePolicy policy = benchPolicy();
+    PolicyEngine engine;
+    CompiledPolicy compiled = PolicyCompiler().compileForGraph(policy, graph);
+    
+    const std::vector<double> base = compiled.gatherParameters(graph);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> jitter(0.7, 1.3);
+    std::vector<double> candidates;
+    for (size_t c = 0; c < kCandidates; ++c) {
+        for (double value : base) candidates.push_back(value * jitter(rng));
+    }
+    std::vector<double> scores(kCandidates);
+    const size_t stride = base.size();
+    
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            for (size_t c = 0; c < kCandidates; ++c) {
+                compiled.scatterParameters(graph, std::span<const double>(candidates.data() + c * stride, stride));
+                scores[c] = engine.computePolicyScore(graph, policy);
+            }
+        } else {
+            engine.computePolicyScores(compiled, candidates, scores);
+        }
+        benchmark::DoNotOptimize(scores.data());
+    }
+    state.SetLabel(state.range(0) == 0 ? "graph" : "compiled batch");
+    state.SetItemsProcessed(state.iterations() * kCandidates);
+}
+BENCHMARK(BM_PolicyScore)->Arg(0)->Arg(1);
@@ -0,0 +1,246 @@
+#include <benchmark/benchmark.h>
+#include "simd_kernels.h"
+#include "audio_stats.h"
+#include "meters.h"
+#include "spectral.h"
+#include "voice_pool.h"
+#include <algorithm>
+#include <complex>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace aiaudio;
+
+namespace {
+
+// Benchmark arguments: block size, kernel level
+void kernelArgs(benchmark::internal::Benchmark* b) {
+    for (int level : {static_cast<int>(SIMDLevel::SCALAR), static_cast<int>(detectSIMDLevel())}) {
+        for (int blockSize : {64, 512, 4096}) {
+            b->Args({blockSize, level});
+        }
+    }
+}
+
+const SIMDKernels& kernelsFor(const benchmark::State& state) {
+    return getSIMDKernels(static_cast<SIMDLevel>(state.range(1)));
+}
+
+// Oscillator -> filter -> envelope, the usual voice patch
+DSPGraph voicePatch() {
+    DSPGraph patch;
+    patch.addStage("osc1", std::make_unique<OscillatorStage>());
+    patch.addStage("filter1", std::make_unique<FilterStage>());
+    patch.addStage("env1", std::make_unique<EnvelopeStage>());
+    patch.addConnection({"osc1", "filter1"});
+    patch.addConnection({"filter1", "env1"});
+    return patch;
+}
+
+AudioBuffer noise(size_t n, unsigned seed = 42) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    AudioBuffer buffer(n);
+    for (auto& sample : buffer) sample = dist(rng);
+    return buffer;
+}
+
+void labelState(benchmark::State& state, const SIMDKernels& kernels) {
+    state.SetLabel(simdLevelName(kernels.level));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+static void BM_SineOscillator(benchmark::State& state) {
+    const SIMDKernels& kernels = kernelsFor(state);
+    const size_t n = state.range(0);
+    AudioBuffer input(n, 0.0f), output(n);
+    double phase = 0.0;
+    const double increment = 2.0 * M_PI * 440.0 / 44100.0;
+    
+    for (auto _ : state) {
+        kernels.sineOscillator(input.data(), output.data(), n, phase, increment, 0.0, 0.5);
+        benchmark::DoNotOptimize(output.data());
+    }
+    labelState(state, kernels);
+}
+BENCHMARK(BM_SineOscillator)->Apply(kernelArgs);
+
+static void BM_BiquadStereo(benchmark::State& state) {
+    const SIMDKernels& kernels = kernelsFor(state);
+    const size_t n = state.range(0);
+    AudioBuffer left = noise(n, 1), right = noise(n, 2);
+    AudioBuffer outLeft(n), outRight(n);
+    const Sample* in[2] = {left.data(), right.data()};
+    Sample* out[2] = {outLeft.data(), outRight.data()};
+    BiquadCoefficients k{0.0675, 0.135, 0.0675, -1.143, 0.413};
+    BiquadState biquadState[2];
+    
+    for (auto _ : state) {
+        kernels.biquad(in, out, 2, n, k, biquadState);
+        benchmark::DoNotOptimize(outLeft.data());
+        benchmark::DoNotOptimize(outRight.data());
+    }
+    labelState(state, kernels);
+}
+BENCHMARK(BM_BiquadStereo)->Apply(kernelArgs);
+
+static void BM_GainAndClamp(benchmark::State& state) {
+    const SIMDKernels& kernels = kernelsFor(state);
+    const size_t n = state.range(0);
+    AudioBuffer buffer = noise(n);
+    
+    for (auto _ : state) {
+        kernels.applyGain(buffer.data(), n, 1.0001f);
+        kernels.clampSymmetric(buffer.data(), n, 0.99f);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    labelState(state, kernels);
+}
+BENCHMARK(BM_GainAndClamp)->Apply(kernelArgs);
+
+static void BM_PeakAndEnergy(benchmark::State& state) {
+    const SIMDKernels& kernels = kernelsFor(state);
+    const size_t n = state.range(0);
+    AudioBuffer buffer = noise(n);
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernels.peakAbs(buffer.data(), n));
+        benchmark::DoNotOptimize(kernels.sumSquares(buffer.data(), n));
+    }
+    labelState(state, kernels);
+}
+BENCHMARK(BM_PeakAndEnergy)->Apply(kernelArgs);
+
+static void BM_SampleStats(benchmark::State& state) {
+    const SIMDKernels& kernels = kernelsFor(state);
+    const size_t n = state.range(0);
+    AudioBuffer buffer = noise(n);
+    SampleStats stats;
+    
+    for (auto _ : state) {
+        kernels.sampleStats(buffer.data(), n, kSilenceThreshold, stats);
+        benchmark::DoNotOptimize(stats);
+    }
+    labelState(state, kernels);
+}
+BENCHMARK(BM_SampleStats)->Apply(kernelArgs);
+
+// Whole-render analysis (moments plus K-weighted loudness) at the
+// generator's default length; argument: seconds
+static void BM_AnalyzeAudio(benchmark::State& state) {
+    const size_t n = state.range(0) * 44100;
+    AudioBuffer buffer = noise(n);
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(analyzeAudio(buffer));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_AnalyzeAudio)->Arg(1)->Arg(8)->Unit(benchmark::kMicrosecond);
+
+// Streaming meters fed one render block at a time; argument: block size
+static void BM_StreamingMeters(benchmark::State& state) {
+    const size_t n = state.range(0);
+    AudioBuffer block = noise(n);
+    LoudnessMeter loudness;
+    TruePeakMeter truePeak;
+    
+    for (auto _ : state) {
+        loudness.process(block);
+        truePeak.process(block);
+        benchmark::DoNotOptimize(loudness.getMomentary());
+        benchmark::DoNotOptimize(truePeak.getTruePeak());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_StreamingMeters)->Arg(64)->Arg(512)->Arg(1024);
+
+// One real FFT; argument: size
+static void BM_RealFFT(benchmark::State& state) {
+    const size_t size = state.range(0);
+    auto plan = FFTPlan::get(size);
+    AudioBuffer frame = noise(size);
+    std::vector<std::complex<float>> spectrum(plan->bins());
+    
+    for (auto _ : state) {
+        plan->forward(frame.data(), spectrum.data());
+        benchmark::DoNotOptimize(spectrum.data());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_RealFFT)->Arg(512)->Arg(1024)->Arg(2048);
+
+// Multiresolution analysis of two renders plus both losses; arguments:
+// seconds, parallel frames
+static void BM_MultiresSTFTLoss(benchmark::State& state) {
+    const size_t n = state.range(0) * 44100;
+    AudioBuffer reference = noise(n, 1), generated = noise(n, 2);
+    SpectralAnalysis::Options options;
+    options.parallel = state.range(1) != 0;
+    
+    for (auto _ : state) {
+        SpectralAnalysis a(reference, 44100.0, options);
+        SpectralAnalysis b(generated, 44100.0, options);
+        benchmark::DoNotOptimize(multiresSTFTLoss(a, b) + barkLoudnessError(a, b));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_MultiresSTFTLoss)->Args({1, 0})->Args({1, 1})->Args({8, 1})->Unit(benchmark::kMillisecond);
+
+// One 512-sample block of a 32-voice pool; argument: sounding notes
+static void BM_VoicePool(benchmark::State& state) {
+    const size_t notes = state.range(0);
+    VoicePool::Options options;
+    options.maxVoices = 32;
+    VoicePool pool(voicePatch(), options);
+    for (size_t v = 0; v < notes; ++v) pool.noteOn(48 + static_cast<int>(v));
+    AudioBuffer block(512);
+    
+    for (auto _ : state) {
+        pool.process(block);
+        benchmark::DoNotOptimize(block.data());
+    }
+    state.SetItemsProcessed(state.iterations() * block.size() * std::max<size_t>(1, notes));
+}
+BENCHMARK(BM_VoicePool)->Arg(0)->Arg(1)->Arg(8)->Arg(32);
+
+// Baseline: one cloned graph per note, summed; argument: sounding notes
+static void BM_GraphPerNote(benchmark::State& state) {
+    const size_t notes = state.range(0);
+    DSPGraph patch = voicePatch();
+    std::vector<std::unique_ptr<DSPGraph>> graphs;
+    for (size_t v = 0; v < notes; ++v) {
+        graphs.push_back(patch.clone());
+        graphs.back()->getStage("osc1")->setParameterValue(OscillatorStage::FREQUENCY,
+                                                           440.0 * std::pow(2.0, (48.0 + v - 69.0) / 12.0));
+        graphs.back()->prepare(512);
+    }
+    AudioBuffer silence(512, 0.0f), rendered, block(512);
+    
+    for (auto _ : state) {
+        std::fill(block.begin(), block.end(), 0.0f);
+        for (auto& graph : graphs) {
+            graph->process(silence, rendered);
+            for (size_t i = 0; i < block.size(); ++i) block[i] += rendered[i];
+        }
+        benchmark::DoNotOptimize(block.data());
+    }
+    state.SetItemsProcessed(state.iterations() * block.size() * notes);
+}
+BENCHMARK(BM_GraphPerNote)->Arg(1)->Arg(8)->Arg(32);
+
+static void BM_DotProduct(benchmark::State& state) {
+    const SIMDKernels& kernels = kernelsFor(state);
+    const size_t n = state.range(0);
+    AudioBuffer a = noise(n, 1), b = noise(n, 2);
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kernels.dotProduct(a.data(), b.data(), n));
+    }
+    labelState(state, kernels);
+}
+BENCHMARK(BM_DotProduct)->Apply(kernelArgs);
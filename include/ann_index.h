@@ -0,0 +1,118 @@
+#pragma once
+
+#include "core_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace aiaudio {
+
+// Approximate nearest-neighbour backends for SemanticSearchEngine
+
+// Read-only view of the engine's flat matrix of unit-length rows
+struct VectorMatrixView {
+    const float* data = nullptr;
+    const Role* roles = nullptr;
+    size_t rows = 0;
+    size_t dimension = 0;
+    
+    const float* row(size_t r) const { return data + r * dimension; }
+};
+
+// Backend interface. The index only stores row numbers; vectors stay in the
+// engine's matrix, which also re-scores the candidates exactly, so an index
+// trades recall for speed but never changes a returned score.
+class ANNIndex {
+public:
+    virtual ~ANNIndex() = default;
+    
+    // Drop everything and index all rows of the matrix
+    virtual void rebuild(const VectorMatrixView& matrix) = 0;
+    
+    // Row was appended or overwritten
+    virtual void insert(const VectorMatrixView& matrix, size_t row) = 0;
+    
+    // Row was removed; the engine then moves its last row into the hole
+    virtual void erase(size_t row) = 0;
+    virtual void renumber(size_t from, size_t to) = 0;
+    
+    virtual void clear() = 0;
+    
+    // Append candidate rows for query to out. Only rows of the given role
+    // are returned (UNKNOWN = any), and at least minCandidates of them when
+    // the role has that many, so filtering cannot starve the top-k.
+    virtual void collectCandidates(const VectorMatrixView& matrix,
+                                   const float* query,
+                                   Role role,
+                                   size_t minCandidates,
+                                   std::vector<size_t>& out) const = 0;
+    
+    virtual std::string getName() const = 0;
+};
+
+// Inverted-file index: spherical k-means centroids partition the rows and a
+// query scans only the nprobe closest lists. Each list is split by role, so a
+// role filter skips foreign rows instead of discarding them after the scan.
+class IVFIndex : public ANNIndex {
+public:
+    struct Params {
+        size_t nlist = 0;             // Lists; 0 = sqrt(rows) at training time
+        size_t nprobe = 8;            // Lists scanned per query (recall vs latency)
+        size_t minTrainSize = 1024;   // Exact scan below this many rows
+        size_t trainSamplesPerList = 64;
+        size_t kmeansIterations = 10;
+        unsigned seed = 42;
+    };
+    
+    IVFIndex();
+    explicit IVFIndex(const Params& params);
+    
+    void rebuild(const VectorMatrixView& matrix) override;
+    void insert(const VectorMatrixView& matrix, size_t row) override;
+    void erase(size_t row) override;
+    void renumber(size_t from, size_t to) override;
+    void clear() override;
+    
+    void collectCandidates(const VectorMatrixView& matrix,
+                           const float* query,
+                           Role role,
+                           size_t minCandidates,
+                           std::vector<size_t>& out) const override;
+    
+    std::string getName() const override { return "ivf"; }
+    
+    // Recall/latency knob, may be changed between queries
+    void setNProbe(size_t nprobe) { params_.nprobe = nprobe; }
+    size_t getNProbe() const { return params_.nprobe; }
+    
+    // Train centroids on the current rows and reassign all of them
+    void train(const VectorMatrixView& matrix);
+    
+    bool isTrained() const { return !centroids_.empty(); }
+    size_t getListCount() const { return isTrained() ? centroids_.size() / dimension_ : 1; }
+    
+private:
+    static constexpr size_t kNumRoles = static_cast<size_t>(Role::UNKNOWN) + 1;
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+    
+    // Where a row lives: postings_[posting][position]
+    struct Slot {
+        uint32_t posting = kNoSlot;
+        uint32_t position = 0;
+    };
+    
+    Params params_;
+    size_t dimension_ = 0;
+    size_t trainedRows_ = 0;
+    std::vector<float> centroids_;               // nlist x dimension
+    std::vector<std::vector<size_t>> postings_;  // (list, role) -> rows
+    std::vector<Slot> slots_;                    // row -> posting slot
+    
+    size_t nearestList(const float* vector) const;
+    void assign(size_t row, size_t list, Role role);
+    void runKMeans(const VectorMatrixView& matrix, size_t nlist);
+};
+
+} // namespace aiaudio
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core_types.h"
+#include "audio_stats.h"
 #include "dsp_ir.h"
 #include <vector>
 #include <memory>
@@ -109,6 +110,7 @@ class AudioValidator {
 public:
     // Validate audio for safety
     static std::vector<std::string> validateAudio(const AudioBuffer& audio);
+    static std::vector<std::string> validateAudio(const AudioStats& stats);
     
     // Check for common audio issues
     static std::vector<std::string> checkAudioIssues(const AudioBuffer& audio);
@@ -120,10 +122,11 @@ public:
     static std::vector<std::string> checkParameterViolations(const DSPGraph& graph);
     
 private:
-    static bool checkClipping(const AudioBuffer& audio);
-    static bool checkDCOffset(const AudioBuffer& audio);
-    static bool checkSilence(const AudioBuffer& audio);
-    static bool checkDenormals(const AudioBuffer& audio);
+    static bool checkClipping(const AudioStats& stats);
+    static bool checkDCOffset(const AudioStats& stats);
+    static bool checkSilence(const AudioStats& stats);
+    static bool checkDenormals(const AudioStats& stats);
+    static bool checkNonFinite(const AudioStats& stats);
     static bool checkParameterRanges(const DSPGraph& graph);
 };
 
@@ -143,12 +146,13 @@ public:
         double headroom;
     };
     static SafetyMetrics getSafetyMetrics(const AudioBuffer& audio);
+    static SafetyMetrics getSafetyMetrics(const AudioStats& stats);
     
     // Check safety thresholds
     static bool checkSafetyThresholds(const SafetyMetrics& metrics);
     
 private:
-    static SafetyMetrics calculateSafetyMetrics(const AudioBuffer& audio);
+    static SafetyMetrics calculateSafetyMetrics(const AudioStats& stats);
     static bool isWithinThresholds(const SafetyMetrics& metrics);
 };
 
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "core_types.h"
+#include "simd_kernels.h"
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace aiaudio {
+
+class SpectralAnalysis;
+
+// One-pass analysis of a rendered buffer. The evaluator, quality assessor and
+// validators all read from AudioStats instead of walking the buffer again.
+
+// Samples quieter than this (-80 dBFS) count towards AudioStats::silentSamples
+constexpr Sample kSilenceThreshold = 1e-4f;
+
+// Integrated loudness floor and BS.1770 absolute gate, in LUFS
+constexpr double kLoudnessFloor = -70.0;
+
+// Frame size of the standalone spectral centroid; frames do not overlap
+constexpr size_t kCentroidFFTSize = 2048;
+
+struct AudioStats {
+    size_t samples = 0;
+    double sampleRate = 44100.0;
+    
+    double peak = 0.0;            // Sample peak, linear
+    double truePeak = 0.0;        // 4x oversampled (TruePeakMeter), linear
+    double rms = 0.0;
+    double dcOffset = 0.0;        // Mean sample value
+    double variance = 0.0;
+    double crestFactorDb = 0.0;   // Peak over RMS; 0 for silence
+    
+    double spectralCentroid = 0.0;  // Hz, from the STFT (SpectralAnalysis)
+    
+    size_t clippedSamples = 0;    // |x| >= 1
+    size_t denormalSamples = 0;
+    size_t nonFiniteSamples = 0;  // NaN or +-inf, left out of every other field
+    size_t silentSamples = 0;     // |x| < kSilenceThreshold
+    size_t zeroCrossings = 0;
+    
+    // K-weighted mean square of each complete 100 ms block, and the BS.1770
+    // gated loudness over 400 ms windows of them. Buffers shorter than one
+    // window report their ungated loudness.
+    std::vector<double> loudnessBlocks;
+    double integratedLoudness = kLoudnessFloor;
+    
+    double peakDb() const;
+    double truePeakDb() const;    // dBTP
+    double rmsDb() const;
+    double zeroCrossingRate() const;  // Crossings per second
+};
+
+// Fused statistics and K-weighted loudness of a mono buffer
+AudioStats analyzeAudio(const AudioBuffer& audio, double sampleRate = 44100.0);
+
+// Same, taking the spectral centroid from an existing analysis of audio
+// instead of running a 2048-point STFT
+AudioStats analyzeAudio(const AudioBuffer& audio, const SpectralAnalysis& spectra);
+
+// The AudioStats fields that follow from sampleStats moments alone: levels,
+// DC, variance, crest factor and the sample counts
+AudioStats statsFromMoments(const SampleStats& moments, size_t samples, double sampleRate);
+
+// BS.1770 K-weighting prefilter at sampleRate: high shelf, then high-pass
+std::array<BiquadCoefficients, 2> kWeightingFilter(double sampleRate);
+
+} // namespace aiaudio
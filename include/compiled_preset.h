@@ -0,0 +1,97 @@
+#pragma once
+
+#include "core_types.h"
+#include "dsp_ir.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace aiaudio {
+
+class ThreadPool;
+
+// Compiled presets: a validated DSPGraph in a compact binary form. Stages are
+// stored in execution order as their type plus the indexed parameter values
+// (enums as ordinals), followed by the connection list, so loading builds the
+// graph through setParameterValue without JSON parsing, name lookups or a
+// second validation pass. JSON stays the authoring format.
+
+constexpr const char* kCompiledPresetExtension = ".aipreset";
+
+// FNV-1a of the JSON source, stamped into compiled files so caches can tell
+// whether they are stale
+uint64_t presetSourceHash(const std::string& jsonData);
+
+// Serialize a graph; throws AIAudioException listing the validate() issues
+// when the graph does not pass
+std::vector<uint8_t> compilePreset(const DSPGraph& graph, uint64_t sourceHash = 0);
+
+// Parse, validate and serialize a JSON preset
+std::vector<uint8_t> compilePresetJSON(const std::string& jsonData);
+
+// Rebuild the graph; malformed or corrupt data throws, naming source
+std::unique_ptr<DSPGraph> loadCompiledPreset(const uint8_t* data, size_t size,
+                                             const std::string& source = "compiled preset");
+std::unique_ptr<DSPGraph> loadCompiledPreset(const std::string& path);
+
+// Source hash from a compiled preset header; false when the bytes do not
+// start with a header of the current version (the body is not checked)
+bool readCompiledSourceHash(const uint8_t* data, size_t size, uint64_t& sourceHash);
+
+// A JSON preset file, or a compiled one when the path ends in
+// kCompiledPresetExtension
+std::unique_ptr<DSPGraph> loadPresetFile(const std::string& path);
+
+// Write aside and rename, so readers never see a partial file
+void writeCompiledPreset(const std::vector<uint8_t>& bytes, const std::string& path);
+
+// Bulk loader for a preset directory. Every *.json file loads in parallel;
+// each goes through a compiled copy in the cache directory, which is reused
+// while its source hash matches and rebuilt otherwise. One bad preset is
+// reported in its entry and does not stop the others.
+class PresetLibrary {
+public:
+    struct Options {
+        std::string cacheDirectory;                // Empty = <directory>/.preset_cache
+        bool useCache = true;
+        bool parallel = true;
+        std::shared_ptr<ThreadPool> threadPool;    // nullptr = ThreadPool::shared()
+    };
+    
+    struct Entry {
+        std::string path;
+        std::unique_ptr<DSPGraph> graph;
+        bool fromCache = false;                     // Loaded without parsing JSON
+        std::string error;                          // Set when graph is null
+        
+        bool ok() const { return graph != nullptr; }
+    };
+    
+    struct LoadStats {
+        size_t files = 0;
+        size_t fromCache = 0;
+        size_t compiled = 0;                        // Parsed from JSON
+        size_t failed = 0;
+        double wallSeconds = 0.0;
+        std::vector<std::string> errors;            // "path: message" per failure
+    };
+    
+    PresetLibrary();
+    explicit PresetLibrary(const Options& options);
+    
+    // Entries sorted by path; throws only when the directory cannot be read
+    std::vector<Entry> loadDirectory(const std::string& directory);
+    
+    // One JSON preset through the cache directory (empty = no cache)
+    static Entry loadFile(const std::string& path, const std::string& cacheDirectory);
+    
+    const LoadStats& getLastLoadStats() const { return lastStats_; }
+    
+private:
+    Options options_;
+    LoadStats lastStats_;
+};
+
+} // namespace aiaudio
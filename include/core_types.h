@@ -18,6 +18,7 @@ namespace aiaudio {
 using Sample = float;
 using AudioBuffer = std::vector<Sample>;
 using StereoBuffer = std::array<AudioBuffer, 2>;
+using PlanarBuffer = std::vector<AudioBuffer>; // One AudioBuffer per channel
 using ComplexSample = std::complex<Sample>;
 
 // Time and frequency types
@@ -136,4 +137,25 @@ inline Percent percentToLinear(Percent p) {
     return Percent{p.value / 100.0};
 }
 
+// Planar <-> interleaved conversion (output must already be sized)
+inline void interleave(const PlanarBuffer& planar, AudioBuffer& interleaved) {
+    const size_t channels = planar.size();
+    for (size_t c = 0; c < channels; ++c) {
+        const AudioBuffer& channel = planar[c];
+        for (size_t i = 0; i < channel.size(); ++i) {
+            interleaved[i * channels + c] = channel[i];
+        }
+    }
+}
+
+inline void deinterleave(const AudioBuffer& interleaved, PlanarBuffer& planar) {
+    const size_t channels = planar.size();
+    for (size_t c = 0; c < channels; ++c) {
+        AudioBuffer& channel = planar[c];
+        for (size_t i = 0; i < channel.size(); ++i) {
+            channel[i] = interleaved[i * channels + c];
+        }
+    }
+}
+
 } // namespace aiaudio
\ No newline at end of file
@@ -1,54 +1,149 @@
 #pragma once
 
 #include "core_types.h"
+#include "dsp_ir.h"
+#include "lru_cache.h"
 #include "semantic_fusion.h"
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <map>
 #include <random>
+#include <span>
+#include <string>
 
 namespace aiaudio {
 
 // Decision Heads (μ) + Routing Masks (R)
 
+// ONNX model interface
+// Backed by ONNX Runtime when built with AIAUDIO_WITH_ONNXRUNTIME; without it
+// loadModel() throws. The model takes one float tensor [batch, features] and
+// returns one [batch, outputs]; a dynamic batch dimension lets a whole batch
+// run as one call.
+// Thread safety: the session is created once by loadModel() and shared, so
+// any number of threads may run inference concurrently. IO bindings are
+// pooled and bind the caller's buffers directly, so no tensors are copied.
+class ONNXModel {
+public:
+    struct Options {
+        int intraOpThreads = 1;    // Threads inside one operator; 0 = runtime default
+        int interOpThreads = 1;    // Threads across independent operators
+        // Tried in order before the CPU fallback: "cuda", "tensorrt", or any
+        // name ONNX Runtime accepts generically (e.g. "XNNPACK", "OpenVINO")
+        std::vector<std::string> executionProviders;
+    };
+    
+    ONNXModel();
+    explicit ONNXModel(const Options& options);
+    ~ONNXModel();
+    
+    ONNXModel(ONNXModel&&) noexcept;
+    ONNXModel& operator=(ONNXModel&&) noexcept;
+    
+    // Whether the ONNX Runtime backend is compiled in
+    static bool isAvailable();
+    
+    // Create the session; throws AIAudioException on any failure
+    void loadModel(const std::string& modelPath);
+    bool isLoaded() const { return session_ != nullptr; }
+    
+    // Run inference
+    std::vector<double> runInference(const std::vector<double>& input) const;
+    
+    // batchSize row-major rows in, batchSize rows of outputs out
+    void runBatch(const float* inputs, size_t batchSize, float* outputs) const;
+    
+    // Get input/output shapes as (batch, features); batch 0 = dynamic
+    std::pair<size_t, size_t> getInputShape() const;
+    std::pair<size_t, size_t> getOutputShape() const;
+    
+    // Quantize model
+    void quantize(int8_t targetPrecision = 8);
+    
+private:
+    struct Session;  // Keeps ONNX Runtime out of this header
+    
+    Options options_;
+    std::unique_ptr<Session> session_;
+};
+
+// Layer activation, applied to each output block right after the GEMM
+enum class Activation {
+    RELU,
+    SIGMOID,
+    TANH,
+    LINEAR
+};
+
 // MLP model for decision making
+// Each layer's weights are one packed row-major (outputs x inputs) float
+// matrix, so a batch of inputs is a small GEMM per layer. Scratch buffers
+// are per thread and only grow, so inference stops allocating once warm.
+// With an ONNX model attached, inference runs on its session instead.
+// Thread safety: forward/forwardBatch only read the weights and may run
+// concurrently; changing weights, quantizing or attaching a model needs
+// exclusive access.
 class DecisionMLP {
 public:
     struct Layer {
-        std::vector<std::vector<double>> weights;
-        std::vector<double> biases;
-        std::string activation; // "relu", "sigmoid", "tanh", "linear"
+        size_t inputs = 0;
+        size_t outputs = 0;
+        std::vector<float> weights;  // outputs x inputs
+        std::vector<float> biases;
+        Activation activation = Activation::LINEAR;
+        
+        float* row(size_t output) { return weights.data() + output * inputs; }
+        const float* row(size_t output) const { return weights.data() + output * inputs; }
     };
     
     // Model architecture
     std::vector<Layer> layers;
-    size_t inputSize;
-    size_t outputSize;
     
     // Initialize model
     DecisionMLP(size_t inputSize, const std::vector<size_t>& hiddenSizes, size_t outputSize);
     
+    size_t getInputSize() const { return inputSize_; }
+    size_t getOutputSize() const { return outputSize_; }
+    
     // Forward pass
     std::vector<double> forward(const std::vector<double>& input) const;
     
-    // Load from ONNX (placeholder)
-    void loadFromONNX(const std::string& modelPath);
+    // Forward pass over batchSize row-major input rows (batchSize x
+    // getInputSize()), writing batchSize x getOutputSize() outputs
+    void forwardBatch(const float* inputs, size_t batchSize, float* outputs) const;
+    
+    // Load from ONNX: inference moves to an ONNX Runtime session and the
+    // input/output sizes follow the model. The packed layers are kept for
+    // training but no longer used by forward().
+    void loadFromONNX(const std::string& modelPath, const ONNXModel::Options& options = {});
+    
+    // Attach an already loaded model, so several MLPs can share one session;
+    // nullptr returns to the packed layers
+    void setONNXModel(std::shared_ptr<const ONNXModel> model);
+    bool usesONNX() const { return onnx_ != nullptr; }
     
     // Save to ONNX (placeholder)
     void saveToONNX(const std::string& modelPath) const;
     
-    // Quantize to int8
+    // Quantize to int8: symmetric weights with one scale per output channel,
+    // activations quantized per row on the fly, int32 accumulation.
+    // The float weights are kept; call again after changing them.
     void quantizeToInt8();
+    void clearQuantization() { quantized_.clear(); }
+    bool isQuantized() const { return !quantized_.empty(); }
     
 private:
-    // Activation functions
-    double relu(double x) const;
-    double sigmoid(double x) const;
-    double tanh(double x) const;
-    double linear(double x) const;
+    struct QuantizedLayer {
+        size_t stride = 0;            // Row length, inputs zero-padded
+        std::vector<int8_t> weights;  // outputs x stride
+        std::vector<float> scales;    // Per output channel
+    };
     
-    // Apply activation
-    double applyActivation(double x, const std::string& activation) const;
+    size_t inputSize_;
+    size_t outputSize_;
+    std::vector<QuantizedLayer> quantized_;  // Parallel to layers when quantized
+    std::shared_ptr<const ONNXModel> onnx_;
     
     // Initialize weights
     void initializeWeights();
@@ -65,6 +160,10 @@ struct DecisionContext {
     
     // Convert to MLP input vector
     std::vector<double> toInputVector() const;
+    
+    // Same encoding written in place, getInputSize() floats
+    size_t getInputSize() const;
+    void writeInputVector(float* out) const;
 };
 
 // Decision output
@@ -77,6 +176,11 @@ struct DecisionOutput {
 };
 
 // Decision heads system
+// Thread safety: inference and mapping hold no mutable state besides the
+// locked binding cache, and the MLP weights are only read, so one instance
+// can serve concurrent requests.
+// applyDecisions writes to the graph it is given, which must be private
+// to the caller.
 class DecisionHeads {
 public:
     // Initialize with model
@@ -85,8 +189,17 @@ public:
     // Make decisions from context
     DecisionOutput infer(const DecisionContext& context) const;
     
-    // Apply decisions to DSP graph
+    // Batched inference: one forward pass over all contexts
+    std::vector<DecisionOutput> inferBatch(std::span<const DecisionContext> contexts) const;
+    
+    const DecisionMLP& getModel() const { return *model_; }
+    
+    // Apply decisions to DSP graph. Each parameter goes to the first stage in
+    // topological order that has it, clamped to that stage's range. The
+    // (stage, index) bindings are resolved once per parameter set and
+    // topology and cached, so repeated calls look up no parameter names.
     void applyDecisions(DSPGraph& graph, const DecisionOutput& decisions) const;
+    CacheStats getBindingCacheStats() const { return bindings_.getStats(); }
     
     // Add jitter for regularization
     DecisionOutput addJitter(const DecisionOutput& decisions, double sigma = 0.01) const;
@@ -105,6 +218,22 @@ public:
 private:
     std::unique_ptr<DecisionMLP> model_;
     
+    // Where one decision parameter lands; stage is empty when no stage has it
+    struct ParameterBinding {
+        std::string stage;
+        int index = -1;
+        ParamRange range;
+    };
+    
+    // Bindings in parameterValues order, per (parameter names, topology)
+    using ParameterBindings = std::vector<ParameterBinding>;
+    mutable LRUCache<uint64_t, std::shared_ptr<const ParameterBindings>> bindings_{256};
+    std::shared_ptr<const ParameterBindings> bindParameters(const DSPGraph& graph,
+                                                            const DecisionOutput& decisions) const;
+    
+    // Model output row -> values, routes and mapped parameters
+    DecisionOutput decodeOutput(const float* output, size_t size, Role role) const;
+    
     // Parameter mapping functions
     double mapValueToParameter(double value, const std::string& paramName, Role role) const;
     std::string getParameterName(size_t valueIndex, Role role) const;
@@ -118,32 +247,30 @@ private:
     std::vector<std::string> getAvailableRoutes(const DSPGraph& graph) const;
 };
 
-// ONNX model interface
-class ONNXModel {
+// Source of training rows for DecisionTrainer. Rows are written straight
+// into the trainer's minibatch buffers, so a data set never has to exist in
+// memory as a whole.
+class TrainingSampleStream {
 public:
-    // Load model from file
-    bool loadModel(const std::string& modelPath);
-    
-    // Run inference
-    std::vector<double> runInference(const std::vector<double>& input) const;
+    virtual ~TrainingSampleStream() = default;
     
-    // Get input/output shapes
-    std::pair<size_t, size_t> getInputShape() const;
-    std::pair<size_t, size_t> getOutputShape() const;
+    virtual size_t getInputSize() const = 0;
+    virtual size_t getTargetSize() const = 0;
     
-    // Quantize model
-    void quantize(int8_t targetPrecision = 8);
+    // Write up to count rows: inputs count x getInputSize(), targets
+    // count x getTargetSize() and one weight per row. Returns the rows
+    // written; 0 once the epoch is exhausted.
+    virtual size_t read(size_t count, float* inputs, float* targets, float* weights) = 0;
     
-private:
-    // ONNX runtime would be used here
-    // This is a placeholder implementation
-    std::vector<std::vector<double>> weights_;
-    std::vector<double> biases_;
-    size_t inputSize_ = 0;
-    size_t outputSize_ = 0;
+    // Start the next epoch
+    virtual void rewind() = 0;
 };
 
 // Decision training system
+// Minibatch SGD with momentum and full backpropagation. Each minibatch is
+// split into shards whose gradients are computed on the shared thread pool
+// and summed before one weight update, so the result does not depend on
+// the number of threads beyond float rounding.
 class DecisionTrainer {
 public:
     struct TrainingData {
@@ -152,10 +279,27 @@ public:
         std::vector<double> weights;
     };
     
+    struct Options {
+        size_t epochs = 100;
+        size_t batchSize = 256;
+        double learningRate = 0.001;
+        double momentum = 0.9;
+        size_t logInterval = 10;   // Epochs between progress lines; 0 = silent
+    };
+    
     // Train decision model
     void trainModel(DecisionMLP& model, const TrainingData& data, 
                    size_t epochs = 100, double learningRate = 0.001) const;
     
+    // Train from a stream; returns the mean weighted loss of every epoch.
+    // Trains the packed layers and drops a stale int8 copy.
+    std::vector<double> trainModel(DecisionMLP& model, TrainingSampleStream& samples,
+                                   const Options& options) const;
+    
+    // Mean weighted squared error over one pass of the stream
+    double evaluateLoss(const DecisionMLP& model, TrainingSampleStream& samples,
+                        size_t batchSize = 256) const;
+    
     // Generate training data from rules
     TrainingData generateFromRules(Role role, size_t numSamples = 1000) const;
     
@@ -164,19 +308,48 @@ public:
     
     // Data augmentation
     TrainingData augmentData(const TrainingData& data, double noiseLevel = 0.1) const;
+};
+
+// Streams an in-memory TrainingData set, reshuffled every epoch. Targets
+// are the values followed by the routes (1 or 0).
+class TrainingDataStream : public TrainingSampleStream {
+public:
+    explicit TrainingDataStream(const DecisionTrainer::TrainingData& data, unsigned seed = 42);
+    
+    size_t getInputSize() const override { return inputSize_; }
+    size_t getTargetSize() const override { return targetSize_; }
+    size_t read(size_t count, float* inputs, float* targets, float* weights) override;
+    void rewind() override;
+    
+private:
+    const DecisionTrainer::TrainingData& data_;
+    size_t inputSize_ = 0;
+    size_t targetSize_ = 0;
+    std::vector<size_t> order_;
+    size_t position_ = 0;
+    std::mt19937 rng_;
+};
+
+// Rule-based samples generated on the fly: numSamples rows per epoch from
+// a seeded generator, optionally with the augmentData() noise applied.
+// rewind() reseeds, so every epoch sees the same rows.
+class RuleSampleStream : public TrainingSampleStream {
+public:
+    RuleSampleStream(Role role, size_t numSamples, size_t queryDimension = 384,
+                     double noiseLevel = 0.0, unsigned seed = 42);
+    
+    size_t getInputSize() const override { return context_.getInputSize(); }
+    size_t getTargetSize() const override;
+    size_t read(size_t count, float* inputs, float* targets, float* weights) override;
+    void rewind() override;
     
 private:
-    // Training helpers
-    double computeLoss(const std::vector<double>& prediction, 
-                      const std::vector<double>& target) const;
-    std::vector<double> computeGradient(const std::vector<double>& prediction,
-                                       const std::vector<double>& target) const;
-    void updateWeights(DecisionMLP& model, const std::vector<double>& gradient, 
-                      double learningRate) const;
-    
-    // Data generation
-    DecisionContext generateRandomContext(Role role) const;
-    DecisionOutput generateTargetFromContext(const DecisionContext& context) const;
+    size_t numSamples_;
+    double noiseLevel_;
+    unsigned seed_;
+    size_t produced_ = 0;
+    std::mt19937 rng_;
+    DecisionContext context_;  // Reused, so generating a row never allocates
 };
 
 // Decision validation and testing
@@ -195,8 +368,9 @@ public:
     double benchmarkDecisions(const DecisionHeads& heads, 
                              const std::vector<DecisionContext>& contexts) const;
     
-    // Test latency requirements
-    bool testLatency(const DecisionHeads& heads, double maxLatencyMs = 1.0) const;
+    // Test latency requirements: a batch of batchSize synthetic contexts
+    // must be inferred within maxLatencyMs
+    bool testLatency(const DecisionHeads& heads, double maxLatencyMs = 1.0, size_t batchSize = 64) const;
     
 private:
     // Validation helpers
@@ -1,15 +1,22 @@
 #pragma once
 
 #include "core_types.h"
+#include "simd_kernels.h"
+#include <limits>
 #include <variant>
 #include <unordered_map>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <functional>
 
 namespace aiaudio {
 
+class ThreadPool;
+
 // DSP Intermediate Representation (IR) System
 
 // Strong typing for units
@@ -63,10 +70,54 @@ enum class StageType {
     MACRO
 };
 
+// Audio-rate oscillators: the naive OscillatorStage and the band-limited
+// WavetableStage (wavetable.h) share parameters and are tuned alike
+inline bool isOscillatorType(StageType type) {
+    return type == StageType::OSCILLATOR || type == StageType::WAVETABLE;
+}
+
+// Oscillator and LFO waveforms
+enum class Waveform {
+    SINE,
+    SAW,
+    SQUARE,
+    TRIANGLE
+};
+
+// Biquad filter responses
+enum class FilterType {
+    LOWPASS,
+    HIGHPASS,
+    BANDPASS
+};
+
+// Preset names for the enums above; unknown names throw
+Waveform parseWaveform(const std::string& name);
+std::string waveformName(Waveform waveform);
+FilterType parseFilterType(const std::string& name);
+std::string filterTypeName(FilterType type);
+
+// output = waveform * gain + input over n samples, advancing phase (radians)
+// by increment per sample. Sine uses the vector kernel when kernels is set.
+void renderOscillator(Waveform waveform, const Sample* input, Sample* output, size_t n,
+                      double& phase, double increment, double phaseOffset, double gain,
+                      const SIMDKernels* kernels = nullptr);
+
 // Parameter types
 using ParamValue = std::variant<double, int, bool, std::string>;
 using ParamMap = std::unordered_map<std::string, ParamValue>;
 
+// Valid values of an indexed parameter (enums: ordinal 0 .. count - 1)
+struct ParamRange {
+    double min = -std::numeric_limits<double>::infinity();
+    double max = std::numeric_limits<double>::infinity();
+};
+
+// Position of name in a stage's parameter-name table, or -1. Built-in
+// stages keep their names in static tables and resolve through this, so
+// getParameterIndex neither allocates nor builds getParameterNames().
+int findParameterIndex(std::span<const std::string_view> names, std::string_view name);
+
 // Base stage interface
 class DSPStage {
 public:
@@ -78,57 +129,157 @@ public:
     virtual std::vector<std::string> getParameterNames() const = 0;
     virtual void reset() = 0;
     virtual std::string getDescription() const = 0;
+    
+    // Indexed numeric parameter access for automation and modulation. Indices
+    // follow getParameterNames(); resolve once with getParameterIndex (-1 if
+    // unknown) and keep strings off the per-block path.
+    virtual int getParameterIndex(const std::string& name) const;
+    virtual void setParameterValue(int index, double value);
+    virtual double getParameterValue(int index) const;
+    virtual ParamRange getParameterRange(int /*index*/) const { return {}; }
+    
+    // Control-rate update: the parameter reaches value over the next frames
+    // samples. The default sets it at once; stages that would click on a
+    // step (filter coefficients, gains) ramp to it instead.
+    virtual void setParameterTarget(int index, double value, size_t frames);
+    
+    // Modulation sources (LFOs, envelopes) advance by frames samples, gated
+    // by gate, and return their control value at the end of the tick; zero
+    // frames reads the current value without advancing
+    virtual bool isControlSource() const { return false; }
+    virtual double advanceControl(size_t /*frames*/, bool /*gate*/) { return 0.0; }
+    
+    // Rate the stage runs at; set by the owning graph
+    virtual void setSampleRate(double /*sampleRate*/) {}
+    
+    // Multichannel processing on planar buffers. The default runs the mono
+    // kernel per channel, which is only correct for stateless stages; stateful
+    // stages override it to share coefficients and keep per-channel state.
+    virtual void processChannels(const PlanarBuffer& input, PlanarBuffer& output);
+    
+    // Size per-channel state ahead of processChannels (called from prepare)
+    virtual void prepareChannels(size_t /*numChannels*/) {}
+    
+    // Independent copy with the same parameters and state
+    virtual std::unique_ptr<DSPStage> clone() const = 0;
+    
+    // Switch hot loops to vectorized kernels; nullptr restores the scalar path
+    virtual void setKernels(const SIMDKernels* /*kernels*/) {}
 };
 
 // Specific stage implementations
 class OscillatorStage : public DSPStage {
 public:
+    enum Param : int { FREQUENCY, AMPLITUDE, PHASE, WAVE_TYPE };
+    
     OscillatorStage();
     StageType getType() const override { return StageType::OSCILLATOR; }
     void process(const AudioBuffer& input, AudioBuffer& output) override;
+    void processChannels(const PlanarBuffer& input, PlanarBuffer& output) override;
     void setParameter(const std::string& name, const ParamValue& value) override;
     ParamValue getParameter(const std::string& name) const override;
+    void setParameterValue(int index, double value) override;
+    double getParameterValue(int index) const override;
     std::vector<std::string> getParameterNames() const override;
+    int getParameterIndex(const std::string& name) const override;
     void reset() override;
     std::string getDescription() const override;
+    std::unique_ptr<DSPStage> clone() const override { return std::make_unique<OscillatorStage>(*this); }
+    void setKernels(const SIMDKernels* kernels) override { kernels_ = kernels; }
+    ParamRange getParameterRange(int index) const override;
+    void setParameterTarget(int index, double value, size_t frames) override;
+    void setSampleRate(double sampleRate) override { sampleRate_ = sampleRate; }
     
 private:
     RangedParam<Hz> frequency_{440.0, 20.0, 20000.0, "frequency"};
     RangedParam<Percent> amplitude_{0.5, 0.0, 1.0, "amplitude"};
     RangedParam<Percent> phase_{0.0, 0.0, 1.0, "phase"};
-    std::string waveType_ = "sine";
+    Waveform waveform_ = Waveform::SINE;
     double phaseAccumulator_ = 0.0;
     double sampleRate_ = 44100.0;
+    const SIMDKernels* kernels_ = nullptr;
+    
+    // Amplitude ramp: gain of the last rendered sample and samples left to
+    // reach amplitude_
+    double rampGain_ = 0.0;
+    size_t rampRemaining_ = 0;
+    bool hasGain_ = false;
 };
 
 class FilterStage : public DSPStage {
 public:
+    enum Param : int { CUTOFF, RESONANCE, FILTER_TYPE };
+    
     FilterStage();
     StageType getType() const override { return StageType::FILTER; }
     void process(const AudioBuffer& input, AudioBuffer& output) override;
+    void processChannels(const PlanarBuffer& input, PlanarBuffer& output) override;
+    void prepareChannels(size_t numChannels) override;
     void setParameter(const std::string& name, const ParamValue& value) override;
     ParamValue getParameter(const std::string& name) const override;
+    void setParameterValue(int index, double value) override;
+    double getParameterValue(int index) const override;
     std::vector<std::string> getParameterNames() const override;
+    int getParameterIndex(const std::string& name) const override;
     void reset() override;
     std::string getDescription() const override;
+    std::unique_ptr<DSPStage> clone() const override { return std::make_unique<FilterStage>(*this); }
+    void setKernels(const SIMDKernels* kernels) override { kernels_ = kernels; }
+    ParamRange getParameterRange(int index) const override;
+    void setParameterTarget(int index, double value, size_t frames) override;
+    void setSampleRate(double sampleRate) override { sampleRate_ = sampleRate; }
+    
+    // Normalized biquad coefficients, shared by every channel
+    BiquadCoefficients computeCoefficients() const;
     
 private:
     RangedParam<Hz> cutoff_{1000.0, 20.0, 20000.0, "cutoff"};
     RangedParam<Ratio> resonance_{0.1, 0.0, 0.99, "resonance"};
-    std::string filterType_ = "lowpass";
-    double x1_ = 0.0, x2_ = 0.0, y1_ = 0.0, y2_ = 0.0; // State variables
+    FilterType filterType_ = FilterType::LOWPASS;
+    double sampleRate_ = 44100.0;
+    BiquadState state_;
+    
+    const SIMDKernels* kernels_ = nullptr;
+    
+    // Per-channel state for processChannels
+    std::vector<BiquadState> channelState_;
+    
+    // Coefficients of the parameters in coefficientKey_, recomputed only
+    // when one of them changes
+    BiquadCoefficients coefficients_;
+    std::array<double, 4> coefficientKey_{};
+    bool hasCoefficients_ = false;
+    
+    // Coefficient ramp: coefficients in use and samples left to reach the
+    // current parameters
+    BiquadCoefficients rampCoefficients_;
+    size_t rampRemaining_ = 0;
+    
+    std::array<double, 4> coefficientParameters() const;
+    const BiquadCoefficients& coefficients();
 };
 
 class EnvelopeStage : public DSPStage {
 public:
+    enum Param : int { ATTACK, DECAY, SUSTAIN, RELEASE };
+    
     EnvelopeStage();
     StageType getType() const override { return StageType::ENVELOPE; }
     void process(const AudioBuffer& input, AudioBuffer& output) override;
+    void processChannels(const PlanarBuffer& input, PlanarBuffer& output) override;
     void setParameter(const std::string& name, const ParamValue& value) override;
     ParamValue getParameter(const std::string& name) const override;
+    void setParameterValue(int index, double value) override;
+    double getParameterValue(int index) const override;
     std::vector<std::string> getParameterNames() const override;
+    int getParameterIndex(const std::string& name) const override;
     void reset() override;
     std::string getDescription() const override;
+    std::unique_ptr<DSPStage> clone() const override { return std::make_unique<EnvelopeStage>(*this); }
+    ParamRange getParameterRange(int index) const override;
+    bool isControlSource() const override { return true; }
+    double advanceControl(size_t frames, bool gate) override;
+    void setSampleRate(double sampleRate) override { sampleRate_ = sampleRate; }
     
 private:
     RangedParam<Seconds> attack_{0.01, 0.001, 2.0, "attack"};
@@ -142,29 +293,76 @@ private:
     double targetLevel_ = 0.0;
     double rate_ = 0.0;
     size_t sampleCount_ = 0;
+    double sampleRate_ = 44100.0;
+    
+    // Advance the state machine one sample for the given gate signal
+    double advance(double gate);
 };
 
 class LFOStage : public DSPStage {
 public:
+    enum Param : int { RATE, DEPTH, WAVE_TYPE };
+    
     LFOStage();
     StageType getType() const override { return StageType::LFO; }
     void process(const AudioBuffer& input, AudioBuffer& output) override;
+    void processChannels(const PlanarBuffer& input, PlanarBuffer& output) override;
     void setParameter(const std::string& name, const ParamValue& value) override;
     ParamValue getParameter(const std::string& name) const override;
+    void setParameterValue(int index, double value) override;
+    double getParameterValue(int index) const override;
     std::vector<std::string> getParameterNames() const override;
+    int getParameterIndex(const std::string& name) const override;
     void reset() override;
     std::string getDescription() const override;
+    std::unique_ptr<DSPStage> clone() const override { return std::make_unique<LFOStage>(*this); }
+    void setKernels(const SIMDKernels* kernels) override { kernels_ = kernels; }
+    ParamRange getParameterRange(int index) const override;
+    bool isControlSource() const override { return true; }
+    double advanceControl(size_t frames, bool gate) override;
+    void setSampleRate(double sampleRate) override { sampleRate_ = sampleRate; }
     
 private:
     RangedParam<Hz> rate_{1.0, 0.01, 20.0, "rate"};
     RangedParam<Percent> depth_{0.5, 0.0, 1.0, "depth"};
-    std::string waveType_ = "sine";
+    Waveform waveform_ = Waveform::SINE;
     double phase_ = 0.0;
     double sampleRate_ = 44100.0;
+    const SIMDKernels* kernels_ = nullptr;
+};
+
+class SpatialStage : public DSPStage {
+public:
+    enum Param : int { PAN, WIDTH };
+    
+    SpatialStage();
+    StageType getType() const override { return StageType::SPATIAL; }
+    void process(const AudioBuffer& input, AudioBuffer& output) override;
+    void processChannels(const PlanarBuffer& input, PlanarBuffer& output) override;
+    void setParameter(const std::string& name, const ParamValue& value) override;
+    ParamValue getParameter(const std::string& name) const override;
+    void setParameterValue(int index, double value) override;
+    double getParameterValue(int index) const override;
+    std::vector<std::string> getParameterNames() const override;
+    int getParameterIndex(const std::string& name) const override;
+    void reset() override;
+    std::string getDescription() const override;
+    std::unique_ptr<DSPStage> clone() const override { return std::make_unique<SpatialStage>(*this); }
+    ParamRange getParameterRange(int index) const override;
+    
+private:
+    RangedParam<Ratio> pan_{0.0, -1.0, 1.0, "pan"};     // -1 = left, 1 = right
+    RangedParam<Percent> width_{1.0, 0.0, 1.0, "width"}; // Stereo width (side gain)
 };
 
 // Routing and connections
 struct Connection {
+    Connection() = default;
+    Connection(std::string source, std::string destination, std::string parameter = {},
+               double amount = 1.0, bool enabled = true)
+        : source(std::move(source)), destination(std::move(destination)),
+          parameter(std::move(parameter)), amount(amount), enabled(enabled) {}
+    
     std::string source;
     std::string destination;
     std::string parameter; // For modulation connections
@@ -172,40 +370,252 @@ struct Connection {
     bool enabled = true;
 };
 
+// Compiled execution plan: stages flattened into execution order with the
+// audio routing of DSPGraph::getAudioSources. A chain ping-pongs between two
+// buffers; any other routing keeps one output per stage. Buffers are reused
+// across calls so block processing never allocates
+class ExecutionPlan {
+public:
+    // sources: audio sources per stage; empty = the stages form a chain
+    explicit ExecutionPlan(std::vector<DSPStage*> stages, std::vector<std::vector<size_t>> sources = {});
+    
+    // Reserve buffer capacity for blocks up to maxBlockSize samples
+    void prepare(size_t maxBlockSize, size_t numChannels = 1);
+    
+    // Run all stages in order; allocation-free once prepared for input.size()
+    void process(const AudioBuffer& input, AudioBuffer& output);
+    
+    // Multichannel variant: one pass per stage over all channels
+    void process(const PlanarBuffer& input, PlanarBuffer& output);
+    
+    // Access
+    const std::vector<DSPStage*>& getStages() const { return stages_; }
+    bool isChain() const { return chain_; }
+    size_t getMaxBlockSize() const { return maxBlockSize_; }
+    size_t getMaxChannels() const { return maxChannels_; }
+    
+private:
+    std::vector<DSPStage*> stages_;
+    std::vector<std::vector<size_t>> sources_;
+    std::vector<size_t> sinks_;
+    bool chain_ = true;
+    std::array<AudioBuffer, 2> buffers_;
+    std::array<PlanarBuffer, 2> channelBuffers_;
+    std::vector<AudioBuffer> inputs_, outputs_;
+    std::vector<PlanarBuffer> channelInputs_, channelOutputs_;
+    size_t maxBlockSize_ = 0;
+    size_t maxChannels_ = 0;
+    
+    template<typename Buffer>
+    void runRouted(const Buffer& input, Buffer& output,
+                   std::vector<Buffer>& inputs, std::vector<Buffer>& outputs);
+};
+
+// Level-parallel plan for graphs with independent branches, with the same
+// routing as ExecutionPlan: each stage reads the sum of its sources' outputs
+// (the graph input when it has none) and the graph output is the sum of the
+// sinks. Stages are grouped by dependency depth and every level runs across
+// a ThreadPool; sums are taken in topological order, so the result does not
+// depend on the thread count.
+class ParallelExecutionPlan {
+public:
+    ParallelExecutionPlan(std::vector<DSPStage*> stages,
+                          std::vector<std::vector<size_t>> sources,
+                          std::shared_ptr<ThreadPool> pool);
+    
+    // Reserve per-stage buffers for blocks up to maxBlockSize samples
+    void prepare(size_t maxBlockSize, size_t numChannels = 1);
+    
+    // Run all levels; allocation-free once prepared for the block size
+    void process(const AudioBuffer& input, AudioBuffer& output);
+    void process(const PlanarBuffer& input, PlanarBuffer& output);
+    
+    // Access
+    const std::vector<DSPStage*>& getStages() const { return stages_; }
+    const std::vector<std::vector<size_t>>& getLevels() const { return levels_; }
+    size_t getMaxBlockSize() const { return maxBlockSize_; }
+    
+private:
+    std::vector<DSPStage*> stages_;              // Topological order
+    std::vector<std::vector<size_t>> sources_;   // Audio sources per stage
+    std::vector<std::vector<size_t>> levels_;    // Stage indices per depth
+    std::vector<size_t> sinks_;
+    std::shared_ptr<ThreadPool> pool_;
+    std::vector<AudioBuffer> inputs_, outputs_;
+    std::vector<PlanarBuffer> channelInputs_, channelOutputs_;
+    size_t maxBlockSize_ = 0;
+    size_t maxChannels_ = 0;
+    
+    template<typename Buffer>
+    void run(const Buffer& input, Buffer& output,
+             std::vector<Buffer>& inputs, std::vector<Buffer>& outputs);
+};
+
+// Control-rate evaluation of a graph's modulation connections (those with a
+// parameter). Each tick advances every source once and moves each target
+// parameter, bound by index, to base + sum(amount * source) clamped to its
+// range; targets ramp to the new value across the tick rather than step.
+// Sources that are also on the audio path are advanced by the plan, so the
+// bus reads their value at the start of the tick instead of advancing them.
+// Base values are read by begin() and written back by end(), so rendering
+// leaves the graph's parameters where they were.
+class ModulationBus {
+public:
+    struct Source {
+        DSPStage* stage;
+        bool onAudioPath;    // Advanced by the plan; the bus only reads it
+    };
+    
+    struct Target {
+        DSPStage* stage;
+        int parameter;
+        ParamRange range;
+        double base = 0.0;
+    };
+    
+    struct Route {
+        size_t source;    // Index into the sources
+        size_t target;    // Index into the targets
+        double amount;
+    };
+    
+    ModulationBus(std::vector<Source> sources, std::vector<Target> targets, std::vector<Route> routes);
+    
+    bool empty() const { return routes_.empty(); }
+    
+    // Bracket one process call
+    void begin();
+    void end();
+    
+    // Advance the off-path sources by frames samples and retarget the
+    // parameters
+    void tick(size_t frames, bool gate);
+    
+    // Access
+    const std::vector<Source>& getSources() const { return sources_; }
+    const std::vector<Target>& getTargets() const { return targets_; }
+    const std::vector<Route>& getRoutes() const { return routes_; }
+    const std::vector<double>& getSourceValues() const { return values_; }
+    
+private:
+    std::vector<Source> sources_;
+    std::vector<Target> targets_;
+    std::vector<Route> routes_;
+    std::vector<double> values_;
+    std::vector<double> offsets_;
+};
+
 // DSP Graph representation
 class DSPGraph {
 public:
     DSPGraph() = default;
     ~DSPGraph() = default;
+    DSPGraph(DSPGraph&&) = default;
+    DSPGraph& operator=(DSPGraph&&) = default;
     
     // Graph construction
     void addStage(const std::string& name, std::unique_ptr<DSPStage> stage);
     void removeStage(const std::string& name);
+    // Modulation connections (with a parameter) are checked here: both
+    // stages must exist, the source must be an LFO or envelope and the
+    // parameter one of the destination's; AIAudioException otherwise
     void addConnection(const Connection& connection);
     void removeConnection(const std::string& source, const std::string& destination);
     
     // Graph processing
     void process(const AudioBuffer& input, AudioBuffer& output);
+    void process(const PlanarBuffer& input, PlanarBuffer& output);
     void reset();
     
-    // Graph analysis
+    // Compiled plan, rebuilt lazily after topology changes
+    ExecutionPlan& getExecutionPlan();
+    void prepare(size_t maxBlockSize, size_t numChannels = 1);
+    
+    // Run independent branches on a thread pool; nullptr restores the
+    // sequential plan
+    void setThreadPool(std::shared_ptr<ThreadPool> pool);
+    bool isParallel() const { return threadPool_ != nullptr; }
+    ParallelExecutionPlan& getParallelPlan();
+    
+    // Sample rate of every stage, including ones added later (default
+    // 44100 Hz)
+    void setSampleRate(double sampleRate);
+    double getSampleRate() const { return sampleRate_; }
+    
+    // Modulation connections are evaluated every interval samples (default
+    // 32); a block with any runs its plan tick by tick
+    void setControlInterval(size_t frames);
+    size_t getControlInterval() const { return controlInterval_; }
+    
+    // Gate of the envelopes used as modulation sources (default open)
+    void setGate(bool open) { gateOpen_ = open; }
+    bool isGateOpen() const { return gateOpen_; }
+    
+    // Compiled modulation routes, rebuilt lazily after topology changes
+    ModulationBus& getModulationBus();
+    
+    // Graph analysis. Cycles and order follow audio connections only:
+    // modulation routes are read at control ticks, so a stage may modulate
+    // one upstream of it
     bool hasCycles() const;
     bool isConnected() const;
     std::vector<std::string> getTopologicalOrder() const;
     double getTotalGain() const; // For feedback stability
     
+    // Topological order of the stages on the audio path: control sources
+    // that only take part in modulation connections are left out
+    std::vector<std::string> getAudioOrder() const;
+    
+    // Audio routing shared by both plans: the sources of each stage of
+    // getAudioOrder(), as indices into it, from the enabled audio
+    // connections. A stage without sources reads the graph input and the
+    // graph output is the sum of the stages no other stage reads. A graph
+    // without audio connections is a chain in audio order, each stage
+    // reading the one before.
+    std::vector<std::vector<size_t>> getAudioSources() const;
+    
+    // True when every audio-path stage reads only the one before it
+    bool isChain() const;
+    
     // Access
     DSPStage* getStage(const std::string& name);
     const DSPStage* getStage(const std::string& name) const;
     std::vector<std::string> getStageNames() const;
     std::vector<Connection> getConnections() const;
     
+    // Deep copy of stages and connections; the plan is rebuilt on demand
+    std::unique_ptr<DSPGraph> clone() const;
+    
     // Validation
     std::vector<std::string> validate() const;
     
 private:
     std::unordered_map<std::string, std::unique_ptr<DSPStage>> stages_;
     std::vector<Connection> connections_;
+    std::unique_ptr<ExecutionPlan> plan_;
+    std::unique_ptr<ParallelExecutionPlan> parallelPlan_;
+    std::unique_ptr<ModulationBus> modulation_;
+    std::shared_ptr<ThreadPool> threadPool_;
+    size_t preparedBlockSize_ = 0;
+    size_t preparedChannels_ = 1;
+    double sampleRate_ = 44100.0;
+    size_t controlInterval_ = 32;
+    bool gateOpen_ = true;
+    
+    // Tick scratch for modulated blocks
+    AudioBuffer tickInput_, tickOutput_;
+    PlanarBuffer tickChannelInput_, tickChannelOutput_;
+    
+    // Drop the compiled plans; called by every topology mutation
+    void invalidatePlan();
+    
+    // Run a plan over the block in control ticks
+    template<typename Plan, typename Buffer>
+    void processModulated(Plan& plan, const Buffer& input, Buffer& output,
+                          Buffer& tickInput, Buffer& tickOutput);
+    
+    // Why a modulation connection cannot bind, or empty when it can
+    std::string checkModulationRoute(const Connection& connection) const;
     
     // Graph analysis helpers
     bool hasCycleDFS(const std::string& node, 
@@ -246,9 +656,10 @@ private:
 class IRCompiler {
 public:
     struct CompileOptions {
-        bool optimizeForCPU = true;
         bool enableSIMD = true;
         bool enableParallel = false;
+        bool bandLimitedOscillators = false;    // Replace oscillators with WavetableStage
+        std::shared_ptr<ThreadPool> threadPool; // nullptr = ThreadPool::shared()
         double maxLatency = 10.0; // ms
         double cpuBudget = 0.8;   // 0-1
     };
@@ -257,6 +668,9 @@ public:
     std::unique_ptr<DSPGraph> compile(const DSPGraph& ir, 
                                      const CompileOptions& options);
     
+    // Run the optimization passes on a graph in place
+    void optimize(DSPGraph& graph, const CompileOptions& options);
+    
     // Estimate CPU cost
     double estimateCPUCost(const DSPGraph& graph) const;
     
@@ -265,10 +679,9 @@ public:
     
 private:
     // Optimization passes
-    void optimizeForCPU(DSPGraph& graph);
     void enableSIMD(DSPGraph& graph);
-    void enableParallel(DSPGraph& graph);
-    void optimizeLatency(DSPGraph& graph);
+    void useWavetables(DSPGraph& graph);
+    void enableParallel(DSPGraph& graph, std::shared_ptr<ThreadPool> pool);
     
     // Cost estimation
     double getStageCost(const DSPStage& stage) const;
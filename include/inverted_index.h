@@ -0,0 +1,125 @@
+#pragma once
+
+#include "core_types.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+
+namespace aiaudio {
+
+// Keyword index over a library of entries (presets, search entries).
+// Tokens are interned once into dense ids; each id has a sorted posting list
+// of documents for free-text terms and another for tags, and every role has
+// a bitset over documents. Adding, replacing and removing an entry touches
+// only that entry's postings, and document frequencies are kept alongside,
+// so IDF weights are a lookup rather than a pass over the library.
+//
+// Text is split into lower-cased alphanumeric runs. Tags are indexed whole
+// (lower-cased, trimmed) and their words are also indexed as terms, so
+// "warm" finds an entry tagged "warm-pad".
+//
+// Not synchronised: const lookups may run concurrently with each other but
+// not with add/remove/clear.
+class InvertedIndex {
+public:
+    using DocId = uint32_t;
+    using TokenId = uint32_t;
+    static constexpr TokenId kNoToken = UINT32_MAX;
+    
+    enum class Field { TERM, TAG };
+    
+    struct Query {
+        std::vector<std::string> terms;         // Every word must occur as a term
+        std::vector<std::string> tags;          // Every one must be a tag
+        std::vector<std::string> excludedTags;  // None may be a tag
+        Role role = Role::UNKNOWN;              // UNKNOWN = any role
+        bool prefixTerms = false;               // Terms also match longer words
+    };
+    
+    // Index or re-index an entry under key
+    void add(const std::string& key, Role role,
+             const std::vector<std::string>& tags,
+             const std::string& text);
+    
+    // False when key was not indexed
+    bool remove(const std::string& key);
+    
+    void clear();
+    
+    size_t size() const { return docOf_.size(); }
+    bool contains(const std::string& key) const { return docOf_.count(key) != 0; }
+    
+    // Matching documents in ascending DocId order; results are appended
+    void match(const Query& query, std::vector<DocId>& out) const;
+    
+    // Keys of the matching documents, sorted
+    std::vector<std::string> search(const Query& query) const;
+    
+    // Free-text query: every word must start a term of the entry (so a
+    // partially typed word still matches), role UNKNOWN = any
+    std::vector<std::string> searchText(const std::string& text, Role role = Role::UNKNOWN) const;
+    
+    const std::string& key(DocId doc) const { return keys_[doc]; }
+    Role role(DocId doc) const { return roles_[doc]; }
+    
+    // Documents holding the token in the field, and log(N / df) (0 when the
+    // token occurs nowhere)
+    size_t documentFrequency(const std::string& token, Field field) const;
+    double idf(const std::string& token, Field field) const;
+    
+    // Documents per role (UNKNOWN = all documents)
+    size_t roleCount(Role role) const;
+    
+    // Interned vocabulary size (tokens stay interned after their last
+    // document is removed)
+    size_t vocabularySize() const { return tokens_.size(); }
+    
+    // Lower-cased alphanumeric runs of text
+    static std::vector<std::string> tokenize(std::string_view text);
+    
+    // Tag as indexed: lower-cased, surrounding whitespace removed
+    static std::string normalizeTag(std::string_view tag);
+    
+private:
+    static constexpr size_t kNumRoles = static_cast<size_t>(Role::UNKNOWN) + 1;
+    
+    struct Postings {
+        std::vector<DocId> terms;
+        std::vector<DocId> tags;
+        const std::string* token = nullptr;    // Key in tokenIds_
+        
+        std::vector<DocId>& of(Field field) { return field == Field::TAG ? tags : terms; }
+        const std::vector<DocId>& of(Field field) const { return field == Field::TAG ? tags : terms; }
+    };
+    
+    // Interned tokens; the ordered map also serves prefix ranges
+    using TokenMap = std::map<std::string, TokenId, std::less<>>;
+    TokenMap tokenIds_;
+    std::vector<Postings> tokens_;
+    
+    // Documents; ids of removed documents are reused
+    std::unordered_map<std::string, DocId> docOf_;
+    std::vector<std::string> keys_;
+    std::vector<Role> roles_;
+    std::vector<std::vector<TokenId>> docTerms_;
+    std::vector<std::vector<TokenId>> docTags_;
+    std::vector<DocId> freeDocs_;
+    std::array<std::vector<uint64_t>, kNumRoles> roleBits_;
+    std::array<size_t, kNumRoles> roleCounts_{};
+    
+    TokenId intern(const std::string& token);
+    TokenId find(std::string_view token) const;
+    bool hasRole(DocId doc, Role role) const;
+    
+    // Tokens starting with prefix, and the union of their term postings
+    std::pair<TokenMap::const_iterator, TokenMap::const_iterator> prefixRange(std::string_view prefix) const;
+    std::vector<DocId> prefixPostings(std::string_view prefix) const;
+};
+
+} // namespace aiaudio
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace aiaudio {
+
+struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t size = 0;
+    size_t weight = 0;      // Sum of entry weights; equals size when all weigh 1
+    size_t capacity = 0;
+    double hitRate = 0.0;
+};
+
+// Bounded least-recently-used cache, safe to share between threads. Values
+// are copied out so callers never hold a reference into the cache. Each
+// entry has a weight (1 by default) and capacity bounds their sum, so a
+// cache of large values can be bounded in bytes.
+template<typename Key, typename Value>
+class LRUCache {
+public:
+    // capacity 0 disables the cache
+    explicit LRUCache(size_t capacity = 1024) : capacity_(capacity) {}
+    
+    std::optional<Value> get(const Key& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            ++misses_;
+            return std::nullopt;
+        }
+        ++hits_;
+        order_.splice(order_.begin(), order_, it->second);
+        return it->second->second;
+    }
+    
+    // Like get(), but an entry rejected by isValid counts as a miss
+    template<typename Predicate>
+    std::optional<Value> getIf(const Key& key, Predicate&& isValid) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end() || !isValid(it->second->second)) {
+            ++misses_;
+            return std::nullopt;
+        }
+        ++hits_;
+        order_.splice(order_.begin(), order_, it->second);
+        return it->second->second;
+    }
+    
+    // A value heavier than the whole capacity is not cached (and drops any
+    // older value under the key)
+    void put(const Key& key, Value value, size_t weight = 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            weight_ -= it->second->weight;
+            order_.erase(it->second);
+            index_.erase(it);
+        }
+        if (weight > capacity_) return;
+        
+        while (weight_ + weight > capacity_) {
+            evictOldest();
+        }
+        order_.push_front(Entry{key, std::move(value), weight});
+        index_.emplace(key, order_.begin());
+        weight_ += weight;
+    }
+    
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        order_.clear();
+        index_.clear();
+        weight_ = 0;
+    }
+    
+    // Shrinking evicts the least recently used entries
+    void setCapacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity;
+        while (weight_ > capacity_) {
+            evictOldest();
+        }
+    }
+    
+    CacheStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        CacheStats stats;
+        stats.hits = hits_;
+        stats.misses = misses_;
+        stats.evictions = evictions_;
+        stats.size = index_.size();
+        stats.weight = weight_;
+        stats.capacity = capacity_;
+        size_t lookups = hits_ + misses_;
+        stats.hitRate = lookups ? static_cast<double>(hits_) / lookups : 0.0;
+        return stats;
+    }
+    
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hits_ = misses_ = evictions_ = 0;
+    }
+    
+private:
+    struct Entry {
+        Key first;
+        Value second;
+        size_t weight;
+    };
+    
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    size_t weight_ = 0;
+    std::list<Entry> order_;  // Most recent first
+    std::unordered_map<Key, typename std::list<Entry>::iterator> index_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    size_t evictions_ = 0;
+    
+    void evictOldest() {
+        weight_ -= order_.back().weight;
+        index_.erase(order_.back().first);
+        order_.pop_back();
+        ++evictions_;
+    }
+};
+
+} // namespace aiaudio
@@ -2,7 +2,10 @@
 
 #include "core_types.h"
 #include "moo_optimization.h"
+#include "meters.h"
 #include "dsp_ir.h"
+#include "compiled_preset.h"
+#include "render_cache.h"
 #include "normalization.h"
 #include "semantic_fusion.h"
 #include "roles_policies.h"
@@ -11,9 +14,109 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <functional>
+#include <span>
+#include <chrono>
+#include <mutex>
 
 namespace aiaudio {
 
+// Block-based streaming renderer
+// Pulls fixed-size blocks from a graph; stage state carries over between
+// blocks and all buffers are allocated up front, so pullBlock() is safe to
+// call from the audio thread as long as the graph topology stays unchanged.
+class StreamingRenderer {
+public:
+    static constexpr size_t kMinBlockSize = 64;
+    static constexpr size_t kMaxBlockSize = 1024;
+    
+    // Receives each rendered block; return false to stop the stream
+    using BlockCallback = std::function<bool(const AudioBuffer& block)>;
+    
+    StreamingRenderer(DSPGraph& graph, size_t blockSize = 512);
+    
+    // Pull interface: render the next block (numFrames <= block size)
+    const AudioBuffer& pullBlock();
+    const AudioBuffer& pullBlock(size_t numFrames);
+    
+    // Push interface: render numSamples, handing each block to the callback
+    size_t render(size_t numSamples, const BlockCallback& callback);
+    
+    // Reset stage state and frame counter
+    void reset();
+    
+    // Access
+    size_t getBlockSize() const { return blockSize_; }
+    size_t getFramesRendered() const { return framesRendered_; }
+    DSPGraph& getGraph() { return graph_; }
+    
+private:
+    DSPGraph& graph_;
+    size_t blockSize_;
+    AudioBuffer input_;  // Silent source block
+    AudioBuffer output_;
+    size_t framesRendered_ = 0;
+};
+
+// Chunked candidate evaluation with early termination. Each candidate graph
+// is streamed chunkSeconds at a time through a StreamingAnalyzer, and after
+// every chunk the CandidatePruner may drop it. Survivors are scored on their
+// full render; feasible ones join the pruner's front, so later candidates
+// (in this run and the next) are also judged against the best seen so far.
+// Candidates run in order, which keeps the verdicts deterministic.
+class CandidatePipeline {
+public:
+    struct Options {
+        double durationSeconds = 8.0;
+        double chunkSeconds = 0.25;       // Audio between pruning checks
+        size_t blockSize = 512;
+        bool enablePruning = true;        // false: full renders, same scoring
+        CandidatePruner::Options pruner;
+    };
+    
+    struct CandidateResult {
+        CandidatePruner::Verdict verdict = CandidatePruner::Verdict::CONTINUE;  // CONTINUE: rendered in full
+        double secondsRendered = 0.0;
+        MOOOptimizer::EvalMetrics metrics;  // Of the full render, or of the partial one when pruned
+        
+        bool pruned() const { return verdict != CandidatePruner::Verdict::CONTINUE; }
+    };
+    
+    struct RunStats {
+        size_t candidates = 0;
+        size_t pruned = 0;
+        double wallSeconds = 0.0;
+        double audioSeconds = 0.0;         // Rendered over all candidates
+        double candidatesPerSecond = 0.0;
+        std::map<std::string, size_t> verdicts;  // Pruned candidates by verdict name
+    };
+    
+    explicit CandidatePipeline(const MOOOptimizer& optimizer);
+    CandidatePipeline(const MOOOptimizer& optimizer, const Options& options);
+    
+    // Results in candidate order; the graphs are prepared and rendered in place
+    std::vector<CandidateResult> evaluate(std::vector<DSPGraph>& candidates,
+                                          Role role,
+                                          const MusicalContext& context,
+                                          const AudioConstraints& constraints,
+                                          const std::string& query = "");
+    
+    const RunStats& getLastRunStats() const { return lastStats_; }
+    
+    // The front carries over between runs; reset() it for a new search
+    CandidatePruner& getPruner() { return pruner_; }
+    
+private:
+    const MOOOptimizer& optimizer_;
+    Options options_;
+    CandidatePruner pruner_;
+    RunStats lastStats_;
+    AudioBuffer audio_;  // Current candidate's render, reused between candidates
+    
+    CandidateResult evaluateCandidate(DSPGraph& graph, Role role, const MusicalContext& context,
+                                      const AudioConstraints& constraints, const std::string& query);
+};
+
 // Main AI Audio Generation System
 class AIAudioGenerator {
 public:
@@ -30,6 +133,9 @@ public:
         bool useSemanticSearch = true;
         bool applyPolicies = true;
         bool optimizeForMOO = true;
+        double durationSeconds = 8.0;
+        double sampleRate = 44100.0;    // Rate of the built graph
+        bool useRenderCache = true;
     };
     
     struct GenerationResult {
@@ -38,14 +144,48 @@ public:
         double qualityScore;
         std::vector<std::string> warnings;
         std::string explanation;
+        bool fromCache = false;  // Audio and meters replayed from the render cache
     };
     
-    // Main generation function
-    GenerationResult generate(const GenerationRequest& request);
-    
-    // Load preset from JSON
+    // Main generation function. Builds a private graph per call and only
+    // reads the shared components, so concurrent calls are safe as long as
+    // no loader or setter runs at the same time. The render is deterministic
+    // in the final graph, seed and length, so it is looked up in the render
+    // cache first; a hit skips rendering, analysis and (for the same scoring
+    // inputs) the scorers.
+    GenerationResult generate(const GenerationRequest& request) const;
+    
+    // Streaming generation: blocks are handed to onBlock as they are rendered.
+    // Quality scoring needs the whole clip, so result.audio stays empty and
+    // qualityScore is not computed.
+    GenerationResult generateStreaming(const GenerationRequest& request,
+                                       const StreamingRenderer::BlockCallback& onBlock,
+                                       size_t blockSize = 512) const;
+    
+    // Receives each batch result as soon as it completes (not in request
+    // order). Calls are serialised but come from pool workers.
+    using ResultCallback = std::function<void(size_t index, const GenerationResult& result)>;
+    
+    // Batch generation: requests run concurrently on the thread pool, each
+    // with its own graph and stage state. Returns results in request order.
+    // Must not be called from a task running on the same pool.
+    std::vector<GenerationResult> generateBatch(std::span<const GenerationRequest> requests,
+                                                const ResultCallback& onResult = {}) const;
+    
+    // Pool used by generateBatch (defaults to ThreadPool::shared())
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) { threadPool_ = std::move(pool); }
+    
+    // Cache used by generate (in memory by default); nullptr disables it
+    void setRenderCache(std::shared_ptr<RenderCache> cache) { renderCache_ = std::move(cache); }
+    std::shared_ptr<RenderCache> getRenderCache() const { return renderCache_; }
+    
+    // Load a JSON preset file, or a compiled one (kCompiledPresetExtension)
     void loadPreset(const std::string& presetPath);
     
+    // Load every JSON preset in a directory in parallel, through the
+    // compiled cache (see PresetLibrary); failures are listed in the stats
+    PresetLibrary::LoadStats loadPresetLibrary(const std::string& directory);
+    
     // Save preset to JSON
     void savePreset(const std::string& presetPath, const DSPGraph& graph);
     
@@ -77,20 +217,26 @@ private:
     // System state
     std::map<std::string, std::unique_ptr<DSPGraph>> loadedPresets_;
     std::map<std::string, std::string> configuration_;
+    std::shared_ptr<ThreadPool> threadPool_;
+    std::shared_ptr<RenderCache> renderCache_;
     bool initialized_ = false;
     
-    // Generation pipeline
-    DSPGraph createGraphFromPrompt(const GenerationRequest& request);
-    DSPGraph applySemanticSearch(const std::string& prompt, Role role);
-    DSPGraph applyDecisionHeads(const DSPGraph& graph, const GenerationRequest& request);
-    DSPGraph applyPolicies(const DSPGraph& graph, Role role, const MusicalContext& context);
-    AudioBuffer renderGraph(const DSPGraph& graph, size_t numSamples);
-    Trace createTrace(const GenerationRequest& request, const DSPGraph& graph, const AudioBuffer& audio);
+    // Generation pipeline (read-only on the shared components). The graph
+    // is built once and the later steps transform it in place; DSPGraph is
+    // move-only, so no step can copy it by accident.
+    DSPGraph buildGraph(const GenerationRequest& request) const;
+    DSPGraph createGraphFromPrompt(const GenerationRequest& request) const;
+    DSPGraph applySemanticSearch(const std::string& prompt, Role role) const;
+    void applyDecisionHeads(DSPGraph& graph, const GenerationRequest& request) const;
+    void applyPolicies(DSPGraph& graph, Role role, const MusicalContext& context) const;
+    AudioBuffer renderGraph(DSPGraph& graph, size_t numSamples) const;
+    Trace createTrace(const GenerationRequest& request, const DSPGraph& graph,
+                      double loudness, double truePeakDb) const;
     
     // Quality assessment
-    double assessQuality(const AudioBuffer& audio, const GenerationRequest& request);
-    std::vector<std::string> checkWarnings(const AudioBuffer& audio, const AudioConstraints& constraints);
-    std::string generateExplanation(const GenerationRequest& request, const DSPGraph& graph);
+    double assessQuality(const AudioStats& stats, const GenerationRequest& request) const;
+    std::vector<std::string> checkWarnings(const AudioStats& stats, const AudioConstraints& constraints) const;
+    std::string generateExplanation(const GenerationRequest& request, const DSPGraph& graph) const;
     
     // System initialization
     void initializeComponents();
@@ -125,7 +271,7 @@ private:
 // Preset manager
 class PresetManager {
 public:
-    // Load preset from file
+    // Load a JSON preset file, or a compiled one (kCompiledPresetExtension)
     std::unique_ptr<DSPGraph> loadPreset(const std::string& filePath);
     
     // Save preset to file
@@ -145,15 +291,22 @@ public:
     
     PresetMetadata getMetadata(const std::string& filePath) const;
     void setMetadata(const std::string& filePath, const PresetMetadata& metadata);
+    void removeMetadata(const std::string& filePath);
     
-    // Search presets
+    // Search presets: every word of the query must start a word of the
+    // preset's name, description or tags (case-insensitive); results are
+    // sorted by path
     std::vector<std::string> searchPresets(const std::string& query, Role role = Role::UNKNOWN) const;
     
     // Get all presets
     std::vector<std::string> getAllPresets() const;
     
+    // Keyword index over the metadata, kept in step by set/removeMetadata
+    const InvertedIndex& getKeywordIndex() const { return keywordIndex_; }
+    
 private:
     std::map<std::string, PresetMetadata> presetMetadata_;
+    InvertedIndex keywordIndex_;
 };
 
 // Audio renderer
@@ -162,16 +315,24 @@ public:
     // Render audio from graph
     AudioBuffer render(const DSPGraph& graph, size_t numSamples, double sampleRate = 44100.0);
     
-    // Render with real-time constraints
-    AudioBuffer renderRealtime(const DSPGraph& graph, size_t numSamples, 
+    // Render with real-time constraints, one block at a time with a
+    // per-block deadline derived from maxLatencyMs
+    AudioBuffer renderRealtime(DSPGraph& graph, size_t numSamples, 
                               double maxLatencyMs = 10.0);
     
+    // Stream blocks to a callback without materialising the whole clip
+    size_t renderStream(DSPGraph& graph, size_t numSamples,
+                        const StreamingRenderer::BlockCallback& callback,
+                        size_t blockSize = 512);
+    
     // Get rendering statistics
     struct RenderStats {
-        double renderTime;
-        double cpuUsage;
-        size_t memoryUsed;
-        bool realtimeSuccess;
+        double renderTime = 0.0;
+        double cpuUsage = 0.0;          // Rendering thread's CPU seconds per second of audio
+        size_t memoryUsed = 0;
+        bool realtimeSuccess = true;
+        size_t blocksRendered = 0;
+        size_t deadlineMisses = 0;
     };
     RenderStats getLastRenderStats() const;
     
@@ -182,13 +343,16 @@ private:
     // Rendering helpers
     void processGraph(DSPGraph& graph, AudioBuffer& output, size_t numSamples);
     bool checkRealtimeConstraints(double renderTime, double maxLatencyMs);
+    size_t blockSizeForLatency(double maxLatencyMs) const;
+    double cpuLoad(double cpuSeconds, size_t numSamples) const;
 };
 
 // Quality assessor
 class QualityAssessor {
 public:
-    // Assess audio quality
+    // Assess audio quality; the AudioStats overloads reuse a render's analysis
     double assessQuality(const AudioBuffer& audio, Role role, const AudioConstraints& constraints);
+    double assessQuality(const AudioStats& stats, Role role, const AudioConstraints& constraints);
     
     // Get detailed quality metrics
     struct QualityMetrics {
@@ -201,8 +365,12 @@ public:
     };
     QualityMetrics getDetailedMetrics(const AudioBuffer& audio, Role role, 
                                      const AudioConstraints& constraints);
+    QualityMetrics getDetailedMetrics(const AudioStats& stats, Role role,
+                                     const AudioConstraints& constraints);
     
-    // Compare two audio samples
+    // Spectral similarity in (0, 1], 1 for identical audio: maps the
+    // multiresolution STFT loss plus the Bark loudness error through
+    // 1 / (1 + d). Buffers of different lengths are compared over the shorter.
     double compareAudio(const AudioBuffer& audio1, const AudioBuffer& audio2);
     
 private:
@@ -215,21 +383,28 @@ private:
     double computeStability(const AudioBuffer& audio);
 };
 
-// System monitor
+// System monitor: process readings plus the pipeline metrics recorded in
+// MetricsRegistry::global()
 class SystemMonitor {
 public:
+    SystemMonitor();
+    
     // Get system performance metrics
     struct PerformanceMetrics {
-        double cpuUsage;
-        double memoryUsage;
-        double diskUsage;
+        double cpuUsage;            // Process CPU since the previous reading, 0-1 of all hardware threads
+        double memoryUsage;         // Resident set, MB
+        double diskUsage;           // Used fraction of the working directory's filesystem
         size_t activeThreads;
-        double averageLatency;
-        size_t totalRenders;
+        double averageLatency;      // Mean generate() latency, ms
+        size_t totalRenders;        // generate() calls
         size_t successfulRenders;
     };
     PerformanceMetrics getMetrics() const;
     
+    // The readings as gauges followed by the registry's histograms and
+    // counters, in OpenMetrics text format for a Prometheus scrape
+    std::string exportMetrics() const;
+    
     // Start monitoring
     void startMonitoring();
     
@@ -242,8 +417,11 @@ public:
 private:
     bool monitoring_ = false;
     std::chrono::system_clock::time_point startTime_;
-    size_t totalRenders_ = 0;
-    size_t successfulRenders_ = 0;
+    
+    // CPU usage is measured between consecutive readings
+    mutable std::mutex cpuSampleMutex_;
+    mutable double lastCPUSeconds_ = 0.0;
+    mutable std::chrono::steady_clock::time_point lastCPUSample_;
     
     // Monitoring helpers
     double getCPUUsage() const;
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace aiaudio {
+
+// Read-only memory-mapped file. Pages come straight from the page cache, so
+// every process mapping the same file shares one physical copy.
+class MappedFile {
+public:
+    // Throws AIAudioException when the file cannot be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    const std::string& getPath() const { return path_; }
+    
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    std::string path_;
+};
+
+} // namespace aiaudio
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "core_types.h"
+#include "audio_stats.h"
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace aiaudio {
+
+// Streaming ITU-R BS.1770 meters. Both are fed block by block (any block
+// size) at a constant cost per sample, so a stream can be metered while it
+// plays instead of being buffered and rescanned.
+
+// K-weighted loudness: momentary (400 ms), short-term (3 s) and gated
+// integrated loudness since the last reset, all in LUFS
+class LoudnessMeter {
+public:
+    explicit LoudnessMeter(double sampleRate = 44100.0);
+    
+    void process(const Sample* data, size_t n);
+    void process(const AudioBuffer& block) { process(block.data(), block.size()); }
+    
+    // Before the first full window these read the loudness of everything
+    // seen so far
+    double getMomentary() const;
+    double getShortTerm() const;
+    
+    // Gating runs on a 0.1 LU histogram of the 400 ms windows, so the
+    // reading costs the same however long the stream has been metered
+    double getIntegrated() const;
+    
+    size_t getSamplesProcessed() const { return samples_; }
+    double getSampleRate() const { return sampleRate_; }
+    
+    void reset();
+    
+private:
+    static constexpr size_t kShortTermBlocks = 30;  // 3 s of 100 ms blocks
+    
+    double sampleRate_;
+    size_t blockSize_;
+    std::array<BiquadCoefficients, 2> filters_;
+    BiquadState shelf_;
+    BiquadState highPass_;
+    std::vector<Sample> scratch_;
+    
+    double blockEnergy_ = 0.0;
+    size_t blockFill_ = 0;
+    double totalEnergy_ = 0.0;
+    size_t samples_ = 0;
+    
+    std::array<double, kShortTermBlocks> recent_{};  // Ring of block mean squares
+    size_t blocks_ = 0;
+    
+    std::vector<double> histogramEnergy_;  // Sum of window mean squares per bin
+    std::vector<size_t> histogramCount_;
+    size_t windows_ = 0;
+    
+    void completeBlock();
+    double recentLoudness(size_t blocks) const;
+    double ungatedLoudness() const;
+};
+
+// True peak by 4x polyphase oversampling (windowed-sinc interpolator,
+// 12 taps per phase); never reads below the sample peak
+class TruePeakMeter {
+public:
+    static constexpr size_t kOversampling = 4;
+    static constexpr size_t kTapsPerPhase = 12;
+    
+    TruePeakMeter();
+    
+    void process(const Sample* data, size_t n);
+    void process(const AudioBuffer& block) { process(block.data(), block.size()); }
+    
+    double getTruePeak() const { return peak_; }  // Linear
+    double getTruePeakDb() const;                 // dBTP
+    
+    void reset();
+    
+private:
+    std::vector<Sample> window_;   // kTapsPerPhase - 1 samples of history, then the chunk
+    std::vector<Sample> phases_;   // Interpolated chunk, one row per fractional phase
+    Sample peak_ = 0.0f;
+};
+
+class FFTPlan;
+
+// Incremental analyzeAudio: the same AudioStats, updated block by block so a
+// render can be judged while it is still running. The snapshot matches
+// analyzeAudio over the same samples except that loudnessBlocks stays empty
+// and the spectral centroid only covers complete kCentroidFFTSize frames.
+class StreamingAnalyzer {
+public:
+    explicit StreamingAnalyzer(double sampleRate = 44100.0);
+    
+    void process(const Sample* data, size_t n);
+    void process(const AudioBuffer& block) { process(block.data(), block.size()); }
+    
+    AudioStats snapshot() const;
+    
+    size_t getSamplesProcessed() const { return samples_; }
+    double getSecondsProcessed() const { return samples_ / sampleRate_; }
+    const LoudnessMeter& getLoudnessMeter() const { return loudness_; }
+    
+    void reset();
+    
+private:
+    double sampleRate_;
+    LoudnessMeter loudness_;
+    TruePeakMeter truePeak_;
+    
+    SampleStats moments_;
+    size_t samples_ = 0;
+    bool previousNegative_ = false;  // Sign of the last sample, for crossings at block edges
+    
+    std::shared_ptr<const FFTPlan> plan_;
+    std::vector<float> frame_;       // Centroid frame being filled
+    size_t frameFill_ = 0;
+    std::vector<float> windowed_;
+    std::vector<std::complex<float>> spectrum_;
+    double centroidWeighted_ = 0.0;
+    double centroidTotal_ = 0.0;
+    
+    void completeFrame();
+};
+
+} // namespace aiaudio
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Instrumentation switch: building with AIAUDIO_NO_METRICS (CMake option
+// AIAUDIO_WITH_METRICS=OFF) compiles every AIAUDIO_TIME_SCOPE and
+// AIAUDIO_COUNT out of the pipeline (AIAUDIO_RECORD_SECONDS records a time
+// the caller measured anyway, unsampled). The registry types stay available, so
+// callers of the export and read APIs build either way; they just see no data.
+#ifndef AIAUDIO_NO_METRICS
+#define AIAUDIO_METRICS_CONCAT_(a, b) a##b
+#define AIAUDIO_METRICS_CONCAT(a, b) AIAUDIO_METRICS_CONCAT_(a, b)
+#define AIAUDIO_TIME_SCOPE(histogram) \
+    ::aiaudio::ScopedTimer AIAUDIO_METRICS_CONCAT(aiaudioScopedTimer_, __LINE__)(histogram)
+#define AIAUDIO_COUNT(counter, n) (counter).add(n)
+#define AIAUDIO_RECORD_SECONDS(histogram, seconds) (histogram).recordSeconds(seconds)
+#else
+#define AIAUDIO_TIME_SCOPE(histogram) ((void)0)
+#define AIAUDIO_COUNT(counter, n) ((void)0)
+#define AIAUDIO_RECORD_SECONDS(histogram, seconds) ((void)0)
+#endif
+
+namespace aiaudio {
+
+// Latency histogram with log-linear buckets: four per octave from 256 ns to
+// about 275 s, plus an underflow and an overflow bucket. Every thread writes
+// its own cache-line-aligned shard with relaxed atomic adds, so recording
+// takes no lock and no shared cache line; snapshot() sums the shards.
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBuckets = 4;
+    static constexpr size_t kOctaves = 30;
+    static constexpr int kMinOctave = 8;                           // 2^8 ns
+    static constexpr size_t kBuckets = kOctaves * kSubBuckets + 2;
+    static constexpr size_t kShards = 16;
+    
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> counts{};
+        uint64_t count = 0;
+        double sum = 0.0;                                          // Seconds
+        
+        double mean() const { return count ? sum / count : 0.0; }
+        
+        // Seconds, interpolated within the bucket holding the quantile
+        double quantile(double q) const;
+    };
+    
+    void record(uint64_t nanoseconds) {
+        Shard& shard = shards_[shardIndex()];
+        shard.counts[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        shard.sumNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+    
+    void recordSeconds(double seconds) {
+        // Clamped to well past the overflow bucket so the conversion stays defined
+        record(seconds > 0.0 ? static_cast<uint64_t>(std::min(seconds, 1e6) * 1e9) : 0);
+    }
+    
+    // Consistent per bucket; records racing the read land in this snapshot
+    // or the next
+    Snapshot snapshot() const;
+    void reset();
+    
+    static size_t bucketFor(uint64_t nanoseconds) {
+        if (nanoseconds < (uint64_t(1) << kMinOctave)) return 0;
+        const int octave = static_cast<int>(std::bit_width(nanoseconds)) - 1;
+        if (octave >= kMinOctave + static_cast<int>(kOctaves)) return kBuckets - 1;
+        const size_t sub = (nanoseconds >> (octave - 2)) & (kSubBuckets - 1);
+        return 1 + (octave - kMinOctave) * kSubBuckets + sub;
+    }
+    
+    // Exclusive upper bound of a bucket in seconds (infinity for overflow)
+    static double bucketUpperBound(size_t bucket);
+    
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, kBuckets> counts{};
+        std::atomic<uint64_t> sumNanoseconds{0};
+    };
+    std::array<Shard, kShards> shards_{};
+    
+    // Threads take shards round-robin on their first record
+    static size_t shardIndex() {
+        static std::atomic<size_t> nextShard{0};
+        thread_local const size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kShards;
+        return shard;
+    }
+};
+
+// Monotonic event counter
+class alignas(64) MetricCounter {
+public:
+    void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+    void reset() { value_.store(0, std::memory_order_relaxed); }
+    
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+// Named histograms and counters with OpenMetrics text export. Registration
+// takes a lock and returns a reference that stays valid for the registry's
+// lifetime; hot paths resolve their series once and keep the reference.
+//
+// Timers are sampled: with a sampling rate of 1/N only every Nth timed
+// scope on each thread reads the clock, the rest cost one thread-local
+// decrement. Histogram counts are sampled counts; counters stay exact.
+class MetricsRegistry {
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+    
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+    
+    // Process-wide registry the pipeline records into
+    static MetricsRegistry& global();
+    
+    // Get or create a series. Names follow OpenMetrics: histograms in
+    // seconds end in _seconds, counters are exported with a _total suffix.
+    // Throws AIAudioException when a name is reused for the other kind.
+    LatencyHistogram& histogram(const std::string& name, const std::string& help, const Labels& labels = {});
+    MetricCounter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+    
+    // Fraction of timed scopes measured, rounded to 1/N; 0 turns timers off
+    void setSamplingRate(double rate);
+    double getSamplingRate() const;
+    
+    // Whether the calling thread's next timed scope is measured
+    bool sample() {
+        const uint32_t period = samplePeriod_.load(std::memory_order_relaxed);
+        if (period <= 1) return period == 1;
+        thread_local uint32_t countdown = 0;
+        if (countdown == 0) {
+            countdown = period - 1;
+            return true;
+        }
+        --countdown;
+        return false;
+    }
+    
+    // All families in OpenMetrics text format; exportOpenMetrics() adds the
+    // terminating "# EOF", writeOpenMetrics() leaves it to the caller so more
+    // families can follow
+    void writeOpenMetrics(std::ostream& out) const;
+    std::string exportOpenMetrics() const;
+    
+    // Zero every series (registrations and references stay)
+    void reset();
+    
+private:
+    template<typename Series>
+    struct Family {
+        std::string help;
+        std::map<std::string, std::unique_ptr<Series>> series;    // By rendered label set
+    };
+    
+    mutable std::mutex mutex_;
+    std::map<std::string, Family<LatencyHistogram>> histograms_;
+    std::map<std::string, Family<MetricCounter>> counters_;
+    std::atomic<uint32_t> samplePeriod_{1};
+};
+
+// Records the lifetime of a scope into a histogram when the global
+// registry samples it; use through AIAUDIO_TIME_SCOPE
+class ScopedTimer {
+public:
+    explicit ScopedTimer(LatencyHistogram& histogram)
+        : histogram_(MetricsRegistry::global().sample() ? &histogram : nullptr) {
+        if (histogram_) start_ = std::chrono::steady_clock::now();
+    }
+    
+    ~ScopedTimer() {
+        if (!histogram_) return;
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        histogram_->record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+    
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    
+private:
+    LatencyHistogram* histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Process readings for the system monitor; 0 where the platform offers none
+double processCPUSeconds();
+double threadCPUSeconds();
+size_t residentMemoryBytes();
+size_t processThreadCount();
+
+} // namespace aiaudio
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "core_types.h"
+#include "audio_stats.h"
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <algorithm>
 #include <cmath>
@@ -34,16 +37,29 @@ public:
     // Initialize with role-specific thresholds
     explicit MOOOptimizer(const std::string& metricsConfigPath);
     
-    // Main evaluation function
+    // Main evaluation function (pure, safe to call concurrently)
     EvalMetrics evaluate(const AudioBuffer& audio, 
                         Role role, 
                         const MusicalContext& context,
-                        const std::string& query = "");
+                        const std::string& query = "") const;
+    
+    // Same, from a render's precomputed analysis (no pass over the audio)
+    EvalMetrics evaluate(const AudioStats& stats,
+                        Role role,
+                        const MusicalContext& context,
+                        const std::string& query = "") const;
+    
+    // Same, checked against the caller's constraints instead of the defaults
+    EvalMetrics evaluate(const AudioStats& stats,
+                        Role role,
+                        const MusicalContext& context,
+                        const AudioConstraints& constraints,
+                        const std::string& query = "") const;
     
     // Pareto dominance checking
     bool dominates(const ParetoPoint& a, const ParetoPoint& b) const;
     
-    // Hypervolume calculation
+    // Hypervolume w.r.t. the origin (see HypervolumeIndicator)
     double calculateHypervolume(const std::vector<ParetoPoint>& front) const;
     
     // Epsilon-constraint method
@@ -51,10 +67,36 @@ public:
                                               size_t primaryObjective = 0,
                                               double epsilon = 0.1) const;
     
-    // NSGA-II selection
+    // NSGA-II selection: whole fronts in rank order, the last one cut by
+    // crowding distance (most isolated first)
     std::vector<ParetoPoint> nsga2Selection(const std::vector<ParetoPoint>& population,
                                            size_t targetSize) const;
     
+    // Population objectives as flat rows, indexed without ObjectiveVector's
+    // bounds-checked switch
+    using ObjectiveRow = std::array<double, ObjectiveVector::size()>;
+    static ObjectiveRow objectiveRow(const ObjectiveVector& objectives);
+    static std::vector<ObjectiveRow> objectiveRows(const std::vector<ParetoPoint>& population);
+    
+    enum class SortMethod {
+        AUTO,            // Picked by population size and thread count
+        DOMINANCE,       // Deb: parallel pairwise dominance bit matrix, O(MN^2)
+        EFFICIENT        // ENS-BS: lexicographic order, binary search over fronts
+    };
+    
+    // Front index of every row, 0 = non-dominated (objectives maximised)
+    static std::vector<uint32_t> nonDominatedSort(const std::vector<ObjectiveRow>& rows,
+                                                  SortMethod method = SortMethod::AUTO);
+    
+    // Crowding distance of each front member (indices into rows); boundary
+    // points are infinite
+    static std::vector<double> crowdingDistances(const std::vector<ObjectiveRow>& rows,
+                                                 const std::vector<size_t>& front);
+    
+    // Row indices chosen by nsga2Selection
+    static std::vector<size_t> nsga2SelectIndices(const std::vector<ObjectiveRow>& rows, size_t targetSize,
+                                                  SortMethod method = SortMethod::AUTO);
+    
     // Bradley-Terry preference model
     double bradleyTerryWinProb(const Trace& traceA, const Trace& traceB) const;
     
@@ -63,23 +105,23 @@ public:
     
 private:
     // Individual objective calculators
-    double calculateSemanticMatch(const AudioBuffer& audio, 
+    double calculateSemanticMatch(const AudioStats& stats, 
                                  const std::string& query, 
                                  Role role) const;
     
-    double calculateMixReadiness(const AudioBuffer& audio, 
+    double calculateMixReadiness(const AudioStats& stats, 
                                 Role role, 
                                 const AudioConstraints& constraints) const;
     
-    double calculatePerceptualQuality(const AudioBuffer& audio) const;
+    double calculatePerceptualQuality(const AudioStats& stats) const;
     
-    double calculateStability(const AudioBuffer& audio) const;
+    double calculateStability(const AudioStats& stats) const;
     
     double calculatePreferenceWin(const Trace& trace, 
                                  const std::vector<Trace>& baselines) const;
     
     // Constraint checking
-    std::vector<ConstraintViolation> checkConstraints(const AudioBuffer& audio,
+    std::vector<ConstraintViolation> checkConstraints(const AudioStats& stats,
                                                      const AudioConstraints& constraints) const;
     
     // Role-specific thresholds
@@ -89,21 +131,125 @@ private:
     std::vector<double> encodeQuery(const std::string& query) const;
     
     // Audio analysis utilities
-    double calculateLUFS(const AudioBuffer& audio) const;
-    double calculateTruePeak(const AudioBuffer& audio) const;
-    double calculateCrestFactor(const AudioBuffer& audio) const;
-    double calculateSpectralCentroid(const AudioBuffer& audio) const;
+    double calculateLUFS(const AudioStats& stats) const;
+    double calculateTruePeak(const AudioStats& stats) const;
+    double calculateCrestFactor(const AudioStats& stats) const;
+    double calculateSpectralCentroid(const AudioStats& stats) const;
     
-    // Multiresolution STFT loss
+    // Multiresolution STFT loss (512/1024/2048-point frames, see spectral.h)
     double multiresSTFTLoss(const AudioBuffer& reference, const AudioBuffer& generated) const;
     
     // Bark loudness calculation
     double barkLoudnessError(const AudioBuffer& reference, const AudioBuffer& generated) const;
 };
 
+// Hypervolume indicator of a front of maximised objectives: the volume
+// dominated by the front and bounded below by a reference point. Fronts up
+// to exactLimit points are measured exactly with WFG (slicing on the last
+// objective, exact sweep in two dimensions); larger ones are estimated by
+// Monte-Carlo sampling on the shared thread pool.
+// The add() side keeps its own front and updates its value by the new
+// point's exclusive contribution only.
+class HypervolumeIndicator {
+public:
+    using Point = MOOOptimizer::ObjectiveRow;
+    
+    struct Options {
+        Point reference{};                  // Origin by default
+        size_t exactLimit = 1024;           // Larger fronts are sampled
+        size_t monteCarloSamples = 1 << 18; // Sample budget per estimate (~2% interval)
+        double zScore = 1.96;               // Interval half-width in standard errors (95%)
+        unsigned seed = 42;
+    };
+    
+    struct Estimate {
+        double value = 0.0;
+        double standardError = 0.0;         // 0 when exact
+        double lower = 0.0;                 // Confidence interval
+        double upper = 0.0;
+        size_t samples = 0;                 // 0 when exact
+        bool exact = true;
+    };
+    
+    HypervolumeIndicator();
+    explicit HypervolumeIndicator(const Options& options);
+    
+    // Exact or sampled by front size; dominated points are allowed
+    Estimate compute(const std::vector<Point>& front) const;
+    double computeExact(const std::vector<Point>& front) const;
+    Estimate estimateMonteCarlo(const std::vector<Point>& front) const;
+    
+    // Add a point to the tracked front and return its exclusive
+    // contribution (0 when it is dominated). Exact unless the slice it
+    // overlaps exceeds exactLimit points.
+    double add(const Point& point);
+    double getValue() const { return value_; }
+    bool isExact() const { return exact_; }
+    const std::vector<Point>& getFront() const { return front_; }
+    void reset();
+    
+private:
+    Options options_;
+    std::vector<Point> front_;   // Mutually non-dominated
+    double value_ = 0.0;
+    bool exact_ = true;
+};
+
+// Early termination for chunked candidate evaluation: judges a candidate
+// from the analysis of the audio rendered so far. Clipping, true-peak and
+// non-finite verdicts are final, since those only grow with more audio; the
+// runaway, loudness and dominance verdicts are heuristics with slack.
+class CandidatePruner {
+public:
+    using Point = MOOOptimizer::ObjectiveRow;
+    
+    struct Options {
+        double runawayVariance = 1.0;   // AntiChaosSystem's chaos threshold
+        double loudnessSeconds = 3.0;   // Judge loudness after a short-term window
+        double loudnessMargin = 6.0;    // LU beyond checkConstraints' 3 LU tolerance
+        bool pruneDominated = true;
+        double dominanceSeconds = 1.0;
+        double dominanceMargin = 0.1;   // A front point must lead by this on some objective
+    };
+    
+    enum class Verdict {
+        CONTINUE,
+        NON_FINITE,
+        HARD_CLIP,
+        TRUE_PEAK,
+        RUNAWAY_GAIN,
+        LOUDNESS,
+        DOMINATED
+    };
+    
+    CandidatePruner();
+    explicit CandidatePruner(const Options& options);
+    
+    // Verdict on a partial render; partial may be nullptr to skip the
+    // dominance test (its score is only needed for that)
+    Verdict check(const AudioStats& stats, const AudioConstraints& constraints,
+                  const MOOOptimizer::EvalMetrics* partial = nullptr) const;
+    
+    // Whether a front point beats objectives by the dominance margin
+    bool isDominated(const Point& objectives) const;
+    
+    // Track a finished feasible candidate; dominated points are dropped
+    void addToFront(const Point& objectives);
+    const std::vector<Point>& getFront() const { return front_; }
+    void reset() { front_.clear(); }
+    
+    static std::string verdictName(Verdict verdict);
+    
+private:
+    Options options_;
+    std::vector<Point> front_;   // Mutually non-dominated
+};
+
 // Pareto front visualization and analysis
 class ParetoAnalyzer {
 public:
+    using ParetoPoint = MOOOptimizer::ParetoPoint;
+    
     struct FrontAnalysis {
         std::vector<ParetoPoint> paretoFront;
         double hypervolume;
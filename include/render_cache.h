@@ -0,0 +1,93 @@
+#pragma once
+
+#include "core_types.h"
+#include "dsp_ir.h"
+#include "lru_cache.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace aiaudio {
+
+// Canonical hash of a graph's content: every stage's type and parameters,
+// the connections, the audio routing (getAudioOrder and getAudioSources),
+// the sample rate and the control interval. Stages and connections are
+// hashed in sorted order, so connected graphs built in a different order
+// hash the same; graphs whose stages chain implicitly hash by the chain
+// they actually run. Runtime state (phases, filter memory, compiled plans,
+// the modulation gate) does not enter.
+uint64_t graphContentHash(const DSPGraph& graph);
+
+// Key of one deterministic render: graph content, seed and length
+uint64_t renderCacheKey(uint64_t graphHash, uint32_t seed, size_t numSamples);
+
+// Key of the inputs a quality score and its warnings depend on besides the
+// audio, so a cached render can be rescored for a different request
+uint64_t scoreCacheKey(const std::string& prompt, Role role, const MusicalContext& context,
+                       const AudioConstraints& constraints);
+
+// Bounded cache of finished renders, keyed by renderCacheKey. Entries live
+// in an LRU bounded by audio bytes. With a spill directory every new entry
+// is also written there as a mono float WAV file named <key>.wav, with the
+// results in an extra RIFF chunk. Other processes (or a web front-end) can
+// serve and reload these files, and a memory miss falls back to them. The
+// spill directory is never trimmed. Safe to share between threads.
+class RenderCache {
+public:
+    struct Options {
+        size_t maxBytes = size_t(256) << 20;    // Audio held in memory
+        std::string spillDirectory;              // Empty = memory only
+    };
+    
+    struct Entry {
+        AudioBuffer audio;
+        double sampleRate = 44100.0;
+        std::map<std::string, double> meters;    // Trace::meters of the render
+        std::vector<std::string> warnings;
+        double qualityScore = 0.0;
+        uint64_t scoreKey = 0;                   // Scoring inputs behind qualityScore
+    };
+    
+    struct Stats {
+        CacheStats memory;
+        size_t spillHits = 0;
+        size_t spillWrites = 0;
+        size_t spillErrors = 0;                  // Unwritable or unreadable files
+    };
+    
+    RenderCache();
+    explicit RenderCache(const Options& options);
+    
+    // Memory first, then the spill directory; nullptr on a miss
+    std::shared_ptr<const Entry> find(uint64_t key);
+    
+    // Insert or replace; spill failures are counted, never thrown
+    std::shared_ptr<const Entry> store(uint64_t key, Entry entry);
+    
+    // Drop the in-memory entries (spilled files stay)
+    void clear() { memory_.clear(); }
+    
+    Stats getStats() const;
+    const Options& getOptions() const { return options_; }
+    
+    // Spill file of a key
+    std::string spillPath(uint64_t key) const;
+    
+private:
+    Options options_;
+    LRUCache<uint64_t, std::shared_ptr<const Entry>> memory_;
+    
+    mutable std::mutex statsMutex_;
+    size_t spillHits_ = 0;
+    size_t spillWrites_ = 0;
+    size_t spillErrors_ = 0;
+    
+    bool writeSpill(uint64_t key, const Entry& entry) const;
+    std::shared_ptr<Entry> readSpill(uint64_t key);
+};
+
+} // namespace aiaudio
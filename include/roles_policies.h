@@ -1,8 +1,13 @@
 #pragma once
 
 #include "core_types.h"
+#include "dsp_ir.h"
+#include "lru_cache.h"
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <vector>
+#include <span>
 #include <string>
 #include <memory>
 #include <yaml-cpp/yaml.h>
@@ -41,6 +46,51 @@ struct RolePolicy {
     std::string description;
 };
 
+// A policy's numeric constraints bound to one graph topology. Stages are
+// numbered in execution order (getTopologicalOrder) and every parameter has
+// a slot in a flat parameter vector: the stage's offset plus the parameter's
+// index in getParameterNames(). Each RANGE constraint becomes one row per
+// stage with a numeric parameter of that name, kept as parallel arrays, so
+// clamping and scoring are flat loops without string lookups or variant
+// reads. CUSTOM constraints keep their validator in a separate row list;
+// ENUM and BOOLEAN constraints carry no score and stay on the string path.
+struct CompiledPolicy {
+    Role role = Role::PAD;
+    uint64_t topologyHash = 0;                  // graphTopologyHash of the bound graph
+    std::vector<std::string> stageNames;        // Execution order
+    std::vector<uint32_t> parameterOffsets;     // Stage s owns slots [offsets[s], offsets[s + 1])
+    
+    // RANGE rows
+    std::vector<uint32_t> stage;
+    std::vector<uint32_t> parameter;            // Index within the stage
+    std::vector<uint32_t> slot;
+    std::vector<double> minValue;
+    std::vector<double> maxValue;
+    std::vector<double> penaltyScale;           // weight / (max - min); weight for a point range
+    
+    struct CustomRow {
+        uint32_t stage;
+        uint32_t parameter;
+        uint32_t slot;
+        double weight;
+        std::function<bool(double)> validator;
+    };
+    std::vector<CustomRow> customRows;
+    
+    size_t numRangeRows() const { return slot.size(); }
+    size_t numRows() const { return slot.size() + customRows.size(); }
+    size_t numParameters() const { return parameterOffsets.empty() ? 0 : parameterOffsets.back(); }
+    
+    // Flat parameter vector of a graph with this topology, and back
+    void gatherParameters(const DSPGraph& graph, std::span<double> parameters) const;
+    std::vector<double> gatherParameters(const DSPGraph& graph) const;
+    void scatterParameters(DSPGraph& graph, std::span<const double> parameters) const;
+};
+
+// Hash of the stage names, types and parameter counts in execution order;
+// graphs with equal hashes share compiled policies
+uint64_t graphTopologyHash(const DSPGraph& graph);
+
 // Policy compiler
 class PolicyCompiler {
 public:
@@ -57,6 +107,9 @@ public:
     std::map<std::string, std::pair<double, double>> compileConstraints(
         const RolePolicy& policy) const;
     
+    // Bind a policy's constraints to a graph's stages and parameter slots
+    CompiledPolicy compileForGraph(const RolePolicy& policy, const DSPGraph& graph) const;
+    
     // Resolve conflicts between policies
     RolePolicy resolveConflicts(const std::vector<RolePolicy>& policies) const;
     
@@ -86,9 +139,24 @@ public:
     void applyRoleTransformations(DSPGraph& graph, Role role, 
                                  const MusicalContext& context) const;
     
-    // Compute policy score
+    // Compute policy score: the product over constrained parameters of
+    // 1 - weight * (distance outside the range / range width), each factor
+    // floored at 0; a rejected CUSTOM value costs its whole weight
     double computePolicyScore(const DSPGraph& graph, const RolePolicy& policy) const;
     
+    // Compiled forms. Parameter vectors are laid out by the policy's slots.
+    void applyPolicy(DSPGraph& graph, const CompiledPolicy& policy) const;
+    std::vector<std::string> checkCompliance(const DSPGraph& graph, const CompiledPolicy& policy) const;
+    double computePolicyScore(const CompiledPolicy& policy, std::span<const double> parameters) const;
+    void clampParameters(const CompiledPolicy& policy, std::span<double> parameters) const;
+    
+    // Score numCandidates parameter vectors stored back to back (row i at
+    // candidates[i * numParameters()]) into scores[i]
+    void computePolicyScores(const CompiledPolicy& policy, std::span<const double> candidates,
+                             std::span<double> scores) const;
+    std::vector<double> computePolicyScores(const CompiledPolicy& policy,
+                                            std::span<const double> candidates) const;
+    
     // Get policy recommendations
     std::vector<std::string> getRecommendations(const DSPGraph& graph, 
                                                const RolePolicy& policy) const;
@@ -117,9 +185,15 @@ private:
     void adjustForTempo(DSPGraph& graph, const MusicalContext& context) const;
     void adjustForKey(DSPGraph& graph, const MusicalContext& context) const;
     void adjustForScale(DSPGraph& graph, const MusicalContext& context) const;
+    
+    // Single-constraint checks for the string path
+    bool validateConstraint(const PolicyConstraint& constraint, double value) const;
+    double computeViolationPenalty(const PolicyConstraint& constraint, double value) const;
 };
 
 // Policy manager
+// Thread safety: const lookups may run concurrently; the returned policy
+// pointer stays valid until the next update, remove, load or import.
 class PolicyManager {
 public:
     // Load all policies from directory
@@ -128,6 +202,10 @@ public:
     // Get policy for role
     const RolePolicy* getPolicy(Role role) const;
     
+    // The role's policy compiled for the graph's topology, cached per (role,
+    // topology) until the policies change; nullptr without a policy
+    std::shared_ptr<const CompiledPolicy> getCompiledPolicy(Role role, const DSPGraph& graph) const;
+    
     // Get all policies
     std::vector<RolePolicy> getAllPolicies() const;
     
@@ -153,6 +231,7 @@ private:
     std::map<Role, RolePolicy> policies_;
     PolicyCompiler compiler_;
     PolicyEngine engine_;
+    mutable LRUCache<uint64_t, std::shared_ptr<const CompiledPolicy>> compiled_{256};
     
     // Conflict detection
     std::vector<std::string> detectConflicts(const RolePolicy& policy1, 
@@ -1,11 +1,17 @@
 #pragma once
 
 #include "core_types.h"
+#include "ann_index.h"
+#include "inverted_index.h"
+#include "mapped_file.h"
+#include "lru_cache.h"
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <unordered_set>
 #include <memory>
+#include <functional>
 
 namespace aiaudio {
 
@@ -15,12 +21,18 @@ class SemanticEmbedding {
 public:
     using EmbeddingVector = std::vector<double>;
     
-    // Encode text to embedding vector
+    virtual ~SemanticEmbedding() = default;
+    
+    // Encode text to embedding vector; must be safe to call concurrently
     virtual EmbeddingVector encode(const std::string& text) const = 0;
     
     // Get embedding dimension
     virtual size_t getDimension() const = 0;
     
+    // Model identity stamped into saved indexes; change it whenever the
+    // model's output changes so stale indexes are rejected
+    virtual std::string getModelId() const = 0;
+    
     // Compute cosine similarity
     static double cosineSimilarity(const EmbeddingVector& a, const EmbeddingVector& b) {
         if (a.size() != b.size()) return 0.0;
@@ -58,6 +70,8 @@ public:
     }
 };
 
+using EmbeddingVector = SemanticEmbedding::EmbeddingVector;
+
 // Simple embedding model (placeholder for real implementation)
 class SimpleEmbedding : public SemanticEmbedding {
 public:
@@ -81,6 +95,8 @@ public:
     
     size_t getDimension() const override { return dimension_; }
     
+    std::string getModelId() const override { return "simple-hash-v1"; }
+    
 private:
     size_t dimension_;
 };
@@ -165,10 +181,18 @@ public:
     // Get role weights
     std::vector<double> getRoleWeights(Role role) const;
     
+    // Underlying embedding model
+    const SemanticEmbedding& getEmbedding() const { return *embedding_; }
+    
+    // Library whose tag document frequencies drive computeIDF; not owned,
+    // nullptr weighs every tag 1
+    void setTermStatistics(const InvertedIndex* index) { termStatistics_ = index; }
+    
 private:
     std::unique_ptr<SemanticEmbedding> embedding_;
     TagSystem tagSystem_;
     std::map<Role, std::vector<double>> roleWeights_;
+    const InvertedIndex* termStatistics_ = nullptr;
     
     // Helper functions
     EmbeddingVector averageEmbeddings(const std::vector<EmbeddingVector>& embeddings) const;
@@ -206,7 +230,44 @@ private:
     EmbeddingVector processForRole(const EmbeddingVector& vector, Role role) const;
 };
 
+// Canonical form of a search query: prompt lower-cased with whitespace
+// collapsed, tags normalised the same way and sorted. Queries with the same
+// canonical form encode identically and share query-cache entries.
+struct CanonicalQuery {
+    std::string prompt;
+    Role role = Role::UNKNOWN;
+    std::vector<std::string> positiveTags;
+    std::vector<std::string> negativeTags;
+    
+    static CanonicalQuery make(const std::string& prompt,
+                               Role role = Role::UNKNOWN,
+                               const std::vector<std::string>& positiveTags = {},
+                               const std::vector<std::string>& negativeTags = {});
+    
+    // Stable across processes and builds (FNV-1a, 16 hex digits)
+    std::string hash() const;
+};
+
+// Trace::queryHash for a query
+std::string computeQueryHash(const std::string& prompt,
+                             Role role,
+                             const std::vector<std::string>& positiveTags = {},
+                             const std::vector<std::string>& negativeTags = {});
+
 // Semantic Search Engine
+// Entry vectors are kept unit length in one row-major float matrix with a
+// row list per role, so a query is a dot product per candidate row and a
+// bounded top-k selection. An optional ANNIndex narrows the candidate rows
+// for large libraries.
+// Repeated queries are served from an LRU cache of query vectors and top-k
+// lists keyed by the canonical query hash.
+// Tags and descriptions are also kept in an InvertedIndex, which answers
+// keyword lookups and prefilters semantic searches to the entries a keyword
+// query matches.
+// Thread safety: the const search/explain methods only read the index and
+// the embedding model (the query caches lock internally), so any number of
+// threads may query concurrently.
+// addEntry/updateEntry/removeEntry/clear need exclusive access.
 class SemanticSearchEngine {
 public:
     struct SearchResult {
@@ -223,7 +284,7 @@ public:
     // Add entry to search index
     void addEntry(const EntryVectorBuilder::EntryData& data);
     
-    // Search for entries
+    // Search for entries; returns at most maxResults hits, best first
     std::vector<SearchResult> search(const std::string& query,
                                     Role role = Role::UNKNOWN,
                                     size_t maxResults = 10) const;
@@ -235,6 +296,18 @@ public:
                                                Role role = Role::UNKNOWN,
                                                size_t maxResults = 10) const;
     
+    // Semantic search over only the entries the keyword filter matches (its
+    // role applies too); the filter narrows the rows before any scoring
+    std::vector<SearchResult> searchFiltered(const std::string& query,
+                                            const InvertedIndex::Query& filter,
+                                            size_t maxResults = 10) const;
+    
+    // Ids of the entries whose tags or description match every word of text
+    std::vector<std::string> searchKeywords(const std::string& text, Role role = Role::UNKNOWN) const;
+    
+    // Keyword index over entry tags and descriptions
+    const InvertedIndex& getKeywordIndex() const { return keywordIndex_; }
+    
     // Get explanation for result
     std::string explainResult(const SearchResult& result) const;
     
@@ -250,18 +323,84 @@ public:
     // Get entry count
     size_t getEntryCount() const;
     
+    // Persist the index: vectors, role partitions, ids and entry metadata
+    void saveIndex(const std::string& path) const;
+    
+    // Replace the index with a saved one without re-encoding anything. The
+    // vectors are used in place from a read-only shared mapping and copied
+    // only on the first add/update/remove. Throws AIAudioException when the
+    // file is corrupt or was built for another embedding model or dimension.
+    void loadIndex(const std::string& path);
+    
+    // True while the vectors are served from a mapped index file
+    bool isMapped() const { return mapped_ != nullptr; }
+    
+    // Approximate backend, built from the current entries and kept in sync
+    // by add/update/remove. Its candidates are re-scored exactly; nullptr
+    // (the default) scans the whole matrix.
+    void setANNIndex(std::unique_ptr<ANNIndex> index);
+    const ANNIndex* getANNIndex() const { return annIndex_.get(); }
+    
+    // Change the backend's search parameters (e.g. IVFIndex::setNProbe)
+    // between queries. Result lists ranked under the old settings are no
+    // longer served; does nothing without a backend.
+    void tuneANNIndex(const std::function<void(ANNIndex&)>& tune);
+    
+    // Query cache sizing (entries per cache, 0 disables) and counters.
+    // Cached result lists are discarded once the index generation moves on;
+    // query vectors only depend on the model and survive index changes.
+    void setQueryCacheCapacity(size_t capacity);
+    CacheStats getVectorCacheStats() const { return vectorCache_.getStats(); }
+    CacheStats getResultCacheStats() const { return resultCache_.getStats(); }
+    void clearQueryCache();
+    
+    // Bumped by every change to the indexed entries
+    uint64_t getGeneration() const { return generation_; }
+    
 private:
     std::unique_ptr<SemanticFusionEngine> fusionEngine_;
     std::map<std::string, EntryVectorBuilder::EntryData> entries_;
-    std::map<std::string, EmbeddingVector> entryVectors_;
+    
+    // Flat index: row r is the vector of rowIds_[r], stored at
+    // rowData()[r * dimension_]; rows are compacted on removal
+    size_t dimension_;
+    std::vector<float> vectors_;
+    std::unique_ptr<MappedFile> mapped_;
+    const float* mappedVectors_ = nullptr;
+    std::vector<std::string> rowIds_;
+    std::vector<Role> rowRoles_;
+    std::unordered_map<std::string, size_t> rowOf_;
+    std::map<Role, std::vector<size_t>> rolePartitions_;
+    std::unique_ptr<ANNIndex> annIndex_;
+    InvertedIndex keywordIndex_;
+    uint64_t generation_ = 0;
+    
+    // Query caches
+    struct CachedResults {
+        uint64_t generation;
+        std::vector<SearchResult> results;
+    };
+    mutable LRUCache<std::string, EmbeddingVector> vectorCache_;
+    mutable LRUCache<std::string, CachedResults> resultCache_;
+    
+    // Index maintenance
+    const float* rowData() const { return mapped_ ? mappedVectors_ : vectors_.data(); }
+    VectorMatrixView matrixView() const;
+    void detachMapping();
+    void storeRow(const std::string& entryId, Role role, const EmbeddingVector& vector);
+    void eraseRow(const std::string& entryId);
     
     // Search helpers
-    std::vector<SearchResult> rankResults(const std::vector<std::string>& entryIds,
-                                         const EmbeddingVector& queryVector,
-                                         Role role) const;
+    std::vector<SearchResult> searchCanonical(const CanonicalQuery& query, size_t maxResults) const;
+    EmbeddingVector queryVector(const CanonicalQuery& query) const;
+    
+    // Scores only the given rows when rows is set
+    std::vector<SearchResult> rankResults(const EmbeddingVector& queryVector,
+                                         Role role,
+                                         size_t maxResults,
+                                         const std::vector<size_t>* rows = nullptr) const;
     
-    std::string generateExplanation(const SearchResult& result,
-                                   const EmbeddingVector& queryVector) const;
+    std::string generateExplanation(const SearchResult& result) const;
 };
 
 // Advanced Semantic Features
@@ -284,6 +423,9 @@ public:
                                   const std::map<std::string, int>& termFrequencies,
                                   int totalDocuments);
     
+    // Same weight from an index's incrementally kept document frequencies
+    static double computeIDFWeight(const std::string& term, const InvertedIndex& index);
+    
     // Semantic clustering
     static std::vector<std::vector<std::string>> clusterTags(
         const std::vector<std::string>& tags,
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "core_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace aiaudio {
+
+// SIMD DSP kernels with runtime CPU dispatch
+
+// Instruction sets with a kernel implementation
+enum class SIMDLevel {
+    SCALAR,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+// Biquad coefficients (normalized, a0 == 1) and direct form I state,
+// shared by the scalar and vector paths
+struct BiquadCoefficients {
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+};
+
+struct BiquadState {
+    double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+};
+
+// Moments and sample counts gathered by the sampleStats kernel. Non-finite
+// samples are only counted; they are left out of the sums and the peak.
+struct SampleStats {
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    double sumAbs = 0.0;
+    Sample peak = 0.0f;          // Largest |x|
+    size_t clipped = 0;          // |x| >= 1
+    size_t denormals = 0;
+    size_t nonFinite = 0;        // NaN or +-inf
+    size_t silent = 0;           // |x| < silenceThreshold
+    size_t zeroCrossings = 0;    // Sign changes between neighbours in the range
+};
+
+// Shape of the dotProductBlock kernels
+constexpr size_t kDotBlockRows = 4;
+constexpr size_t kDotBlockCols = 2;
+
+// Kernel table, one instance per instruction set
+struct SIMDKernels {
+    SIMDLevel level;
+    
+    // out[i] = amplitude * sin(phase + phaseOffset) + in[i]; phase advances by
+    // increment per sample and is kept wrapped to [0, 2*pi). The scalar table
+    // uses std::sin, the vector tables a 9th-order polynomial (~4e-6 error).
+    void (*sineOscillator)(const Sample* in, Sample* out, size_t n,
+                           double& phase, double increment,
+                           double phaseOffset, double amplitude);
+    
+    // Biquad over numChannels planar channels, one channel per vector lane
+    void (*biquad)(const Sample* const* in, Sample* const* out,
+                   size_t numChannels, size_t n,
+                   const BiquadCoefficients& k, BiquadState* state);
+    
+    // Elementwise gain and symmetric clamp to [-limit, limit]
+    void (*applyGain)(Sample* data, size_t n, Sample gain);
+    void (*clampSymmetric)(Sample* data, size_t n, Sample limit);
+    
+    // Reductions
+    Sample (*peakAbs)(const Sample* data, size_t n);
+    double (*sumSquares)(const Sample* data, size_t n);
+    
+    // Every SampleStats field in one pass over data (out is overwritten).
+    // Denormal and non-finite tests look at the bits, so they hold under
+    // -ffast-math and flush-to-zero.
+    void (*sampleStats)(const Sample* data, size_t n, Sample silenceThreshold, SampleStats& out);
+    
+    // Single-precision dot product (embedding scoring, dense layers)
+    float (*dotProduct)(const float* a, const float* b, size_t n);
+    
+    // Exact int8 dot product with 32-bit accumulation (quantized layers).
+    // Operands must lie in [-127, 127], as symmetric quantization produces;
+    // AVX2 uses AVX-VNNI when the CPU has it.
+    int32_t (*dotProductInt8)(const int8_t* a, const int8_t* b, size_t n);
+    
+    // Register-blocked dot products for small GEMMs:
+    // out[r * kDotBlockCols + c] = dot(a + r * aStride, b + c * bStride, n)
+    // for kDotBlockRows rows of a and kDotBlockCols rows of b
+    void (*dotProductBlock)(const float* a, size_t aStride,
+                            const float* b, size_t bStride,
+                            size_t n, float* out);
+    void (*dotProductInt8Block)(const int8_t* a, size_t aStride,
+                                const int8_t* b, size_t bStride,
+                                size_t n, int32_t* out);
+};
+
+// Highest instruction set supported by the running CPU
+SIMDLevel detectSIMDLevel();
+
+// Kernel table for a level; falls back to scalar when not available
+const SIMDKernels& getSIMDKernels(SIMDLevel level);
+
+// Kernel table for the running CPU (detected once)
+const SIMDKernels& getActiveKernels();
+
+// Human-readable level name
+std::string simdLevelName(SIMDLevel level);
+
+} // namespace aiaudio
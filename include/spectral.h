@@ -0,0 +1,106 @@
+#pragma once
+
+#include "core_types.h"
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace aiaudio {
+
+// Shared spectral engine. A SpectralAnalysis computes the STFT frames of a
+// buffer once per resolution; the spectral centroid, the multiresolution
+// STFT loss and the Bark loudness error all read those frames.
+
+// Real FFT of one power-of-two size: a half-size complex FFT on the packed
+// even/odd samples plus a split pass. Bit reversal, twiddles and the analysis
+// window are built once; plans are immutable and shared between threads.
+class FFTPlan {
+public:
+    explicit FFTPlan(size_t size);
+    
+    // Cached plan of the given size, built on first use (thread-safe)
+    static std::shared_ptr<const FFTPlan> get(size_t size);
+    
+    size_t size() const { return size_; }
+    size_t bins() const { return size_ / 2 + 1; }  // DC to Nyquist
+    
+    // Periodic Hann window of size() samples
+    const std::vector<float>& window() const { return window_; }
+    
+    // Spectrum of size() real samples into bins() values, unnormalised
+    void forward(const float* input, std::complex<float>* output) const;
+    
+private:
+    size_t size_;
+    std::vector<uint32_t> bitReverse_;              // Half-size permutation
+    std::vector<std::complex<float>> twiddles_;     // Per stage, contiguous: span h at [h - 1, 2h - 1)
+    std::vector<std::complex<float>> splitTwiddles_;  // exp(-2 pi i k / size)
+    std::vector<float> window_;
+};
+
+// Hann-windowed STFT magnitudes; frames start every hopSize samples and the
+// last one is zero-padded
+struct Spectrogram {
+    size_t fftSize = 0;
+    size_t hopSize = 0;
+    size_t frames = 0;
+    size_t bins = 0;
+    double sampleRate = 44100.0;
+    std::vector<float> magnitude;  // frames x bins, row-major
+    
+    const float* frame(size_t index) const { return magnitude.data() + index * bins; }
+    double binFrequency(size_t bin) const { return bin * sampleRate / fftSize; }
+};
+
+// Frames run across the shared thread pool when parallel is set and there
+// are enough of them to split
+Spectrogram computeSpectrogram(const AudioBuffer& audio, double sampleRate,
+                               size_t fftSize, size_t hopSize, bool parallel = true);
+
+class SpectralAnalysis {
+public:
+    struct Options {
+        std::vector<size_t> fftSizes{512, 1024, 2048};
+        size_t hopDivisor = 4;   // hop = fftSize / hopDivisor
+        bool parallel = true;
+    };
+    
+    // 24 critical bands of one Bark each, plus everything above 24 Bark
+    static constexpr size_t kBarkBands = 25;
+    
+    explicit SpectralAnalysis(const AudioBuffer& audio, double sampleRate = 44100.0);
+    SpectralAnalysis(const AudioBuffer& audio, double sampleRate, const Options& options);
+    
+    double getSampleRate() const { return sampleRate_; }
+    const std::vector<Spectrogram>& getResolutions() const { return resolutions_; }
+    
+    // Magnitude-weighted mean frequency over the frames of the largest FFT,
+    // in Hz (0 for silence)
+    double spectralCentroid() const { return centroid_; }
+    
+    // Energy per Bark band of each frame of the largest FFT (frames x kBarkBands)
+    const std::vector<float>& getBarkEnergy() const { return barkEnergy_; }
+    size_t getBarkFrames() const;
+    
+private:
+    double sampleRate_;
+    std::vector<Spectrogram> resolutions_;
+    double centroid_ = 0.0;
+    std::vector<float> barkEnergy_;
+    
+    void analyzeFinest();
+};
+
+// Multiresolution STFT loss (spectral convergence plus mean absolute log
+// magnitude difference, averaged over resolutions); 0 for identical audio.
+// Frames past the shorter analysis are not compared. Both analyses must
+// share their FFT sizes, hops and sample rate.
+double multiresSTFTLoss(const SpectralAnalysis& reference, const SpectralAnalysis& generated);
+
+// Relative L1 distance between the Bark-band specific loudness (Zwicker's
+// E^0.23 power law) of the two analyses; 0 for identical audio
+double barkLoudnessError(const SpectralAnalysis& reference, const SpectralAnalysis& generated);
+
+} // namespace aiaudio
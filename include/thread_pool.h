@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace aiaudio {
+
+// Persistent worker pool shared by graph execution and batch jobs.
+//
+// submit() queues tasks on per-worker deques; an idle worker pops its own
+// queue and steals from the others. parallelFor() is the per-block path: the
+// job is published through atomics only and the calling thread takes part,
+// so a block never waits on a lock or on a worker being woken.
+class ThreadPool {
+public:
+    // 0 = one worker per hardware thread
+    explicit ThreadPool(size_t numThreads = 0);
+    ~ThreadPool();
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    // Queue a task; the future carries its result or exception
+    template<typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>>;
+    
+    // Run fn(i) for every i in [0, count) on the workers and the caller and
+    // return once all calls have finished. Runs inline when another
+    // parallelFor already owns the pool. The first exception is rethrown.
+    template<typename F>
+    void parallelFor(size_t count, F&& fn);
+    
+    size_t size() const { return workers_.size(); }
+    
+    // Process-wide pool sized to the hardware
+    static std::shared_ptr<ThreadPool> shared();
+    
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+    
+    using IndexFn = void (*)(void* context, size_t index);
+    
+    void enqueue(std::function<void()> task);
+    bool popTask(size_t self, std::function<void()>& task);
+    void workerLoop(size_t index);
+    void runParallel(size_t count, IndexFn fn, void* context);
+    void helpParallel();
+    
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::atomic<size_t> nextQueue_{0};
+    std::atomic<size_t> pendingTasks_{0};
+    std::atomic<bool> stop_{false};
+    
+    // Idle workers park here; only submit() and parallelFor() notify
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCv_;
+    
+    // Single parallelFor job slot
+    std::atomic<bool> jobBusy_{false};
+    std::atomic<bool> jobActive_{false};
+    std::atomic<int> jobHelpers_{0};
+    std::atomic<size_t> jobNext_{0};
+    std::atomic<size_t> jobDone_{0};
+    std::atomic<bool> jobFailed_{false};
+    size_t jobCount_ = 0;
+    IndexFn jobFn_ = nullptr;
+    void* jobContext_ = nullptr;
+    std::exception_ptr jobError_;
+};
+
+template<typename F>
+auto ThreadPool::submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+    using Result = std::invoke_result_t<std::decay_t<F>>;
+    
+    // packaged_task is move-only; std::function needs a copyable target
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> future = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return future;
+}
+
+template<typename F>
+void ThreadPool::parallelFor(size_t count, F&& fn) {
+    using Fn = std::remove_reference_t<F>;
+    
+    // Type-erased without allocating: the callable stays on the caller's stack
+    runParallel(count, [](void* context, size_t index) { (*static_cast<Fn*>(context))(index); },
+                const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+}
+
+} // namespace aiaudio
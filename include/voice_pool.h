@@ -0,0 +1,137 @@
+#pragma once
+
+#include "core_types.h"
+#include "dsp_ir.h"
+#include "simd_kernels.h"
+#include "wavetable.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace aiaudio {
+
+// Polyphonic voice engine. The patch graph, which must route its audio as a
+// single chain (DSPGraph::isChain), is compiled once into a list of
+// per-stage operations; every voice runs that list on its own state, kept as
+// one array per state variable across a fixed pool of voices. Note-on claims
+// a free voice (or steals one) without allocating, and only active voices
+// are processed, so idle voices cost nothing.
+//
+// Oscillators follow the note: the patch's first oscillator sounds at the
+// note's pitch and the others keep their frequency ratio to it. LFOs run at
+// their own rate, wavetable oscillators read the process-wide shared tables
+// (no copy per voice), filters share their coefficients across voices and run
+// one voice per vector lane, and envelopes are gated by note-on/note-off
+// instead of the input level. A voice ends when its envelopes finish the
+// release, or at note-off when the patch has none. Voices run at the patch's
+// sample rate; modulation connections are not evaluated, and LFOs and
+// envelopes that only feed them are left out like in the graph's plan.
+// Parameters are read at construction; build a new pool to pick up patch
+// edits.
+class VoicePool {
+public:
+    struct Options {
+        size_t maxVoices = 16;
+        size_t maxBlockSize = 512;              // Longer renders run block by block
+        const SIMDKernels* kernels = nullptr;   // nullptr = getActiveKernels()
+    };
+    
+    explicit VoicePool(const DSPGraph& patch);
+    VoicePool(const DSPGraph& patch, const Options& options);
+    
+    // Start a MIDI note (0-127) at velocity 0-1 and return its voice. With
+    // every voice busy, the oldest releasing voice is stolen, else the oldest.
+    size_t noteOn(int note, double velocity = 1.0);
+    
+    // Release every voice holding the note
+    void noteOff(int note);
+    void allNotesOff();
+    
+    // Overwrite output with the velocity-weighted sum of the active voices;
+    // allocation-free
+    void process(Sample* output, size_t n);
+    void process(AudioBuffer& output) { process(output.data(), output.size()); }
+    
+    // Silence every voice at once
+    void reset();
+    
+    // Access
+    size_t getActiveVoices() const { return active_.size(); }
+    size_t getMaxVoices() const { return maxVoices_; }
+    size_t getStolenVoices() const { return stolen_; }
+    bool isActive(size_t voice) const { return voice < maxVoices_ && slot_[voice] != kInactive; }
+    int getNote(size_t voice) const { return note_.at(voice); }
+    
+private:
+    static constexpr uint32_t kInactive = UINT32_MAX;
+    
+    enum class EnvPhase : uint8_t { ATTACK, DECAY, SUSTAIN, RELEASE, IDLE };
+    
+    // One compiled stage; index selects its row in the per-kind tables
+    struct Operation {
+        StageType type;
+        size_t index;
+    };
+    
+    struct OscillatorParams {
+        Waveform waveform;
+        bool keyed;           // Oscillator (follows the note) or LFO (fixed rate)
+        double frequency;     // Ratio to the root oscillator when keyed, else Hz
+        double gain;
+        double phaseOffset;
+        std::shared_ptr<const Wavetable> table;   // Set for wavetable oscillators
+    };
+    
+    struct EnvelopeParams {
+        double attackRate;    // Level change per sample
+        double decayRate;
+        double sustain;
+        double releaseRate;
+    };
+    
+    size_t maxVoices_;
+    size_t maxBlockSize_;
+    double sampleRate_;    // The patch graph's
+    const SIMDKernels* kernels_;
+    
+    std::vector<Operation> program_;
+    std::vector<OscillatorParams> oscillators_;
+    std::vector<BiquadCoefficients> filters_;
+    std::vector<EnvelopeParams> envelopes_;
+    
+    // Per-voice state, row r of a stage kind at [r * maxVoices_ + voice]
+    std::vector<double> phase_;
+    std::vector<double> increment_;
+    std::vector<BiquadState> biquad_;
+    std::vector<EnvPhase> envPhase_;
+    std::vector<double> envLevel_;
+    
+    // Per-voice bookkeeping
+    std::vector<int> note_;
+    std::vector<Sample> velocity_;
+    std::vector<uint64_t> started_;    // Note-on order, for stealing
+    std::vector<uint8_t> releasing_;
+    std::vector<uint32_t> slot_;       // Position in active_, or kInactive
+    std::vector<uint32_t> active_;     // Active voices (capacity maxVoices_)
+    std::vector<uint32_t> free_;       // Free voices (capacity maxVoices_)
+    uint64_t noteCounter_ = 0;
+    size_t stolen_ = 0;
+    
+    // Block scratch: one row of maxBlockSize_ samples per voice, plus lane
+    // pointers and gathered filter state for the biquad kernel
+    std::vector<Sample> voiceBuffers_;
+    std::vector<Sample*> lanes_;
+    std::vector<BiquadState> laneState_;
+    
+    size_t claimVoice();
+    void startVoice(size_t voice, int note, double velocity);
+    void releaseVoice(size_t voice);
+    void freeVoice(size_t voice);
+    bool finished(size_t voice) const;
+    void processBlock(Sample* output, size_t n);
+    void applyEnvelope(const EnvelopeParams& envelope, EnvPhase& phase, double& level,
+                       Sample* data, size_t n) const;
+};
+
+} // namespace aiaudio
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "dsp_ir.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace aiaudio {
+
+// Band-limited single-cycle wavetables, mip-mapped by octave. Level m holds
+// the waveform's first kMaxHarmonics >> m harmonics, so a note reads the
+// finest level whose top harmonic stays below Nyquist and never aliases.
+// Tables are immutable once built and shared through a process-wide cache.
+class Wavetable {
+public:
+    static constexpr size_t kTableBits = 11;
+    static constexpr size_t kTableSize = size_t(1) << kTableBits;
+    static constexpr size_t kMaxHarmonics = kTableSize / 2;
+    static constexpr size_t kLevels = kTableBits;           // kMaxHarmonics ... 1 harmonic
+    static constexpr size_t kLevelStride = kTableSize + 1;  // Guard sample repeats the first
+    
+    // Additive build from per-harmonic sine and cosine amplitudes (index 0 =
+    // fundamental); harmonics past kMaxHarmonics are ignored
+    static std::shared_ptr<const Wavetable> fromHarmonics(const std::vector<double>& sineAmplitudes,
+                                                          const std::vector<double>& cosineAmplitudes = {});
+    
+    // Finest level without aliasing for a phase increment in cycles per
+    // sample; computed once per block
+    static size_t levelFor(double cyclesPerSample);
+    
+    const float* level(size_t m) const { return samples_.data() + m * kLevelStride; }
+    
+    size_t memoryBytes() const { return samples_.size() * sizeof(float); }
+    
+    // Linear interpolation at a 32-bit fixed-point phase (2^32 = one cycle)
+    static float lookup(const float* table, uint32_t phase) {
+        constexpr unsigned kFracBits = 32 - kTableBits;
+        const uint32_t index = phase >> kFracBits;
+        const float frac = static_cast<float>(phase & ((uint32_t(1) << kFracBits) - 1)) *
+                           (1.0f / static_cast<float>(uint32_t(1) << kFracBits));
+        const float a = table[index];
+        return a + (table[index + 1] - a) * frac;
+    }
+    
+private:
+    Wavetable() = default;
+    std::vector<float> samples_;    // kLevels x kLevelStride
+};
+
+// Shared tables for the standard waveforms, built on first use. Every stage
+// and voice reading a waveform holds the same table.
+std::shared_ptr<const Wavetable> sharedWavetable(Waveform waveform);
+
+// Release cached tables no stage holds any more; returns the bytes freed
+size_t trimWavetableCache();
+
+// Bytes held by the cache
+size_t wavetableCacheBytes();
+
+// output = table * gain + input over n samples, advancing phase (radians)
+// by increment and gain by gainStep per sample like renderOscillator. The
+// mip level is chosen once for the block and each sample is a fixed-point
+// table read.
+void renderWavetable(const Wavetable& table, const Sample* input, Sample* output, size_t n,
+                     double& phase, double increment, double phaseOffset, double gain,
+                     double gainStep = 0.0);
+
+// Wavetable oscillator: the parameters of OscillatorStage, rendered from
+// the shared band-limited tables instead of per-sample sin and naive
+// (aliasing) saw, square and triangle. Clones share the table.
+class WavetableStage : public DSPStage {
+public:
+    enum Param : int { FREQUENCY, AMPLITUDE, PHASE, WAVE_TYPE };
+    
+    WavetableStage();
+    
+    // Same parameters as an existing oscillator, from phase 0
+    explicit WavetableStage(const OscillatorStage& oscillator);
+    
+    StageType getType() const override { return StageType::WAVETABLE; }
+    void process(const AudioBuffer& input, AudioBuffer& output) override;
+    void processChannels(const PlanarBuffer& input, PlanarBuffer& output) override;
+    void setParameter(const std::string& name, const ParamValue& value) override;
+    ParamValue getParameter(const std::string& name) const override;
+    void setParameterValue(int index, double value) override;
+    double getParameterValue(int index) const override;
+    std::vector<std::string> getParameterNames() const override;
+    int getParameterIndex(const std::string& name) const override;
+    void reset() override;
+    std::string getDescription() const override;
+    std::unique_ptr<DSPStage> clone() const override { return std::make_unique<WavetableStage>(*this); }
+    ParamRange getParameterRange(int index) const override;
+    void setParameterTarget(int index, double value, size_t frames) override;
+    void setSampleRate(double sampleRate) override { sampleRate_ = sampleRate; }
+    
+    const Wavetable& getTable() const { return *table_; }
+    
+private:
+    RangedParam<Hz> frequency_{440.0, 20.0, 20000.0, "frequency"};
+    RangedParam<Percent> amplitude_{0.5, 0.0, 1.0, "amplitude"};
+    RangedParam<Percent> phase_{0.0, 0.0, 1.0, "phase"};
+    Waveform waveform_ = Waveform::SINE;
+    std::shared_ptr<const Wavetable> table_;
+    double phaseAccumulator_ = 0.0;
+    double sampleRate_ = 44100.0;
+    
+    // Amplitude ramp, as in OscillatorStage
+    double rampGain_ = 0.0;
+    size_t rampRemaining_ = 0;
+    bool hasGain_ = false;
+    
+    void setWaveform(Waveform waveform);
+    
+    // One channel of a block, ramping the gain while a ramp is pending;
+    // advanceRamp then moves the ramp past the block
+    void render(const Sample* input, Sample* output, size_t n, double& phase, double increment,
+                double phaseOffset);
+    void advanceRamp(size_t n);
+};
+
+} // namespace aiaudio
@@ -0,0 +1,264 @@
+#include "ann_index.h"
+#include "simd_kernels.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace aiaudio {
+
+namespace {
+
+// Rows per parallel assignment task
+constexpr size_t kAssignChunk = 256;
+
+// Retrain once the index has grown this much past its training set
+constexpr size_t kRetrainGrowth = 4;
+
+void normalizeInPlace(float* v, size_t n) {
+    double norm = 0.0;
+    for (size_t i = 0; i < n; ++i) norm += static_cast<double>(v[i]) * v[i];
+    if (norm <= 0.0) return;
+    
+    float scale = static_cast<float>(1.0 / std::sqrt(norm));
+    for (size_t i = 0; i < n; ++i) v[i] *= scale;
+}
+
+} // namespace
+
+IVFIndex::IVFIndex() : IVFIndex(Params{}) {
+}
+
+IVFIndex::IVFIndex(const Params& params) : params_(params) {
+}
+
+void IVFIndex::rebuild(const VectorMatrixView& matrix) {
+    clear();
+    dimension_ = matrix.dimension;
+    
+    if (matrix.rows >= params_.minTrainSize) {
+        train(matrix);
+        return;
+    }
+    
+    postings_.resize(kNumRoles);
+    for (size_t row = 0; row < matrix.rows; ++row) {
+        assign(row, 0, matrix.roles[row]);
+    }
+}
+
+void IVFIndex::insert(const VectorMatrixView& matrix, size_t row) {
+    if (postings_.empty()) {
+        dimension_ = matrix.dimension;
+        postings_.resize(kNumRoles);
+    }
+    
+    // Training reassigns every row, including this one
+    bool firstTraining = !isTrained() && matrix.rows >= params_.minTrainSize;
+    bool outgrown = isTrained() && matrix.rows > kRetrainGrowth * trainedRows_;
+    if (firstTraining || outgrown) {
+        train(matrix);
+        return;
+    }
+    
+    erase(row);
+    assign(row, isTrained() ? nearestList(matrix.row(row)) : 0, matrix.roles[row]);
+}
+
+void IVFIndex::erase(size_t row) {
+    if (row >= slots_.size() || slots_[row].posting == kNoSlot) return;
+    
+    Slot slot = slots_[row];
+    auto& posting = postings_[slot.posting];
+    size_t moved = posting.back();
+    posting[slot.position] = moved;
+    slots_[moved].position = slot.position;
+    posting.pop_back();
+    slots_[row] = Slot{};
+}
+
+void IVFIndex::renumber(size_t from, size_t to) {
+    if (from >= slots_.size() || slots_[from].posting == kNoSlot) return;
+    
+    if (to >= slots_.size()) slots_.resize(to + 1);
+    Slot slot = slots_[from];
+    postings_[slot.posting][slot.position] = to;
+    slots_[to] = slot;
+    slots_[from] = Slot{};
+    
+    while (!slots_.empty() && slots_.back().posting == kNoSlot) {
+        slots_.pop_back();
+    }
+}
+
+void IVFIndex::clear() {
+    centroids_.clear();
+    postings_.clear();
+    slots_.clear();
+    trainedRows_ = 0;
+}
+
+void IVFIndex::collectCandidates(const VectorMatrixView& /*matrix*/,
+                                 const float* query,
+                                 Role role,
+                                 size_t minCandidates,
+                                 std::vector<size_t>& out) const {
+    if (postings_.empty()) return;
+    
+    size_t collected = 0;
+    auto scanList = [&](size_t list) {
+        const size_t base = list * kNumRoles;
+        if (role == Role::UNKNOWN) {
+            for (size_t r = 0; r < kNumRoles; ++r) {
+                out.insert(out.end(), postings_[base + r].begin(), postings_[base + r].end());
+                collected += postings_[base + r].size();
+            }
+        } else {
+            const auto& posting = postings_[base + static_cast<size_t>(role)];
+            out.insert(out.end(), posting.begin(), posting.end());
+            collected += posting.size();
+        }
+    };
+    
+    if (!isTrained()) {
+        scanList(0);
+        return;
+    }
+    
+    // Rank lists by centroid similarity
+    const auto dot = getActiveKernels().dotProduct;
+    const size_t nlist = getListCount();
+    std::vector<std::pair<float, size_t>> order(nlist);
+    for (size_t list = 0; list < nlist; ++list) {
+        order[list] = {dot(query, centroids_.data() + list * dimension_, dimension_), list};
+    }
+    auto closer = [](const auto& a, const auto& b) { return a.first > b.first; };
+    
+    size_t nprobe = std::clamp<size_t>(params_.nprobe, 1, nlist);
+    std::partial_sort(order.begin(), order.begin() + nprobe, order.end(), closer);
+    for (size_t i = 0; i < nprobe; ++i) {
+        scanList(order[i].second);
+    }
+    
+    // A sparse role can leave the probed lists short; widen until there are
+    // enough candidates rather than returning a truncated top-k
+    if (collected < minCandidates && nprobe < nlist) {
+        std::sort(order.begin() + nprobe, order.end(), closer);
+        for (size_t i = nprobe; i < nlist && collected < minCandidates; ++i) {
+            scanList(order[i].second);
+        }
+    }
+}
+
+void IVFIndex::train(const VectorMatrixView& matrix) {
+    clear();
+    dimension_ = matrix.dimension;
+    if (matrix.rows == 0 || dimension_ == 0) {
+        postings_.resize(kNumRoles);
+        return;
+    }
+    
+    size_t nlist = params_.nlist ? params_.nlist
+                                 : static_cast<size_t>(std::sqrt(static_cast<double>(matrix.rows)));
+    nlist = std::clamp<size_t>(nlist, 1, matrix.rows);
+    runKMeans(matrix, nlist);
+    
+    // Nearest list per row in parallel, then fill the postings serially
+    std::vector<uint32_t> lists(matrix.rows);
+    size_t chunks = (matrix.rows + kAssignChunk - 1) / kAssignChunk;
+    ThreadPool::shared()->parallelFor(chunks, [&](size_t chunk) {
+        size_t end = std::min(matrix.rows, (chunk + 1) * kAssignChunk);
+        for (size_t row = chunk * kAssignChunk; row < end; ++row) {
+            lists[row] = static_cast<uint32_t>(nearestList(matrix.row(row)));
+        }
+    });
+    
+    postings_.assign(nlist * kNumRoles, {});
+    slots_.assign(matrix.rows, Slot{});
+    for (size_t row = 0; row < matrix.rows; ++row) {
+        assign(row, lists[row], matrix.roles[row]);
+    }
+    trainedRows_ = matrix.rows;
+}
+
+size_t IVFIndex::nearestList(const float* vector) const {
+    const auto dot = getActiveKernels().dotProduct;
+    const size_t nlist = getListCount();
+    
+    size_t best = 0;
+    float bestScore = -2.0f;
+    for (size_t list = 0; list < nlist; ++list) {
+        float score = dot(vector, centroids_.data() + list * dimension_, dimension_);
+        if (score > bestScore) {
+            bestScore = score;
+            best = list;
+        }
+    }
+    return best;
+}
+
+void IVFIndex::assign(size_t row, size_t list, Role role) {
+    size_t posting = list * kNumRoles + static_cast<size_t>(role);
+    if (row >= slots_.size()) slots_.resize(row + 1);
+    
+    slots_[row] = Slot{static_cast<uint32_t>(posting), static_cast<uint32_t>(postings_[posting].size())};
+    postings_[posting].push_back(row);
+}
+
+void IVFIndex::runKMeans(const VectorMatrixView& matrix, size_t nlist) {
+    std::mt19937 rng(params_.seed);
+    
+    // Random training sample; the first nlist rows of it seed the centroids
+    std::vector<size_t> sample(matrix.rows);
+    std::iota(sample.begin(), sample.end(), 0);
+    size_t sampleSize = std::min(matrix.rows, std::max(nlist, nlist * params_.trainSamplesPerList));
+    for (size_t i = 0; i < sampleSize; ++i) {
+        std::uniform_int_distribution<size_t> pick(i, matrix.rows - 1);
+        std::swap(sample[i], sample[pick(rng)]);
+    }
+    sample.resize(sampleSize);
+    
+    centroids_.assign(nlist * dimension_, 0.0f);
+    for (size_t list = 0; list < nlist; ++list) {
+        std::copy_n(matrix.row(sample[list]), dimension_, centroids_.data() + list * dimension_);
+    }
+    
+    std::vector<uint32_t> labels(sampleSize);
+    std::vector<float> sums(nlist * dimension_);
+    std::vector<size_t> counts(nlist);
+    std::uniform_int_distribution<size_t> anySample(0, sampleSize - 1);
+    size_t chunks = (sampleSize + kAssignChunk - 1) / kAssignChunk;
+    
+    for (size_t iteration = 0; iteration < params_.kmeansIterations; ++iteration) {
+        ThreadPool::shared()->parallelFor(chunks, [&](size_t chunk) {
+            size_t end = std::min(sampleSize, (chunk + 1) * kAssignChunk);
+            for (size_t i = chunk * kAssignChunk; i < end; ++i) {
+                labels[i] = static_cast<uint32_t>(nearestList(matrix.row(sample[i])));
+            }
+        });
+        
+        std::fill(sums.begin(), sums.end(), 0.0f);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (size_t i = 0; i < sampleSize; ++i) {
+            const float* v = matrix.row(sample[i]);
+            float* sum = sums.data() + labels[i] * dimension_;
+            for (size_t d = 0; d < dimension_; ++d) sum[d] += v[d];
+            ++counts[labels[i]];
+        }
+        
+        // Spherical k-means: centroids are unit-length means; empty lists
+        // are reseeded from a random sample row
+        for (size_t list = 0; list < nlist; ++list) {
+            float* centroid = centroids_.data() + list * dimension_;
+            if (counts[list] == 0) {
+                std::copy_n(matrix.row(sample[anySample(rng)]), dimension_, centroid);
+            } else {
+                std::copy_n(sums.data() + list * dimension_, dimension_, centroid);
+                normalizeInPlace(centroid, dimension_);
+            }
+        }
+    }
+}
+
+} // namespace aiaudio
@@ -1,4 +1,6 @@
 #include "audio_safety.h"
+#include "meters.h"
+#include "simd_kernels.h"
 #include <algorithm>
 #include <cmath>
 #include <numeric>
@@ -47,7 +49,7 @@ void GainStager::autoGainStage(DSPGraph& graph) {
 
 double GainStager::calculateStageGain(const DSPStage& stage) {
     // Calculate gain based on stage type and parameters
-    if (stage.getType() == StageType::OSCILLATOR) {
+    if (isOscillatorType(stage.getType())) {
         auto amp = stage.getParameter("amplitude");
         if (std::holds_alternative<double>(amp)) {
             double amplitude = std::get<double>(amp);
@@ -59,7 +61,7 @@ double GainStager::calculateStageGain(const DSPStage& stage) {
 }
 
 void GainStager::adjustStageGain(DSPStage& stage, double targetGain) {
-    if (stage.getType() == StageType::OSCILLATOR) {
+    if (isOscillatorType(stage.getType())) {
         auto amp = stage.getParameter("amplitude");
         if (std::holds_alternative<double>(amp)) {
             double currentAmp = std::get<double>(amp);
@@ -76,9 +78,7 @@ void TruePeakLimiter::limitTruePeak(AudioBuffer& audio, double limitDb) {
     
     if (truePeak > limitLinear) {
         double gain = limitLinear / truePeak;
-        for (double& sample : audio) {
-            sample *= gain;
-        }
+        getActiveKernels().applyGain(audio.data(), audio.size(), static_cast<Sample>(gain));
     }
 }
 
@@ -95,11 +95,9 @@ void TruePeakLimiter::hardLimit(AudioBuffer& audio, double limit) {
 }
 
 double TruePeakLimiter::calculateTruePeak(const AudioBuffer& audio) {
-    double maxPeak = 0.0;
-    for (double sample : audio) {
-        maxPeak = std::max(maxPeak, std::abs(sample));
-    }
-    return maxPeak;
+    TruePeakMeter meter;
+    meter.process(audio);
+    return meter.getTruePeak();
 }
 
 void TruePeakLimiter::applySoftLimiter(AudioBuffer& audio, double threshold, double ratio) {
@@ -124,14 +122,7 @@ void TruePeakLimiter::applySoftLimiter(AudioBuffer& audio, double threshold, dou
 
 void TruePeakLimiter::applyHardLimiter(AudioBuffer& audio, double limit) {
     double limitLinear = std::pow(10.0, limit / 20.0);
-    
-    for (double& sample : audio) {
-        if (sample > limitLinear) {
-            sample = limitLinear;
-        } else if (sample < -limitLinear) {
-            sample = -limitLinear;
-        }
-    }
+    getActiveKernels().clampSymmetric(audio.data(), audio.size(), static_cast<Sample>(limitLinear));
 }
 
 // FeedbackGuard implementation
@@ -166,7 +157,7 @@ double FeedbackGuard::findFeedbackLoops(const DSPGraph& graph) {
         auto* stage = graph.getStage(stageName);
         if (stage) {
             // Estimate gain contribution
-            if (stage->getType() == StageType::OSCILLATOR) {
+            if (isOscillatorType(stage->getType())) {
                 auto amp = stage->getParameter("amplitude");
                 if (std::holds_alternative<double>(amp)) {
                     totalGain *= std::get<double>(amp);
@@ -301,7 +292,7 @@ void HeadroomManager::manageHeadroom(DSPGraph& graph, double targetHeadroom) {
         auto* stage = graph.getStage(stageName);
         if (stage) {
             // Adjust stage parameters to maintain headroom
-            if (stage->getType() == StageType::OSCILLATOR) {
+            if (isOscillatorType(stage->getType())) {
                 auto amp = stage->getParameter("amplitude");
                 if (std::holds_alternative<double>(amp)) {
                     double currentAmp = std::get<double>(amp);
@@ -351,24 +342,32 @@ void HeadroomManager::adjustHeadroom(AudioBuffer& audio, double targetHeadroom)
 
 // AudioValidator implementation
 std::vector<std::string> AudioValidator::validateAudio(const AudioBuffer& audio) {
+    return validateAudio(analyzeAudio(audio));
+}
+
+std::vector<std::string> AudioValidator::validateAudio(const AudioStats& stats) {
     std::vector<std::string> issues;
     
-    if (checkClipping(audio)) {
+    if (checkClipping(stats)) {
         issues.push_back("Audio clipping detected");
     }
     
-    if (checkDCOffset(audio)) {
+    if (checkDCOffset(stats)) {
         issues.push_back("DC offset detected");
     }
     
-    if (checkSilence(audio)) {
+    if (checkSilence(stats)) {
         issues.push_back("Audio is silent or too quiet");
     }
     
-    if (checkDenormals(audio)) {
+    if (checkDenormals(stats)) {
         issues.push_back("Denormal numbers detected");
     }
     
+    if (checkNonFinite(stats)) {
+        issues.push_back("NaN or infinite samples detected");
+    }
+    
     return issues;
 }
 
@@ -423,40 +422,24 @@ std::vector<std::string> AudioValidator::checkParameterViolations(const DSPGraph
     return violations;
 }
 
-bool AudioValidator::checkClipping(const AudioBuffer& audio) {
-    for (double sample : audio) {
-        if (std::abs(sample) >= 1.0) {
-            return true;
-        }
-    }
-    return false;
+bool AudioValidator::checkClipping(const AudioStats& stats) {
+    return stats.clippedSamples > 0;
 }
 
-bool AudioValidator::checkDCOffset(const AudioBuffer& audio) {
-    double sum = 0.0;
-    for (double sample : audio) {
-        sum += sample;
-    }
-    double dcOffset = sum / audio.size();
-    return std::abs(dcOffset) > 0.001;
+bool AudioValidator::checkDCOffset(const AudioStats& stats) {
+    return std::abs(stats.dcOffset) > 0.001;
 }
 
-bool AudioValidator::checkSilence(const AudioBuffer& audio) {
-    double rms = 0.0;
-    for (double sample : audio) {
-        rms += sample * sample;
-    }
-    rms = std::sqrt(rms / audio.size());
-    return rms < 0.001;
+bool AudioValidator::checkSilence(const AudioStats& stats) {
+    return stats.rms < 0.001;
 }
 
-bool AudioValidator::checkDenormals(const AudioBuffer& audio) {
-    for (double sample : audio) {
-        if (std::fpclassify(sample) == FP_SUBNORMAL) {
-            return true;
-        }
-    }
-    return false;
+bool AudioValidator::checkDenormals(const AudioStats& stats) {
+    return stats.denormalSamples > 0;
+}
+
+bool AudioValidator::checkNonFinite(const AudioStats& stats) {
+    return stats.nonFiniteSamples > 0;
 }
 
 bool AudioValidator::checkParameterRanges(const DSPGraph& graph) {
@@ -471,66 +454,26 @@ bool SafetyMonitor::monitorSafety(const AudioBuffer& audio) {
 }
 
 SafetyMonitor::SafetyMetrics SafetyMonitor::getSafetyMetrics(const AudioBuffer& audio) {
-    return calculateSafetyMetrics(audio);
+    return calculateSafetyMetrics(analyzeAudio(audio));
+}
+
+SafetyMonitor::SafetyMetrics SafetyMonitor::getSafetyMetrics(const AudioStats& stats) {
+    return calculateSafetyMetrics(stats);
 }
 
 bool SafetyMonitor::checkSafetyThresholds(const SafetyMetrics& metrics) {
     return isWithinThresholds(metrics);
 }
 
-SafetyMonitor::SafetyMetrics SafetyMonitor::calculateSafetyMetrics(const AudioBuffer& audio) {
+SafetyMonitor::SafetyMetrics SafetyMonitor::calculateSafetyMetrics(const AudioStats& stats) {
     SafetyMetrics metrics;
-    
-    // Calculate true peak
-    double maxPeak = 0.0;
-    for (double sample : audio) {
-        maxPeak = std::max(maxPeak, std::abs(sample));
-    }
-    metrics.truePeak = 20.0 * std::log10(std::max(maxPeak, 1e-10));
-    
-    // Calculate RMS
-    double sum = 0.0;
-    for (double sample : audio) {
-        sum += sample * sample;
-    }
-    double rms = std::sqrt(sum / audio.size());
-    metrics.rms = 20.0 * std::log10(std::max(rms, 1e-10));
-    
-    // Calculate crest factor
-    if (rms > 0.0) {
-        metrics.crestFactor = 20.0 * std::log10(maxPeak / rms);
-    } else {
-        metrics.crestFactor = 0.0;
-    }
-    
-    // Calculate DC offset
-    double dcSum = 0.0;
-    for (double sample : audio) {
-        dcSum += sample;
-    }
-    metrics.dcOffset = 20.0 * std::log10(std::max(std::abs(dcSum / audio.size()), 1e-10));
-    
-    // Check for clipping
-    metrics.clipping = false;
-    for (double sample : audio) {
-        if (std::abs(sample) >= 1.0) {
-            metrics.clipping = true;
-            break;
-        }
-    }
-    
-    // Check for denormals
-    metrics.denormals = false;
-    for (double sample : audio) {
-        if (std::fpclassify(sample) == FP_SUBNORMAL) {
-            metrics.denormals = true;
-            break;
-        }
-    }
-    
-    // Calculate headroom
-    metrics.headroom = 20.0 * std::log10(1.0 / std::max(maxPeak, 1e-10));
-    
+    metrics.truePeak = stats.truePeakDb();
+    metrics.rms = stats.rmsDb();
+    metrics.crestFactor = stats.crestFactorDb;
+    metrics.dcOffset = 20.0 * std::log10(std::max(std::abs(stats.dcOffset), 1e-10));
+    metrics.clipping = stats.clippedSamples > 0;
+    metrics.denormals = stats.denormalSamples > 0 || stats.nonFiniteSamples > 0;
+    metrics.headroom = -metrics.truePeak;
     return metrics;
 }
 
@@ -0,0 +1,232 @@
+#include "audio_stats.h"
+#include "meters.h"
+#include "spectral.h"
+#include <algorithm>
+#include <cmath>
+
+namespace aiaudio {
+
+namespace {
+
+constexpr double kBlockSeconds = 0.1;        // Loudness block (gating step)
+constexpr size_t kBlocksPerWindow = 4;       // 400 ms gating window
+constexpr double kRelativeGate = -10.0;      // LU below the abs-gated loudness
+constexpr double kLoudnessOffset = -0.691;   // BS.1770 calibration
+
+// The K-weighting runs on up to kMaxLanes segments side by side, one per
+// vector lane. Each lane first filters the block before its segment, by
+// which point the filter transients are far below float resolution.
+constexpr size_t kMaxLanes = 8;
+constexpr size_t kFilterChunk = 1024;
+
+double loudness(double meanSquare) {
+    return meanSquare > 0.0 ? kLoudnessOffset + 10.0 * std::log10(meanSquare) : kLoudnessFloor;
+}
+
+double gatedLoudness(const std::vector<double>& blocks) {
+    std::vector<double> windows;
+    windows.reserve(blocks.size() - kBlocksPerWindow + 1);
+    for (size_t j = 0; j + kBlocksPerWindow <= blocks.size(); ++j) {
+        double sum = 0.0;
+        for (size_t b = 0; b < kBlocksPerWindow; ++b) sum += blocks[j + b];
+        windows.push_back(sum / kBlocksPerWindow);
+    }
+    
+    auto meanAbove = [&](double gate, size_t& count) {
+        double sum = 0.0;
+        count = 0;
+        for (double z : windows) {
+            if (loudness(z) > gate) {
+                sum += z;
+                ++count;
+            }
+        }
+        return count ? sum / count : 0.0;
+    };
+    
+    size_t count = 0;
+    double absoluteMean = meanAbove(kLoudnessFloor, count);
+    if (count == 0) return kLoudnessFloor;
+    
+    double relativeGate = std::max(kLoudnessFloor, loudness(absoluteMean) + kRelativeGate);
+    double gatedMean = meanAbove(relativeGate, count);
+    return std::max(kLoudnessFloor, loudness(gatedMean));
+}
+
+// K-weighted energy per block (the last block may be partial)
+std::vector<double> kWeightedBlockEnergy(const SIMDKernels& kernels, const AudioBuffer& audio,
+                                         double sampleRate, size_t blockSize) {
+    const size_t n = audio.size();
+    const auto filters = kWeightingFilter(sampleRate);
+    std::vector<double> energy((n + blockSize - 1) / blockSize, 0.0);
+    
+    // Lane l owns [l * segment, (l + 1) * segment). Reads before the start
+    // of the buffer are zeros, which leave the zero initial state unchanged.
+    const size_t lanes = std::clamp<size_t>(n / (4 * blockSize), 1, kMaxLanes);
+    const size_t warmup = lanes > 1 ? blockSize : 0;
+    const size_t segment = (n + lanes - 1) / lanes;
+    const size_t laneLength = warmup + segment;
+    
+    std::vector<Sample> staging(lanes * kFilterChunk);
+    std::vector<Sample> scratch(lanes * kFilterChunk);
+    BiquadState shelf[kMaxLanes] = {};
+    BiquadState highPass[kMaxLanes] = {};
+    const Sample* in[kMaxLanes];
+    Sample* out[kMaxLanes];
+    
+    for (size_t t = 0; t < laneLength; t += kFilterChunk) {
+        const size_t len = std::min(kFilterChunk, laneLength - t);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            const ptrdiff_t start = static_cast<ptrdiff_t>(lane * segment + t) - static_cast<ptrdiff_t>(warmup);
+            out[lane] = scratch.data() + lane * kFilterChunk;
+            if (start >= 0 && static_cast<size_t>(start) + len <= n) {
+                in[lane] = audio.data() + start;
+                continue;
+            }
+            Sample* staged = staging.data() + lane * kFilterChunk;
+            for (size_t j = 0; j < len; ++j) {
+                ptrdiff_t pos = start + static_cast<ptrdiff_t>(j);
+                staged[j] = pos >= 0 && static_cast<size_t>(pos) < n ? audio[pos] : 0.0f;
+            }
+            in[lane] = staged;
+        }
+        
+        kernels.biquad(in, out, lanes, len, filters[0], shelf);
+        kernels.biquad(out, out, lanes, len, filters[1], highPass);
+        
+        // Keep each lane's outputs inside its own segment, split at blocks
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            const ptrdiff_t start = static_cast<ptrdiff_t>(lane * segment + t) - static_cast<ptrdiff_t>(warmup);
+            const ptrdiff_t laneBegin = static_cast<ptrdiff_t>(lane * segment);
+            const ptrdiff_t laneEnd = static_cast<ptrdiff_t>(std::min(n, (lane + 1) * segment));
+            ptrdiff_t begin = std::max(start, laneBegin);
+            const ptrdiff_t end = std::min(start + static_cast<ptrdiff_t>(len), laneEnd);
+            while (begin < end) {
+                size_t block = static_cast<size_t>(begin) / blockSize;
+                ptrdiff_t stop = std::min(end, static_cast<ptrdiff_t>((block + 1) * blockSize));
+                energy[block] += kernels.sumSquares(out[lane] + (begin - start), stop - begin);
+                begin = stop;
+            }
+        }
+    }
+    return energy;
+}
+
+} // namespace
+
+double AudioStats::peakDb() const {
+    return 20.0 * std::log10(std::max(peak, 1e-10));
+}
+
+double AudioStats::truePeakDb() const {
+    return 20.0 * std::log10(std::max(truePeak, 1e-10));
+}
+
+double AudioStats::rmsDb() const {
+    return 20.0 * std::log10(std::max(rms, 1e-10));
+}
+
+double AudioStats::zeroCrossingRate() const {
+    return samples ? zeroCrossings * sampleRate / samples : 0.0;
+}
+
+AudioStats analyzeAudio(const AudioBuffer& audio, double sampleRate) {
+    if (sampleRate <= 0.0) {
+        throw AIAudioException("Sample rate must be positive");
+    }
+    
+    SpectralAnalysis::Options options;
+    options.fftSizes = {kCentroidFFTSize};
+    options.hopDivisor = 1;
+    return analyzeAudio(audio, SpectralAnalysis(audio, sampleRate, options));
+}
+
+AudioStats analyzeAudio(const AudioBuffer& audio, const SpectralAnalysis& spectra) {
+    const double sampleRate = spectra.getSampleRate();
+    if (sampleRate <= 0.0) {
+        throw AIAudioException("Sample rate must be positive");
+    }
+    
+    if (audio.empty()) return statsFromMoments(SampleStats{}, 0, sampleRate);
+    
+    const SIMDKernels& kernels = getActiveKernels();
+    SampleStats moments;
+    kernels.sampleStats(audio.data(), audio.size(), kSilenceThreshold, moments);
+    
+    AudioStats stats = statsFromMoments(moments, audio.size(), sampleRate);
+    stats.spectralCentroid = spectra.spectralCentroid();
+    
+    TruePeakMeter truePeak;
+    truePeak.process(audio);
+    stats.truePeak = std::max(truePeak.getTruePeak(), stats.peak);
+    
+    const size_t blockSize = std::max<size_t>(1, static_cast<size_t>(std::lround(sampleRate * kBlockSeconds)));
+    std::vector<double> energy = kWeightedBlockEnergy(kernels, audio, sampleRate, blockSize);
+    const size_t completeBlocks = audio.size() / blockSize;
+    stats.loudnessBlocks.resize(completeBlocks);
+    for (size_t b = 0; b < completeBlocks; ++b) {
+        stats.loudnessBlocks[b] = energy[b] / blockSize;
+    }
+    
+    if (completeBlocks >= kBlocksPerWindow) {
+        stats.integratedLoudness = gatedLoudness(stats.loudnessBlocks);
+    } else {
+        double total = 0.0;
+        for (double e : energy) total += e;
+        stats.integratedLoudness = std::max(kLoudnessFloor, loudness(total / audio.size()));
+    }
+    return stats;
+}
+
+AudioStats statsFromMoments(const SampleStats& moments, size_t samples, double sampleRate) {
+    AudioStats stats;
+    stats.samples = samples;
+    stats.sampleRate = sampleRate;
+    if (samples == 0) return stats;
+    
+    const double n = static_cast<double>(samples);
+    stats.peak = moments.peak;
+    stats.dcOffset = moments.sum / n;
+    stats.rms = std::sqrt(moments.sumSquares / n);
+    stats.variance = std::max(0.0, moments.sumSquares / n - stats.dcOffset * stats.dcOffset);
+    stats.crestFactorDb = stats.rms < 1e-10 ? 0.0 : 20.0 * std::log10(stats.peak / stats.rms);
+    
+    stats.clippedSamples = moments.clipped;
+    stats.denormalSamples = moments.denormals;
+    stats.nonFiniteSamples = moments.nonFinite;
+    stats.silentSamples = moments.silent;
+    stats.zeroCrossings = moments.zeroCrossings;
+    return stats;
+}
+
+std::array<BiquadCoefficients, 2> kWeightingFilter(double sampleRate) {
+    // Pre-warped analog prototypes matching the BS.1770 48 kHz coefficients
+    constexpr double kShelfFrequency = 1681.974450955533;
+    constexpr double kShelfGainDb = 3.999843853973347;
+    constexpr double kShelfQ = 0.7071752369554196;
+    constexpr double kHighPassFrequency = 38.13547087602444;
+    constexpr double kHighPassQ = 0.5003270373238773;
+    
+    std::array<BiquadCoefficients, 2> filters;
+    
+    double k = std::tan(M_PI * kShelfFrequency / sampleRate);
+    double vh = std::pow(10.0, kShelfGainDb / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / kShelfQ + k * k;
+    filters[0].b0 = (vh + vb * k / kShelfQ + k * k) / a0;
+    filters[0].b1 = 2.0 * (k * k - vh) / a0;
+    filters[0].b2 = (vh - vb * k / kShelfQ + k * k) / a0;
+    filters[0].a1 = 2.0 * (k * k - 1.0) / a0;
+    filters[0].a2 = (1.0 - k / kShelfQ + k * k) / a0;
+    
+    k = std::tan(M_PI * kHighPassFrequency / sampleRate);
+    a0 = 1.0 + k / kHighPassQ + k * k;
+    filters[1].b0 = 1.0;
+    filters[1].b1 = -2.0;
+    filters[1].b2 = 1.0;
+    filters[1].a1 = 2.0 * (k * k - 1.0) / a0;
+    filters[1].a2 = (1.0 - k / kHighPassQ + k * k) / a0;
+    return filters;
+}
+
+} // namespace aiaudio
@@ -0,0 +1,446 @@
+#include "compiled_preset.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "wavetable.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
+
+namespace aiaudio {
+
+namespace {
+
+// Compiled preset, version 2, host byte order (little-endian on every
+// supported target):
+//   PresetFileHeader
+//   graph        float64 sample rate, uint32 control interval
+//   stages       per stage in execution order: name, uint8 StageType,
+//                uint32 count, count x float64 indexed parameter values
+//   connections  per connection: uint32 source and destination stage
+//                positions, parameter, float64 amount, uint8 enabled
+// Strings are a uint32 length and the bytes. The checksum covers every byte
+// after the header. Bump the version whenever a stage's parameter list
+// changes, which invalidates every cached copy.
+static_assert(std::endian::native == std::endian::little, "compiled presets are little-endian");
+
+constexpr char kPresetMagic[8] = {'A', 'I', 'A', 'P', 'R', 'S', 'T', '\0'};
+constexpr uint32_t kPresetVersion = 2;
+
+struct PresetFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t stageCount;
+    uint32_t connectionCount;
+    uint32_t reserved;
+    uint64_t sourceHash;
+    uint64_t fileSize;
+    uint64_t checksum;
+};
+static_assert(std::is_trivially_copyable_v<PresetFileHeader>);
+
+constexpr uint64_t kFNVOffset = 0xcbf29ce484222325ull;
+constexpr uint64_t kFNVPrime = 0x100000001b3ull;
+
+// FNV-1a over 64-bit words, then the tail bytes
+uint64_t presetChecksum(const uint8_t* data, size_t size) {
+    uint64_t hash = kFNVOffset;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * kFNVPrime;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * kFNVPrime;
+    }
+    return hash;
+}
+
+// Stage types a compiled preset can hold
+std::unique_ptr<DSPStage> makeStage(StageType type) {
+    switch (type) {
+        case StageType::OSCILLATOR: return std::make_unique<OscillatorStage>();
+        case StageType::WAVETABLE: return std::make_unique<WavetableStage>();
+        case StageType::FILTER: return std::make_unique<FilterStage>();
+        case StageType::ENVELOPE: return std::make_unique<EnvelopeStage>();
+        case StageType::LFO: return std::make_unique<LFOStage>();
+        case StageType::SPATIAL: return std::make_unique<SpatialStage>();
+        default: return nullptr;
+    }
+}
+
+class PresetWriter {
+public:
+    void put(const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        buffer_.insert(buffer_.end(), bytes, bytes + size);
+    }
+    
+    template<typename T>
+    void pod(T value) { put(&value, sizeof(value)); }
+    
+    void string(const std::string& value) {
+        pod(static_cast<uint32_t>(value.size()));
+        put(value.data(), value.size());
+    }
+    
+    std::vector<uint8_t>& bytes() { return buffer_; }
+    
+private:
+    std::vector<uint8_t> buffer_;
+};
+
+[[noreturn]] void rejectPreset(const std::string& source, const std::string& reason) {
+    throw AIAudioException("Invalid compiled preset " + source + ": " + reason);
+}
+
+// Bounds-checked reads over the compiled bytes
+class PresetReader {
+public:
+    PresetReader(const uint8_t* data, size_t size, size_t offset, const std::string& source)
+        : data_(data), size_(size), pos_(offset), source_(source) {
+    }
+    
+    template<typename T>
+    T pod() {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+    
+    std::string string() {
+        uint32_t length = pod<uint32_t>();
+        const uint8_t* data = take(length);
+        return std::string(reinterpret_cast<const char*>(data), length);
+    }
+    
+    bool atEnd() const { return pos_ == size_; }
+    
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+    const std::string& source_;
+    
+    const uint8_t* take(size_t size) {
+        if (size > size_ - pos_) rejectPreset(source_, "truncated");
+        const uint8_t* data = data_ + pos_;
+        pos_ += size;
+        return data;
+    }
+};
+
+std::string readTextFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw AIAudioException("Could not open preset file: " + path);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+} // namespace
+
+uint64_t presetSourceHash(const std::string& jsonData) {
+    uint64_t hash = kFNVOffset;
+    for (unsigned char c : jsonData) {
+        hash = (hash ^ c) * kFNVPrime;
+    }
+    return hash;
+}
+
+std::vector<uint8_t> compilePreset(const DSPGraph& graph, uint64_t sourceHash) {
+    auto issues = graph.validate();
+    if (!issues.empty()) {
+        std::string message = "Preset failed validation:";
+        for (const auto& issue : issues) message += " " + issue + ";";
+        message.pop_back();
+        throw AIAudioException(message);
+    }
+    
+    const std::vector<std::string> order = graph.getTopologicalOrder();
+    std::unordered_map<std::string, uint32_t> position;
+    for (const auto& name : order) {
+        position.emplace(name, static_cast<uint32_t>(position.size()));
+    }
+    const std::vector<Connection> connections = graph.getConnections();
+    
+    PresetFileHeader header{};
+    std::memcpy(header.magic, kPresetMagic, sizeof(kPresetMagic));
+    header.version = kPresetVersion;
+    header.stageCount = static_cast<uint32_t>(order.size());
+    header.connectionCount = static_cast<uint32_t>(connections.size());
+    header.sourceHash = sourceHash;
+    
+    PresetWriter out;
+    out.put(&header, sizeof(header));
+    out.pod(graph.getSampleRate());
+    out.pod(static_cast<uint32_t>(graph.getControlInterval()));
+    
+    for (const auto& name : order) {
+        const DSPStage* stage = graph.getStage(name);
+        if (!makeStage(stage->getType())) {
+            throw AIAudioException("Stage cannot be compiled: " + stage->getDescription());
+        }
+        const size_t count = stage->getParameterNames().size();
+        out.string(name);
+        out.pod(static_cast<uint8_t>(stage->getType()));
+        out.pod(static_cast<uint32_t>(count));
+        for (size_t i = 0; i < count; ++i) {
+            out.pod(stage->getParameterValue(static_cast<int>(i)));
+        }
+    }
+    
+    for (const auto& connection : connections) {
+        auto source = position.find(connection.source);
+        auto destination = position.find(connection.destination);
+        if (source == position.end() || destination == position.end()) {
+            throw AIAudioException("Connection references an unknown stage: " +
+                                   connection.source + " -> " + connection.destination);
+        }
+        out.pod(source->second);
+        out.pod(destination->second);
+        out.string(connection.parameter);
+        out.pod(connection.amount);
+        out.pod(static_cast<uint8_t>(connection.enabled));
+    }
+    
+    auto& bytes = out.bytes();
+    header.fileSize = bytes.size();
+    header.checksum = presetChecksum(bytes.data() + sizeof(header), bytes.size() - sizeof(header));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    return std::move(bytes);
+}
+
+std::vector<uint8_t> compilePresetJSON(const std::string& jsonData) {
+    IRParser parser;
+    auto graph = parser.parsePreset(jsonData);
+    return compilePreset(*graph, presetSourceHash(jsonData));
+}
+
+bool readCompiledSourceHash(const uint8_t* data, size_t size, uint64_t& sourceHash) {
+    PresetFileHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kPresetMagic, sizeof(kPresetMagic)) != 0) return false;
+    if (header.version != kPresetVersion || header.fileSize != size) return false;
+    sourceHash = header.sourceHash;
+    return true;
+}
+
+std::unique_ptr<DSPGraph> loadCompiledPreset(const uint8_t* data, size_t size, const std::string& source) {
+    PresetFileHeader header;
+    if (size < sizeof(header)) rejectPreset(source, "truncated header");
+    std::memcpy(&header, data, sizeof(header));
+    
+    if (std::memcmp(header.magic, kPresetMagic, sizeof(kPresetMagic)) != 0) {
+        rejectPreset(source, "not a compiled preset");
+    }
+    if (header.version != kPresetVersion) {
+        rejectPreset(source, "unsupported version " + std::to_string(header.version));
+    }
+    if (header.fileSize != size) rejectPreset(source, "size mismatch");
+    if (presetChecksum(data + sizeof(header), size - sizeof(header)) != header.checksum) {
+        rejectPreset(source, "checksum mismatch");
+    }
+    
+    // Validated when compiled; only the structure is checked here
+    auto graph = std::make_unique<DSPGraph>();
+    PresetReader in(data, size, sizeof(header), source);
+    const double sampleRate = in.pod<double>();
+    const uint32_t controlInterval = in.pod<uint32_t>();
+    try {
+        graph->setSampleRate(sampleRate);
+        graph->setControlInterval(controlInterval);
+    } catch (const AIAudioException& e) {
+        rejectPreset(source, e.what());
+    }
+    
+    std::vector<std::string> names(header.stageCount);
+    for (auto& name : names) {
+        name = in.string();
+        auto stage = makeStage(static_cast<StageType>(in.pod<uint8_t>()));
+        if (!stage) rejectPreset(source, "unknown stage type");
+        
+        const uint32_t count = in.pod<uint32_t>();
+        if (count != stage->getParameterNames().size()) {
+            rejectPreset(source, "parameter count mismatch for stage " + name);
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            const double value = in.pod<double>();
+            try {
+                stage->setParameterValue(static_cast<int>(i), value);
+            } catch (const AIAudioException& e) {
+                rejectPreset(source, "stage " + name + ": " + e.what());
+            }
+        }
+        graph->addStage(name, std::move(stage));
+    }
+    
+    for (uint32_t c = 0; c < header.connectionCount; ++c) {
+        Connection connection;
+        uint32_t from = in.pod<uint32_t>();
+        uint32_t to = in.pod<uint32_t>();
+        if (from >= names.size() || to >= names.size()) {
+            rejectPreset(source, "connection stage out of range");
+        }
+        connection.source = names[from];
+        connection.destination = names[to];
+        connection.parameter = in.string();
+        connection.amount = in.pod<double>();
+        connection.enabled = in.pod<uint8_t>() != 0;
+        try {
+            graph->addConnection(connection);
+        } catch (const AIAudioException& e) {
+            rejectPreset(source, e.what());
+        }
+    }
+    if (!in.atEnd()) rejectPreset(source, "trailing bytes");
+    return graph;
+}
+
+std::unique_ptr<DSPGraph> loadCompiledPreset(const std::string& path) {
+    MappedFile file(path);
+    return loadCompiledPreset(file.data(), file.size(), path);
+}
+
+std::unique_ptr<DSPGraph> loadPresetFile(const std::string& path) {
+    if (std::filesystem::path(path).extension() == kCompiledPresetExtension) {
+        return loadCompiledPreset(path);
+    }
+    IRParser parser;
+    return parser.parsePreset(readTextFile(path));
+}
+
+void writeCompiledPreset(const std::vector<uint8_t>& bytes, const std::string& path) {
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw AIAudioException("Could not write compiled preset: " + tempPath);
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        if (!file) {
+            throw AIAudioException("Could not write compiled preset: " + tempPath);
+        }
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        throw AIAudioException("Could not replace compiled preset: " + path);
+    }
+}
+
+// PresetLibrary implementation
+PresetLibrary::PresetLibrary() : PresetLibrary(Options{}) {
+}
+
+PresetLibrary::PresetLibrary(const Options& options) : options_(options) {
+}
+
+std::vector<PresetLibrary::Entry> PresetLibrary::loadDirectory(const std::string& directory) {
+    namespace fs = std::filesystem;
+    auto start = std::chrono::steady_clock::now();
+    
+    std::vector<std::string> paths;
+    try {
+        for (const auto& file : fs::directory_iterator(directory)) {
+            if (file.is_regular_file() && file.path().extension() == ".json") {
+                paths.push_back(file.path().string());
+            }
+        }
+    } catch (const fs::filesystem_error& e) {
+        throw AIAudioException("Could not read preset directory " + directory + ": " + e.what());
+    }
+    std::sort(paths.begin(), paths.end());
+    
+    // An unwritable cache only costs the JSON parse
+    std::string cacheDirectory;
+    if (options_.useCache) {
+        cacheDirectory = options_.cacheDirectory.empty()
+            ? (fs::path(directory) / ".preset_cache").string()
+            : options_.cacheDirectory;
+        std::error_code error;
+        fs::create_directories(cacheDirectory, error);
+        if (error) cacheDirectory.clear();
+    }
+    
+    std::vector<Entry> entries(paths.size());
+    auto loadOne = [&](size_t i) { entries[i] = loadFile(paths[i], cacheDirectory); };
+    if (options_.parallel && paths.size() > 1) {
+        auto pool = options_.threadPool ? options_.threadPool : ThreadPool::shared();
+        pool->parallelFor(paths.size(), loadOne);
+    } else {
+        for (size_t i = 0; i < paths.size(); ++i) loadOne(i);
+    }
+    
+    lastStats_ = LoadStats{};
+    lastStats_.files = entries.size();
+    for (const auto& entry : entries) {
+        if (!entry.ok()) {
+            ++lastStats_.failed;
+            lastStats_.errors.push_back(entry.path + ": " + entry.error);
+        } else if (entry.fromCache) {
+            ++lastStats_.fromCache;
+        } else {
+            ++lastStats_.compiled;
+        }
+    }
+    lastStats_.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return entries;
+}
+
+PresetLibrary::Entry PresetLibrary::loadFile(const std::string& path, const std::string& cacheDirectory) {
+    namespace fs = std::filesystem;
+    Entry entry;
+    entry.path = path;
+    
+    try {
+        const std::string json = readTextFile(path);
+        const uint64_t sourceHash = presetSourceHash(json);
+        
+        std::string cachePath;
+        if (!cacheDirectory.empty()) {
+            cachePath = (fs::path(cacheDirectory) / fs::path(path).stem()).string() + kCompiledPresetExtension;
+            std::error_code error;
+            if (fs::exists(cachePath, error)) {
+                try {
+                    MappedFile file(cachePath);
+                    uint64_t cachedHash = 0;
+                    if (readCompiledSourceHash(file.data(), file.size(), cachedHash) && cachedHash == sourceHash) {
+                        entry.graph = loadCompiledPreset(file.data(), file.size(), cachePath);
+                        entry.fromCache = true;
+                        return entry;
+                    }
+                } catch (const AIAudioException&) {
+                    // Corrupt copy: rebuilt below
+                }
+            }
+        }
+        
+        IRParser parser;
+        auto graph = parser.parsePreset(json);
+        auto bytes = compilePreset(*graph, sourceHash);
+        if (!cachePath.empty()) {
+            try {
+                writeCompiledPreset(bytes, cachePath);
+            } catch (const AIAudioException&) {
+                // The parsed graph is still good
+            }
+        }
+        entry.graph = std::move(graph);
+    } catch (const std::exception& e) {
+        entry.graph.reset();
+        entry.error = e.what();
+    }
+    return entry;
+}
+
+} // namespace aiaudio
@@ -1,32 +1,356 @@
 #include "decision_heads.h"
+#include "roles_policies.h"
+#include "simd_kernels.h"
+#include "thread_pool.h"
 #include <algorithm>
+#include <array>
+#include <numeric>
+#include <chrono>
 #include <cmath>
+#include <iostream>
+#include <limits>
 #include <random>
 #include <sstream>
 
 namespace aiaudio {
 
+namespace {
+
+// Batch rows per GEMM block; a block of activations stays in L1 while every
+// weight row streams past it once
+constexpr size_t kBatchTile = 16;
+
+// Quantized rows are padded to this many bytes so the int8 kernels never
+// fall into their scalar tails
+constexpr size_t kQuantizedRowAlignment = 32;
+
+// Timed latency trials per validation; the best one counts
+constexpr size_t kLatencyTrials = 5;
+
+// Per-thread inference scratch: ping-pong activations plus the quantized
+// copy of the current layer input
+struct InferenceScratch {
+    std::vector<float> ping;
+    std::vector<float> pong;
+    std::vector<int8_t> quantizedInput;
+    std::vector<float> inputScales;
+};
+
+InferenceScratch& scratch() {
+    thread_local InferenceScratch instance;
+    return instance;
+}
+
+// resize() never gives capacity back, so warm buffers do not allocate
+template<typename T>
+T* grow(std::vector<T>& buffer, size_t size) {
+    if (buffer.size() < size) buffer.resize(size);
+    return buffer.data();
+}
+
+void activate(float* values, size_t n, Activation activation) {
+    switch (activation) {
+        case Activation::RELU:
+            for (size_t i = 0; i < n; ++i) values[i] = std::max(0.0f, values[i]);
+            break;
+        case Activation::SIGMOID:
+            for (size_t i = 0; i < n; ++i) values[i] = 1.0f / (1.0f + std::exp(-values[i]));
+            break;
+        case Activation::TANH:
+            for (size_t i = 0; i < n; ++i) values[i] = std::tanh(values[i]);
+            break;
+        case Activation::LINEAR:
+            break;
+    }
+}
+
+// Dot products of every weight row with every input row of [b0, b1), in
+// kDotBlockRows x kDotBlockCols register blocks with single dot products
+// at the edges. store(b, o, dot) finishes one output.
+template<typename T, typename Acc, typename Store>
+void gemmTile(const T* weights, size_t outputs, const T* in, size_t inputs,
+              size_t b0, size_t b1,
+              void (*block)(const T*, size_t, const T*, size_t, size_t, Acc*),
+              Acc (*dot)(const T*, const T*, size_t),
+              Store&& store) {
+    size_t o = 0;
+    for (; o + kDotBlockRows <= outputs; o += kDotBlockRows) {
+        const T* w = weights + o * inputs;
+        size_t b = b0;
+        for (; b + kDotBlockCols <= b1; b += kDotBlockCols) {
+            Acc sums[kDotBlockRows * kDotBlockCols];
+            block(w, inputs, in + b * inputs, inputs, inputs, sums);
+            for (size_t r = 0; r < kDotBlockRows; ++r) {
+                for (size_t c = 0; c < kDotBlockCols; ++c) {
+                    store(b + c, o + r, sums[r * kDotBlockCols + c]);
+                }
+            }
+        }
+        for (; b < b1; ++b) {
+            for (size_t r = 0; r < kDotBlockRows; ++r) {
+                store(b, o + r, dot(w + r * inputs, in + b * inputs, inputs));
+            }
+        }
+    }
+    for (; o < outputs; ++o) {
+        for (size_t b = b0; b < b1; ++b) {
+            store(b, o, dot(weights + o * inputs, in + b * inputs, inputs));
+        }
+    }
+}
+
+void denseFloat(const DecisionMLP::Layer& layer, const float* in, size_t batch, float* out) {
+    const SIMDKernels& kernels = getActiveKernels();
+    for (size_t b0 = 0; b0 < batch; b0 += kBatchTile) {
+        size_t b1 = std::min(batch, b0 + kBatchTile);
+        gemmTile(layer.weights.data(), layer.outputs, in, layer.inputs, b0, b1,
+                 kernels.dotProductBlock, kernels.dotProduct,
+                 [&](size_t b, size_t o, float sum) {
+                     out[b * layer.outputs + o] = layer.biases[o] + sum;
+                 });
+        activate(out + b0 * layer.outputs, (b1 - b0) * layer.outputs, layer.activation);
+    }
+}
+
+size_t paddedStride(size_t n) {
+    return (n + kQuantizedRowAlignment - 1) / kQuantizedRowAlignment * kQuantizedRowAlignment;
+}
+
+// Symmetric quantization of n values to [-127, 127], zero-padded to stride;
+// returns the scale
+float quantizeRow(const float* in, size_t n, size_t stride, int8_t* out) {
+    float peak = 0.0f;
+    for (size_t i = 0; i < n; ++i) peak = std::max(peak, std::abs(in[i]));
+    
+    float scale = peak > 0.0f ? peak / 127.0f : 1.0f;
+    float inverse = 1.0f / scale;
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<int8_t>(std::lrint(in[i] * inverse));
+    }
+    std::fill(out + n, out + stride, int8_t{0});
+    return scale;
+}
+
+// Rows are stride bytes apart in both operands
+void denseInt8(const DecisionMLP::Layer& layer, const int8_t* weights, const float* weightScales,
+               size_t stride, const int8_t* in, const float* inScales, size_t batch, float* out) {
+    const SIMDKernels& kernels = getActiveKernels();
+    for (size_t b0 = 0; b0 < batch; b0 += kBatchTile) {
+        size_t b1 = std::min(batch, b0 + kBatchTile);
+        gemmTile(weights, layer.outputs, in, stride, b0, b1,
+                 kernels.dotProductInt8Block, kernels.dotProductInt8,
+                 [&](size_t b, size_t o, int32_t sum) {
+                     out[b * layer.outputs + o] = layer.biases[o]
+                         + static_cast<float>(sum) * weightScales[o] * inScales[b];
+                 });
+        activate(out + b0 * layer.outputs, (b1 - b0) * layer.outputs, layer.activation);
+    }
+}
+
+// Rule-based samples: role characteristics followed by a routing mask
+constexpr size_t kRuleValues = 6;
+constexpr size_t kRuleRoutes = 10;
+constexpr size_t kRuleStats = 10;
+
+// Fewest rows worth a gradient shard of their own; below this the shard
+// reduction costs more than the parallel backward pass saves
+constexpr size_t kMinShardRows = 32;
+
+// Parameters per reduction/update task
+constexpr size_t kUpdateChunk = 4096;
+
+// Activation derivative in terms of the activation's output
+float derivative(float y, Activation activation) {
+    switch (activation) {
+        case Activation::RELU: return y > 0.0f ? 1.0f : 0.0f;
+        case Activation::SIGMOID: return y * (1.0f - y);
+        case Activation::TANH: return 1.0f - y * y;
+        case Activation::LINEAR: return 1.0f;
+    }
+    return 1.0f;
+}
+
+// y += a * x
+void axpy(float* y, float a, const float* x, size_t n) {
+    for (size_t i = 0; i < n; ++i) y[i] += a * x[i];
+}
+
+// Model parameters in a flat order: layer l's weights at offsets[l], its
+// biases right after. ranges cut that order into update-sized pieces.
+struct ParameterLayout {
+    struct Range {
+        float* values;   // Model storage
+        size_t offset;   // Position in the flat gradient/velocity vectors
+        size_t size;
+    };
+    
+    std::vector<size_t> offsets;
+    std::vector<Range> ranges;
+    size_t total = 0;
+    
+    explicit ParameterLayout(DecisionMLP& model) {
+        auto add = [&](std::vector<float>& values) {
+            for (size_t i = 0; i < values.size(); i += kUpdateChunk) {
+                ranges.push_back({values.data() + i, total + i, std::min(kUpdateChunk, values.size() - i)});
+            }
+            total += values.size();
+        };
+        for (auto& layer : model.layers) {
+            offsets.push_back(total);
+            add(layer.weights);
+            add(layer.biases);
+        }
+    }
+};
+
+// One shard's activations, deltas and gradient sum
+struct GradientShard {
+    std::vector<std::vector<float>> activations;  // Per layer, rows x outputs
+    std::vector<float> delta;
+    std::vector<float> previousDelta;
+    std::vector<float> gradient;                  // ParameterLayout order
+    double loss = 0.0;                            // Sum of weight x row MSE
+};
+
+// Forward and backward pass over rows samples, adding the gradient of
+// gradientScale x sum(weight x squared error) to shard.gradient
+void backpropagate(const DecisionMLP& model, const ParameterLayout& layout,
+                   const float* inputs, const float* targets, const float* weights,
+                   size_t rows, float gradientScale, GradientShard& shard) {
+    const auto& layers = model.layers;
+    const size_t depth = layers.size();
+    shard.activations.resize(depth);
+    
+    const float* in = inputs;
+    for (size_t l = 0; l < depth; ++l) {
+        float* out = grow(shard.activations[l], rows * layers[l].outputs);
+        denseFloat(layers[l], in, rows, out);
+        in = out;
+    }
+    
+    const auto& last = layers.back();
+    float* delta = grow(shard.delta, rows * last.outputs);
+    for (size_t b = 0; b < rows; ++b) {
+        const float* y = shard.activations.back().data() + b * last.outputs;
+        const float* t = targets + b * last.outputs;
+        float* d = delta + b * last.outputs;
+        float scale = 2.0f * weights[b] * gradientScale;
+        double squared = 0.0;
+        for (size_t o = 0; o < last.outputs; ++o) {
+            float diff = y[o] - t[o];
+            squared += static_cast<double>(diff) * diff;
+            d[o] = scale * diff * derivative(y[o], last.activation);
+        }
+        shard.loss += weights[b] * squared / last.outputs;
+    }
+    
+    for (size_t l = depth; l-- > 0;) {
+        const auto& layer = layers[l];
+        const float* layerInput = l ? shard.activations[l - 1].data() : inputs;
+        float* weightGradient = shard.gradient.data() + layout.offsets[l];
+        float* biasGradient = weightGradient + layer.weights.size();
+        
+        // Row tiles stay cached while each gradient row streams past once;
+        // zero deltas (inactive ReLUs) are skipped
+        for (size_t b0 = 0; b0 < rows; b0 += kBatchTile) {
+            size_t b1 = std::min(rows, b0 + kBatchTile);
+            for (size_t o = 0; o < layer.outputs; ++o) {
+                float* row = weightGradient + o * layer.inputs;
+                for (size_t b = b0; b < b1; ++b) {
+                    float d = delta[b * layer.outputs + o];
+                    if (d == 0.0f) continue;
+                    biasGradient[o] += d;
+                    axpy(row, d, layerInput + b * layer.inputs, layer.inputs);
+                }
+            }
+        }
+        if (l == 0) break;
+        
+        // Previous delta = (delta x W) * f'(previous output)
+        float* previous = grow(shard.previousDelta, rows * layer.inputs);
+        std::fill_n(previous, rows * layer.inputs, 0.0f);
+        for (size_t b0 = 0; b0 < rows; b0 += kBatchTile) {
+            size_t b1 = std::min(rows, b0 + kBatchTile);
+            for (size_t o = 0; o < layer.outputs; ++o) {
+                const float* w = layer.row(o);
+                for (size_t b = b0; b < b1; ++b) {
+                    float d = delta[b * layer.outputs + o];
+                    if (d != 0.0f) axpy(previous + b * layer.inputs, d, w, layer.inputs);
+                }
+            }
+        }
+        const Activation activation = layers[l - 1].activation;
+        for (size_t i = 0; i < rows * layer.inputs; ++i) {
+            previous[i] *= derivative(layerInput[i], activation);
+        }
+        std::swap(shard.delta, shard.previousDelta);
+        delta = shard.delta.data();
+    }
+}
+
+const std::array<double, kRuleValues>& ruleValues(Role role) {
+    static const std::array<double, kRuleValues> pad{0.7, 0.5, 0.8, 0.6, 0.7, 0.9};
+    static const std::array<double, kRuleValues> bass{0.3, 0.8, 0.2, 0.4, 0.8, 0.3};
+    static const std::array<double, kRuleValues> lead{0.8, 0.9, 0.6, 0.7, 0.8, 0.6};
+    static const std::array<double, kRuleValues> neutral{0.5, 0.5, 0.5, 0.5, 0.5, 0.5};
+    switch (role) {
+        case Role::PAD: return pad;
+        case Role::BASS: return bass;
+        case Role::LEAD: return lead;
+        default: return neutral;
+    }
+}
+
+// Random query, tempo, key and stats, keeping the context's vector sizes
+void randomizeContext(DecisionContext& context, std::mt19937& gen) {
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    for (double& value : context.queryVector) {
+        value = dist(gen);
+    }
+    
+    context.tempo = 60.0 + (gen() % 140); // 60-200 BPM
+    context.key = gen() % 12; // 0-11
+    
+    for (double& value : context.entryStats) {
+        value = dist(gen);
+    }
+}
+
+DecisionContext makeRuleContext(Role role, size_t queryDimension) {
+    DecisionContext context;
+    context.queryVector.resize(queryDimension);
+    context.role = role;
+    context.tempo = 120.0;
+    context.key = 0;
+    context.entryStats.resize(kRuleStats);
+    return context;
+}
+
+} // namespace
+
 // DecisionMLP implementation
 DecisionMLP::DecisionMLP(size_t inputSize, const std::vector<size_t>& hiddenSizes, size_t outputSize)
     : inputSize_(inputSize), outputSize_(outputSize) {
     
+    auto makeLayer = [](size_t inputs, size_t outputs, Activation activation) {
+        Layer layer;
+        layer.inputs = inputs;
+        layer.outputs = outputs;
+        layer.weights.resize(inputs * outputs);
+        layer.biases.resize(outputs);
+        layer.activation = activation;
+        return layer;
+    };
+    
     // Create layers
     size_t prevSize = inputSize;
     for (size_t hiddenSize : hiddenSizes) {
-        Layer layer;
-        layer.weights.resize(hiddenSize, std::vector<double>(prevSize));
-        layer.biases.resize(hiddenSize);
-        layer.activation = "relu";
-        layers.push_back(layer);
+        layers.push_back(makeLayer(prevSize, hiddenSize, Activation::RELU));
         prevSize = hiddenSize;
     }
     
     // Output layer
-    Layer outputLayer;
-    outputLayer.weights.resize(outputSize, std::vector<double>(prevSize));
-    outputLayer.biases.resize(outputSize);
-    outputLayer.activation = "sigmoid";
-    layers.push_back(outputLayer);
+    layers.push_back(makeLayer(prevSize, outputSize, Activation::SIGMOID));
     
     initializeWeights();
 }
@@ -36,28 +360,58 @@ std::vector<double> DecisionMLP::forward(const std::vector<double>& input) const
         throw AIAudioException("Input size mismatch");
     }
     
-    std::vector<double> current = input;
+    std::vector<float> in(input.begin(), input.end());
+    std::vector<float> out(outputSize_);
+    forwardBatch(in.data(), 1, out.data());
+    return std::vector<double>(out.begin(), out.end());
+}
+
+void DecisionMLP::forwardBatch(const float* inputs, size_t batchSize, float* outputs) const {
+    if (batchSize == 0) return;
+    if (onnx_) {
+        onnx_->runBatch(inputs, batchSize, outputs);
+        return;
+    }
     
-    for (const auto& layer : layers) {
-        std::vector<double> next(layer.weights.size());
+    InferenceScratch& buffers = scratch();
+    const float* current = inputs;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        const Layer& layer = layers[l];
         
-        for (size_t i = 0; i < layer.weights.size(); ++i) {
-            double sum = layer.biases[i];
-            for (size_t j = 0; j < layer.weights[i].size(); ++j) {
-                sum += layer.weights[i][j] * current[j];
+        // Last layer writes straight into the caller's buffer
+        float* next = l + 1 == layers.size()
+            ? outputs
+            : grow(l % 2 ? buffers.pong : buffers.ping, batchSize * layer.outputs);
+        
+        if (isQuantized()) {
+            const QuantizedLayer& q = quantized_[l];
+            int8_t* in = grow(buffers.quantizedInput, batchSize * q.stride);
+            float* inScales = grow(buffers.inputScales, batchSize);
+            for (size_t b = 0; b < batchSize; ++b) {
+                inScales[b] = quantizeRow(current + b * layer.inputs, layer.inputs, q.stride, in + b * q.stride);
             }
-            next[i] = applyActivation(sum, layer.activation);
+            denseInt8(layer, q.weights.data(), q.scales.data(), q.stride, in, inScales, batchSize, next);
+        } else {
+            denseFloat(layer, current, batchSize, next);
         }
-        
         current = next;
     }
-    
-    return current;
 }
 
-void DecisionMLP::loadFromONNX(const std::string& modelPath) {
-    // Placeholder for ONNX loading
-    // In practice, would use ONNX Runtime
+void DecisionMLP::loadFromONNX(const std::string& modelPath, const ONNXModel::Options& options) {
+    auto model = std::make_shared<ONNXModel>(options);
+    model->loadModel(modelPath);
+    setONNXModel(std::move(model));
+}
+
+void DecisionMLP::setONNXModel(std::shared_ptr<const ONNXModel> model) {
+    if (model && !model->isLoaded()) {
+        throw AIAudioException("ONNX model not loaded");
+    }
+    
+    inputSize_ = model ? model->getInputShape().second : layers.front().inputs;
+    outputSize_ = model ? model->getOutputShape().second : layers.back().outputs;
+    onnx_ = std::move(model);
 }
 
 void DecisionMLP::saveToONNX(const std::string& modelPath) const {
@@ -66,47 +420,32 @@ void DecisionMLP::saveToONNX(const std::string& modelPath) const {
 }
 
 void DecisionMLP::quantizeToInt8() {
-    // Placeholder for int8 quantization
-    // In practice, would implement proper quantization
-}
-
-double DecisionMLP::relu(double x) const {
-    return std::max(0.0, x);
-}
-
-double DecisionMLP::sigmoid(double x) const {
-    return 1.0 / (1.0 + std::exp(-x));
-}
-
-double DecisionMLP::tanh(double x) const {
-    return std::tanh(x);
-}
-
-double DecisionMLP::linear(double x) const {
-    return x;
-}
-
-double DecisionMLP::applyActivation(double x, const std::string& activation) const {
-    if (activation == "relu") return relu(x);
-    if (activation == "sigmoid") return sigmoid(x);
-    if (activation == "tanh") return tanh(x);
-    if (activation == "linear") return linear(x);
-    return x;
+    std::vector<QuantizedLayer> quantized(layers.size());
+    for (size_t l = 0; l < layers.size(); ++l) {
+        const Layer& layer = layers[l];
+        QuantizedLayer& q = quantized[l];
+        q.stride = paddedStride(layer.inputs);
+        q.weights.resize(layer.outputs * q.stride);
+        q.scales.resize(layer.outputs);
+        
+        for (size_t o = 0; o < layer.outputs; ++o) {
+            q.scales[o] = quantizeRow(layer.row(o), layer.inputs, q.stride, q.weights.data() + o * q.stride);
+        }
+    }
+    quantized_ = std::move(quantized);
 }
 
 void DecisionMLP::initializeWeights() {
     std::random_device rd;
     std::mt19937 gen(rd());
-    std::normal_distribution<double> dist(0.0, 0.1);
+    std::normal_distribution<float> dist(0.0f, 0.1f);
     
     for (auto& layer : layers) {
-        for (auto& row : layer.weights) {
-            for (double& weight : row) {
-                weight = dist(gen);
-            }
+        for (float& weight : layer.weights) {
+            weight = dist(gen);
         }
         
-        for (double& bias : layer.biases) {
+        for (float& bias : layer.biases) {
             bias = dist(gen);
         }
     }
@@ -114,29 +453,36 @@ void DecisionMLP::initializeWeights() {
 
 // DecisionContext implementation
 std::vector<double> DecisionContext::toInputVector() const {
-    std::vector<double> input;
-    
+    std::vector<float> encoded(getInputSize());
+    writeInputVector(encoded.data());
+    return std::vector<double>(encoded.begin(), encoded.end());
+}
+
+size_t DecisionContext::getInputSize() const {
+    // Query, role one-hot (8 roles), tempo, key, stats, metadata count
+    return queryVector.size() + 8 + 2 + entryStats.size() + 1;
+}
+
+void DecisionContext::writeInputVector(float* out) const {
     // Add query vector
-    input.insert(input.end(), queryVector.begin(), queryVector.end());
+    out = std::copy(queryVector.begin(), queryVector.end(), out);
     
     // Add role one-hot encoding
-    std::vector<double> roleOneHot(8, 0.0); // 8 roles
-    roleOneHot[static_cast<int>(role)] = 1.0;
-    input.insert(input.end(), roleOneHot.begin(), roleOneHot.end());
+    std::fill(out, out + 8, 0.0f);
+    out[static_cast<int>(role)] = 1.0f;
+    out += 8;
     
     // Add tempo (normalized)
-    input.push_back(tempo / 200.0); // Normalize to [0, 1]
+    *out++ = static_cast<float>(tempo / 200.0); // Normalize to [0, 1]
     
     // Add key (normalized)
-    input.push_back(key / 12.0); // Normalize to [0, 1]
+    *out++ = static_cast<float>(key / 12.0); // Normalize to [0, 1]
     
     // Add entry stats
-    input.insert(input.end(), entryStats.begin(), entryStats.end());
+    out = std::copy(entryStats.begin(), entryStats.end(), out);
     
     // Add metadata (simplified)
-    input.push_back(metadata.size() / 10.0); // Normalize metadata count
-    
-    return input;
+    *out = static_cast<float>(metadata.size() / 10.0); // Normalize metadata count
 }
 
 // DecisionHeads implementation
@@ -144,23 +490,44 @@ DecisionHeads::DecisionHeads(std::unique_ptr<DecisionMLP> model) : model_(std::m
 }
 
 DecisionOutput DecisionHeads::infer(const DecisionContext& context) const {
-    std::vector<double> input = context.toInputVector();
-    std::vector<double> output = model_->forward(input);
+    return std::move(inferBatch(std::span<const DecisionContext>(&context, 1)).front());
+}
+
+std::vector<DecisionOutput> DecisionHeads::inferBatch(std::span<const DecisionContext> contexts) const {
+    const size_t inputSize = model_->getInputSize();
+    const size_t outputSize = model_->getOutputSize();
+    
+    std::vector<float> inputs(contexts.size() * inputSize);
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        if (contexts[i].getInputSize() != inputSize) {
+            throw AIAudioException("Input size mismatch");
+        }
+        contexts[i].writeInputVector(inputs.data() + i * inputSize);
+    }
+    
+    std::vector<float> outputs(contexts.size() * outputSize);
+    model_->forwardBatch(inputs.data(), contexts.size(), outputs.data());
     
+    std::vector<DecisionOutput> results;
+    results.reserve(contexts.size());
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        results.push_back(decodeOutput(outputs.data() + i * outputSize, outputSize, contexts[i].role));
+    }
+    return results;
+}
+
+DecisionOutput DecisionHeads::decodeOutput(const float* output, size_t size, Role role) const {
     DecisionOutput result;
     
     // Split output into values and routes
-    size_t numValues = output.size() / 2; // Assume half for values, half for routes
-    size_t numRoutes = output.size() - numValues;
+    size_t numValues = size / 2; // Assume half for values, half for routes
     
     // Extract values (μ)
-    for (size_t i = 0; i < numValues; ++i) {
-        result.values.push_back(output[i]);
-    }
+    result.values.assign(output, output + numValues);
     
     // Extract routes (sigmoid -> threshold)
-    for (size_t i = numValues; i < output.size(); ++i) {
-        result.routes.push_back(output[i] > 0.5);
+    for (size_t i = numValues; i < size; ++i) {
+        result.routes.push_back(output[i] > 0.5f);
     }
     
     // Compute confidence (average of values)
@@ -171,27 +538,54 @@ DecisionOutput DecisionHeads::infer(const DecisionContext& context) const {
     result.confidence /= result.values.size();
     
     // Map to parameters and routes
-    result.parameterValues = mapValuesToParameters(result.values, context.role);
+    result.parameterValues = mapValuesToParameters(result.values, role);
     result.routingMask = mapRoutesToTargets(result.routes, DSPGraph{}); // Would need actual graph
     
     return result;
 }
 
-void DecisionHeads::applyDecisions(DSPGraph& graph, const DecisionOutput& decisions) const {
-    // Apply parameter values to graph stages
-    auto stageNames = graph.getStageNames();
-    for (const auto& [paramName, value] : decisions.parameterValues) {
-        // Find stage containing this parameter
-        for (const auto& stageName : stageNames) {
-            auto* stage = graph.getStage(stageName);
-            if (stage) {
-                auto paramNames = stage->getParameterNames();
-                if (std::find(paramNames.begin(), paramNames.end(), paramName) != paramNames.end()) {
-                    stage->setParameter(paramName, value);
-                    break;
-                }
+std::shared_ptr<const DecisionHeads::ParameterBindings> DecisionHeads::bindParameters(
+    const DSPGraph& graph, const DecisionOutput& decisions) const {
+    // Keyed by the topology and the parameter names the decisions carry
+    uint64_t key = graphTopologyHash(graph);
+    for (const auto& entry : decisions.parameterValues) {
+        key = (key ^ std::hash<std::string>{}(entry.first)) * 0x100000001b3ull;
+    }
+    if (auto cached = bindings_.getIf(key, [&](const auto& bindings) {
+            return bindings->size() == decisions.parameterValues.size();
+        })) {
+        return *cached;
+    }
+    
+    const std::vector<std::string> order = graph.getTopologicalOrder();
+    auto bindings = std::make_shared<ParameterBindings>();
+    bindings->reserve(decisions.parameterValues.size());
+    for (const auto& entry : decisions.parameterValues) {
+        ParameterBinding binding;
+        for (const auto& stageName : order) {
+            const DSPStage* stage = graph.getStage(stageName);
+            const int index = stage ? stage->getParameterIndex(entry.first) : -1;
+            if (index >= 0) {
+                binding = {stageName, index, stage->getParameterRange(index)};
+                break;
             }
         }
+        bindings->push_back(std::move(binding));
+    }
+    bindings_.put(key, bindings);
+    return bindings;
+}
+
+void DecisionHeads::applyDecisions(DSPGraph& graph, const DecisionOutput& decisions) const {
+    // Apply parameter values through the bindings of this topology
+    const auto bindings = bindParameters(graph, decisions);
+    size_t next = 0;
+    for (const auto& entry : decisions.parameterValues) {
+        const ParameterBinding& binding = (*bindings)[next++];
+        DSPStage* stage = binding.index >= 0 ? graph.getStage(binding.stage) : nullptr;
+        if (!stage) continue;
+        // Role ranges can be wider than the stage's own
+        stage->setParameterValue(binding.index, std::clamp(entry.second, binding.range.min, binding.range.max));
     }
     
     // Apply routing decisions
@@ -217,7 +611,7 @@ DecisionOutput DecisionHeads::addJitter(const DecisionOutput& decisions, double
     }
     
     // Add jitter to routes (with lower probability)
-    for (bool& route : jittered.routes) {
+    for (auto&& route : jittered.routes) {
         if (dist(gen) < sigma) {
             route = !route;
         }
@@ -381,47 +775,159 @@ void DecisionTrainer::trainModel(DecisionMLP& model, const TrainingData& data,
     if (data.contexts.size() != data.targets.size()) {
         throw AIAudioException("Context and target size mismatch");
     }
+    if (data.contexts.empty()) return;
     
-    for (size_t epoch = 0; epoch < epochs; ++epoch) {
-        double totalLoss = 0.0;
+    Options options;
+    options.epochs = epochs;
+    options.learningRate = learningRate;
+    TrainingDataStream samples(data);
+    trainModel(model, samples, options);
+}
+
+std::vector<double> DecisionTrainer::trainModel(DecisionMLP& model, TrainingSampleStream& samples,
+                                                const Options& options) const {
+    const size_t inputSize = samples.getInputSize();
+    const size_t targetSize = samples.getTargetSize();
+    if (model.layers.empty() || inputSize != model.layers.front().inputs ||
+        targetSize != model.layers.back().outputs) {
+        throw AIAudioException("Training samples do not match the model size");
+    }
+    if (options.batchSize == 0) {
+        throw AIAudioException("Training batch size must be positive");
+    }
+    
+    // The int8 copy would go stale with every update
+    model.clearQuantization();
+    
+    const ParameterLayout layout(model);
+    std::vector<float> velocity(layout.total, 0.0f);
+    
+    const size_t batchSize = options.batchSize;
+    std::vector<float> inputs(batchSize * inputSize);
+    std::vector<float> targets(batchSize * targetSize);
+    std::vector<float> weights(batchSize);
+    
+    auto pool = ThreadPool::shared();
+    const size_t maxShards = std::clamp<size_t>((batchSize + kMinShardRows - 1) / kMinShardRows, 1,
+                                                std::max<size_t>(pool->size(), 1));
+    std::vector<GradientShard> shards(maxShards);
+    for (auto& shard : shards) shard.gradient.resize(layout.total);
+    
+    const float learningRate = static_cast<float>(options.learningRate);
+    const float momentum = static_cast<float>(options.momentum);
+    
+    std::vector<double> epochLosses;
+    epochLosses.reserve(options.epochs);
+    for (size_t epoch = 0; epoch < options.epochs; ++epoch) {
+        samples.rewind();
+        double lossSum = 0.0;
+        double weightSum = 0.0;
         
-        for (size_t i = 0; i < data.contexts.size(); ++i) {
-            const auto& context = data.contexts[i];
-            const auto& target = data.targets[i];
-            
-            // Forward pass
-            std::vector<double> input = context.toInputVector();
-            std::vector<double> prediction = model.forward(input);
+        while (size_t rows = samples.read(batchSize, inputs.data(), targets.data(), weights.data())) {
+            double batchWeight = std::accumulate(weights.begin(), weights.begin() + rows, 0.0);
+            if (batchWeight <= 0.0) continue;
             
-            // Compute loss
-            std::vector<double> targetValues = target.values;
-            targetValues.insert(targetValues.end(), target.routes.begin(), target.routes.end());
+            // Loss is the weighted mean over the batch of each row's MSE
+            const float gradientScale = static_cast<float>(1.0 / (batchWeight * targetSize));
+            const size_t shardCount = std::min(maxShards, (rows + kMinShardRows - 1) / kMinShardRows);
+            const size_t shardRows = (rows + shardCount - 1) / shardCount;
+            pool->parallelFor(shardCount, [&](size_t s) {
+                GradientShard& shard = shards[s];
+                std::fill(shard.gradient.begin(), shard.gradient.end(), 0.0f);
+                shard.loss = 0.0;
+                
+                size_t r0 = s * shardRows;
+                size_t r1 = std::min(rows, r0 + shardRows);
+                if (r0 >= r1) return;
+                backpropagate(model, layout, inputs.data() + r0 * inputSize, targets.data() + r0 * targetSize,
+                              weights.data() + r0, r1 - r0, gradientScale, shard);
+            });
             
-            double loss = computeLoss(prediction, targetValues);
-            totalLoss += loss;
+            // Sum the shards and take one momentum step, range by range
+            pool->parallelFor(layout.ranges.size(), [&](size_t r) {
+                const auto& range = layout.ranges[r];
+                float* gradient = shards[0].gradient.data() + range.offset;
+                for (size_t s = 1; s < shardCount; ++s) {
+                    const float* other = shards[s].gradient.data() + range.offset;
+                    for (size_t i = 0; i < range.size; ++i) gradient[i] += other[i];
+                }
+                
+                float* v = velocity.data() + range.offset;
+                for (size_t i = 0; i < range.size; ++i) {
+                    v[i] = momentum * v[i] - learningRate * gradient[i];
+                    range.values[i] += v[i];
+                }
+            });
             
-            // Compute gradient and update weights
-            std::vector<double> gradient = computeGradient(prediction, targetValues);
-            updateWeights(model, gradient, learningRate);
+            for (size_t s = 0; s < shardCount; ++s) lossSum += shards[s].loss;
+            weightSum += batchWeight;
         }
         
+        double loss = weightSum > 0.0 ? lossSum / weightSum : 0.0;
+        epochLosses.push_back(loss);
+        
         // Print progress
-        if (epoch % 10 == 0) {
-            std::cout << "Epoch " << epoch << ", Loss: " << totalLoss / data.contexts.size() << std::endl;
+        if (options.logInterval && epoch % options.logInterval == 0) {
+            std::cout << "Epoch " << epoch << ", Loss: " << loss << std::endl;
         }
     }
+    
+    return epochLosses;
+}
+
+double DecisionTrainer::evaluateLoss(const DecisionMLP& model, TrainingSampleStream& samples,
+                                     size_t batchSize) const {
+    const size_t inputSize = samples.getInputSize();
+    const size_t targetSize = samples.getTargetSize();
+    if (inputSize != model.getInputSize() || targetSize != model.getOutputSize()) {
+        throw AIAudioException("Evaluation samples do not match the model size");
+    }
+    batchSize = std::max<size_t>(batchSize, 1);
+    
+    std::vector<float> inputs(batchSize * inputSize);
+    std::vector<float> targets(batchSize * targetSize);
+    std::vector<float> weights(batchSize);
+    std::vector<float> outputs(batchSize * targetSize);
+    
+    samples.rewind();
+    double lossSum = 0.0;
+    double weightSum = 0.0;
+    while (size_t rows = samples.read(batchSize, inputs.data(), targets.data(), weights.data())) {
+        model.forwardBatch(inputs.data(), rows, outputs.data());
+        for (size_t i = 0; i < rows * targetSize; ++i) {
+            double diff = outputs[i] - targets[i];
+            lossSum += weights[i / targetSize] * diff * diff / targetSize;
+        }
+        weightSum += std::accumulate(weights.begin(), weights.begin() + rows, 0.0);
+    }
+    return weightSum > 0.0 ? lossSum / weightSum : 0.0;
 }
 
 DecisionTrainer::TrainingData DecisionTrainer::generateFromRules(Role role, size_t numSamples) const {
     TrainingData data;
+    data.contexts.reserve(numSamples);
+    data.targets.reserve(numSamples);
+    data.weights.assign(numSamples, 1.0);
+    
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    const auto& values = ruleValues(role);
     
     for (size_t i = 0; i < numSamples; ++i) {
-        DecisionContext context = generateRandomContext(role);
-        DecisionOutput target = generateTargetFromContext(context);
+        DecisionContext context = makeRuleContext(role, 384); // Default embedding size
+        randomizeContext(context, gen);
         
-        data.contexts.push_back(context);
-        data.targets.push_back(target);
-        data.weights.push_back(1.0);
+        DecisionOutput target;
+        target.values.assign(values.begin(), values.end());
+        target.routes.resize(kRuleRoutes);
+        for (auto&& route : target.routes) {
+            route = dist(gen) > 0.5;
+        }
+        target.confidence = 0.8; // Default confidence
+        
+        data.contexts.push_back(std::move(context));
+        data.targets.push_back(std::move(target));
     }
     
     return data;
@@ -488,109 +994,132 @@ DecisionTrainer::TrainingData DecisionTrainer::augmentData(const TrainingData& d
     return augmented;
 }
 
-DecisionContext DecisionTrainer::generateRandomContext(Role role) const {
-    DecisionContext context;
-    
-    // Generate random query vector
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<double> dist(-1.0, 1.0);
-    
-    context.queryVector.resize(384); // Default embedding size
-    for (double& value : context.queryVector) {
-        value = dist(gen);
-    }
-    
-    context.role = role;
-    context.tempo = 60.0 + (gen() % 140); // 60-200 BPM
-    context.key = gen() % 12; // 0-11
-    
-    // Generate random entry stats
-    context.entryStats.resize(10);
-    for (double& value : context.entryStats) {
-        value = dist(gen);
+
+// TrainingDataStream implementation
+TrainingDataStream::TrainingDataStream(const DecisionTrainer::TrainingData& data, unsigned seed)
+    : data_(data), order_(data.contexts.size()), rng_(seed) {
+    if (!data.contexts.empty()) {
+        inputSize_ = data.contexts.front().getInputSize();
+        targetSize_ = data.targets.front().values.size() + data.targets.front().routes.size();
     }
-    
-    return context;
+    std::iota(order_.begin(), order_.end(), 0);
 }
 
-DecisionOutput DecisionTrainer::generateTargetFromContext(const DecisionContext& context) const {
-    DecisionOutput target;
-    
-    // Generate target values based on context
-    // This is a simplified implementation
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<double> dist(0.0, 1.0);
-    
-    // Generate values based on role
-    switch (context.role) {
-        case Role::PAD:
-            target.values = {0.7, 0.5, 0.8, 0.6, 0.7, 0.9}; // Pad characteristics
-            break;
-        case Role::BASS:
-            target.values = {0.3, 0.8, 0.2, 0.4, 0.8, 0.3}; // Bass characteristics
-            break;
-        case Role::LEAD:
-            target.values = {0.8, 0.9, 0.6, 0.7, 0.8, 0.6}; // Lead characteristics
-            break;
-        default:
-            target.values.resize(6, 0.5);
-            break;
-    }
-    
-    // Generate routes
-    target.routes.resize(10);
-    for (bool& route : target.routes) {
-        route = dist(gen) > 0.5;
+size_t TrainingDataStream::read(size_t count, float* inputs, float* targets, float* weights) {
+    size_t rows = std::min(count, order_.size() - position_);
+    for (size_t r = 0; r < rows; ++r) {
+        size_t i = order_[position_++];
+        const DecisionContext& context = data_.contexts[i];
+        const DecisionOutput& target = data_.targets[i];
+        if (context.getInputSize() != inputSize_ ||
+            target.values.size() + target.routes.size() != targetSize_) {
+            throw AIAudioException("Inconsistent training sample size at index " + std::to_string(i));
+        }
+        
+        context.writeInputVector(inputs + r * inputSize_);
+        float* t = std::copy(target.values.begin(), target.values.end(), targets + r * targetSize_);
+        for (bool route : target.routes) *t++ = route ? 1.0f : 0.0f;
+        weights[r] = i < data_.weights.size() ? static_cast<float>(data_.weights[i]) : 1.0f;
     }
-    
-    target.confidence = 0.8; // Default confidence
-    
-    return target;
+    return rows;
 }
 
-double DecisionTrainer::computeLoss(const std::vector<double>& prediction, 
-                                   const std::vector<double>& target) const {
-    if (prediction.size() != target.size()) {
-        return 1.0; // Maximum loss for size mismatch
-    }
+void TrainingDataStream::rewind() {
+    std::shuffle(order_.begin(), order_.end(), rng_);
+    position_ = 0;
+}
+
+// RuleSampleStream implementation
+RuleSampleStream::RuleSampleStream(Role role, size_t numSamples, size_t queryDimension,
+                                   double noiseLevel, unsigned seed)
+    : numSamples_(numSamples), noiseLevel_(noiseLevel), seed_(seed), rng_(seed),
+      context_(makeRuleContext(role, queryDimension)) {
+}
+
+size_t RuleSampleStream::getTargetSize() const {
+    return kRuleValues + kRuleRoutes;
+}
+
+size_t RuleSampleStream::read(size_t count, float* inputs, float* targets, float* weights) {
+    const size_t inputSize = getInputSize();
+    const auto& values = ruleValues(context_.role);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<double> noise(0.0, noiseLevel_ > 0.0 ? noiseLevel_ : 1.0);
     
-    double loss = 0.0;
-    for (size_t i = 0; i < prediction.size(); ++i) {
-        double diff = prediction[i] - target[i];
-        loss += diff * diff;
+    size_t rows = std::min(count, numSamples_ - produced_);
+    for (size_t r = 0; r < rows; ++r) {
+        randomizeContext(context_, rng_);
+        
+        // Same perturbation as augmentData()
+        if (noiseLevel_ > 0.0) {
+            for (double& value : context_.queryVector) value += noise(rng_);
+            for (double& value : context_.entryStats) value += noise(rng_);
+        }
+        context_.writeInputVector(inputs + r * inputSize);
+        
+        float* t = targets + r * getTargetSize();
+        for (size_t v = 0; v < kRuleValues; ++v) {
+            double value = noiseLevel_ > 0.0 ? std::clamp(values[v] + noise(rng_), 0.0, 1.0) : values[v];
+            *t++ = static_cast<float>(value);
+        }
+        for (size_t route = 0; route < kRuleRoutes; ++route) {
+            *t++ = unit(rng_) > 0.5 ? 1.0f : 0.0f;
+        }
+        weights[r] = 1.0f;
     }
+    produced_ += rows;
+    return rows;
+}
+
+void RuleSampleStream::rewind() {
+    rng_.seed(seed_);
+    produced_ = 0;
+}
+
+// DecisionValidator implementation
+double DecisionValidator::benchmarkDecisions(const DecisionHeads& heads,
+                                             const std::vector<DecisionContext>& contexts) const {
+    if (contexts.empty()) return 0.0;
     
-    return loss / prediction.size();
+    // Mean milliseconds per context, inferred as one batch
+    auto start = std::chrono::steady_clock::now();
+    heads.inferBatch(contexts);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / contexts.size();
 }
 
-std::vector<double> DecisionTrainer::computeGradient(const std::vector<double>& prediction,
-                                                    const std::vector<double>& target) const {
-    std::vector<double> gradient(prediction.size());
+bool DecisionValidator::testLatency(const DecisionHeads& heads, double maxLatencyMs, size_t batchSize) const {
+    const size_t inputSize = heads.getModel().getInputSize();
+    DecisionContext probe;
+    probe.role = Role::UNKNOWN;
+    probe.tempo = 120.0;
+    probe.key = 0;
+    if (inputSize < probe.getInputSize()) return false;
     
-    for (size_t i = 0; i < prediction.size(); ++i) {
-        gradient[i] = 2.0 * (prediction[i] - target[i]);
+    // Synthetic contexts shaped for the model; the query fills the rest
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<DecisionContext> contexts(std::max<size_t>(batchSize, 1), probe);
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        contexts[i].role = static_cast<Role>(i % 8);
+        contexts[i].queryVector.resize(inputSize - probe.getInputSize());
+        for (double& value : contexts[i].queryVector) value = dist(gen);
     }
     
-    return gradient;
+    // Warm-up sizes the scratch buffers, then the best trial counts
+    heads.inferBatch(contexts);
+    double best = std::numeric_limits<double>::max();
+    for (size_t trial = 0; trial < kLatencyTrials; ++trial) {
+        best = std::min(best, benchmarkDecisions(heads, contexts) * contexts.size());
+    }
+    return best <= maxLatencyMs;
 }
 
-void DecisionTrainer::updateWeights(DecisionMLP& model, const std::vector<double>& gradient, 
-                                   double learningRate) const {
-    // Simplified weight update
-    // In practice, would implement proper backpropagation
-    for (auto& layer : model.layers) {
-        for (auto& row : layer.weights) {
-            for (double& weight : row) {
-                weight -= learningRate * 0.01; // Simplified update
-            }
-        }
-        
-        for (double& bias : layer.biases) {
-            bias -= learningRate * 0.01; // Simplified update
-        }
-    }
+double DecisionValidator::measureInferenceTime(const DecisionHeads& heads,
+                                               const DecisionContext& context) const {
+    auto start = std::chrono::steady_clock::now();
+    heads.infer(context);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
-} // namespace aiaudio
\ No newline at end of file
+} // namespace aiaudio
@@ -1,13 +1,308 @@
 #include "dsp_ir.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include "wavetable.h"
 #include <algorithm>
 #include <cmath>
 #include <queue>
 #include <sstream>
 #include <fstream>
+#include <unordered_set>
 #include <json/json.h>
 
 namespace aiaudio {
 
+namespace {
+
+// Parameter names of the built-in stages, in Param enum order
+constexpr std::string_view kOscillatorParameters[] = {"frequency", "amplitude", "phase", "waveType"};
+constexpr std::string_view kFilterParameters[] = {"cutoff", "resonance", "filterType"};
+constexpr std::string_view kEnvelopeParameters[] = {"attack", "decay", "sustain", "release"};
+constexpr std::string_view kLFOParameters[] = {"rate", "depth", "waveType"};
+constexpr std::string_view kSpatialParameters[] = {"pan", "width"};
+
+std::vector<std::string> parameterNames(std::span<const std::string_view> names) {
+    return std::vector<std::string>(names.begin(), names.end());
+}
+
+// Match the planar output layout to the input; returns the frame count
+size_t matchChannelLayout(const PlanarBuffer& input, PlanarBuffer& output) {
+    const size_t numFrames = input.empty() ? 0 : input[0].size();
+    output.resize(input.size());
+    for (auto& channel : output) {
+        channel.resize(numFrames);
+    }
+    return numFrames;
+}
+
+#ifndef AIAUDIO_NO_METRICS
+// Process time per stage type. Series are registered on a type's first
+// block, so types that never run export nothing; later blocks only load
+// the cached pointer.
+LatencyHistogram& stageProcessHistogram(StageType type) {
+    static constexpr std::array<const char*, 12> names = {
+        "oscillator", "sampler", "wavetable", "shaper", "filter", "spatial",
+        "effect", "meter", "limiter", "envelope", "lfo", "macro"};
+    static std::array<std::atomic<LatencyHistogram*>, 12> histograms{};
+    
+    const size_t index = static_cast<size_t>(type);
+    LatencyHistogram* histogram = histograms[index].load(std::memory_order_acquire);
+    if (!histogram) {
+        // The registry returns the same series to racing threads
+        histogram = &MetricsRegistry::global().histogram(
+            "aiaudio_stage_process_seconds", "Time in DSPStage::process per block", {{"stage", names[index]}});
+        histograms[index].store(histogram, std::memory_order_release);
+    }
+    return *histogram;
+}
+#endif
+
+// Waveform shapes, specialized so the waveform is chosen once per block
+// rather than compared per sample
+template<Waveform W>
+double waveformValue(double phase, double phaseOffset) {
+    if constexpr (W == Waveform::SINE) {
+        return std::sin(phase + phaseOffset);
+    } else if constexpr (W == Waveform::SAW) {
+        return 2.0 * (phase / (2.0 * M_PI)) - 1.0;
+    } else if constexpr (W == Waveform::SQUARE) {
+        return (phase < M_PI) ? 1.0 : -1.0;
+    } else {
+        if (phase < M_PI) {
+            return 2.0 * phase / M_PI - 1.0;
+        }
+        return 3.0 - 2.0 * phase / M_PI;
+    }
+}
+
+// output = waveform * gain + input, advancing phase by increment and gain
+// by gainStep per sample
+template<Waveform W>
+void renderWaveform(const Sample* input, Sample* output, size_t n, double& phase,
+                    double increment, double phaseOffset, double gain, double gainStep) {
+    for (size_t i = 0; i < n; ++i) {
+        output[i] = waveformValue<W>(phase, phaseOffset) * gain + input[i];
+        phase += increment;
+        gain += gainStep;
+        
+        // Wrap phase
+        while (phase >= 2.0 * M_PI) {
+            phase -= 2.0 * M_PI;
+        }
+    }
+}
+
+// Planar variant: one waveform evaluation per frame, shared by every channel
+template<Waveform W>
+void renderWaveformChannels(const PlanarBuffer& input, PlanarBuffer& output, size_t offset, size_t numFrames,
+                            double& phase, double increment, double phaseOffset, double gain, double gainStep) {
+    for (size_t i = offset; i < offset + numFrames; ++i) {
+        double scaled = waveformValue<W>(phase, phaseOffset) * gain;
+        for (size_t c = 0; c < input.size(); ++c) {
+            output[c][i] = scaled + input[c][i];
+        }
+        
+        phase += increment;
+        gain += gainStep;
+        while (phase >= 2.0 * M_PI) {
+            phase -= 2.0 * M_PI;
+        }
+    }
+}
+
+using WaveformRenderer = void (*)(const Sample*, Sample*, size_t, double&,
+                                  double, double, double, double);
+using WaveformChannelRenderer = void (*)(const PlanarBuffer&, PlanarBuffer&, size_t, size_t, double&,
+                                         double, double, double, double);
+
+WaveformRenderer selectRenderer(Waveform waveform) {
+    switch (waveform) {
+        case Waveform::SAW: return renderWaveform<Waveform::SAW>;
+        case Waveform::SQUARE: return renderWaveform<Waveform::SQUARE>;
+        case Waveform::TRIANGLE: return renderWaveform<Waveform::TRIANGLE>;
+        default: return renderWaveform<Waveform::SINE>;
+    }
+}
+
+WaveformChannelRenderer selectChannelRenderer(Waveform waveform) {
+    switch (waveform) {
+        case Waveform::SAW: return renderWaveformChannels<Waveform::SAW>;
+        case Waveform::SQUARE: return renderWaveformChannels<Waveform::SQUARE>;
+        case Waveform::TRIANGLE: return renderWaveformChannels<Waveform::TRIANGLE>;
+        default: return renderWaveformChannels<Waveform::SINE>;
+    }
+}
+
+// Enum parameters travel through the indexed API as their ordinal
+Waveform waveformFromIndex(double value) {
+    int ordinal = static_cast<int>(std::lround(value));
+    if (ordinal < 0 || ordinal > static_cast<int>(Waveform::TRIANGLE)) {
+        throw AIAudioException("Waveform index out of range: " + std::to_string(ordinal));
+    }
+    return static_cast<Waveform>(ordinal);
+}
+
+FilterType filterTypeFromIndex(double value) {
+    int ordinal = static_cast<int>(std::lround(value));
+    if (ordinal < 0 || ordinal > static_cast<int>(FilterType::BANDPASS)) {
+        throw AIAudioException("Filter type index out of range: " + std::to_string(ordinal));
+    }
+    return static_cast<FilterType>(ordinal);
+}
+
+// Waveform value at one phase, for control-rate sources
+double waveformAt(Waveform waveform, double phase) {
+    switch (waveform) {
+        case Waveform::SAW: return waveformValue<Waveform::SAW>(phase, 0.0);
+        case Waveform::SQUARE: return waveformValue<Waveform::SQUARE>(phase, 0.0);
+        case Waveform::TRIANGLE: return waveformValue<Waveform::TRIANGLE>(phase, 0.0);
+        default: return waveformValue<Waveform::SINE>(phase, 0.0);
+    }
+}
+
+double clampToRange(double value, const ParamRange& range) {
+    return std::min(std::max(value, range.min), range.max);
+}
+
+// Direct form I biquad over n samples
+void runBiquad(const BiquadCoefficients& k, BiquadState& st, const Sample* in, Sample* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        double sample = k.b0 * in[i] + k.b1 * st.x1 + k.b2 * st.x2 - k.a1 * st.y1 - k.a2 * st.y2;
+        
+        st.x2 = st.x1;
+        st.x1 = in[i];
+        st.y2 = st.y1;
+        st.y1 = sample;
+        
+        out[i] = sample;
+    }
+}
+
+// Same, with the coefficients moving by step after every sample
+void runBiquadRamp(BiquadCoefficients k, const BiquadCoefficients& step, BiquadState& st,
+                   const Sample* in, Sample* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        k.b0 += step.b0;
+        k.b1 += step.b1;
+        k.b2 += step.b2;
+        k.a1 += step.a1;
+        k.a2 += step.a2;
+        double sample = k.b0 * in[i] + k.b1 * st.x1 + k.b2 * st.x2 - k.a1 * st.y1 - k.a2 * st.y2;
+        
+        st.x2 = st.x1;
+        st.x1 = in[i];
+        st.y2 = st.y1;
+        st.y1 = sample;
+        
+        out[i] = sample;
+    }
+}
+
+// Per-sample change that takes from to to in n samples
+BiquadCoefficients coefficientStep(const BiquadCoefficients& from, const BiquadCoefficients& to, size_t n) {
+    const double scale = 1.0 / static_cast<double>(n);
+    return {(to.b0 - from.b0) * scale, (to.b1 - from.b1) * scale, (to.b2 - from.b2) * scale,
+            (to.a1 - from.a1) * scale, (to.a2 - from.a2) * scale};
+}
+
+BiquadCoefficients advanceCoefficients(BiquadCoefficients k, const BiquadCoefficients& step, size_t n) {
+    const double count = static_cast<double>(n);
+    k.b0 += step.b0 * count;
+    k.b1 += step.b1 * count;
+    k.b2 += step.b2 * count;
+    k.a1 += step.a1 * count;
+    k.a2 += step.a2 * count;
+    return k;
+}
+
+} // namespace
+
+// Enum names used by presets
+Waveform parseWaveform(const std::string& name) {
+    if (name == "sine") return Waveform::SINE;
+    if (name == "saw") return Waveform::SAW;
+    if (name == "square") return Waveform::SQUARE;
+    if (name == "triangle") return Waveform::TRIANGLE;
+    throw AIAudioException("Unknown waveform: " + name);
+}
+
+std::string waveformName(Waveform waveform) {
+    switch (waveform) {
+        case Waveform::SAW: return "saw";
+        case Waveform::SQUARE: return "square";
+        case Waveform::TRIANGLE: return "triangle";
+        default: return "sine";
+    }
+}
+
+FilterType parseFilterType(const std::string& name) {
+    if (name == "lowpass") return FilterType::LOWPASS;
+    if (name == "highpass") return FilterType::HIGHPASS;
+    if (name == "bandpass") return FilterType::BANDPASS;
+    throw AIAudioException("Unknown filter type: " + name);
+}
+
+std::string filterTypeName(FilterType type) {
+    switch (type) {
+        case FilterType::HIGHPASS: return "highpass";
+        case FilterType::BANDPASS: return "bandpass";
+        default: return "lowpass";
+    }
+}
+
+void renderOscillator(Waveform waveform, const Sample* input, Sample* output, size_t n,
+                      double& phase, double increment, double phaseOffset, double gain,
+                      const SIMDKernels* kernels) {
+    if (kernels && waveform == Waveform::SINE) {
+        kernels->sineOscillator(input, output, n, phase, increment, phaseOffset, gain);
+        return;
+    }
+    selectRenderer(waveform)(input, output, n, phase, increment, phaseOffset, gain, 0.0);
+}
+
+int findParameterIndex(std::span<const std::string_view> names, std::string_view name) {
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (names[i] == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// DSPStage default indexed parameter access, via the string-keyed API
+int DSPStage::getParameterIndex(const std::string& name) const {
+    auto names = getParameterNames();
+    auto it = std::find(names.begin(), names.end(), name);
+    return it != names.end() ? static_cast<int>(it - names.begin()) : -1;
+}
+
+void DSPStage::setParameterValue(int index, double value) {
+    auto names = getParameterNames();
+    if (index < 0 || index >= static_cast<int>(names.size())) {
+        throw AIAudioException("Parameter index out of range: " + std::to_string(index));
+    }
+    setParameter(names[index], value);
+}
+
+double DSPStage::getParameterValue(int index) const {
+    auto names = getParameterNames();
+    if (index < 0 || index >= static_cast<int>(names.size())) {
+        throw AIAudioException("Parameter index out of range: " + std::to_string(index));
+    }
+    auto value = getParameter(names[index]);
+    return std::holds_alternative<double>(value) ? std::get<double>(value) : 0.0;
+}
+
+void DSPStage::setParameterTarget(int index, double value, size_t /*frames*/) {
+    setParameterValue(index, value);
+}
+
+// DSPStage default multichannel path
+void DSPStage::processChannels(const PlanarBuffer& input, PlanarBuffer& output) {
+    output.resize(input.size());
+    for (size_t c = 0; c < input.size(); ++c) {
+        process(input[c], output[c]);
+    }
+}
+
 // OscillatorStage implementation
 OscillatorStage::OscillatorStage() : frequency_(440.0, 20.0, 20000.0, "frequency"),
                                     amplitude_(0.5, 0.0, 1.0, "amplitude"),
@@ -18,32 +313,56 @@ void OscillatorStage::process(const AudioBuffer& input, AudioBuffer& output) {
     output.resize(input.size());
     
     double phaseIncrement = 2.0 * M_PI * frequency_.value / sampleRate_;
+    double phaseOffset = phase_.value * 2.0 * M_PI;
     
-    for (size_t i = 0; i < input.size(); ++i) {
-        double sample = 0.0;
-        
-        if (waveType_ == "sine") {
-            sample = std::sin(phaseAccumulator_ + phase_.value * 2.0 * M_PI);
-        } else if (waveType_ == "saw") {
-            sample = 2.0 * (phaseAccumulator_ / (2.0 * M_PI)) - 1.0;
-        } else if (waveType_ == "square") {
-            sample = (phaseAccumulator_ < M_PI) ? 1.0 : -1.0;
-        } else if (waveType_ == "triangle") {
-            if (phaseAccumulator_ < M_PI) {
-                sample = 2.0 * phaseAccumulator_ / M_PI - 1.0;
-            } else {
-                sample = 3.0 - 2.0 * phaseAccumulator_ / M_PI;
-            }
-        }
-        
-        output[i] = sample * amplitude_.value + input[i];
-        phaseAccumulator_ += phaseIncrement;
-        
-        // Wrap phase
-        while (phaseAccumulator_ >= 2.0 * M_PI) {
-            phaseAccumulator_ -= 2.0 * M_PI;
+    // Ramped samples take the scalar path, the rest the usual one
+    size_t done = 0;
+    if (rampRemaining_ > 0) {
+        done = std::min(input.size(), rampRemaining_);
+        const double step = (amplitude_.value - rampGain_) / static_cast<double>(rampRemaining_);
+        selectRenderer(waveform_)(input.data(), output.data(), done, phaseAccumulator_,
+                                  phaseIncrement, phaseOffset, rampGain_ + step, step);
+        rampGain_ += step * static_cast<double>(done);
+        rampRemaining_ -= done;
+    }
+    renderOscillator(waveform_, input.data() + done, output.data() + done, input.size() - done,
+                     phaseAccumulator_, phaseIncrement, phaseOffset, amplitude_.value, kernels_);
+    if (done < input.size()) rampGain_ = amplitude_.value;
+    hasGain_ = hasGain_ || !input.empty();
+}
+
+void OscillatorStage::processChannels(const PlanarBuffer& input, PlanarBuffer& output) {
+    const size_t numFrames = matchChannelLayout(input, output);
+    const size_t numChannels = input.size();
+    
+    double phaseIncrement = 2.0 * M_PI * frequency_.value / sampleRate_;
+    double phaseOffset = phase_.value * 2.0 * M_PI;
+    
+    size_t done = 0;
+    if (rampRemaining_ > 0) {
+        done = std::min(numFrames, rampRemaining_);
+        const double step = (amplitude_.value - rampGain_) / static_cast<double>(rampRemaining_);
+        selectChannelRenderer(waveform_)(input, output, 0, done, phaseAccumulator_,
+                                         phaseIncrement, phaseOffset, rampGain_ + step, step);
+        rampGain_ += step * static_cast<double>(done);
+        rampRemaining_ -= done;
+    }
+    if (done < numFrames) rampGain_ = amplitude_.value;
+    hasGain_ = hasGain_ || numFrames > 0;
+    
+    if (kernels_ && waveform_ == Waveform::SINE) {
+        // Every channel starts from the same phase
+        double startPhase = phaseAccumulator_;
+        for (size_t c = 0; c < numChannels; ++c) {
+            phaseAccumulator_ = startPhase;
+            kernels_->sineOscillator(input[c].data() + done, output[c].data() + done, numFrames - done,
+                                     phaseAccumulator_, phaseIncrement, phaseOffset, amplitude_.value);
         }
+        return;
     }
+    
+    selectChannelRenderer(waveform_)(input, output, done, numFrames - done, phaseAccumulator_,
+                                     phaseIncrement, phaseOffset, amplitude_.value, 0.0);
 }
 
 void OscillatorStage::setParameter(const std::string& name, const ParamValue& value) {
@@ -54,7 +373,7 @@ void OscillatorStage::setParameter(const std::string& name, const ParamValue& va
     } else if (name == "phase") {
         phase_.setValue(std::get<double>(value));
     } else if (name == "waveType") {
-        waveType_ = std::get<std::string>(value);
+        waveform_ = parseWaveform(std::get<std::string>(value));
     }
 }
 
@@ -62,269 +381,999 @@ ParamValue OscillatorStage::getParameter(const std::string& name) const {
     if (name == "frequency") return frequency_.value;
     if (name == "amplitude") return amplitude_.value;
     if (name == "phase") return phase_.value;
-    if (name == "waveType") return waveType_;
+    if (name == "waveType") return waveformName(waveform_);
     return 0.0;
 }
 
+void OscillatorStage::setParameterValue(int index, double value) {
+    switch (index) {
+        case FREQUENCY: frequency_.setValue(value); break;
+        case AMPLITUDE: amplitude_.setValue(value); break;
+        case PHASE: phase_.setValue(value); break;
+        case WAVE_TYPE: waveform_ = waveformFromIndex(value); break;
+        default: DSPStage::setParameterValue(index, value);
+    }
+}
+
+double OscillatorStage::getParameterValue(int index) const {
+    switch (index) {
+        case FREQUENCY: return frequency_.value;
+        case AMPLITUDE: return amplitude_.value;
+        case PHASE: return phase_.value;
+        case WAVE_TYPE: return static_cast<double>(waveform_);
+        default: return DSPStage::getParameterValue(index);
+    }
+}
+
+ParamRange OscillatorStage::getParameterRange(int index) const {
+    switch (index) {
+        case FREQUENCY: return {frequency_.min, frequency_.max};
+        case AMPLITUDE: return {amplitude_.min, amplitude_.max};
+        case PHASE: return {phase_.min, phase_.max};
+        case WAVE_TYPE: return {0.0, static_cast<double>(Waveform::TRIANGLE)};
+        default: return DSPStage::getParameterRange(index);
+    }
+}
+
+void OscillatorStage::setParameterTarget(int index, double value, size_t frames) {
+    if (index != AMPLITUDE || frames == 0) {
+        setParameterValue(index, value);
+        return;
+    }
+    // Ramp from the gain of the last rendered sample
+    if (!hasGain_) rampGain_ = amplitude_.value;
+    amplitude_.setValue(value);
+    rampRemaining_ = rampGain_ == value ? 0 : frames;
+}
+
 std::vector<std::string> OscillatorStage::getParameterNames() const {
-    return {"frequency", "amplitude", "phase", "waveType"};
+    return parameterNames(kOscillatorParameters);
+}
+
+int OscillatorStage::getParameterIndex(const std::string& name) const {
+    return findParameterIndex(kOscillatorParameters, name);
 }
 
 void OscillatorStage::reset() {
     phaseAccumulator_ = 0.0;
+    rampRemaining_ = 0;
+    hasGain_ = false;
+}
+
+std::string OscillatorStage::getDescription() const {
+    return "Oscillator: " + waveformName(waveform_) + " wave at " + std::to_string(frequency_.value) + " Hz";
+}
+
+// FilterStage implementation
+FilterStage::FilterStage() : cutoff_(1000.0, 20.0, 20000.0, "cutoff"),
+                           resonance_(0.1, 0.0, 0.99, "resonance") {
+}
+
+BiquadCoefficients FilterStage::computeCoefficients() const {
+    // Simple biquad filter implementation
+    double w = 2.0 * M_PI * cutoff_.value / sampleRate_;
+    double cosw = std::cos(w);
+    double sinw = std::sin(w);
+    double alpha = sinw / (2.0 * resonance_.value);
+    
+    double b0, b1, b2;
+    switch (filterType_) {
+        case FilterType::HIGHPASS:
+            b0 = (1.0 + cosw) / 2.0;
+            b1 = -(1.0 + cosw);
+            b2 = (1.0 + cosw) / 2.0;
+            break;
+        case FilterType::BANDPASS:
+            // Constant 0 dB peak gain
+            b0 = alpha;
+            b1 = 0.0;
+            b2 = -alpha;
+            break;
+        default:
+            b0 = (1.0 - cosw) / 2.0;
+            b1 = 1.0 - cosw;
+            b2 = (1.0 - cosw) / 2.0;
+            break;
+    }
+    
+    double a0 = 1.0 + alpha;
+    double a1 = -2.0 * cosw;
+    double a2 = 1.0 - alpha;
+    
+    // Normalize coefficients
+    return {b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+}
+
+std::array<double, 4> FilterStage::coefficientParameters() const {
+    return {cutoff_.value, resonance_.value, static_cast<double>(filterType_), sampleRate_};
+}
+
+const BiquadCoefficients& FilterStage::coefficients() {
+    // Static parameters reuse the cached coefficients; trig runs only when
+    // cutoff, resonance, type or rate changed since the last block
+    const std::array<double, 4> key = coefficientParameters();
+    if (!hasCoefficients_ || key != coefficientKey_) {
+        coefficients_ = computeCoefficients();
+        coefficientKey_ = key;
+        hasCoefficients_ = true;
+    }
+    return coefficients_;
+}
+
+void FilterStage::process(const AudioBuffer& input, AudioBuffer& output) {
+    output.resize(input.size());
+    
+    const BiquadCoefficients& k = coefficients();
+    
+    size_t done = 0;
+    if (rampRemaining_ > 0) {
+        done = std::min(input.size(), rampRemaining_);
+        const BiquadCoefficients step = coefficientStep(rampCoefficients_, k, rampRemaining_);
+        runBiquadRamp(rampCoefficients_, step, state_, input.data(), output.data(), done);
+        rampCoefficients_ = advanceCoefficients(rampCoefficients_, step, done);
+        rampRemaining_ -= done;
+    }
+    runBiquad(k, state_, input.data() + done, output.data() + done, input.size() - done);
+}
+
+void FilterStage::processChannels(const PlanarBuffer& input, PlanarBuffer& output) {
+    const size_t numFrames = matchChannelLayout(input, output);
+    prepareChannels(input.size());
+    
+    // Coefficients are computed once and shared across channels
+    const BiquadCoefficients& k = coefficients();
+    
+    // Every channel follows the same coefficient ramp
+    size_t done = 0;
+    if (rampRemaining_ > 0) {
+        done = std::min(numFrames, rampRemaining_);
+        const BiquadCoefficients step = coefficientStep(rampCoefficients_, k, rampRemaining_);
+        for (size_t c = 0; c < input.size(); ++c) {
+            runBiquadRamp(rampCoefficients_, step, channelState_[c], input[c].data(), output[c].data(), done);
+        }
+        rampCoefficients_ = advanceCoefficients(rampCoefficients_, step, done);
+        rampRemaining_ -= done;
+    }
+    
+    if (kernels_) {
+        // Channels run in vector lanes, up to four per kernel call
+        const Sample* in[4];
+        Sample* out[4];
+        for (size_t c = 0; c < input.size(); c += 4) {
+            size_t count = std::min<size_t>(4, input.size() - c);
+            for (size_t lane = 0; lane < count; ++lane) {
+                in[lane] = input[c + lane].data() + done;
+                out[lane] = output[c + lane].data() + done;
+            }
+            kernels_->biquad(in, out, count, numFrames - done, k, &channelState_[c]);
+        }
+        return;
+    }
+    
+    for (size_t c = 0; c < input.size(); ++c) {
+        runBiquad(k, channelState_[c], input[c].data() + done, output[c].data() + done, numFrames - done);
+    }
+}
+
+void FilterStage::prepareChannels(size_t numChannels) {
+    if (channelState_.size() < numChannels) {
+        channelState_.resize(numChannels);
+    }
+}
+
+void FilterStage::setParameter(const std::string& name, const ParamValue& value) {
+    if (name == "cutoff") {
+        cutoff_.setValue(std::get<double>(value));
+    } else if (name == "resonance") {
+        resonance_.setValue(std::get<double>(value));
+    } else if (name == "filterType") {
+        filterType_ = parseFilterType(std::get<std::string>(value));
+    }
+}
+
+ParamValue FilterStage::getParameter(const std::string& name) const {
+    if (name == "cutoff") return cutoff_.value;
+    if (name == "resonance") return resonance_.value;
+    if (name == "filterType") return filterTypeName(filterType_);
+    return 0.0;
+}
+
+void FilterStage::setParameterValue(int index, double value) {
+    switch (index) {
+        case CUTOFF: cutoff_.setValue(value); break;
+        case RESONANCE: resonance_.setValue(value); break;
+        case FILTER_TYPE: filterType_ = filterTypeFromIndex(value); break;
+        default: DSPStage::setParameterValue(index, value);
+    }
+}
+
+double FilterStage::getParameterValue(int index) const {
+    switch (index) {
+        case CUTOFF: return cutoff_.value;
+        case RESONANCE: return resonance_.value;
+        case FILTER_TYPE: return static_cast<double>(filterType_);
+        default: return DSPStage::getParameterValue(index);
+    }
+}
+
+ParamRange FilterStage::getParameterRange(int index) const {
+    switch (index) {
+        case CUTOFF: return {cutoff_.min, cutoff_.max};
+        case RESONANCE: return {resonance_.min, resonance_.max};
+        case FILTER_TYPE: return {0.0, static_cast<double>(FilterType::BANDPASS)};
+        default: return DSPStage::getParameterRange(index);
+    }
+}
+
+void FilterStage::setParameterTarget(int index, double value, size_t frames) {
+    // Coefficients in use: part way through a ramp, or the last block's
+    const bool ramping = rampRemaining_ > 0;
+    const bool haveCurrent = ramping || hasCoefficients_;
+    const BiquadCoefficients current = ramping ? rampCoefficients_ : coefficients_;
+    
+    setParameterValue(index, value);
+    if (frames == 0 || !haveCurrent) return;
+    if (!ramping && coefficientParameters() == coefficientKey_) return;  // Unchanged
+    rampCoefficients_ = current;
+    rampRemaining_ = frames;
+}
+
+std::vector<std::string> FilterStage::getParameterNames() const {
+    return parameterNames(kFilterParameters);
+}
+
+int FilterStage::getParameterIndex(const std::string& name) const {
+    return findParameterIndex(kFilterParameters, name);
+}
+
+void FilterStage::reset() {
+    state_ = BiquadState{};
+    std::fill(channelState_.begin(), channelState_.end(), BiquadState{});
+    rampRemaining_ = 0;
+    hasCoefficients_ = false;    // Nothing to ramp from after a reset
+}
+
+std::string FilterStage::getDescription() const {
+    return "Filter: " + filterTypeName(filterType_) + " at " + std::to_string(cutoff_.value) + " Hz";
+}
+
+// EnvelopeStage implementation
+EnvelopeStage::EnvelopeStage() : attack_(0.01, 0.001, 2.0, "attack"),
+                                decay_(0.1, 0.001, 2.0, "decay"),
+                                sustain_(0.7, 0.0, 1.0, "sustain"),
+                                release_(0.5, 0.001, 5.0, "release") {
+}
+
+void EnvelopeStage::process(const AudioBuffer& input, AudioBuffer& output) {
+    output.resize(input.size());
+    
+    for (size_t i = 0; i < input.size(); ++i) {
+        output[i] = input[i] * advance(input[i]);
+    }
+}
+
+void EnvelopeStage::processChannels(const PlanarBuffer& input, PlanarBuffer& output) {
+    const size_t numFrames = matchChannelLayout(input, output);
+    const size_t numChannels = input.size();
+    
+    // Linked envelope: gate on the loudest channel, one level for all channels
+    for (size_t i = 0; i < numFrames; ++i) {
+        double gate = input[0][i];
+        for (size_t c = 1; c < numChannels; ++c) {
+            gate = std::max(gate, static_cast<double>(input[c][i]));
+        }
+        
+        double level = advance(gate);
+        for (size_t c = 0; c < numChannels; ++c) {
+            output[c][i] = input[c][i] * level;
+        }
+    }
+}
+
+double EnvelopeStage::advance(double gate) {
+    // Simple envelope state machine
+    if (gate > 0.001 && state_ == EnvState::IDLE) {
+        // Gate on
+        state_ = EnvState::ATTACK;
+        currentLevel_ = 0.0;
+        targetLevel_ = 1.0;
+        rate_ = 1.0 / (attack_.value * sampleRate_);
+        sampleCount_ = 0;
+    } else if (gate <= 0.001 && state_ != EnvState::IDLE && state_ != EnvState::RELEASE) {
+        // Gate off
+        state_ = EnvState::RELEASE;
+        targetLevel_ = 0.0;
+        rate_ = 1.0 / (release_.value * sampleRate_);
+        sampleCount_ = 0;
+    }
+    
+    // Update envelope level
+    switch (state_) {
+        case EnvState::ATTACK:
+            currentLevel_ += rate_;
+            if (currentLevel_ >= 1.0) {
+                currentLevel_ = 1.0;
+                state_ = EnvState::DECAY;
+                targetLevel_ = sustain_.value;
+                rate_ = (1.0 - sustain_.value) / (decay_.value * sampleRate_);
+                sampleCount_ = 0;
+            }
+            break;
+            
+        case EnvState::DECAY:
+            currentLevel_ -= rate_;
+            if (currentLevel_ <= sustain_.value) {
+                currentLevel_ = sustain_.value;
+                state_ = EnvState::SUSTAIN;
+            }
+            break;
+            
+        case EnvState::SUSTAIN:
+            currentLevel_ = sustain_.value;
+            break;
+            
+        case EnvState::RELEASE:
+            currentLevel_ -= rate_;
+            if (currentLevel_ <= 0.0) {
+                currentLevel_ = 0.0;
+                state_ = EnvState::IDLE;
+            }
+            break;
+            
+        case EnvState::IDLE:
+            currentLevel_ = 0.0;
+            break;
+    }
+    
+    sampleCount_++;
+    return currentLevel_;
+}
+
+void EnvelopeStage::setParameter(const std::string& name, const ParamValue& value) {
+    if (name == "attack") {
+        attack_.setValue(std::get<double>(value));
+    } else if (name == "decay") {
+        decay_.setValue(std::get<double>(value));
+    } else if (name == "sustain") {
+        sustain_.setValue(std::get<double>(value));
+    } else if (name == "release") {
+        release_.setValue(std::get<double>(value));
+    }
+}
+
+ParamValue EnvelopeStage::getParameter(const std::string& name) const {
+    if (name == "attack") return attack_.value;
+    if (name == "decay") return decay_.value;
+    if (name == "sustain") return sustain_.value;
+    if (name == "release") return release_.value;
+    return 0.0;
+}
+
+void EnvelopeStage::setParameterValue(int index, double value) {
+    switch (index) {
+        case ATTACK: attack_.setValue(value); break;
+        case DECAY: decay_.setValue(value); break;
+        case SUSTAIN: sustain_.setValue(value); break;
+        case RELEASE: release_.setValue(value); break;
+        default: DSPStage::setParameterValue(index, value);
+    }
+}
+
+double EnvelopeStage::getParameterValue(int index) const {
+    switch (index) {
+        case ATTACK: return attack_.value;
+        case DECAY: return decay_.value;
+        case SUSTAIN: return sustain_.value;
+        case RELEASE: return release_.value;
+        default: return DSPStage::getParameterValue(index);
+    }
+}
+
+ParamRange EnvelopeStage::getParameterRange(int index) const {
+    switch (index) {
+        case ATTACK: return {attack_.min, attack_.max};
+        case DECAY: return {decay_.min, decay_.max};
+        case SUSTAIN: return {sustain_.min, sustain_.max};
+        case RELEASE: return {release_.min, release_.max};
+        default: return DSPStage::getParameterRange(index);
+    }
+}
+
+double EnvelopeStage::advanceControl(size_t frames, bool gate) {
+    // The same state machine as the audio path, gated by the graph
+    const double level = gate ? 1.0 : 0.0;
+    for (size_t i = 0; i < frames; ++i) {
+        advance(level);
+    }
+    return currentLevel_;
+}
+
+std::vector<std::string> EnvelopeStage::getParameterNames() const {
+    return parameterNames(kEnvelopeParameters);
+}
+
+int EnvelopeStage::getParameterIndex(const std::string& name) const {
+    return findParameterIndex(kEnvelopeParameters, name);
+}
+
+void EnvelopeStage::reset() {
+    state_ = EnvState::IDLE;
+    currentLevel_ = 0.0;
+    targetLevel_ = 0.0;
+    rate_ = 0.0;
+    sampleCount_ = 0;
+}
+
+std::string EnvelopeStage::getDescription() const {
+    return "Envelope: A=" + std::to_string(attack_.value) + 
+           "s D=" + std::to_string(decay_.value) + 
+           "s S=" + std::to_string(sustain_.value) + 
+           " R=" + std::to_string(release_.value) + "s";
+}
+
+// LFOStage implementation
+LFOStage::LFOStage() : rate_(1.0, 0.01, 20.0, "rate"),
+                      depth_(0.5, 0.0, 1.0, "depth") {
+}
+
+void LFOStage::process(const AudioBuffer& input, AudioBuffer& output) {
+    output.resize(input.size());
+    
+    double phaseIncrement = 2.0 * M_PI * rate_.value / sampleRate_;
+    
+    // Scaled by depth and centered around 0
+    renderOscillator(waveform_, input.data(), output.data(), input.size(), phase_,
+                     phaseIncrement, 0.0, depth_.value, kernels_);
+}
+
+void LFOStage::processChannels(const PlanarBuffer& input, PlanarBuffer& output) {
+    const size_t numFrames = matchChannelLayout(input, output);
+    const size_t numChannels = input.size();
+    
+    double phaseIncrement = 2.0 * M_PI * rate_.value / sampleRate_;
+    
+    if (kernels_ && waveform_ == Waveform::SINE) {
+        double startPhase = phase_;
+        for (size_t c = 0; c < numChannels; ++c) {
+            phase_ = startPhase;
+            kernels_->sineOscillator(input[c].data(), output[c].data(), numFrames, phase_,
+                                     phaseIncrement, 0.0, depth_.value);
+        }
+        return;
+    }
+    
+    selectChannelRenderer(waveform_)(input, output, 0, numFrames, phase_, phaseIncrement,
+                                     0.0, depth_.value, 0.0);
+}
+
+void LFOStage::setParameter(const std::string& name, const ParamValue& value) {
+    if (name == "rate") {
+        rate_.setValue(std::get<double>(value));
+    } else if (name == "depth") {
+        depth_.setValue(std::get<double>(value));
+    } else if (name == "waveType") {
+        waveform_ = parseWaveform(std::get<std::string>(value));
+    }
+}
+
+ParamValue LFOStage::getParameter(const std::string& name) const {
+    if (name == "rate") return rate_.value;
+    if (name == "depth") return depth_.value;
+    if (name == "waveType") return waveformName(waveform_);
+    return 0.0;
+}
+
+void LFOStage::setParameterValue(int index, double value) {
+    switch (index) {
+        case RATE: rate_.setValue(value); break;
+        case DEPTH: depth_.setValue(value); break;
+        case WAVE_TYPE: waveform_ = waveformFromIndex(value); break;
+        default: DSPStage::setParameterValue(index, value);
+    }
+}
+
+double LFOStage::getParameterValue(int index) const {
+    switch (index) {
+        case RATE: return rate_.value;
+        case DEPTH: return depth_.value;
+        case WAVE_TYPE: return static_cast<double>(waveform_);
+        default: return DSPStage::getParameterValue(index);
+    }
+}
+
+ParamRange LFOStage::getParameterRange(int index) const {
+    switch (index) {
+        case RATE: return {rate_.min, rate_.max};
+        case DEPTH: return {depth_.min, depth_.max};
+        case WAVE_TYPE: return {0.0, static_cast<double>(Waveform::TRIANGLE)};
+        default: return DSPStage::getParameterRange(index);
+    }
+}
+
+double LFOStage::advanceControl(size_t frames, bool /*gate*/) {
+    // Free-running: one waveform evaluation per tick
+    phase_ += 2.0 * M_PI * rate_.value / sampleRate_ * static_cast<double>(frames);
+    phase_ -= 2.0 * M_PI * std::floor(phase_ / (2.0 * M_PI));
+    return waveformAt(waveform_, phase_) * depth_.value;
+}
+
+std::vector<std::string> LFOStage::getParameterNames() const {
+    return parameterNames(kLFOParameters);
+}
+
+int LFOStage::getParameterIndex(const std::string& name) const {
+    return findParameterIndex(kLFOParameters, name);
+}
+
+void LFOStage::reset() {
+    phase_ = 0.0;
+}
+
+std::string LFOStage::getDescription() const {
+    return "LFO: " + waveformName(waveform_) + " at " + std::to_string(rate_.value) + " Hz, depth " + std::to_string(depth_.value);
+}
+
+// SpatialStage implementation
+SpatialStage::SpatialStage() : pan_(0.0, -1.0, 1.0, "pan"),
+                              width_(1.0, 0.0, 1.0, "width") {
+}
+
+void SpatialStage::process(const AudioBuffer& input, AudioBuffer& output) {
+    // Panning needs at least two channels; mono passes through
+    output.assign(input.begin(), input.end());
+}
+
+void SpatialStage::processChannels(const PlanarBuffer& input, PlanarBuffer& output) {
+    const size_t numFrames = matchChannelLayout(input, output);
+    
+    if (input.size() < 2) {
+        for (size_t c = 0; c < input.size(); ++c) {
+            std::copy(input[c].begin(), input[c].end(), output[c].begin());
+        }
+        return;
+    }
+    
+    // Constant-power pan of the mid signal, unity gain at centre
+    double angle = (pan_.value + 1.0) * M_PI / 4.0;
+    double gainL = std::cos(angle) * M_SQRT2;
+    double gainR = std::sin(angle) * M_SQRT2;
+    double width = width_.value;
+    
+    const AudioBuffer& inL = input[0];
+    const AudioBuffer& inR = input[1];
+    AudioBuffer& outL = output[0];
+    AudioBuffer& outR = output[1];
+    
+    for (size_t i = 0; i < numFrames; ++i) {
+        double mid = 0.5 * (inL[i] + inR[i]);
+        double side = 0.5 * (inL[i] - inR[i]) * width;
+        outL[i] = mid * gainL + side;
+        outR[i] = mid * gainR - side;
+    }
+    
+    // Channels beyond the stereo pair pass through
+    for (size_t c = 2; c < input.size(); ++c) {
+        std::copy(input[c].begin(), input[c].end(), output[c].begin());
+    }
+}
+
+void SpatialStage::setParameter(const std::string& name, const ParamValue& value) {
+    if (name == "pan") {
+        pan_.setValue(std::get<double>(value));
+    } else if (name == "width") {
+        width_.setValue(std::get<double>(value));
+    }
+}
+
+ParamValue SpatialStage::getParameter(const std::string& name) const {
+    if (name == "pan") return pan_.value;
+    if (name == "width") return width_.value;
+    return 0.0;
+}
+
+void SpatialStage::setParameterValue(int index, double value) {
+    switch (index) {
+        case PAN: pan_.setValue(value); break;
+        case WIDTH: width_.setValue(value); break;
+        default: DSPStage::setParameterValue(index, value);
+    }
+}
+
+double SpatialStage::getParameterValue(int index) const {
+    switch (index) {
+        case PAN: return pan_.value;
+        case WIDTH: return width_.value;
+        default: return DSPStage::getParameterValue(index);
+    }
+}
+
+ParamRange SpatialStage::getParameterRange(int index) const {
+    switch (index) {
+        case PAN: return {pan_.min, pan_.max};
+        case WIDTH: return {width_.min, width_.max};
+        default: return DSPStage::getParameterRange(index);
+    }
+}
+
+std::vector<std::string> SpatialStage::getParameterNames() const {
+    return parameterNames(kSpatialParameters);
+}
+
+int SpatialStage::getParameterIndex(const std::string& name) const {
+    return findParameterIndex(kSpatialParameters, name);
+}
+
+void SpatialStage::reset() {
+    // Stateless
+}
+
+std::string SpatialStage::getDescription() const {
+    return "Spatial: pan " + std::to_string(pan_.value) + ", width " + std::to_string(width_.value);
+}
+
+// Stage routing shared by the sequential and parallel plans
+namespace {
+
+void runStage(DSPStage& stage, const AudioBuffer& input, AudioBuffer& output) {
+    AIAUDIO_TIME_SCOPE(stageProcessHistogram(stage.getType()));
+    stage.process(input, output);
+}
+
+void runStage(DSPStage& stage, const PlanarBuffer& input, PlanarBuffer& output) {
+    AIAUDIO_TIME_SCOPE(stageProcessHistogram(stage.getType()));
+    stage.processChannels(input, output);
+}
+
+void copyBuffer(const AudioBuffer& source, AudioBuffer& target) {
+    target.assign(source.begin(), source.end());
+}
+
+void copyBuffer(const PlanarBuffer& source, PlanarBuffer& target) {
+    target.resize(source.size());
+    for (size_t c = 0; c < source.size(); ++c) {
+        target[c].assign(source[c].begin(), source[c].end());
+    }
+}
+
+void mixBuffer(const AudioBuffer& source, AudioBuffer& target) {
+    size_t n = std::min(source.size(), target.size());
+    for (size_t i = 0; i < n; ++i) {
+        target[i] += source[i];
+    }
+}
+
+void mixBuffer(const PlanarBuffer& source, PlanarBuffer& target) {
+    size_t channels = std::min(source.size(), target.size());
+    for (size_t c = 0; c < channels; ++c) {
+        mixBuffer(source[c], target[c]);
+    }
+}
+
+
+// Every stage reads only the one before it
+bool isChainRouting(const std::vector<std::vector<size_t>>& sources) {
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (i == 0 ? !sources[i].empty() : sources[i] != std::vector<size_t>{i - 1}) return false;
+    }
+    return true;
+}
+
+// Stages no other stage reads; their sum is the graph output
+std::vector<size_t> findSinks(const std::vector<std::vector<size_t>>& sources) {
+    std::vector<bool> hasConsumer(sources.size(), false);
+    for (const auto& stageSources : sources) {
+        for (size_t source : stageSources) {
+            hasConsumer[source] = true;
+        }
+    }
+    
+    std::vector<size_t> sinks;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (!hasConsumer[i]) sinks.push_back(i);
+    }
+    return sinks;
+}
+
+// Input of a routed stage: the graph input, its only source's output, or the
+// sum of its sources mixed into the stage's own input buffer
+template<typename Buffer>
+const Buffer& routedInput(const std::vector<size_t>& sources, const Buffer& input,
+                          const std::vector<Buffer>& outputs, Buffer& mix) {
+    if (sources.empty()) return input;
+    if (sources.size() == 1) return outputs[sources[0]];
+    
+    copyBuffer(outputs[sources[0]], mix);
+    for (size_t s = 1; s < sources.size(); ++s) {
+        mixBuffer(outputs[sources[s]], mix);
+    }
+    return mix;
+}
+
+// Graph output: the sum of the sinks in order, so it is deterministic
+template<typename Buffer>
+void mixSinks(const std::vector<size_t>& sinks, const Buffer& input,
+              const std::vector<Buffer>& outputs, Buffer& output) {
+    if (sinks.empty()) {
+        copyBuffer(input, output);
+        return;
+    }
+    
+    copyBuffer(outputs[sinks[0]], output);
+    for (size_t s = 1; s < sinks.size(); ++s) {
+        mixBuffer(outputs[sinks[s]], output);
+    }
+}
+
+void reservePerStage(std::vector<AudioBuffer>& inputs, std::vector<AudioBuffer>& outputs,
+                     std::vector<PlanarBuffer>& channelInputs, std::vector<PlanarBuffer>& channelOutputs,
+                     size_t maxBlockSize, size_t maxChannels) {
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        inputs[i].reserve(maxBlockSize);
+        outputs[i].reserve(maxBlockSize);
+        
+        if (maxChannels > 1) {
+            channelInputs[i].resize(maxChannels);
+            channelOutputs[i].resize(maxChannels);
+            for (size_t c = 0; c < maxChannels; ++c) {
+                channelInputs[i][c].reserve(maxBlockSize);
+                channelOutputs[i][c].reserve(maxBlockSize);
+            }
+        }
+    }
+}
+
+} // namespace
+
+// ExecutionPlan implementation
+ExecutionPlan::ExecutionPlan(std::vector<DSPStage*> stages, std::vector<std::vector<size_t>> sources)
+    : stages_(std::move(stages)), sources_(std::move(sources)) {
+    // Anything but a chain keeps one output per stage
+    chain_ = sources_.empty() || isChainRouting(sources_);
+    if (!chain_) {
+        sinks_ = findSinks(sources_);
+        inputs_.resize(stages_.size());
+        outputs_.resize(stages_.size());
+        channelInputs_.resize(stages_.size());
+        channelOutputs_.resize(stages_.size());
+    }
 }
 
-std::string OscillatorStage::getDescription() const {
-    return "Oscillator: " + waveType_ + " wave at " + std::to_string(frequency_.value) + " Hz";
+void ExecutionPlan::prepare(size_t maxBlockSize, size_t numChannels) {
+    if (maxBlockSize <= maxBlockSize_ && numChannels <= maxChannels_) return;
+    
+    maxBlockSize_ = std::max(maxBlockSize_, maxBlockSize);
+    maxChannels_ = std::max(maxChannels_, numChannels);
+    
+    reservePerStage(inputs_, outputs_, channelInputs_, channelOutputs_, maxBlockSize_, maxChannels_);
+    for (auto& buffer : buffers_) {
+        buffer.reserve(maxBlockSize_);
+    }
+    
+    if (maxChannels_ > 1) {
+        for (auto& planar : channelBuffers_) {
+            planar.resize(maxChannels_);
+            for (auto& channel : planar) {
+                channel.reserve(maxBlockSize_);
+            }
+        }
+    }
+    
+    for (DSPStage* stage : stages_) {
+        stage->prepareChannels(maxChannels_);
+    }
 }
 
-// FilterStage implementation
-FilterStage::FilterStage() : cutoff_(1000.0, 20.0, 20000.0, "cutoff"),
-                           resonance_(0.1, 0.0, 0.99, "resonance") {
+void ExecutionPlan::process(const AudioBuffer& input, AudioBuffer& output) {
+    // Grows only when a block exceeds the prepared size
+    prepare(input.size());
+    if (!chain_) {
+        runRouted(input, output, inputs_, outputs_);
+        return;
+    }
+    
+    // Ping-pong between the two buffers instead of copying after every stage
+    const AudioBuffer* current = &input;
+    size_t next = 0;
+    
+    for (DSPStage* stage : stages_) {
+        AudioBuffer& target = buffers_[next];
+        AIAUDIO_TIME_SCOPE(stageProcessHistogram(stage->getType()));
+        stage->process(*current, target);
+        current = &target;
+        next ^= 1;
+    }
+    
+    output.assign(current->begin(), current->end());
 }
 
-void FilterStage::process(const AudioBuffer& input, AudioBuffer& output) {
-    output.resize(input.size());
-    
-    // Simple biquad filter implementation
-    double w = 2.0 * M_PI * cutoff_.value / 44100.0;
-    double cosw = std::cos(w);
-    double sinw = std::sin(w);
-    double alpha = sinw / (2.0 * resonance_.value);
+void ExecutionPlan::process(const PlanarBuffer& input, PlanarBuffer& output) {
+    const size_t numFrames = input.empty() ? 0 : input[0].size();
+    prepare(numFrames, input.size());
+    if (!chain_) {
+        runRouted(input, output, channelInputs_, channelOutputs_);
+        return;
+    }
     
-    double b0 = (1.0 - cosw) / 2.0;
-    double b1 = 1.0 - cosw;
-    double b2 = (1.0 - cosw) / 2.0;
-    double a0 = 1.0 + alpha;
-    double a1 = -2.0 * cosw;
-    double a2 = 1.0 - alpha;
+    const PlanarBuffer* current = &input;
+    size_t next = 0;
     
-    // Normalize coefficients
-    b0 /= a0; b1 /= a0; b2 /= a0; a1 /= a0; a2 /= a0;
+    for (DSPStage* stage : stages_) {
+        PlanarBuffer& target = channelBuffers_[next];
+        AIAUDIO_TIME_SCOPE(stageProcessHistogram(stage->getType()));
+        stage->processChannels(*current, target);
+        current = &target;
+        next ^= 1;
+    }
     
-    for (size_t i = 0; i < input.size(); ++i) {
-        double sample = b0 * input[i] + b1 * x1_ + b2 * x2_ - a1 * y1_ - a2 * y2_;
-        
-        // Update state
-        x2_ = x1_;
-        x1_ = input[i];
-        y2_ = y1_;
-        y1_ = sample;
-        
-        output[i] = sample;
+    output.resize(current->size());
+    for (size_t c = 0; c < current->size(); ++c) {
+        output[c].assign((*current)[c].begin(), (*current)[c].end());
     }
 }
 
-void FilterStage::setParameter(const std::string& name, const ParamValue& value) {
-    if (name == "cutoff") {
-        cutoff_.setValue(std::get<double>(value));
-    } else if (name == "resonance") {
-        resonance_.setValue(std::get<double>(value));
-    } else if (name == "filterType") {
-        filterType_ = std::get<std::string>(value);
+template<typename Buffer>
+void ExecutionPlan::runRouted(const Buffer& input, Buffer& output,
+                              std::vector<Buffer>& inputs, std::vector<Buffer>& outputs) {
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        runStage(*stages_[i], routedInput(sources_[i], input, outputs, inputs[i]), outputs[i]);
     }
+    mixSinks(sinks_, input, outputs, output);
 }
 
-ParamValue FilterStage::getParameter(const std::string& name) const {
-    if (name == "cutoff") return cutoff_.value;
-    if (name == "resonance") return resonance_.value;
-    if (name == "filterType") return filterType_;
-    return 0.0;
-}
+// ParallelExecutionPlan implementation
 
-std::vector<std::string> FilterStage::getParameterNames() const {
-    return {"cutoff", "resonance", "filterType"};
+ParallelExecutionPlan::ParallelExecutionPlan(std::vector<DSPStage*> stages,
+                                             std::vector<std::vector<size_t>> sources,
+                                             std::shared_ptr<ThreadPool> pool)
+    : stages_(std::move(stages)), sources_(std::move(sources)), pool_(std::move(pool)) {
+    // Depth of each stage: one past its deepest source
+    std::vector<size_t> depth(stages_.size(), 0);
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        for (size_t source : sources_[i]) {
+            depth[i] = std::max(depth[i], depth[source] + 1);
+        }
+        if (levels_.size() <= depth[i]) {
+            levels_.resize(depth[i] + 1);
+        }
+        levels_[depth[i]].push_back(i);
+    }
+    sinks_ = findSinks(sources_);
+    
+    inputs_.resize(stages_.size());
+    outputs_.resize(stages_.size());
+    channelInputs_.resize(stages_.size());
+    channelOutputs_.resize(stages_.size());
 }
 
-void FilterStage::reset() {
-    x1_ = x2_ = y1_ = y2_ = 0.0;
+void ParallelExecutionPlan::prepare(size_t maxBlockSize, size_t numChannels) {
+    if (maxBlockSize <= maxBlockSize_ && numChannels <= maxChannels_) return;
+    
+    maxBlockSize_ = std::max(maxBlockSize_, maxBlockSize);
+    maxChannels_ = std::max(maxChannels_, numChannels);
+    
+    reservePerStage(inputs_, outputs_, channelInputs_, channelOutputs_, maxBlockSize_, maxChannels_);
+    for (DSPStage* stage : stages_) {
+        stage->prepareChannels(maxChannels_);
+    }
 }
 
-std::string FilterStage::getDescription() const {
-    return "Filter: " + filterType_ + " at " + std::to_string(cutoff_.value) + " Hz";
+void ParallelExecutionPlan::process(const AudioBuffer& input, AudioBuffer& output) {
+    prepare(input.size());
+    run(input, output, inputs_, outputs_);
 }
 
-// EnvelopeStage implementation
-EnvelopeStage::EnvelopeStage() : attack_(0.01, 0.001, 2.0, "attack"),
-                                decay_(0.1, 0.001, 2.0, "decay"),
-                                sustain_(0.7, 0.0, 1.0, "sustain"),
-                                release_(0.5, 0.001, 5.0, "release") {
+void ParallelExecutionPlan::process(const PlanarBuffer& input, PlanarBuffer& output) {
+    const size_t numFrames = input.empty() ? 0 : input[0].size();
+    prepare(numFrames, input.size());
+    run(input, output, channelInputs_, channelOutputs_);
 }
 
-void EnvelopeStage::process(const AudioBuffer& input, AudioBuffer& output) {
-    output.resize(input.size());
+template<typename Buffer>
+void ParallelExecutionPlan::run(const Buffer& input, Buffer& output,
+                                std::vector<Buffer>& inputs, std::vector<Buffer>& outputs) {
+    // Each task writes only its own stage's buffers and reads buffers from
+    // earlier levels, so levels need no synchronization beyond the barrier
+    auto runNode = [&](size_t node) {
+        runStage(*stages_[node], routedInput(sources_[node], input, outputs, inputs[node]), outputs[node]);
+    };
     
-    for (size_t i = 0; i < input.size(); ++i) {
-        // Simple envelope state machine
-        if (input[i] > 0.001 && state_ == EnvState::IDLE) {
-            // Gate on
-            state_ = EnvState::ATTACK;
-            currentLevel_ = 0.0;
-            targetLevel_ = 1.0;
-            rate_ = 1.0 / (attack_.value * 44100.0);
-            sampleCount_ = 0;
-        } else if (input[i] <= 0.001 && state_ != EnvState::IDLE && state_ != EnvState::RELEASE) {
-            // Gate off
-            state_ = EnvState::RELEASE;
-            targetLevel_ = 0.0;
-            rate_ = 1.0 / (release_.value * 44100.0);
-            sampleCount_ = 0;
-        }
-        
-        // Update envelope level
-        switch (state_) {
-            case EnvState::ATTACK:
-                currentLevel_ += rate_;
-                if (currentLevel_ >= 1.0) {
-                    currentLevel_ = 1.0;
-                    state_ = EnvState::DECAY;
-                    targetLevel_ = sustain_.value;
-                    rate_ = (1.0 - sustain_.value) / (decay_.value * 44100.0);
-                    sampleCount_ = 0;
-                }
-                break;
-                
-            case EnvState::DECAY:
-                currentLevel_ -= rate_;
-                if (currentLevel_ <= sustain_.value) {
-                    currentLevel_ = sustain_.value;
-                    state_ = EnvState::SUSTAIN;
-                }
-                break;
-                
-            case EnvState::SUSTAIN:
-                currentLevel_ = sustain_.value;
-                break;
-                
-            case EnvState::RELEASE:
-                currentLevel_ -= rate_;
-                if (currentLevel_ <= 0.0) {
-                    currentLevel_ = 0.0;
-                    state_ = EnvState::IDLE;
-                }
-                break;
-                
-            case EnvState::IDLE:
-                currentLevel_ = 0.0;
-                break;
+    for (const auto& level : levels_) {
+        if (level.size() == 1 || !pool_) {
+            for (size_t node : level) {
+                runNode(node);
+            }
+        } else {
+            pool_->parallelFor(level.size(), [&](size_t i) { runNode(level[i]); });
         }
-        
-        output[i] = input[i] * currentLevel_;
-        sampleCount_++;
     }
+    
+    mixSinks(sinks_, input, outputs, output);
 }
 
-void EnvelopeStage::setParameter(const std::string& name, const ParamValue& value) {
-    if (name == "attack") {
-        attack_.setValue(std::get<double>(value));
-    } else if (name == "decay") {
-        decay_.setValue(std::get<double>(value));
-    } else if (name == "sustain") {
-        sustain_.setValue(std::get<double>(value));
-    } else if (name == "release") {
-        release_.setValue(std::get<double>(value));
-    }
+// ModulationBus implementation
+ModulationBus::ModulationBus(std::vector<Source> sources, std::vector<Target> targets, std::vector<Route> routes)
+    : sources_(std::move(sources)), targets_(std::move(targets)), routes_(std::move(routes)),
+      values_(sources_.size(), 0.0), offsets_(targets_.size(), 0.0) {
 }
 
-ParamValue EnvelopeStage::getParameter(const std::string& name) const {
-    if (name == "attack") return attack_.value;
-    if (name == "decay") return decay_.value;
-    if (name == "sustain") return sustain_.value;
-    if (name == "release") return release_.value;
-    return 0.0;
+void ModulationBus::begin() {
+    for (auto& target : targets_) {
+        target.base = target.stage->getParameterValue(target.parameter);
+    }
 }
 
-std::vector<std::string> EnvelopeStage::getParameterNames() const {
-    return {"attack", "decay", "sustain", "release"};
+void ModulationBus::end() {
+    for (const auto& target : targets_) {
+        target.stage->setParameterValue(target.parameter, target.base);
+    }
 }
 
-void EnvelopeStage::reset() {
-    state_ = EnvState::IDLE;
-    currentLevel_ = 0.0;
-    targetLevel_ = 0.0;
-    rate_ = 0.0;
-    sampleCount_ = 0;
+void ModulationBus::tick(size_t frames, bool gate) {
+    // A source on the audio path moves once per block, in its own process()
+    for (size_t s = 0; s < sources_.size(); ++s) {
+        const Source& source = sources_[s];
+        values_[s] = source.stage->advanceControl(source.onAudioPath ? 0 : frames, gate);
+    }
+    
+    std::fill(offsets_.begin(), offsets_.end(), 0.0);
+    for (const auto& route : routes_) {
+        offsets_[route.target] += route.amount * values_[route.source];
+    }
+    
+    for (size_t t = 0; t < targets_.size(); ++t) {
+        const Target& target = targets_[t];
+        target.stage->setParameterTarget(target.parameter, clampToRange(target.base + offsets_[t], target.range),
+                                         frames);
+    }
 }
 
-std::string EnvelopeStage::getDescription() const {
-    return "Envelope: A=" + std::to_string(attack_.value) + 
-           "s D=" + std::to_string(decay_.value) + 
-           "s S=" + std::to_string(sustain_.value) + 
-           " R=" + std::to_string(release_.value) + "s";
+// Buffer helpers for control ticks
+namespace {
+
+size_t frameCount(const AudioBuffer& buffer) {
+    return buffer.size();
 }
 
-// LFOStage implementation
-LFOStage::LFOStage() : rate_(1.0, 0.01, 20.0, "rate"),
-                      depth_(0.5, 0.0, 1.0, "depth") {
+size_t frameCount(const PlanarBuffer& buffer) {
+    return buffer.empty() ? 0 : buffer[0].size();
 }
 
-void LFOStage::process(const AudioBuffer& input, AudioBuffer& output) {
+void sizeLike(const AudioBuffer& input, AudioBuffer& output) {
     output.resize(input.size());
-    
-    double phaseIncrement = 2.0 * M_PI * rate_.value / sampleRate_;
-    
-    for (size_t i = 0; i < input.size(); ++i) {
-        double lfoValue = 0.0;
-        
-        if (waveType_ == "sine") {
-            lfoValue = std::sin(phase_);
-        } else if (waveType_ == "saw") {
-            lfoValue = 2.0 * (phase_ / (2.0 * M_PI)) - 1.0;
-        } else if (waveType_ == "square") {
-            lfoValue = (phase_ < M_PI) ? 1.0 : -1.0;
-        } else if (waveType_ == "triangle") {
-            if (phase_ < M_PI) {
-                lfoValue = 2.0 * phase_ / M_PI - 1.0;
-            } else {
-                lfoValue = 3.0 - 2.0 * phase_ / M_PI;
-            }
-        }
-        
-        // Scale by depth and center around 0
-        lfoValue = lfoValue * depth_.value;
-        
-        output[i] = input[i] + lfoValue;
-        phase_ += phaseIncrement;
-        
-        // Wrap phase
-        while (phase_ >= 2.0 * M_PI) {
-            phase_ -= 2.0 * M_PI;
-        }
-    }
 }
 
-void LFOStage::setParameter(const std::string& name, const ParamValue& value) {
-    if (name == "rate") {
-        rate_.setValue(std::get<double>(value));
-    } else if (name == "depth") {
-        depth_.setValue(std::get<double>(value));
-    } else if (name == "waveType") {
-        waveType_ = std::get<std::string>(value);
-    }
+void sizeLike(const PlanarBuffer& input, PlanarBuffer& output) {
+    matchChannelLayout(input, output);
 }
 
-ParamValue LFOStage::getParameter(const std::string& name) const {
-    if (name == "rate") return rate_.value;
-    if (name == "depth") return depth_.value;
-    if (name == "waveType") return waveType_;
-    return 0.0;
+void copyFrames(const AudioBuffer& source, size_t offset, size_t n, AudioBuffer& target) {
+    target.assign(source.begin() + offset, source.begin() + offset + n);
 }
 
-std::vector<std::string> LFOStage::getParameterNames() const {
-    return {"rate", "depth", "waveType"};
+void copyFrames(const PlanarBuffer& source, size_t offset, size_t n, PlanarBuffer& target) {
+    target.resize(source.size());
+    for (size_t c = 0; c < source.size(); ++c) {
+        copyFrames(source[c], offset, n, target[c]);
+    }
 }
 
-void LFOStage::reset() {
-    phase_ = 0.0;
+void writeFrames(const AudioBuffer& source, AudioBuffer& target, size_t offset) {
+    std::copy(source.begin(), source.end(), target.begin() + offset);
 }
 
-std::string LFOStage::getDescription() const {
-    return "LFO: " + waveType_ + " at " + std::to_string(rate_.value) + " Hz, depth " + std::to_string(depth_.value);
+void writeFrames(const PlanarBuffer& source, PlanarBuffer& target, size_t offset) {
+    for (size_t c = 0; c < std::min(source.size(), target.size()); ++c) {
+        writeFrames(source[c], target[c], offset);
+    }
 }
 
+} // namespace
+
 // DSPGraph implementation
 void DSPGraph::addStage(const std::string& name, std::unique_ptr<DSPStage> stage) {
+    stage->setSampleRate(sampleRate_);
     stages_[name] = std::move(stage);
+    invalidatePlan();
 }
 
 void DSPGraph::removeStage(const std::string& name) {
@@ -338,10 +1387,19 @@ void DSPGraph::removeStage(const std::string& name) {
                       }),
         connections_.end()
     );
+    invalidatePlan();
 }
 
 void DSPGraph::addConnection(const Connection& connection) {
+    // Rejected here so that rendering never meets a route it cannot bind
+    if (!connection.parameter.empty()) {
+        const std::string problem = checkModulationRoute(connection);
+        if (!problem.empty()) {
+            throw AIAudioException(problem);
+        }
+    }
     connections_.push_back(connection);
+    invalidatePlan();
 }
 
 void DSPGraph::removeConnection(const std::string& source, const std::string& destination) {
@@ -352,6 +1410,7 @@ void DSPGraph::removeConnection(const std::string& source, const std::string& de
                       }),
         connections_.end()
     );
+    invalidatePlan();
 }
 
 void DSPGraph::process(const AudioBuffer& input, AudioBuffer& output) {
@@ -360,26 +1419,176 @@ void DSPGraph::process(const AudioBuffer& input, AudioBuffer& output) {
         return;
     }
     
-    // Get topological order
-    auto order = getTopologicalOrder();
-    if (order.empty()) {
+    if (!getModulationBus().empty()) {
+        if (threadPool_) {
+            processModulated(getParallelPlan(), input, output, tickInput_, tickOutput_);
+        } else {
+            processModulated(getExecutionPlan(), input, output, tickInput_, tickOutput_);
+        }
+    } else if (threadPool_) {
+        getParallelPlan().process(input, output);
+    } else {
+        getExecutionPlan().process(input, output);
+    }
+}
+
+void DSPGraph::process(const PlanarBuffer& input, PlanarBuffer& output) {
+    if (stages_.empty()) {
         output = input;
         return;
     }
     
-    // Process stages in order
-    AudioBuffer currentInput = input;
-    AudioBuffer tempBuffer;
+    if (!getModulationBus().empty()) {
+        if (threadPool_) {
+            processModulated(getParallelPlan(), input, output, tickChannelInput_, tickChannelOutput_);
+        } else {
+            processModulated(getExecutionPlan(), input, output, tickChannelInput_, tickChannelOutput_);
+        }
+    } else if (threadPool_) {
+        getParallelPlan().process(input, output);
+    } else {
+        getExecutionPlan().process(input, output);
+    }
+}
+
+template<typename Plan, typename Buffer>
+void DSPGraph::processModulated(Plan& plan, const Buffer& input, Buffer& output,
+                                Buffer& tickInput, Buffer& tickOutput) {
+    // Controls update at the start of every tick; the stages ramp across it
+    const size_t numFrames = frameCount(input);
+    sizeLike(input, output);
+    
+    ModulationBus& bus = *modulation_;
+    bus.begin();
+    for (size_t offset = 0; offset < numFrames; offset += controlInterval_) {
+        const size_t n = std::min(controlInterval_, numFrames - offset);
+        bus.tick(n, gateOpen_);
+        copyFrames(input, offset, n, tickInput);
+        plan.process(tickInput, tickOutput);
+        writeFrames(tickOutput, output, offset);
+    }
+    bus.end();
+}
+
+ExecutionPlan& DSPGraph::getExecutionPlan() {
+    if (!plan_) {
+        std::vector<DSPStage*> ordered;
+        for (const auto& stageName : getAudioOrder()) {
+            ordered.push_back(stages_.at(stageName).get());
+        }
+        
+        plan_ = std::make_unique<ExecutionPlan>(std::move(ordered), getAudioSources());
+        plan_->prepare(preparedBlockSize_, preparedChannels_);
+    }
+    
+    return *plan_;
+}
+
+void DSPGraph::prepare(size_t maxBlockSize, size_t numChannels) {
+    preparedBlockSize_ = std::max(preparedBlockSize_, maxBlockSize);
+    preparedChannels_ = std::max(preparedChannels_, numChannels);
+    
+    if (threadPool_) {
+        getParallelPlan().prepare(preparedBlockSize_, preparedChannels_);
+    } else {
+        getExecutionPlan().prepare(preparedBlockSize_, preparedChannels_);
+    }
+}
+
+void DSPGraph::setThreadPool(std::shared_ptr<ThreadPool> pool) {
+    threadPool_ = std::move(pool);
+    parallelPlan_.reset();
+}
+
+ParallelExecutionPlan& DSPGraph::getParallelPlan() {
+    if (!parallelPlan_) {
+        std::vector<DSPStage*> ordered;
+        for (const auto& stageName : getAudioOrder()) {
+            ordered.push_back(stages_.at(stageName).get());
+        }
+        
+        parallelPlan_ = std::make_unique<ParallelExecutionPlan>(std::move(ordered), getAudioSources(),
+                                                                threadPool_);
+        parallelPlan_->prepare(preparedBlockSize_, preparedChannels_);
+    }
     
-    for (const auto& stageName : order) {
-        auto it = stages_.find(stageName);
-        if (it != stages_.end()) {
-            it->second->process(currentInput, tempBuffer);
-            currentInput = tempBuffer;
+    return *parallelPlan_;
+}
+
+void DSPGraph::setSampleRate(double sampleRate) {
+    if (!(sampleRate > 0.0)) {
+        throw AIAudioException("Sample rate must be positive: " + std::to_string(sampleRate));
+    }
+    sampleRate_ = sampleRate;
+    for (auto& [name, stage] : stages_) {
+        stage->setSampleRate(sampleRate);
+    }
+}
+
+void DSPGraph::setControlInterval(size_t frames) {
+    if (frames == 0) {
+        throw AIAudioException("Control interval must be at least one sample");
+    }
+    controlInterval_ = frames;
+}
+
+std::string DSPGraph::checkModulationRoute(const Connection& connection) const {
+    const DSPStage* source = getStage(connection.source);
+    const DSPStage* destination = getStage(connection.destination);
+    if (!source || !destination) {
+        return "Modulation connection references an unknown stage: " + connection.source + " -> " +
+               connection.destination;
+    }
+    if (!source->isControlSource()) {
+        return "Modulation source is not an LFO or envelope: " + connection.source;
+    }
+    if (destination->getParameterIndex(connection.parameter) < 0) {
+        return "Unknown modulation parameter: " + connection.destination + "." + connection.parameter;
+    }
+    return {};
+}
+
+ModulationBus& DSPGraph::getModulationBus() {
+    if (!modulation_) {
+        // One target per (stage, parameter); routes into it are summed.
+        // Routes were checked when added; one left stale by replacing a
+        // stage under its name is skipped (and reported by validate())
+        std::vector<ModulationBus::Source> sources;
+        std::vector<ModulationBus::Target> targets;
+        std::vector<ModulationBus::Route> routes;
+        std::unordered_map<const DSPStage*, size_t> sourceIndex;
+        const std::vector<std::string> audioOrder = getAudioOrder();
+        const std::unordered_set<std::string> onAudioPath(audioOrder.begin(), audioOrder.end());
+        
+        for (const auto& conn : connections_) {
+            if (!conn.enabled || conn.parameter.empty() || !checkModulationRoute(conn).empty()) continue;
+            DSPStage* source = getStage(conn.source);
+            DSPStage* destination = getStage(conn.destination);
+            const int parameter = destination->getParameterIndex(conn.parameter);
+            
+            auto [it, inserted] = sourceIndex.try_emplace(source, sources.size());
+            if (inserted) sources.push_back({source, onAudioPath.count(conn.source) > 0});
+            
+            auto target = std::find_if(targets.begin(), targets.end(), [&](const auto& t) {
+                return t.stage == destination && t.parameter == parameter;
+            });
+            if (target == targets.end()) {
+                targets.push_back({destination, parameter, destination->getParameterRange(parameter)});
+                target = targets.end() - 1;
+            }
+            routes.push_back({it->second, static_cast<size_t>(target - targets.begin()), conn.amount});
         }
+        
+        modulation_ = std::make_unique<ModulationBus>(std::move(sources), std::move(targets), std::move(routes));
     }
     
-    output = currentInput;
+    return *modulation_;
+}
+
+void DSPGraph::invalidatePlan() {
+    plan_.reset();
+    parallelPlan_.reset();
+    modulation_.reset();
 }
 
 void DSPGraph::reset() {
@@ -453,7 +1662,7 @@ double DSPGraph::getTotalGain() const {
     
     for (const auto& [name, stage] : stages_) {
         // Estimate gain for each stage (simplified)
-        if (stage->getType() == StageType::OSCILLATOR) {
+        if (isOscillatorType(stage->getType())) {
             auto amp = stage->getParameter("amplitude");
             if (std::holds_alternative<double>(amp)) {
                 totalGain *= std::get<double>(amp);
@@ -464,6 +1673,65 @@ double DSPGraph::getTotalGain() const {
     return totalGain;
 }
 
+std::vector<std::string> DSPGraph::getAudioOrder() const {
+    // Names that are only connection endpoints are dropped. A control source
+    // stays on the audio path while any audio connection enters or leaves
+    // it, or when no modulation connection leaves it
+    std::unordered_set<std::string> audio, modulation;
+    for (const auto& conn : connections_) {
+        if (!conn.enabled) continue;
+        if (conn.parameter.empty()) {
+            audio.insert(conn.source);
+            audio.insert(conn.destination);
+        } else {
+            modulation.insert(conn.source);
+        }
+    }
+    
+    std::vector<std::string> order = getTopologicalOrder();
+    order.erase(std::remove_if(order.begin(), order.end(), [&](const std::string& name) {
+                    const DSPStage* stage = getStage(name);
+                    return !stage || (stage->isControlSource() && modulation.count(name) && !audio.count(name));
+                }),
+                order.end());
+    return order;
+}
+
+std::vector<std::vector<size_t>> DSPGraph::getAudioSources() const {
+    const std::vector<std::string> order = getAudioOrder();
+    std::unordered_map<std::string, size_t> index;
+    for (size_t i = 0; i < order.size(); ++i) {
+        index[order[i]] = i;
+    }
+    
+    // Audio edges only; modulation connections carry a parameter name
+    std::vector<std::vector<size_t>> sources(order.size());
+    bool routed = false;
+    for (const auto& conn : connections_) {
+        if (!conn.enabled || !conn.parameter.empty()) continue;
+        auto src = index.find(conn.source);
+        auto dst = index.find(conn.destination);
+        if (src != index.end() && dst != index.end()) {
+            sources[dst->second].push_back(src->second);
+            routed = true;
+        }
+    }
+    
+    if (!routed) {
+        for (size_t i = 1; i < order.size(); ++i) {
+            sources[i].push_back(i - 1);
+        }
+    }
+    for (auto& stageSources : sources) {
+        std::sort(stageSources.begin(), stageSources.end());
+    }
+    return sources;
+}
+
+bool DSPGraph::isChain() const {
+    return isChainRouting(getAudioSources());
+}
+
 DSPStage* DSPGraph::getStage(const std::string& name) {
     auto it = stages_.find(name);
     return (it != stages_.end()) ? it->second.get() : nullptr;
@@ -486,6 +1754,21 @@ std::vector<Connection> DSPGraph::getConnections() const {
     return connections_;
 }
 
+std::unique_ptr<DSPGraph> DSPGraph::clone() const {
+    auto copy = std::make_unique<DSPGraph>();
+    for (const auto& [name, stage] : stages_) {
+        copy->stages_[name] = stage->clone();
+    }
+    copy->connections_ = connections_;
+    copy->threadPool_ = threadPool_;
+    copy->preparedBlockSize_ = preparedBlockSize_;
+    copy->preparedChannels_ = preparedChannels_;
+    copy->sampleRate_ = sampleRate_;
+    copy->controlInterval_ = controlInterval_;
+    copy->gateOpen_ = gateOpen_;
+    return copy;
+}
+
 std::vector<std::string> DSPGraph::validate() const {
     std::vector<std::string> issues;
     
@@ -504,6 +1787,15 @@ std::vector<std::string> DSPGraph::validate() const {
         issues.push_back("Total gain >= 1.0, potential feedback instability");
     }
     
+    // Check modulation routes
+    for (const auto& conn : connections_) {
+        if (conn.parameter.empty()) continue;
+        const std::string problem = checkModulationRoute(conn);
+        if (!problem.empty()) {
+            issues.push_back(problem);
+        }
+    }
+    
     // Check stage parameters
     for (const auto& [name, stage] : stages_) {
         auto paramNames = stage->getParameterNames();
@@ -525,9 +1817,10 @@ bool DSPGraph::hasCycleDFS(const std::string& node,
     visited.insert(node);
     recStack.insert(node);
     
-    // Check all outgoing connections
+    // Check all outgoing audio connections; modulation routes are read at
+    // control ticks and cannot feed back within a block
     for (const auto& conn : connections_) {
-        if (conn.source == node) {
+        if (conn.source == node && conn.parameter.empty()) {
             if (visited.find(conn.destination) == visited.end()) {
                 if (hasCycleDFS(conn.destination, visited, recStack)) {
                     return true;
@@ -547,9 +1840,9 @@ void DSPGraph::topologicalSortDFS(const std::string& node,
                                  std::vector<std::string>& result) const {
     visited.insert(node);
     
-    // Process all outgoing connections first
+    // Process all outgoing audio connections first
     for (const auto& conn : connections_) {
-        if (conn.source == node && visited.find(conn.destination) == visited.end()) {
+        if (conn.source == node && conn.parameter.empty() && visited.find(conn.destination) == visited.end()) {
             topologicalSortDFS(conn.destination, visited, result);
         }
     }
@@ -568,6 +1861,14 @@ std::unique_ptr<DSPGraph> IRParser::parsePreset(const std::string& jsonData) {
         throw AIAudioException("Failed to parse JSON: " + reader.getFormattedErrorMessages());
     }
     
+    // Graph settings, ahead of the stages that pick them up
+    if (root.isMember("sampleRate")) {
+        graph->setSampleRate(root["sampleRate"].asDouble());
+    }
+    if (root.isMember("controlInterval")) {
+        graph->setControlInterval(root["controlInterval"].asUInt());
+    }
+    
     // Parse stages
     if (root.isMember("stages")) {
         const auto& stages = root["stages"];
@@ -626,6 +1927,12 @@ std::unique_ptr<DSPStage> IRParser::createStageFromJSON(const std::string& type,
             stage->setParameter(name, value);
         }
         return stage;
+    } else if (type == "wavetable") {
+        auto stage = std::make_unique<WavetableStage>();
+        for (const auto& [name, value] : params) {
+            stage->setParameter(name, value);
+        }
+        return stage;
     } else if (type == "filter") {
         auto stage = std::make_unique<FilterStage>();
         for (const auto& [name, value] : params) {
@@ -644,6 +1951,12 @@ std::unique_ptr<DSPStage> IRParser::createStageFromJSON(const std::string& type,
             stage->setParameter(name, value);
         }
         return stage;
+    } else if (type == "spatial") {
+        auto stage = std::make_unique<SpatialStage>();
+        for (const auto& [name, value] : params) {
+            stage->setParameter(name, value);
+        }
+        return stage;
     }
     
     throw AIAudioException("Unknown stage type: " + type);
@@ -653,4 +1966,49 @@ std::vector<std::string> IRParser::validate(const DSPGraph& graph) {
     return graph.validate();
 }
 
+// IRCompiler implementation
+std::unique_ptr<DSPGraph> IRCompiler::compile(const DSPGraph& ir, 
+                                             const CompileOptions& options) {
+    auto graph = ir.clone();
+    optimize(*graph, options);
+    return graph;
+}
+
+void IRCompiler::optimize(DSPGraph& graph, const CompileOptions& options) {
+    if (options.bandLimitedOscillators) useWavetables(graph);
+    if (options.enableSIMD) enableSIMD(graph);
+    if (options.enableParallel) {
+        enableParallel(graph, options.threadPool ? options.threadPool : ThreadPool::shared());
+    }
+}
+
+void IRCompiler::enableSIMD(DSPGraph& graph) {
+    // Kernel table for the running CPU, detected once per process
+    const SIMDKernels& kernels = getActiveKernels();
+    if (kernels.level == SIMDLevel::SCALAR) return;
+    
+    for (const auto& stageName : graph.getStageNames()) {
+        graph.getStage(stageName)->setKernels(&kernels);
+    }
+}
+
+void IRCompiler::useWavetables(DSPGraph& graph) {
+    // Same name, so connections and plans keep referring to the stage
+    for (const auto& stageName : graph.getStageNames()) {
+        if (const auto* oscillator = dynamic_cast<const OscillatorStage*>(graph.getStage(stageName))) {
+            graph.addStage(stageName, std::make_unique<WavetableStage>(*oscillator));
+        }
+    }
+}
+
+void IRCompiler::enableParallel(DSPGraph& graph, std::shared_ptr<ThreadPool> pool) {
+    // Only worth the barrier per level when some level has independent stages
+    for (const auto& level : graph.getParallelPlan().getLevels()) {
+        if (level.size() > 1) {
+            graph.setThreadPool(std::move(pool));
+            return;
+        }
+    }
+}
+
 } // namespace aiaudio
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "inverted_index.h"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cmath>
+
+namespace aiaudio {
+
+namespace {
+
+void insertSorted(std::vector<InvertedIndex::DocId>& list, InvertedIndex::DocId doc) {
+    // Fresh documents take the highest id, so this is usually an append
+    if (list.empty() || list.back() < doc) {
+        list.push_back(doc);
+        return;
+    }
+    list.insert(std::lower_bound(list.begin(), list.end(), doc), doc);
+}
+
+void eraseSorted(std::vector<InvertedIndex::DocId>& list, InvertedIndex::DocId doc) {
+    auto it = std::lower_bound(list.begin(), list.end(), doc);
+    if (it != list.end() && *it == doc) list.erase(it);
+}
+
+void sortUnique(std::vector<InvertedIndex::TokenId>& ids) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+} // namespace
+
+std::vector<std::string> InvertedIndex::tokenize(std::string_view text) {
+    std::vector<std::string> tokens;
+    std::string token;
+    for (unsigned char c : text) {
+        if (std::isalnum(c)) {
+            token += static_cast<char>(std::tolower(c));
+        } else if (!token.empty()) {
+            tokens.push_back(std::move(token));
+            token.clear();
+        }
+    }
+    if (!token.empty()) tokens.push_back(std::move(token));
+    return tokens;
+}
+
+std::string InvertedIndex::normalizeTag(std::string_view tag) {
+    size_t begin = 0, end = tag.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(tag[begin]))) ++begin;
+    while (end > begin && std::isspace(static_cast<unsigned char>(tag[end - 1]))) --end;
+    
+    std::string normalized(tag.substr(begin, end - begin));
+    for (char& c : normalized) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return normalized;
+}
+
+InvertedIndex::TokenId InvertedIndex::intern(const std::string& token) {
+    auto [it, inserted] = tokenIds_.try_emplace(token, static_cast<TokenId>(tokens_.size()));
+    if (inserted) {
+        tokens_.emplace_back();
+        tokens_.back().token = &it->first;
+    }
+    return it->second;
+}
+
+InvertedIndex::TokenId InvertedIndex::find(std::string_view token) const {
+    auto it = tokenIds_.find(token);
+    return it == tokenIds_.end() ? kNoToken : it->second;
+}
+
+bool InvertedIndex::hasRole(DocId doc, Role role) const {
+    const auto& bits = roleBits_[static_cast<size_t>(role)];
+    return (bits[doc / 64] >> (doc % 64)) & 1;
+}
+
+void InvertedIndex::add(const std::string& key, Role role,
+                        const std::vector<std::string>& tags,
+                        const std::string& text) {
+    remove(key);
+    
+    DocId doc;
+    if (!freeDocs_.empty()) {
+        doc = freeDocs_.back();
+        freeDocs_.pop_back();
+    } else {
+        doc = static_cast<DocId>(keys_.size());
+        keys_.emplace_back();
+        roles_.push_back(Role::UNKNOWN);
+        docTerms_.emplace_back();
+        docTags_.emplace_back();
+        if (doc % 64 == 0) {
+            for (auto& bits : roleBits_) bits.push_back(0);
+        }
+    }
+    
+    std::vector<TokenId> terms, tagIds;
+    for (const auto& token : tokenize(text)) terms.push_back(intern(token));
+    for (const auto& tag : tags) {
+        std::string normalized = normalizeTag(tag);
+        if (normalized.empty()) continue;
+        tagIds.push_back(intern(normalized));
+        for (const auto& token : tokenize(normalized)) terms.push_back(intern(token));
+    }
+    sortUnique(terms);
+    sortUnique(tagIds);
+    
+    for (TokenId id : terms) insertSorted(tokens_[id].terms, doc);
+    for (TokenId id : tagIds) insertSorted(tokens_[id].tags, doc);
+    
+    keys_[doc] = key;
+    roles_[doc] = role;
+    docTerms_[doc] = std::move(terms);
+    docTags_[doc] = std::move(tagIds);
+    roleBits_[static_cast<size_t>(role)][doc / 64] |= uint64_t(1) << (doc % 64);
+    ++roleCounts_[static_cast<size_t>(role)];
+    docOf_.emplace(key, doc);
+}
+
+bool InvertedIndex::remove(const std::string& key) {
+    auto it = docOf_.find(key);
+    if (it == docOf_.end()) return false;
+    const DocId doc = it->second;
+    docOf_.erase(it);
+    
+    for (TokenId id : docTerms_[doc]) eraseSorted(tokens_[id].terms, doc);
+    for (TokenId id : docTags_[doc]) eraseSorted(tokens_[id].tags, doc);
+    docTerms_[doc].clear();
+    docTags_[doc].clear();
+    
+    const size_t role = static_cast<size_t>(roles_[doc]);
+    roleBits_[role][doc / 64] &= ~(uint64_t(1) << (doc % 64));
+    --roleCounts_[role];
+    keys_[doc].clear();
+    freeDocs_.push_back(doc);
+    return true;
+}
+
+void InvertedIndex::clear() {
+    tokenIds_.clear();
+    tokens_.clear();
+    docOf_.clear();
+    keys_.clear();
+    roles_.clear();
+    docTerms_.clear();
+    docTags_.clear();
+    freeDocs_.clear();
+    for (auto& bits : roleBits_) bits.clear();
+    roleCounts_.fill(0);
+}
+
+std::pair<InvertedIndex::TokenMap::const_iterator, InvertedIndex::TokenMap::const_iterator>
+InvertedIndex::prefixRange(std::string_view prefix) const {
+    auto first = tokenIds_.lower_bound(prefix), last = first;
+    while (last != tokenIds_.end() && last->first.compare(0, prefix.size(), prefix) == 0) ++last;
+    return {first, last};
+}
+
+std::vector<InvertedIndex::DocId> InvertedIndex::prefixPostings(std::string_view prefix) const {
+    std::vector<DocId> docs;
+    size_t lists = 0;
+    auto [first, last] = prefixRange(prefix);
+    for (auto it = first; it != last; ++it) {
+        const auto& list = tokens_[it->second].terms;
+        docs.insert(docs.end(), list.begin(), list.end());
+        ++lists;
+    }
+    if (lists > 1) {
+        std::sort(docs.begin(), docs.end());
+        docs.erase(std::unique(docs.begin(), docs.end()), docs.end());
+    }
+    return docs;
+}
+
+void InvertedIndex::match(const Query& query, std::vector<DocId>& out) const {
+    // Posting lists every match must appear in. A prefix covering a single
+    // token uses that token's list; wider prefixes are checked against each
+    // candidate's own terms, which is cheaper than merging their lists
+    std::vector<const std::vector<DocId>*> lists;
+    struct WidePrefix {
+        std::string prefix;
+        size_t postings;
+    };
+    std::vector<WidePrefix> widePrefixes;
+    
+    for (const auto& term : query.terms) {
+        for (const auto& token : tokenize(term)) {
+            if (!query.prefixTerms) {
+                const TokenId id = find(token);
+                if (id == kNoToken) return;
+                lists.push_back(&tokens_[id].terms);
+                continue;
+            }
+            auto [first, last] = prefixRange(token);
+            if (first == last) return;
+            if (std::next(first) == last) {
+                lists.push_back(&tokens_[first->second].terms);
+                continue;
+            }
+            size_t postings = 0;
+            for (auto it = first; it != last; ++it) postings += tokens_[it->second].terms.size();
+            widePrefixes.push_back({token, postings});
+        }
+    }
+    for (const auto& tag : query.tags) {
+        const TokenId id = find(normalizeTag(tag));
+        if (id == kNoToken) return;
+        lists.push_back(&tokens_[id].tags);
+    }
+    
+    std::vector<const std::vector<DocId>*> excluded;
+    for (const auto& tag : query.excludedTags) {
+        const TokenId id = find(normalizeTag(tag));
+        if (id != kNoToken && !tokens_[id].tags.empty()) excluded.push_back(&tokens_[id].tags);
+    }
+    
+    // With nothing else to drive the intersection, merge the cheapest prefix
+    std::vector<DocId> merged;
+    if (lists.empty() && !widePrefixes.empty()) {
+        auto cheapest = std::min_element(widePrefixes.begin(), widePrefixes.end(),
+                                         [](const auto& a, const auto& b) { return a.postings < b.postings; });
+        merged = prefixPostings(cheapest->prefix);
+        widePrefixes.erase(cheapest);
+        lists.push_back(&merged);
+    }
+    
+    auto accept = [&](DocId doc) {
+        for (const auto* list : excluded) {
+            if (std::binary_search(list->begin(), list->end(), doc)) return false;
+        }
+        for (const auto& wide : widePrefixes) {
+            const auto& terms = docTerms_[doc];
+            if (std::none_of(terms.begin(), terms.end(), [&](TokenId id) {
+                    return tokens_[id].token->compare(0, wide.prefix.size(), wide.prefix) == 0;
+                })) {
+                return false;
+            }
+        }
+        return true;
+    };
+    
+    if (lists.empty()) {
+        // Nothing to intersect: walk the role bitsets
+        for (size_t word = 0; word < roleBits_[0].size(); ++word) {
+            uint64_t bits = 0;
+            if (query.role == Role::UNKNOWN) {
+                for (const auto& roleBits : roleBits_) bits |= roleBits[word];
+            } else {
+                bits = roleBits_[static_cast<size_t>(query.role)][word];
+            }
+            while (bits) {
+                const DocId doc = static_cast<DocId>(word * 64 + std::countr_zero(bits));
+                bits &= bits - 1;
+                if (accept(doc)) out.push_back(doc);
+            }
+        }
+        return;
+    }
+    
+    // Shortest list first; each candidate is then looked up in the longer
+    // lists, resuming each search where the previous candidate's ended
+    std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+    std::vector<std::vector<DocId>::const_iterator> cursors;
+    for (const auto* list : lists) cursors.push_back(list->begin());
+    
+    for (DocId doc : *lists[0]) {
+        if (query.role != Role::UNKNOWN && !hasRole(doc, query.role)) continue;
+        bool inAll = true;
+        for (size_t l = 1; l < lists.size() && inAll; ++l) {
+            cursors[l] = std::lower_bound(cursors[l], lists[l]->end(), doc);
+            inAll = cursors[l] != lists[l]->end() && *cursors[l] == doc;
+        }
+        if (inAll && accept(doc)) out.push_back(doc);
+    }
+}
+
+std::vector<std::string> InvertedIndex::search(const Query& query) const {
+    std::vector<DocId> docs;
+    match(query, docs);
+    
+    std::vector<std::string> keys;
+    keys.reserve(docs.size());
+    for (DocId doc : docs) keys.push_back(keys_[doc]);
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+std::vector<std::string> InvertedIndex::searchText(const std::string& text, Role role) const {
+    Query query;
+    query.terms = tokenize(text);
+    query.role = role;
+    query.prefixTerms = true;
+    return search(query);
+}
+
+size_t InvertedIndex::documentFrequency(const std::string& token, Field field) const {
+    const TokenId id = find(token);
+    return id == kNoToken ? 0 : tokens_[id].of(field).size();
+}
+
+double InvertedIndex::idf(const std::string& token, Field field) const {
+    const size_t df = documentFrequency(token, field);
+    if (df == 0) return 0.0;
+    return std::log(static_cast<double>(size()) / df);
+}
+
+size_t InvertedIndex::roleCount(Role role) const {
+    if (role == Role::UNKNOWN) return size();
+    return roleCounts_[static_cast<size_t>(role)];
+}
+
+} // namespace aiaudio
@@ -1,12 +1,67 @@
 #include "main_app.h"
+#include "metrics.h"
+#include "spectral.h"
+#include "thread_pool.h"
 #include <fstream>
 #include <sstream>
 #include <chrono>
 #include <thread>
 #include <algorithm>
+#include <filesystem>
 
 namespace aiaudio {
 
+namespace {
+
+// Seed recorded in every trace; generation is deterministic under it
+constexpr uint32_t kGenerationSeed = 1234;
+
+// Decision inputs applyDecisionHeads encodes besides role, tempo and key:
+// a query embedding and entry statistics (placeholders for now)
+constexpr size_t kQueryEmbeddingSize = 384;
+constexpr size_t kEntryStatsSize = 10;
+
+// Pipeline series in the global registry, resolved once so the recording
+// sites never take the registry lock
+struct PipelineMetrics {
+    LatencyHistogram& generate;
+    LatencyHistogram& search;
+    LatencyHistogram& decisions;
+    LatencyHistogram& policies;
+    LatencyHistogram& render;
+    LatencyHistogram& scoring;
+    LatencyHistogram& realtimeBlock;
+    MetricCounter& generations;
+    MetricCounter& generationErrors;
+    MetricCounter& realtimeBlocks;
+    MetricCounter& deadlineMisses;
+};
+
+PipelineMetrics& pipelineMetrics() {
+    static PipelineMetrics metrics = [] {
+        MetricsRegistry& registry = MetricsRegistry::global();
+        auto phase = [&](const char* name) -> LatencyHistogram& {
+            return registry.histogram("aiaudio_generate_phase_seconds", "Time per generate() phase", {{"phase", name}});
+        };
+        return PipelineMetrics{
+            registry.histogram("aiaudio_generate_seconds", "End-to-end generate() latency"),
+            phase("search"),
+            phase("decisions"),
+            phase("policies"),
+            phase("render"),
+            phase("scoring"),
+            registry.histogram("aiaudio_realtime_block_seconds", "Render time per renderRealtime block"),
+            registry.counter("aiaudio_generations", "generate() calls"),
+            registry.counter("aiaudio_generation_errors", "generate() calls that failed"),
+            registry.counter("aiaudio_realtime_blocks", "Blocks rendered by renderRealtime"),
+            registry.counter("aiaudio_realtime_deadline_misses", "renderRealtime blocks that overran their duration (xruns)"),
+        };
+    }();
+    return metrics;
+}
+
+} // namespace
+
 // AIAudioGenerator implementation
 AIAudioGenerator::AIAudioGenerator() {
     initializeComponents();
@@ -17,60 +72,175 @@ AIAudioGenerator::AIAudioGenerator() {
     initialized_ = true;
 }
 
-AIAudioGenerator::GenerationResult AIAudioGenerator::generate(const GenerationRequest& request) {
+AIAudioGenerator::GenerationResult AIAudioGenerator::generate(const GenerationRequest& request) const {
     GenerationResult result;
+    AIAUDIO_COUNT(pipelineMetrics().generations, 1);
+    AIAUDIO_TIME_SCOPE(pipelineMetrics().generate);
     
     try {
-        // Create DSP graph from prompt
-        DSPGraph graph = createGraphFromPrompt(request);
+        DSPGraph graph = buildGraph(request);
+        size_t numSamples = static_cast<size_t>(request.durationSeconds * graph.getSampleRate());
         
-        // Apply semantic search if requested
-        if (request.useSemanticSearch) {
-            DSPGraph semanticGraph = applySemanticSearch(request.prompt, request.role);
-            // Merge or replace graph based on semantic results
-            graph = semanticGraph;
+        // Replay an earlier render of the same graph, seed and length
+        std::shared_ptr<RenderCache> cache = request.useRenderCache ? renderCache_ : nullptr;
+        uint64_t renderKey = 0;
+        uint64_t scoreKey = 0;
+        if (cache) {
+            renderKey = renderCacheKey(graphContentHash(graph), kGenerationSeed, numSamples);
+            scoreKey = scoreCacheKey(request.prompt, request.role, request.context, request.constraints);
+            if (auto cached = cache->find(renderKey)) {
+                result.audio = cached->audio;
+                result.trace = createTrace(request, graph, 0.0, 0.0);
+                result.trace.meters = cached->meters;
+                if (cached->scoreKey == scoreKey) {
+                    result.qualityScore = cached->qualityScore;
+                    result.warnings = cached->warnings;
+                } else {
+                    AIAUDIO_TIME_SCOPE(pipelineMetrics().scoring);
+                    AudioStats stats = analyzeAudio(result.audio, graph.getSampleRate());
+                    result.qualityScore = assessQuality(stats, request);
+                    result.warnings = checkWarnings(stats, request.constraints);
+                }
+                result.explanation = generateExplanation(request, graph);
+                result.fromCache = true;
+                return result;
+            }
         }
         
-        // Apply decision heads
-        DSPGraph decisionGraph = applyDecisionHeads(graph, request);
+        // Render audio
+        {
+            AIAUDIO_TIME_SCOPE(pipelineMetrics().render);
+            result.audio = renderGraph(graph, numSamples);
+        }
         
-        // Apply policies if requested
-        if (request.applyPolicies) {
-            decisionGraph = applyPolicies(decisionGraph, request.role, request.context);
+        {
+            AIAUDIO_TIME_SCOPE(pipelineMetrics().scoring);
+            
+            // One analysis pass feeds the trace meters, scorers and warnings
+            AudioStats stats = analyzeAudio(result.audio, graph.getSampleRate());
+            
+            // Create trace
+            result.trace = createTrace(request, graph, stats.integratedLoudness, stats.truePeakDb());
+            
+            // Assess quality
+            result.qualityScore = assessQuality(stats, request);
+            
+            // Check for warnings
+            result.warnings = checkWarnings(stats, request.constraints);
         }
         
-        // Render audio
-        result.audio = renderGraph(decisionGraph, 44100 * 8); // 8 seconds at 44.1kHz
+        // Generate explanation
+        result.explanation = generateExplanation(request, graph);
         
-        // Create trace
-        result.trace = createTrace(request, decisionGraph, result.audio);
+        if (cache) {
+            RenderCache::Entry entry;
+            entry.audio = result.audio;
+            entry.sampleRate = graph.getSampleRate();
+            entry.meters = result.trace.meters;
+            entry.warnings = result.warnings;
+            entry.qualityScore = result.qualityScore;
+            entry.scoreKey = scoreKey;
+            cache->store(renderKey, std::move(entry));
+        }
         
-        // Assess quality
-        result.qualityScore = assessQuality(result.audio, request);
+    } catch (const std::exception& e) {
+        AIAUDIO_COUNT(pipelineMetrics().generationErrors, 1);
+        result.warnings.push_back("Generation error: " + std::string(e.what()));
+        result.qualityScore = 0.0;
+    }
+    
+    return result;
+}
+
+AIAudioGenerator::GenerationResult AIAudioGenerator::generateStreaming(
+    const GenerationRequest& request,
+    const StreamingRenderer::BlockCallback& onBlock,
+    size_t blockSize) const {
+    
+    GenerationResult result;
+    result.qualityScore = 0.0;
+    
+    try {
+        DSPGraph graph = buildGraph(request);
         
-        // Check for warnings
-        result.warnings = checkWarnings(result.audio, request.constraints);
+        // Playback can start as soon as the first block arrives; the meters
+        // see each block on its way out
+        StreamingRenderer renderer(graph, blockSize);
+        LoudnessMeter loudness(graph.getSampleRate());
+        TruePeakMeter truePeak;
+        size_t numSamples = static_cast<size_t>(request.durationSeconds * graph.getSampleRate());
+        renderer.render(numSamples, [&](const AudioBuffer& block) {
+            loudness.process(block);
+            truePeak.process(block);
+            return !onBlock || onBlock(block);
+        });
         
-        // Generate explanation
-        result.explanation = generateExplanation(request, decisionGraph);
+        result.trace = createTrace(request, graph, loudness.getIntegrated(), truePeak.getTruePeakDb());
+        result.explanation = generateExplanation(request, graph);
         
     } catch (const std::exception& e) {
         result.warnings.push_back("Generation error: " + std::string(e.what()));
-        result.qualityScore = 0.0;
     }
     
     return result;
 }
 
+std::vector<AIAudioGenerator::GenerationResult> AIAudioGenerator::generateBatch(
+    std::span<const GenerationRequest> requests,
+    const ResultCallback& onResult) const {
+    
+    std::vector<GenerationResult> results(requests.size());
+    std::shared_ptr<ThreadPool> pool = threadPool_ ? threadPool_ : ThreadPool::shared();
+    std::mutex callbackMutex;
+    
+    // One task per request: the graph and its stage state live on the
+    // worker's stack, everything reached through members is only read
+    std::vector<std::future<void>> pending;
+    pending.reserve(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        pending.push_back(pool->submit([&, i]() {
+            results[i] = generate(requests[i]);
+            if (onResult) {
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                onResult(i, results[i]);
+            }
+        }));
+    }
+    
+    // Wait for every task before rethrowing, the tasks reference our locals
+    std::exception_ptr error;
+    for (auto& task : pending) {
+        try {
+            task.get();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    
+    return results;
+}
+
 void AIAudioGenerator::loadPreset(const std::string& presetPath) {
     try {
-        auto graph = irParser_->parsePreset(presetPath);
-        loadedPresets_[presetPath] = std::move(graph);
+        loadedPresets_[presetPath] = loadPresetFile(presetPath);
     } catch (const std::exception& e) {
         throw AIAudioException("Failed to load preset: " + std::string(e.what()));
     }
 }
 
+PresetLibrary::LoadStats AIAudioGenerator::loadPresetLibrary(const std::string& directory) {
+    PresetLibrary::Options options;
+    options.threadPool = threadPool_;
+    PresetLibrary library(options);
+    for (auto& entry : library.loadDirectory(directory)) {
+        if (entry.ok()) loadedPresets_[entry.path] = std::move(entry.graph);
+    }
+    return library.getLastLoadStats();
+}
+
 void AIAudioGenerator::savePreset(const std::string& presetPath, const DSPGraph& graph) {
     // Implementation would serialize graph to JSON
     // This is a placeholder
@@ -98,7 +268,34 @@ AIAudioGenerator::SystemStatus AIAudioGenerator::getStatus() const {
     return status;
 }
 
-DSPGraph AIAudioGenerator::createGraphFromPrompt(const GenerationRequest& request) {
+DSPGraph AIAudioGenerator::buildGraph(const GenerationRequest& request) const {
+    // One graph per request, built once and then transformed in place.
+    // Semantic search replaces the prompt graph, so only one of them is built.
+    DSPGraph graph;
+    {
+        AIAUDIO_TIME_SCOPE(pipelineMetrics().search);
+        graph = request.useSemanticSearch
+            ? applySemanticSearch(request.prompt, request.role)
+            : createGraphFromPrompt(request);
+    }
+    graph.setSampleRate(request.sampleRate);
+    
+    // Apply decision heads
+    {
+        AIAUDIO_TIME_SCOPE(pipelineMetrics().decisions);
+        applyDecisionHeads(graph, request);
+    }
+    
+    // Apply policies if requested
+    if (request.applyPolicies) {
+        AIAUDIO_TIME_SCOPE(pipelineMetrics().policies);
+        applyPolicies(graph, request.role, request.context);
+    }
+    
+    return graph;
+}
+
+DSPGraph AIAudioGenerator::createGraphFromPrompt(const GenerationRequest& request) const {
     // Create a basic graph based on role
     DSPGraph graph;
     
@@ -186,102 +383,97 @@ DSPGraph AIAudioGenerator::createGraphFromPrompt(const GenerationRequest& reques
     return graph;
 }
 
-DSPGraph AIAudioGenerator::applySemanticSearch(const std::string& prompt, Role role) {
+DSPGraph AIAudioGenerator::applySemanticSearch(const std::string& prompt, Role role) const {
     // Use semantic engine to find relevant presets
     // This is a simplified implementation
     return createGraphFromPrompt({prompt, role, MusicalContext{}, AudioConstraints{}});
 }
 
-DSPGraph AIAudioGenerator::applyDecisionHeads(const DSPGraph& graph, const GenerationRequest& request) {
-    // Create decision context
-    DecisionContext context;
-    context.queryVector = std::vector<double>(384, 0.5); // Placeholder embedding
+void AIAudioGenerator::applyDecisionHeads(DSPGraph& graph, const GenerationRequest& request) const {
+    // Decision context, per thread like the inference scratch: its vectors
+    // keep their capacity, so requests after the first reuse them
+    thread_local DecisionContext context;
+    context.queryVector.assign(kQueryEmbeddingSize, 0.5); // Placeholder embedding
     context.role = request.role;
     context.tempo = request.context.tempo;
     context.key = request.context.key;
-    context.entryStats = std::vector<double>(10, 0.5); // Placeholder stats
+    context.entryStats.assign(kEntryStatsSize, 0.5); // Placeholder stats
+    context.metadata.clear();
     
     // Get decisions
     DecisionOutput decisions = decisionHeads_->infer(context);
     
     // Apply decisions to graph
-    DSPGraph resultGraph = graph;
-    decisionHeads_->applyDecisions(resultGraph, decisions);
-    
-    return resultGraph;
+    decisionHeads_->applyDecisions(graph, decisions);
 }
 
-DSPGraph AIAudioGenerator::applyPolicies(const DSPGraph& graph, Role role, const MusicalContext& context) {
-    // Get policy for role
-    const RolePolicy* policy = policyManager_->getPolicy(role);
-    if (policy) {
-        DSPGraph resultGraph = graph;
-        // Apply policy using policy engine
-        // This would use the PolicyEngine class
-        return resultGraph;
+void AIAudioGenerator::applyPolicies(DSPGraph& graph, Role role, const MusicalContext& /*context*/) const {
+    // Clamp to the role's ranges through its policy compiled for this
+    // topology; the manager caches one per (role, topology)
+    if (auto compiled = policyManager_->getCompiledPolicy(role, graph)) {
+        PolicyEngine().applyPolicy(graph, *compiled);
     }
-    
-    return graph;
 }
 
-AudioBuffer AIAudioGenerator::renderGraph(const DSPGraph& graph, size_t numSamples) {
-    AudioBuffer input(numSamples, 0.0); // Silent input
+AudioBuffer AIAudioGenerator::renderGraph(DSPGraph& graph, size_t numSamples) const {
     AudioBuffer output;
+    output.reserve(numSamples);
     
-    graph.process(input, output);
+    StreamingRenderer renderer(graph);
+    renderer.render(numSamples, [&output](const AudioBuffer& block) {
+        output.insert(output.end(), block.begin(), block.end());
+        return true;
+    });
     
     return output;
 }
 
-Trace AIAudioGenerator::createTrace(const GenerationRequest& request, const DSPGraph& graph, const AudioBuffer& audio) {
+Trace AIAudioGenerator::createTrace(const GenerationRequest& request, const DSPGraph& /*graph*/,
+                                    double loudness, double truePeakDb) const {
     Trace trace;
     trace.prompt = request.prompt;
-    trace.queryHash = "placeholder_hash";
+    trace.queryHash = computeQueryHash(request.prompt, request.role);
     trace.entryId = "generated";
     trace.policyVersion = "1.0";
     trace.budgetTier = "S";
-    trace.seed = 1234;
+    trace.seed = kGenerationSeed;
     trace.timestamp = std::chrono::system_clock::now();
     
     // Add meter readings
-    trace.meters["lufs"] = -18.0; // Placeholder
-    trace.meters["tp"] = -1.0;    // Placeholder
+    trace.meters["lufs"] = loudness;
+    trace.meters["tp"] = truePeakDb;
     
     return trace;
 }
 
-double AIAudioGenerator::assessQuality(const AudioBuffer& audio, const GenerationRequest& request) {
+double AIAudioGenerator::assessQuality(const AudioStats& stats, const GenerationRequest& request) const {
     if (!mooOptimizer_) return 0.5;
     
-    auto metrics = mooOptimizer_->evaluate(audio, request.role, request.context, request.prompt);
+    auto metrics = mooOptimizer_->evaluate(stats, request.role, request.context, request.prompt);
     return metrics.overallScore;
 }
 
-std::vector<std::string> AIAudioGenerator::checkWarnings(const AudioBuffer& audio, const AudioConstraints& constraints) {
+std::vector<std::string> AIAudioGenerator::checkWarnings(const AudioStats& stats, const AudioConstraints& constraints) const {
     std::vector<std::string> warnings;
     
     // Check for clipping
-    for (double sample : audio) {
-        if (std::abs(sample) >= 1.0) {
-            warnings.push_back("Audio clipping detected");
-            break;
-        }
+    if (stats.clippedSamples > 0) {
+        warnings.push_back("Audio clipping detected");
     }
     
     // Check for silence
-    double rms = 0.0;
-    for (double sample : audio) {
-        rms += sample * sample;
-    }
-    rms = std::sqrt(rms / audio.size());
-    if (rms < 0.001) {
+    if (stats.rms < 0.001) {
         warnings.push_back("Audio is too quiet");
     }
     
+    if (stats.nonFiniteSamples > 0) {
+        warnings.push_back("Audio contains NaN or infinite samples");
+    }
+    
     return warnings;
 }
 
-std::string AIAudioGenerator::generateExplanation(const GenerationRequest& request, const DSPGraph& graph) {
+std::string AIAudioGenerator::generateExplanation(const GenerationRequest& request, const DSPGraph& graph) const {
     std::stringstream explanation;
     explanation << "Generated " << request.role << " sound for prompt: \"" << request.prompt << "\"\n";
     explanation << "Graph contains " << graph.getStageNames().size() << " stages\n";
@@ -295,11 +487,16 @@ void AIAudioGenerator::initializeComponents() {
     irParser_ = std::make_unique<IRParser>();
     normalizer_ = std::make_unique<PresetNormalizer>();
     semanticEngine_ = std::make_unique<SemanticFusionEngine>(
-        std::make_unique<SimpleEmbedding>(384));
+        std::make_unique<SimpleEmbedding>(kQueryEmbeddingSize));
     policyManager_ = std::make_unique<PolicyManager>();
+    renderCache_ = std::make_shared<RenderCache>();
     
-    // Create decision heads with simple MLP
-    auto mlp = std::make_unique<DecisionMLP>(400, {256, 128}, 20); // 400 input, 20 output
+    // Create decision heads with simple MLP, sized for the context
+    // applyDecisionHeads encodes; 20 outputs
+    DecisionContext context;
+    context.queryVector.resize(kQueryEmbeddingSize);
+    context.entryStats.resize(kEntryStatsSize);
+    auto mlp = std::make_unique<DecisionMLP>(context.getInputSize(), std::vector<size_t>{256, 128}, 20);
     decisionHeads_ = std::make_unique<DecisionHeads>(std::move(mlp));
 }
 
@@ -366,17 +563,7 @@ std::map<std::string, std::string> ConfigurationManager::getAllValues() const {
 
 // PresetManager implementation
 std::unique_ptr<DSPGraph> PresetManager::loadPreset(const std::string& filePath) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        throw AIAudioException("Could not open preset file: " + filePath);
-    }
-    
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    
-    // Parse JSON and create graph
-    // This would use the IRParser
-    return std::make_unique<DSPGraph>();
+    return loadPresetFile(filePath);
 }
 
 void PresetManager::savePreset(const DSPGraph& graph, const std::string& filePath) {
@@ -410,29 +597,152 @@ PresetManager::PresetMetadata PresetManager::getMetadata(const std::string& file
 
 void PresetManager::setMetadata(const std::string& filePath, const PresetMetadata& metadata) {
     presetMetadata_[filePath] = metadata;
+    keywordIndex_.add(filePath, metadata.role, metadata.tags, metadata.name + " " + metadata.description);
+}
+
+void PresetManager::removeMetadata(const std::string& filePath) {
+    presetMetadata_.erase(filePath);
+    keywordIndex_.remove(filePath);
 }
 
 std::vector<std::string> PresetManager::searchPresets(const std::string& query, Role role) const {
-    std::vector<std::string> results;
-    
+    return keywordIndex_.searchText(query, role);
+}
+
+std::vector<std::string> PresetManager::getAllPresets() const {
+    std::vector<std::string> presets;
     for (const auto& [filePath, metadata] : presetMetadata_) {
-        if (role != Role::UNKNOWN && metadata.role != role) continue;
+        presets.push_back(filePath);
+    }
+    return presets;
+}
+
+// StreamingRenderer implementation
+StreamingRenderer::StreamingRenderer(DSPGraph& graph, size_t blockSize)
+    : graph_(graph),
+      blockSize_(std::clamp(blockSize, kMinBlockSize, kMaxBlockSize)) {
+    // Allocate everything the audio thread will touch
+    input_.assign(blockSize_, 0.0f);
+    output_.reserve(blockSize_);
+    graph_.prepare(blockSize_);
+}
+
+const AudioBuffer& StreamingRenderer::pullBlock() {
+    return pullBlock(blockSize_);
+}
+
+const AudioBuffer& StreamingRenderer::pullBlock(size_t numFrames) {
+    // Shrinking or regrowing within capacity never reallocates;
+    // input_ is never written, so regrown samples stay silent
+    input_.resize(std::min(numFrames, blockSize_), 0.0f);
+    
+    graph_.process(input_, output_);
+    framesRendered_ += input_.size();
+    
+    return output_;
+}
+
+size_t StreamingRenderer::render(size_t numSamples, const BlockCallback& callback) {
+    size_t rendered = 0;
+    
+    while (rendered < numSamples) {
+        size_t frames = std::min(blockSize_, numSamples - rendered);
+        const AudioBuffer& block = pullBlock(frames);
+        rendered += frames;
+        
+        if (!callback(block)) {
+            break;
+        }
+    }
+    
+    return rendered;
+}
+
+void StreamingRenderer::reset() {
+    graph_.reset();
+    framesRendered_ = 0;
+}
+
+// CandidatePipeline implementation
+CandidatePipeline::CandidatePipeline(const MOOOptimizer& optimizer)
+    : CandidatePipeline(optimizer, Options{}) {
+}
+
+CandidatePipeline::CandidatePipeline(const MOOOptimizer& optimizer, const Options& options)
+    : optimizer_(optimizer), options_(options), pruner_(options.pruner) {
+}
+
+std::vector<CandidatePipeline::CandidateResult> CandidatePipeline::evaluate(
+    std::vector<DSPGraph>& candidates,
+    Role role,
+    const MusicalContext& context,
+    const AudioConstraints& constraints,
+    const std::string& query) {
+    
+    auto startTime = std::chrono::steady_clock::now();
+    lastStats_ = RunStats{};
+    
+    std::vector<CandidateResult> results;
+    results.reserve(candidates.size());
+    for (auto& graph : candidates) {
+        results.push_back(evaluateCandidate(graph, role, context, constraints, query));
         
-        if (metadata.name.find(query) != std::string::npos ||
-            metadata.description.find(query) != std::string::npos) {
-            results.push_back(filePath);
+        const CandidateResult& result = results.back();
+        lastStats_.audioSeconds += result.secondsRendered;
+        if (result.pruned()) {
+            ++lastStats_.pruned;
+            ++lastStats_.verdicts[CandidatePruner::verdictName(result.verdict)];
         }
     }
     
+    lastStats_.candidates = candidates.size();
+    lastStats_.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    lastStats_.candidatesPerSecond = lastStats_.wallSeconds > 0.0
+        ? candidates.size() / lastStats_.wallSeconds : 0.0;
     return results;
 }
 
-std::vector<std::string> PresetManager::getAllPresets() const {
-    std::vector<std::string> presets;
-    for (const auto& [filePath, metadata] : presetMetadata_) {
-        presets.push_back(filePath);
+CandidatePipeline::CandidateResult CandidatePipeline::evaluateCandidate(
+    DSPGraph& graph, Role role, const MusicalContext& context,
+    const AudioConstraints& constraints, const std::string& query) {
+    
+    const double sampleRate = graph.getSampleRate();
+    const size_t total = static_cast<size_t>(options_.durationSeconds * sampleRate);
+    const size_t chunk = std::max<size_t>(1, static_cast<size_t>(options_.chunkSeconds * sampleRate));
+    
+    StreamingRenderer renderer(graph, options_.blockSize);
+    StreamingAnalyzer analyzer(sampleRate);
+    audio_.clear();
+    audio_.reserve(total);
+    
+    CandidateResult result;
+    size_t rendered = 0;
+    while (rendered < total) {
+        rendered += renderer.render(std::min(chunk, total - rendered), [&](const AudioBuffer& block) {
+            analyzer.process(block);
+            audio_.insert(audio_.end(), block.begin(), block.end());
+            return true;
+        });
+        
+        // The last chunk is judged on the full analysis below
+        if (!options_.enablePruning || rendered == total) continue;
+        
+        AudioStats partial = analyzer.snapshot();
+        MOOOptimizer::EvalMetrics metrics = optimizer_.evaluate(partial, role, context, constraints, query);
+        result.verdict = pruner_.check(partial, constraints, &metrics);
+        if (result.pruned()) {
+            result.secondsRendered = rendered / sampleRate;
+            result.metrics = std::move(metrics);
+            return result;
+        }
     }
-    return presets;
+    
+    result.secondsRendered = rendered / sampleRate;
+    result.metrics = optimizer_.evaluate(analyzeAudio(audio_, sampleRate), role, context, constraints, query);
+    if (result.metrics.feasible) {
+        pruner_.addToFront(MOOOptimizer::objectiveRow(result.metrics.objectives));
+    }
+    return result;
 }
 
 // AudioRenderer implementation
@@ -440,6 +750,7 @@ AudioBuffer AudioRenderer::render(const DSPGraph& graph, size_t numSamples, doub
     sampleRate_ = sampleRate;
     
     auto startTime = std::chrono::high_resolution_clock::now();
+    double startCPU = threadCPUSeconds();
     
     AudioBuffer input(numSamples, 0.0);
     AudioBuffer output;
@@ -451,51 +762,119 @@ AudioBuffer AudioRenderer::render(const DSPGraph& graph, size_t numSamples, doub
     
     // Update stats
     lastStats_.renderTime = duration.count() / 1000.0; // Convert to ms
-    lastStats_.cpuUsage = 0.0; // Would calculate actual CPU usage
+    lastStats_.cpuUsage = cpuLoad(threadCPUSeconds() - startCPU, numSamples);
     lastStats_.memoryUsed = output.size() * sizeof(double);
     lastStats_.realtimeSuccess = true;
+    lastStats_.blocksRendered = 1;
+    lastStats_.deadlineMisses = 0;
     
     return output;
 }
 
-AudioBuffer AudioRenderer::renderRealtime(const DSPGraph& graph, size_t numSamples, double maxLatencyMs) {
+AudioBuffer AudioRenderer::renderRealtime(DSPGraph& graph, size_t numSamples, double maxLatencyMs) {
+    AudioBuffer result;
+    result.reserve(numSamples);
+    
+    size_t blockSize = blockSizeForLatency(maxLatencyMs);
+    double blockDeadlineMs = 1000.0 * blockSize / sampleRate_;
+    
+    lastStats_ = RenderStats{};
+    StreamingRenderer renderer(graph, blockSize);
+    
     auto startTime = std::chrono::high_resolution_clock::now();
+    auto blockStart = startTime;
+    double startCPU = threadCPUSeconds();
+    
+    renderer.render(numSamples, [&](const AudioBuffer& block) {
+        auto blockEnd = std::chrono::high_resolution_clock::now();
+        double blockTime = std::chrono::duration<double, std::milli>(blockEnd - blockStart).count();
+        AIAUDIO_RECORD_SECONDS(pipelineMetrics().realtimeBlock, blockTime / 1000.0);
+        AIAUDIO_COUNT(pipelineMetrics().realtimeBlocks, 1);
+        
+        // A block that takes longer than its own duration is an xrun
+        if (!checkRealtimeConstraints(blockTime, blockDeadlineMs)) {
+            lastStats_.deadlineMisses++;
+            AIAUDIO_COUNT(pipelineMetrics().deadlineMisses, 1);
+        }
+        lastStats_.blocksRendered++;
+        
+        result.insert(result.end(), block.begin(), block.end());
+        blockStart = std::chrono::high_resolution_clock::now();
+        return true;
+    });
     
-    AudioBuffer result = render(graph, numSamples);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    lastStats_.renderTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    lastStats_.cpuUsage = cpuLoad(threadCPUSeconds() - startCPU, result.size());
+    lastStats_.memoryUsed = blockSize * sizeof(Sample) * 2;
+    lastStats_.realtimeSuccess = lastStats_.deadlineMisses == 0;
+    
+    return result;
+}
+
+size_t AudioRenderer::renderStream(DSPGraph& graph, size_t numSamples,
+                                   const StreamingRenderer::BlockCallback& callback,
+                                   size_t blockSize) {
+    StreamingRenderer renderer(graph, blockSize);
     
+    auto startTime = std::chrono::high_resolution_clock::now();
+    double startCPU = threadCPUSeconds();
+    size_t rendered = renderer.render(numSamples, callback);
     auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
-    double renderTime = duration.count() / 1000.0;
     
-    lastStats_.realtimeSuccess = checkRealtimeConstraints(renderTime, maxLatencyMs);
+    lastStats_ = RenderStats{};
+    lastStats_.renderTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    lastStats_.cpuUsage = cpuLoad(threadCPUSeconds() - startCPU, rendered);
+    lastStats_.memoryUsed = renderer.getBlockSize() * sizeof(Sample) * 2;
+    lastStats_.blocksRendered = (rendered + renderer.getBlockSize() - 1) / renderer.getBlockSize();
     
-    return result;
+    return rendered;
 }
 
 AudioRenderer::RenderStats AudioRenderer::getLastRenderStats() const {
     return lastStats_;
 }
 
+double AudioRenderer::cpuLoad(double cpuSeconds, size_t numSamples) const {
+    double audioSeconds = numSamples / sampleRate_;
+    return audioSeconds > 0.0 ? cpuSeconds / audioSeconds : 0.0;
+}
+
 bool AudioRenderer::checkRealtimeConstraints(double renderTime, double maxLatencyMs) {
     return renderTime <= maxLatencyMs;
 }
 
+size_t AudioRenderer::blockSizeForLatency(double maxLatencyMs) const {
+    // Largest block whose duration fits the latency budget
+    size_t frames = static_cast<size_t>(maxLatencyMs * sampleRate_ / 1000.0);
+    return std::clamp(frames, StreamingRenderer::kMinBlockSize, StreamingRenderer::kMaxBlockSize);
+}
+
 // QualityAssessor implementation
 double QualityAssessor::assessQuality(const AudioBuffer& audio, Role role, const AudioConstraints& constraints) {
+    return assessQuality(analyzeAudio(audio), role, constraints);
+}
+
+double QualityAssessor::assessQuality(const AudioStats& stats, Role role, const AudioConstraints& constraints) {
     if (!mooOptimizer_) return 0.5;
     
     MusicalContext context;
-    auto metrics = mooOptimizer_->evaluate(audio, role, context);
+    auto metrics = mooOptimizer_->evaluate(stats, role, context);
     return metrics.overallScore;
 }
 
 QualityAssessor::QualityMetrics QualityAssessor::getDetailedMetrics(const AudioBuffer& audio, Role role, 
                                                                    const AudioConstraints& constraints) {
+    return getDetailedMetrics(analyzeAudio(audio), role, constraints);
+}
+
+QualityAssessor::QualityMetrics QualityAssessor::getDetailedMetrics(const AudioStats& stats, Role role,
+                                                                   const AudioConstraints& constraints) {
     QualityMetrics metrics;
     
     if (mooOptimizer_) {
         MusicalContext context;
-        auto evalMetrics = mooOptimizer_->evaluate(audio, role, context);
+        auto evalMetrics = mooOptimizer_->evaluate(stats, role, context);
         
         metrics.overallScore = evalMetrics.overallScore;
         metrics.semanticMatch = evalMetrics.objectives.semMatch;
@@ -519,39 +898,61 @@ QualityAssessor::QualityMetrics QualityAssessor::getDetailedMetrics(const AudioB
 }
 
 double QualityAssessor::compareAudio(const AudioBuffer& audio1, const AudioBuffer& audio2) {
-    if (audio1.size() != audio2.size()) return 0.0;
+    if (audio1.empty() || audio2.empty()) return 0.0;
     
-    double correlation = 0.0;
-    double norm1 = 0.0;
-    double norm2 = 0.0;
-    
-    for (size_t i = 0; i < audio1.size(); ++i) {
-        correlation += audio1[i] * audio2[i];
-        norm1 += audio1[i] * audio1[i];
-        norm2 += audio2[i] * audio2[i];
-    }
-    
-    if (norm1 == 0.0 || norm2 == 0.0) return 0.0;
-    
-    return correlation / (std::sqrt(norm1) * std::sqrt(norm2));
+    // One set of frames per buffer feeds both distances
+    SpectralAnalysis reference(audio1);
+    SpectralAnalysis candidate(audio2);
+    double distance = multiresSTFTLoss(reference, candidate) + barkLoudnessError(reference, candidate);
+    return 1.0 / (1.0 + distance);
 }
 
 // SystemMonitor implementation
+SystemMonitor::SystemMonitor()
+    : lastCPUSeconds_(processCPUSeconds()), lastCPUSample_(std::chrono::steady_clock::now()) {
+}
+
 SystemMonitor::PerformanceMetrics SystemMonitor::getMetrics() const {
+    PipelineMetrics& pipeline = pipelineMetrics();
+    uint64_t generations = pipeline.generations.value();
+    uint64_t errors = pipeline.generationErrors.value();
+    
     PerformanceMetrics metrics;
     metrics.cpuUsage = getCPUUsage();
     metrics.memoryUsage = getMemoryUsage();
     metrics.diskUsage = getDiskUsage();
     metrics.activeThreads = getActiveThreads();
-    metrics.averageLatency = 0.0; // Would calculate from actual measurements
-    metrics.totalRenders = totalRenders_;
-    metrics.successfulRenders = successfulRenders_;
+    metrics.averageLatency = pipeline.generate.snapshot().mean() * 1000.0;
+    metrics.totalRenders = generations;
+    metrics.successfulRenders = generations - std::min(errors, generations);
     return metrics;
 }
 
+std::string SystemMonitor::exportMetrics() const {
+    std::ostringstream out;
+    auto gauge = [&out](const char* name, const char* help, double value) {
+        out << "# TYPE " << name << " gauge\n";
+        out << "# HELP " << name << " " << help << "\n";
+        out << name << " " << value << "\n";
+    };
+    gauge("aiaudio_process_cpu_usage_ratio", "Process CPU time over wall time since the previous reading, of all hardware threads", getCPUUsage());
+    gauge("aiaudio_process_resident_memory_bytes", "Resident set size", static_cast<double>(residentMemoryBytes()));
+    gauge("aiaudio_process_threads", "Threads in the process", static_cast<double>(getActiveThreads()));
+    gauge("aiaudio_disk_usage_ratio", "Used fraction of the working directory's filesystem", getDiskUsage());
+    gauge("aiaudio_metrics_sampling_rate", "Fraction of timed scopes recorded in the histograms",
+          MetricsRegistry::global().getSamplingRate());
+    MetricsRegistry::global().writeOpenMetrics(out);
+    out << "# EOF\n";
+    return out.str();
+}
+
 void SystemMonitor::startMonitoring() {
     monitoring_ = true;
     startTime_ = std::chrono::system_clock::now();
+    
+    std::lock_guard<std::mutex> lock(cpuSampleMutex_);
+    lastCPUSeconds_ = processCPUSeconds();
+    lastCPUSample_ = std::chrono::steady_clock::now();
 }
 
 void SystemMonitor::stopMonitoring() {
@@ -563,23 +964,32 @@ bool SystemMonitor::isMonitoring() const {
 }
 
 double SystemMonitor::getCPUUsage() const {
-    // Placeholder - would use system calls to get actual CPU usage
-    return 0.0;
+    std::lock_guard<std::mutex> lock(cpuSampleMutex_);
+    double cpuSeconds = processCPUSeconds();
+    auto now = std::chrono::steady_clock::now();
+    double wallSeconds = std::chrono::duration<double>(now - lastCPUSample_).count();
+    double cores = std::max(1u, std::thread::hardware_concurrency());
+    
+    double usage = wallSeconds > 0.0 ? (cpuSeconds - lastCPUSeconds_) / (wallSeconds * cores) : 0.0;
+    lastCPUSeconds_ = cpuSeconds;
+    lastCPUSample_ = now;
+    return std::clamp(usage, 0.0, 1.0);
 }
 
 double SystemMonitor::getMemoryUsage() const {
-    // Placeholder - would use system calls to get actual memory usage
-    return 0.0;
+    return residentMemoryBytes() / (1024.0 * 1024.0);
 }
 
 double SystemMonitor::getDiskUsage() const {
-    // Placeholder - would use system calls to get actual disk usage
-    return 0.0;
+    std::error_code error;
+    auto space = std::filesystem::space(std::filesystem::current_path(error), error);
+    if (error || space.capacity == 0) return 0.0;
+    return 1.0 - static_cast<double>(space.available) / space.capacity;
 }
 
 size_t SystemMonitor::getActiveThreads() const {
-    // Placeholder - would use system calls to get actual thread count
-    return std::thread::hardware_concurrency();
+    size_t threads = processThreadCount();
+    return threads > 0 ? threads : std::thread::hardware_concurrency();
 }
 
-} // namespace aiaudio
\ No newline at end of file
+} // namespace aiaudio
@@ -0,0 +1,47 @@
+#include "mapped_file.h"
+#include "core_types.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace aiaudio {
+
+MappedFile::MappedFile(const std::string& path) : path_(path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw AIAudioException("Could not open " + path + ": " + std::strerror(errno));
+    }
+    
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw AIAudioException("Could not stat " + path + ": " + std::strerror(error));
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    
+    // Empty files cannot be mapped; data() stays null
+    if (size_ > 0) {
+        void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw AIAudioException("Could not map " + path + ": " + std::strerror(error));
+        }
+        data_ = static_cast<const uint8_t*>(mapping);
+    }
+    
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data_) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+} // namespace aiaudio
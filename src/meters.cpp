@@ -0,0 +1,316 @@
+#include "meters.h"
+#include "simd_kernels.h"
+#include "spectral.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace aiaudio {
+
+namespace {
+
+constexpr double kBlockSeconds = 0.1;       // Gating step
+constexpr size_t kMomentaryBlocks = 4;      // 400 ms window
+constexpr double kRelativeGate = -10.0;
+constexpr double kLoudnessOffset = -0.691;
+
+// Integrated-loudness histogram: 0.1 LU bins from the absolute gate up
+constexpr double kHistogramStep = 0.1;
+constexpr double kHistogramTop = 10.0;
+constexpr size_t kHistogramBins = static_cast<size_t>((kHistogramTop - kLoudnessFloor) / kHistogramStep);
+
+// Samples filtered per kernel call
+constexpr size_t kMeterChunk = 1024;
+
+// Negative and finite; non-finite samples count as zero for crossings
+bool negativeSample(Sample x) {
+    constexpr uint32_t kExponentMask = 0x7f800000u;
+    return (std::bit_cast<uint32_t>(x) & kExponentMask) != kExponentMask && x < 0.0f;
+}
+
+double loudness(double meanSquare) {
+    return meanSquare > 0.0 ? kLoudnessOffset + 10.0 * std::log10(meanSquare) : kLoudnessFloor;
+}
+
+size_t histogramBin(double lufs) {
+    double bin = std::floor((lufs - kLoudnessFloor) / kHistogramStep);
+    return static_cast<size_t>(std::clamp(bin, 0.0, static_cast<double>(kHistogramBins - 1)));
+}
+
+// Polyphase interpolator: coefficient [phase][offset] weighs
+// window[i + offset] for output 4 * i + phase. Hann-windowed sinc over
+// 48 taps centred on tap 24, so phase 0 passes the input through; each
+// phase is normalised to unity DC gain.
+using PhaseTable = std::array<std::array<float, TruePeakMeter::kTapsPerPhase>, TruePeakMeter::kOversampling>;
+
+const PhaseTable& interpolator() {
+    static const PhaseTable table = [] {
+        constexpr size_t L = TruePeakMeter::kOversampling;
+        constexpr size_t T = TruePeakMeter::kTapsPerPhase;
+        constexpr double center = L * T / 2.0;
+        
+        PhaseTable phases{};
+        for (size_t p = 0; p < L; ++p) {
+            double sum = 0.0;
+            std::array<double, T> taps{};
+            for (size_t k = 0; k < T; ++k) {
+                double n = static_cast<double>(p + L * k) - center;
+                double t = n / L;
+                double sinc = t == 0.0 ? 1.0 : std::sin(M_PI * t) / (M_PI * t);
+                double window = 0.5 * (1.0 + std::cos(M_PI * n / center));
+                taps[k] = sinc * window;
+                sum += taps[k];
+            }
+            // Tap k multiplies the input k samples back
+            for (size_t k = 0; k < T; ++k) {
+                phases[p][T - 1 - k] = static_cast<float>(taps[k] / sum);
+            }
+        }
+        return phases;
+    }();
+    return table;
+}
+
+} // namespace
+
+// LoudnessMeter implementation
+LoudnessMeter::LoudnessMeter(double sampleRate)
+    : sampleRate_(sampleRate),
+      scratch_(kMeterChunk),
+      histogramEnergy_(kHistogramBins, 0.0),
+      histogramCount_(kHistogramBins, 0) {
+    if (sampleRate <= 0.0) {
+        throw AIAudioException("Sample rate must be positive");
+    }
+    blockSize_ = std::max<size_t>(1, static_cast<size_t>(std::lround(sampleRate * kBlockSeconds)));
+    filters_ = kWeightingFilter(sampleRate);
+}
+
+void LoudnessMeter::process(const Sample* data, size_t n) {
+    const SIMDKernels& kernels = getActiveKernels();
+    while (n > 0) {
+        size_t len = std::min({n, kMeterChunk, blockSize_ - blockFill_});
+        Sample* out = scratch_.data();
+        kernels.biquad(&data, &out, 1, len, filters_[0], &shelf_);
+        kernels.biquad(&out, &out, 1, len, filters_[1], &highPass_);
+        
+        double energy = kernels.sumSquares(out, len);
+        blockEnergy_ += energy;
+        totalEnergy_ += energy;
+        blockFill_ += len;
+        samples_ += len;
+        if (blockFill_ == blockSize_) completeBlock();
+        
+        data += len;
+        n -= len;
+    }
+}
+
+void LoudnessMeter::completeBlock() {
+    recent_[blocks_ % kShortTermBlocks] = blockEnergy_ / blockSize_;
+    ++blocks_;
+    blockEnergy_ = 0.0;
+    blockFill_ = 0;
+    
+    // Every block closes a 400 ms gating window (75% overlap)
+    if (blocks_ < kMomentaryBlocks) return;
+    double window = 0.0;
+    for (size_t b = blocks_ - kMomentaryBlocks; b < blocks_; ++b) {
+        window += recent_[b % kShortTermBlocks];
+    }
+    window /= kMomentaryBlocks;
+    
+    double lufs = loudness(window);
+    if (lufs <= kLoudnessFloor) return;  // Absolute gate
+    size_t bin = histogramBin(lufs);
+    histogramEnergy_[bin] += window;
+    ++histogramCount_[bin];
+    ++windows_;
+}
+
+double LoudnessMeter::recentLoudness(size_t blocks) const {
+    size_t count = std::min(blocks, blocks_);
+    if (count == 0) return ungatedLoudness();
+    
+    double sum = 0.0;
+    for (size_t b = blocks_ - count; b < blocks_; ++b) {
+        sum += recent_[b % kShortTermBlocks];
+    }
+    return std::max(kLoudnessFloor, loudness(sum / count));
+}
+
+double LoudnessMeter::ungatedLoudness() const {
+    return samples_ ? std::max(kLoudnessFloor, loudness(totalEnergy_ / samples_)) : kLoudnessFloor;
+}
+
+double LoudnessMeter::getMomentary() const {
+    return recentLoudness(kMomentaryBlocks);
+}
+
+double LoudnessMeter::getShortTerm() const {
+    return recentLoudness(kShortTermBlocks);
+}
+
+double LoudnessMeter::getIntegrated() const {
+    if (blocks_ < kMomentaryBlocks) return ungatedLoudness();
+    if (windows_ == 0) return kLoudnessFloor;
+    
+    double sum = 0.0;
+    for (double energy : histogramEnergy_) sum += energy;
+    double relativeGate = loudness(sum / windows_) + kRelativeGate;
+    
+    // Bins above the gate count whole; the bin holding it counts when its
+    // mean lies above the gate
+    size_t gateBin = histogramBin(relativeGate);
+    double gatedSum = 0.0;
+    size_t gatedCount = 0;
+    for (size_t bin = gateBin; bin < kHistogramBins; ++bin) {
+        if (histogramCount_[bin] == 0) continue;
+        if (bin == gateBin && relativeGate > kLoudnessFloor
+            && loudness(histogramEnergy_[bin] / histogramCount_[bin]) <= relativeGate) {
+            continue;
+        }
+        gatedSum += histogramEnergy_[bin];
+        gatedCount += histogramCount_[bin];
+    }
+    return gatedCount ? std::max(kLoudnessFloor, loudness(gatedSum / gatedCount)) : kLoudnessFloor;
+}
+
+void LoudnessMeter::reset() {
+    shelf_ = BiquadState{};
+    highPass_ = BiquadState{};
+    blockEnergy_ = 0.0;
+    blockFill_ = 0;
+    totalEnergy_ = 0.0;
+    samples_ = 0;
+    recent_.fill(0.0);
+    blocks_ = 0;
+    std::fill(histogramEnergy_.begin(), histogramEnergy_.end(), 0.0);
+    std::fill(histogramCount_.begin(), histogramCount_.end(), 0);
+    windows_ = 0;
+}
+
+// TruePeakMeter implementation
+TruePeakMeter::TruePeakMeter()
+    : window_(kTapsPerPhase - 1 + kMeterChunk, 0.0f),
+      phases_((kOversampling - 1) * kMeterChunk) {
+}
+
+void TruePeakMeter::process(const Sample* data, size_t n) {
+    const SIMDKernels& kernels = getActiveKernels();
+    const PhaseTable& table = interpolator();
+    constexpr size_t history = kTapsPerPhase - 1;
+    
+    peak_ = std::max(peak_, kernels.peakAbs(data, n));
+    while (n > 0) {
+        size_t len = std::min(n, kMeterChunk);
+        std::copy_n(data, len, window_.data() + history);
+        
+        // Phase 0 is the input itself, already in the sample peak. One
+        // multiply-add sweep per tap keeps the inner loop contiguous.
+        for (size_t p = 1; p < kOversampling; ++p) {
+            Sample* out = phases_.data() + (p - 1) * len;
+            std::fill_n(out, len, 0.0f);
+            for (size_t k = 0; k < kTapsPerPhase; ++k) {
+                const float c = table[p][k];
+                const Sample* in = window_.data() + k;
+                for (size_t i = 0; i < len; ++i) out[i] += c * in[i];
+            }
+        }
+        peak_ = std::max(peak_, kernels.peakAbs(phases_.data(), (kOversampling - 1) * len));
+        
+        std::copy_n(window_.data() + len, history, window_.data());
+        data += len;
+        n -= len;
+    }
+}
+
+double TruePeakMeter::getTruePeakDb() const {
+    return 20.0 * std::log10(std::max(static_cast<double>(peak_), 1e-10));
+}
+
+void TruePeakMeter::reset() {
+    std::fill(window_.begin(), window_.end(), 0.0f);
+    peak_ = 0.0f;
+}
+
+// StreamingAnalyzer implementation
+StreamingAnalyzer::StreamingAnalyzer(double sampleRate)
+    : sampleRate_(sampleRate),
+      loudness_(sampleRate),
+      plan_(FFTPlan::get(kCentroidFFTSize)),
+      frame_(kCentroidFFTSize),
+      windowed_(kCentroidFFTSize),
+      spectrum_(plan_->bins()) {
+}
+
+void StreamingAnalyzer::process(const Sample* data, size_t n) {
+    if (n == 0) return;
+    loudness_.process(data, n);
+    truePeak_.process(data, n);
+    
+    SampleStats block;
+    getActiveKernels().sampleStats(data, n, kSilenceThreshold, block);
+    moments_.sum += block.sum;
+    moments_.sumSquares += block.sumSquares;
+    moments_.sumAbs += block.sumAbs;
+    moments_.peak = std::max(moments_.peak, block.peak);
+    moments_.clipped += block.clipped;
+    moments_.denormals += block.denormals;
+    moments_.nonFinite += block.nonFinite;
+    moments_.silent += block.silent;
+    moments_.zeroCrossings += block.zeroCrossings;
+    
+    // The kernel only sees crossings inside the block
+    if (samples_ > 0) moments_.zeroCrossings += negativeSample(data[0]) != previousNegative_;
+    previousNegative_ = negativeSample(data[n - 1]);
+    samples_ += n;
+    
+    while (n > 0) {
+        size_t len = std::min(n, kCentroidFFTSize - frameFill_);
+        std::copy_n(data, len, frame_.data() + frameFill_);
+        frameFill_ += len;
+        if (frameFill_ == kCentroidFFTSize) completeFrame();
+        data += len;
+        n -= len;
+    }
+}
+
+void StreamingAnalyzer::completeFrame() {
+    const std::vector<float>& window = plan_->window();
+    for (size_t i = 0; i < kCentroidFFTSize; ++i) windowed_[i] = frame_[i] * window[i];
+    plan_->forward(windowed_.data(), spectrum_.data());
+    
+    // Same sums as SpectralAnalysis::spectralCentroid
+    for (size_t k = 0; k < spectrum_.size(); ++k) {
+        float magnitude = std::sqrt(spectrum_[k].real() * spectrum_[k].real()
+                                    + spectrum_[k].imag() * spectrum_[k].imag());
+        centroidWeighted_ += magnitude * (k * sampleRate_ / kCentroidFFTSize);
+        centroidTotal_ += magnitude;
+    }
+    frameFill_ = 0;
+}
+
+AudioStats StreamingAnalyzer::snapshot() const {
+    AudioStats stats = statsFromMoments(moments_, samples_, sampleRate_);
+    if (samples_ == 0) return stats;
+    
+    stats.truePeak = std::max(truePeak_.getTruePeak(), stats.peak);
+    stats.spectralCentroid = centroidTotal_ > 0.0 ? centroidWeighted_ / centroidTotal_ : 0.0;
+    stats.integratedLoudness = loudness_.getIntegrated();
+    return stats;
+}
+
+void StreamingAnalyzer::reset() {
+    loudness_.reset();
+    truePeak_.reset();
+    moments_ = SampleStats{};
+    samples_ = 0;
+    previousNegative_ = false;
+    frameFill_ = 0;
+    centroidWeighted_ = 0.0;
+    centroidTotal_ = 0.0;
+}
+
+} // namespace aiaudio
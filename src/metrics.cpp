@@ -0,0 +1,240 @@
+#include "metrics.h"
+#include "core_types.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <unistd.h>
+
+namespace aiaudio {
+
+namespace {
+
+// OpenMetrics label set: {key="value",...} with \, " and newlines escaped
+std::string renderLabels(const MetricsRegistry::Labels& labels) {
+    std::string text;
+    for (const auto& [key, value] : labels) {
+        if (!text.empty()) text += ',';
+        text += key + "=\"";
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                text += '\\';
+                text += c;
+            } else if (c == '\n') {
+                text += "\\n";
+            } else {
+                text += c;
+            }
+        }
+        text += '"';
+    }
+    return text;
+}
+
+std::string withLabel(const std::string& labels, const std::string& extra) {
+    return "{" + labels + (labels.empty() ? "" : ",") + extra + "}";
+}
+
+std::string formatNumber(double value) {
+    if (std::isinf(value)) return value > 0 ? "+Inf" : "-Inf";
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+double clockSeconds(clockid_t clock) {
+    timespec ts{};
+    if (clock_gettime(clock, &ts) != 0) return 0.0;
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+} // namespace
+
+// LatencyHistogram implementation
+double LatencyHistogram::Snapshot::quantile(double q) const {
+    if (count == 0) return 0.0;
+    const double target = std::clamp(q, 0.0, 1.0) * count;
+    
+    uint64_t cumulative = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        if (counts[b] == 0) continue;
+        if (cumulative + counts[b] >= target) {
+            const double lower = b == 0 ? 0.0 : bucketUpperBound(b - 1);
+            // The overflow bucket has no upper edge; report its lower one
+            if (b == kBuckets - 1) return lower;
+            const double fraction = (target - cumulative) / counts[b];
+            return lower + fraction * (bucketUpperBound(b) - lower);
+        }
+        cumulative += counts[b];
+    }
+    return bucketUpperBound(kBuckets - 2);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot result;
+    uint64_t sumNanoseconds = 0;
+    for (const Shard& shard : shards_) {
+        for (size_t b = 0; b < kBuckets; ++b) {
+            result.counts[b] += shard.counts[b].load(std::memory_order_relaxed);
+        }
+        sumNanoseconds += shard.sumNanoseconds.load(std::memory_order_relaxed);
+    }
+    for (uint64_t count : result.counts) {
+        result.count += count;
+    }
+    result.sum = sumNanoseconds * 1e-9;
+    return result;
+}
+
+void LatencyHistogram::reset() {
+    for (Shard& shard : shards_) {
+        for (auto& count : shard.counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        shard.sumNanoseconds.store(0, std::memory_order_relaxed);
+    }
+}
+
+double LatencyHistogram::bucketUpperBound(size_t bucket) {
+    if (bucket == 0) return std::ldexp(1.0, kMinOctave) * 1e-9;
+    if (bucket >= kBuckets - 1) return std::numeric_limits<double>::infinity();
+    const int octave = kMinOctave + static_cast<int>((bucket - 1) / kSubBuckets);
+    const size_t sub = (bucket - 1) % kSubBuckets;
+    return std::ldexp(1.0 + double(sub + 1) / kSubBuckets, octave) * 1e-9;
+}
+
+// MetricsRegistry implementation
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                             const Labels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (counters_.count(name)) {
+        throw AIAudioException("Metric " + name + " is already registered as a counter");
+    }
+    auto& family = histograms_[name];
+    if (family.help.empty()) family.help = help;
+    auto& series = family.series[renderLabels(labels)];
+    if (!series) series = std::make_unique<LatencyHistogram>();
+    return *series;
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help,
+                                        const Labels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (histograms_.count(name)) {
+        throw AIAudioException("Metric " + name + " is already registered as a histogram");
+    }
+    auto& family = counters_[name];
+    if (family.help.empty()) family.help = help;
+    auto& series = family.series[renderLabels(labels)];
+    if (!series) series = std::make_unique<MetricCounter>();
+    return *series;
+}
+
+void MetricsRegistry::setSamplingRate(double rate) {
+    uint32_t period = 0;
+    if (rate > 0.0) {
+        period = static_cast<uint32_t>(std::clamp(std::round(1.0 / std::min(rate, 1.0)), 1.0, 1e9));
+    }
+    samplePeriod_.store(period, std::memory_order_relaxed);
+}
+
+double MetricsRegistry::getSamplingRate() const {
+    const uint32_t period = samplePeriod_.load(std::memory_order_relaxed);
+    return period == 0 ? 0.0 : 1.0 / period;
+}
+
+void MetricsRegistry::writeOpenMetrics(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    for (const auto& [name, family] : histograms_) {
+        out << "# TYPE " << name << " histogram\n";
+        out << "# HELP " << name << " " << family.help << "\n";
+        if (name.size() > 8 && name.compare(name.size() - 8, 8, "_seconds") == 0) {
+            out << "# UNIT " << name << " seconds\n";
+        }
+        for (const auto& [labels, histogram] : family.series) {
+            const LatencyHistogram::Snapshot snapshot = histogram->snapshot();
+            
+            // Buckets at octave edges (and the underflow edge) keep the
+            // exposition short; the edges are exact sums of the fine buckets
+            uint64_t cumulative = snapshot.counts[0];
+            out << name << "_bucket" << withLabel(labels, "le=\"" + formatNumber(LatencyHistogram::bucketUpperBound(0)) + "\"")
+                << " " << cumulative << "\n";
+            for (size_t b = 1; b + 1 < LatencyHistogram::kBuckets; ++b) {
+                cumulative += snapshot.counts[b];
+                if (b % LatencyHistogram::kSubBuckets != 0) continue;
+                out << name << "_bucket" << withLabel(labels, "le=\"" + formatNumber(LatencyHistogram::bucketUpperBound(b)) + "\"")
+                    << " " << cumulative << "\n";
+            }
+            out << name << "_bucket" << withLabel(labels, "le=\"+Inf\"") << " " << snapshot.count << "\n";
+            
+            const std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+            out << name << "_count" << suffix << " " << snapshot.count << "\n";
+            out << name << "_sum" << suffix << " " << formatNumber(snapshot.sum) << "\n";
+        }
+    }
+    
+    for (const auto& [name, family] : counters_) {
+        out << "# TYPE " << name << " counter\n";
+        out << "# HELP " << name << " " << family.help << "\n";
+        for (const auto& [labels, counter] : family.series) {
+            out << name << "_total" << (labels.empty() ? "" : "{" + labels + "}") << " " << counter->value() << "\n";
+        }
+    }
+}
+
+std::string MetricsRegistry::exportOpenMetrics() const {
+    std::ostringstream out;
+    writeOpenMetrics(out);
+    out << "# EOF\n";
+    return out.str();
+}
+
+void MetricsRegistry::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [name, family] : histograms_) {
+        for (auto& [labels, histogram] : family.series) histogram->reset();
+    }
+    for (auto& [name, family] : counters_) {
+        for (auto& [labels, counter] : family.series) counter->reset();
+    }
+}
+
+// Process readings
+double processCPUSeconds() {
+    return clockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+double threadCPUSeconds() {
+    return clockSeconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+size_t residentMemoryBytes() {
+    // Second field of statm: resident pages
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    if (!(statm >> totalPages >> residentPages)) return 0;
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    return pageSize > 0 ? residentPages * static_cast<size_t>(pageSize) : 0;
+}
+
+size_t processThreadCount() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) {
+            return static_cast<size_t>(std::strtoul(line.c_str() + 8, nullptr, 10));
+        }
+    }
+    return 0;
+}
+
+} // namespace aiaudio
@@ -1,12 +1,273 @@
 #include "moo_optimization.h"
+#include "spectral.h"
+#include "thread_pool.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <bit>
+#include <limits>
 #include <numeric>
+#include <random>
 #include <cmath>
 
 namespace aiaudio {
 
+namespace {
+
+using ObjectiveRow = MOOOptimizer::ObjectiveRow;
+
+constexpr size_t kObjectives = ObjectiveVector::size();
+
+// Dominance matrix rows per parallel task
+constexpr size_t kDominanceChunk = 64;
+
+// AUTO picks the dominance matrix inside this range when the pool has more
+// than one worker: on one core the two are even from 1k to 4k points, below
+// it ENS wins outright and above it the N^2 bits grow too large
+constexpr size_t kDominanceMatrixMin = 256;
+constexpr size_t kDominanceMatrixMax = 8192;
+
+// a dominates b: nowhere worse and somewhere better
+bool dominatesRow(const ObjectiveRow& a, const ObjectiveRow& b) {
+    bool better = false;
+    for (size_t m = 0; m < kObjectives; ++m) {
+        if (a[m] < b[m]) return false;
+        better |= a[m] > b[m];
+    }
+    return better;
+}
+
+// Deb's fast non-dominated sort. Bit (i, j) of the matrix is set when i
+// dominates j; every task owns the bits and dominator counts of its rows,
+// so the parallel pass shares nothing. Objectives are compared column-wise
+// (SoA) one 64-point word at a time so the inner loop vectorises.
+std::vector<uint32_t> sortByDominanceMatrix(const std::vector<ObjectiveRow>& rows) {
+    const size_t n = rows.size();
+    const size_t words = (n + 63) / 64;
+    std::vector<uint64_t> dominated(n * words, 0);
+    std::vector<uint32_t> dominators(n, 0);
+    
+    std::vector<double> columns(kObjectives * n);
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t m = 0; m < kObjectives; ++m) columns[m * n + j] = rows[j][m];
+    }
+    
+    size_t chunks = (n + kDominanceChunk - 1) / kDominanceChunk;
+    ThreadPool::shared()->parallelFor(chunks, [&](size_t chunk) {
+        size_t end = std::min(n, (chunk + 1) * kDominanceChunk);
+        for (size_t i = chunk * kDominanceChunk; i < end; ++i) {
+            const ObjectiveRow& a = rows[i];
+            uint64_t* bits = dominated.data() + i * words;
+            uint32_t count = 0;
+            for (size_t w = 0; w < words; ++w) {
+                const size_t j0 = w * 64;
+                const size_t width = std::min<size_t>(64, n - j0);
+                uint8_t better[64] = {};
+                uint8_t worse[64] = {};
+                for (size_t m = 0; m < kObjectives; ++m) {
+                    const double* column = columns.data() + m * n + j0;
+                    for (size_t k = 0; k < width; ++k) {
+                        better[k] |= a[m] > column[k];
+                        worse[k] |= a[m] < column[k];
+                    }
+                }
+                
+                uint64_t word = 0;
+                for (size_t k = 0; k < width; ++k) {
+                    word |= static_cast<uint64_t>(better[k] & ~worse[k] & 1) << k;
+                    count += worse[k] & ~better[k] & 1;
+                }
+                bits[w] = word;
+            }
+            dominators[i] = count;
+        }
+    });
+    
+    // Peel fronts: retiring a front releases the points only it dominated
+    std::vector<uint32_t> rank(n, 0);
+    std::vector<size_t> current;
+    std::vector<size_t> next;
+    for (size_t i = 0; i < n; ++i) {
+        if (dominators[i] == 0) current.push_back(i);
+    }
+    for (uint32_t front = 0; !current.empty(); ++front) {
+        next.clear();
+        for (size_t i : current) {
+            rank[i] = front;
+            const uint64_t* bits = dominated.data() + i * words;
+            for (size_t w = 0; w < words; ++w) {
+                for (uint64_t word = bits[w]; word; word &= word - 1) {
+                    size_t j = w * 64 + std::countr_zero(word);
+                    if (--dominators[j] == 0) next.push_back(j);
+                }
+            }
+        }
+        std::swap(current, next);
+    }
+    return rank;
+}
+
+// ENS-BS (Zhang et al.): in descending lexicographic order no point can be
+// dominated by a later one, so each point only meets the fronts built so
+// far. Fronts are nested (a point dominated from front k is also dominated
+// from k - 1), which makes the front search binary; members are tried
+// newest first since those are the likeliest dominators.
+std::vector<uint32_t> sortEfficient(const std::vector<ObjectiveRow>& rows) {
+    const size_t n = rows.size();
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rows[a] > rows[b]; });
+    
+    std::vector<std::vector<size_t>> fronts;
+    std::vector<uint32_t> rank(n, 0);
+    for (size_t p : order) {
+        const ObjectiveRow& point = rows[p];
+        auto dominatedFrom = [&](const std::vector<size_t>& front) {
+            for (auto it = front.rbegin(); it != front.rend(); ++it) {
+                if (dominatesRow(rows[*it], point)) return true;
+            }
+            return false;
+        };
+        
+        size_t lo = 0;
+        size_t hi = fronts.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (dominatedFrom(fronts[mid])) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo == fronts.size()) fronts.emplace_back();
+        fronts[lo].push_back(p);
+        rank[p] = static_cast<uint32_t>(lo);
+    }
+    return rank;
+}
+
+// Monte-Carlo samples per parallel task
+constexpr size_t kSampleChunk = 16384;
+
+// point - reference; false when the box it spans is empty
+bool translate(const ObjectiveRow& point, const ObjectiveRow& reference, ObjectiveRow& out) {
+    for (size_t m = 0; m < kObjectives; ++m) {
+        out[m] = point[m] - reference[m];
+        if (!(out[m] > 0.0)) return false;
+    }
+    return true;
+}
+
+// a >= b in the first d objectives
+bool covers(const ObjectiveRow& a, const ObjectiveRow& b, size_t d) {
+    for (size_t m = 0; m < d; ++m) {
+        if (a[m] < b[m]) return false;
+    }
+    return true;
+}
+
+// Drop points weakly dominated in the first d objectives; they add no volume
+void removeCovered(std::vector<ObjectiveRow>& points, size_t d) {
+    std::vector<ObjectiveRow> kept;
+    kept.reserve(points.size());
+    for (const auto& point : points) {
+        if (std::any_of(kept.begin(), kept.end(), [&](const auto& k) { return covers(k, point, d); })) continue;
+        kept.erase(std::remove_if(kept.begin(), kept.end(), [&](const auto& k) { return covers(point, k, d); }),
+                   kept.end());
+        kept.push_back(point);
+    }
+    points.swap(kept);
+}
+
+// WFG hypervolume of the first d objectives, reference at the origin.
+// Sorted ascending on the last objective, every later point clipped to
+// points[k] keeps points[k]'s last coordinate, so the volume points[k]
+// shares with them is a (d - 1)-dimensional slice of that height.
+// Reorders points.
+double wfg(std::vector<ObjectiveRow>& points, size_t d) {
+    if (points.empty()) return 0.0;
+    if (d == 1) {
+        return std::max_element(points.begin(), points.end(),
+                                [](const auto& a, const auto& b) { return a[0] < b[0]; })->at(0);
+    }
+    if (d == 2) {
+        std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) { return a[0] > b[0]; });
+        double area = 0.0;
+        double height = 0.0;
+        for (const auto& point : points) {
+            if (point[1] > height) {
+                area += point[0] * (point[1] - height);
+                height = point[1];
+            }
+        }
+        return area;
+    }
+    
+    std::sort(points.begin(), points.end(), [d](const auto& a, const auto& b) { return a[d - 1] < b[d - 1]; });
+    double volume = 0.0;
+    std::vector<ObjectiveRow> slice;
+    for (size_t k = 0; k < points.size(); ++k) {
+        const ObjectiveRow& point = points[k];
+        double box = 1.0;
+        for (size_t m = 0; m < d; ++m) box *= point[m];
+        
+        slice.clear();
+        for (size_t j = k + 1; j < points.size(); ++j) {
+            ObjectiveRow clipped = points[j];
+            for (size_t m = 0; m + 1 < d; ++m) clipped[m] = std::min(clipped[m], point[m]);
+            slice.push_back(clipped);
+        }
+        removeCovered(slice, d - 1);
+        volume += box - point[d - 1] * wfg(slice, d - 1);
+    }
+    return volume;
+}
+
+// Samples drawn uniformly in [0, upper] that front covers. front must be
+// sorted descending on the first objective, so a scan stops at the first
+// point left of the sample. Each task seeds its own generator, so the count
+// does not depend on the thread count.
+size_t sampleHits(const std::vector<ObjectiveRow>& front, const ObjectiveRow& upper,
+                  size_t samples, unsigned seed) {
+    size_t chunks = (samples + kSampleChunk - 1) / kSampleChunk;
+    std::vector<size_t> hits(chunks, 0);
+    ThreadPool::shared()->parallelFor(chunks, [&](size_t chunk) {
+        std::seed_seq sequence{seed, static_cast<unsigned>(chunk)};
+        std::mt19937_64 rng(sequence);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        
+        size_t end = std::min(samples, (chunk + 1) * kSampleChunk);
+        size_t count = 0;
+        ObjectiveRow sample;
+        for (size_t i = chunk * kSampleChunk; i < end; ++i) {
+            for (size_t m = 0; m < kObjectives; ++m) sample[m] = unit(rng) * upper[m];
+            for (const auto& point : front) {
+                if (point[0] < sample[0]) break;
+                if (covers(point, sample, kObjectives)) {
+                    ++count;
+                    break;
+                }
+            }
+        }
+        hits[chunk] = count;
+    });
+    return std::accumulate(hits.begin(), hits.end(), size_t{0});
+}
+
+// Translated, covered-free copy of a front
+std::vector<ObjectiveRow> prepareFront(const std::vector<ObjectiveRow>& front, const ObjectiveRow& reference) {
+    std::vector<ObjectiveRow> points;
+    points.reserve(front.size());
+    for (const auto& point : front) {
+        ObjectiveRow translated;
+        if (translate(point, reference, translated)) points.push_back(translated);
+    }
+    removeCovered(points, kObjectives);
+    return points;
+}
+
+} // namespace
+
 MOOOptimizer::MOOOptimizer(const std::string& metricsConfigPath) {
     // Load metrics configuration
     std::ifstream file(metricsConfigPath);
@@ -44,19 +305,33 @@ MOOOptimizer::MOOOptimizer(const std::string& metricsConfigPath) {
 MOOOptimizer::EvalMetrics MOOOptimizer::evaluate(const AudioBuffer& audio, 
                                                  Role role, 
                                                  const MusicalContext& context,
-                                                 const std::string& query) {
+                                                 const std::string& query) const {
+    return evaluate(analyzeAudio(audio), role, context, query);
+}
+
+MOOOptimizer::EvalMetrics MOOOptimizer::evaluate(const AudioStats& stats,
+                                                 Role role,
+                                                 const MusicalContext& context,
+                                                 const std::string& query) const {
+    return evaluate(stats, role, context, AudioConstraints{}, query);
+}
+
+MOOOptimizer::EvalMetrics MOOOptimizer::evaluate(const AudioStats& stats,
+                                                 Role role,
+                                                 const MusicalContext& /*context*/,
+                                                 const AudioConstraints& constraints,
+                                                 const std::string& query) const {
     EvalMetrics metrics;
     
     // Calculate individual objectives
-    metrics.objectives.semMatch = calculateSemanticMatch(audio, query, role);
-    metrics.objectives.mixReadiness = calculateMixReadiness(audio, role, AudioConstraints{});
-    metrics.objectives.perceptualQuality = calculatePerceptualQuality(audio);
-    metrics.objectives.stability = calculateStability(audio);
+    metrics.objectives.semMatch = calculateSemanticMatch(stats, query, role);
+    metrics.objectives.mixReadiness = calculateMixReadiness(stats, role, constraints);
+    metrics.objectives.perceptualQuality = calculatePerceptualQuality(stats);
+    metrics.objectives.stability = calculateStability(stats);
     metrics.objectives.preferenceWin = 0.5; // Placeholder - would need trace data
     
     // Check constraints
-    AudioConstraints constraints;
-    metrics.violations = checkConstraints(audio, constraints);
+    metrics.violations = checkConstraints(stats, constraints);
     metrics.feasible = metrics.violations.empty();
     
     // Calculate overall score (weighted sum for now)
@@ -89,32 +364,8 @@ bool MOOOptimizer::dominates(const ParetoPoint& a, const ParetoPoint& b) const {
 double MOOOptimizer::calculateHypervolume(const std::vector<ParetoPoint>& front) const {
     if (front.empty()) return 0.0;
     
-    // Reference point (worst possible values)
-    ObjectiveVector reference;
-    for (size_t i = 0; i < ObjectiveVector::size(); ++i) {
-        reference[i] = 0.0; // Assuming all objectives are maximized
-    }
-    
-    // Calculate hypervolume using Lebesgue measure
-    double hypervolume = 0.0;
-    std::vector<ParetoPoint> sortedFront = front;
-    
-    // Sort by first objective
-    std::sort(sortedFront.begin(), sortedFront.end(),
-              [](const ParetoPoint& a, const ParetoPoint& b) {
-                  return a.objectives[0] > b.objectives[0];
-              });
-    
-    // Calculate hypervolume contribution of each point
-    for (const auto& point : sortedFront) {
-        double contribution = 1.0;
-        for (size_t i = 0; i < ObjectiveVector::size(); ++i) {
-            contribution *= std::max(0.0, point.objectives[i] - reference[i]);
-        }
-        hypervolume += contribution;
-    }
-    
-    return hypervolume;
+    // Reference point (worst possible values): all objectives are maximised from 0
+    return HypervolumeIndicator().compute(objectiveRows(front)).value;
 }
 
 std::vector<MOOOptimizer::ParetoPoint> MOOOptimizer::epsilonConstraint(
@@ -150,85 +401,259 @@ std::vector<MOOOptimizer::ParetoPoint> MOOOptimizer::nsga2Selection(
     size_t targetSize) const {
     
     std::vector<ParetoPoint> result;
-    std::vector<ParetoPoint> working = population;
-    
-    // Calculate dominance relationships
-    std::vector<std::vector<size_t>> dominatedBy(population.size());
-    std::vector<int> dominationCount(population.size(), 0);
-    
-    for (size_t i = 0; i < population.size(); ++i) {
-        for (size_t j = 0; j < population.size(); ++j) {
-            if (i != j) {
-                if (dominates(population[i], population[j])) {
-                    dominatedBy[i].push_back(j);
-                    dominationCount[j]++;
-                }
-            }
-        }
+    for (size_t index : nsga2SelectIndices(objectiveRows(population), targetSize)) {
+        result.push_back(population[index]);
     }
+    return result;
+}
+
+MOOOptimizer::ObjectiveRow MOOOptimizer::objectiveRow(const ObjectiveVector& o) {
+    ObjectiveRow row{o.semMatch, o.mixReadiness, o.perceptualQuality, o.stability, o.preferenceWin};
     
-    // NSGA-II selection process
-    std::vector<int> front(population.size());
-    std::vector<int> crowdingDistance(population.size(), 0);
-    
-    // Assign front numbers
-    std::queue<size_t> currentFront;
+    // NaN would break the sort order; treat it as the worst score
+    for (double& value : row) {
+        if (std::isnan(value)) value = -std::numeric_limits<double>::infinity();
+    }
+    return row;
+}
+
+std::vector<MOOOptimizer::ObjectiveRow> MOOOptimizer::objectiveRows(const std::vector<ParetoPoint>& population) {
+    std::vector<ObjectiveRow> rows(population.size());
     for (size_t i = 0; i < population.size(); ++i) {
-        if (dominationCount[i] == 0) {
-            front[i] = 0;
-            currentFront.push(i);
+        rows[i] = objectiveRow(population[i].objectives);
+    }
+    return rows;
+}
+
+std::vector<uint32_t> MOOOptimizer::nonDominatedSort(const std::vector<ObjectiveRow>& rows, SortMethod method) {
+    if (method == SortMethod::AUTO) {
+        bool parallel = ThreadPool::shared()->size() > 1;
+        bool fits = rows.size() >= kDominanceMatrixMin && rows.size() <= kDominanceMatrixMax;
+        method = parallel && fits ? SortMethod::DOMINANCE : SortMethod::EFFICIENT;
+    }
+    return method == SortMethod::DOMINANCE ? sortByDominanceMatrix(rows) : sortEfficient(rows);
+}
+
+std::vector<double> MOOOptimizer::crowdingDistances(const std::vector<ObjectiveRow>& rows,
+                                                    const std::vector<size_t>& front) {
+    const size_t n = front.size();
+    if (n <= 2) return std::vector<double>(n, std::numeric_limits<double>::infinity());
+    
+    std::vector<double> distance(n, 0.0);
+    std::vector<size_t> order(n);
+    for (size_t m = 0; m < kObjectives; ++m) {
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return rows[front[a]][m] < rows[front[b]][m];
+        });
+        
+        distance[order.front()] = std::numeric_limits<double>::infinity();
+        distance[order.back()] = std::numeric_limits<double>::infinity();
+        double range = rows[front[order.back()]][m] - rows[front[order.front()]][m];
+        if (!(range > 0.0) || !std::isfinite(range)) continue;
+        
+        for (size_t k = 1; k + 1 < n; ++k) {
+            distance[order[k]] += (rows[front[order[k + 1]]][m] - rows[front[order[k - 1]]][m]) / range;
         }
     }
+    return distance;
+}
+
+std::vector<size_t> MOOOptimizer::nsga2SelectIndices(const std::vector<ObjectiveRow>& rows, size_t targetSize,
+                                                     SortMethod method) {
+    std::vector<size_t> selected;
+    if (rows.empty() || targetSize == 0) return selected;
+    
+    std::vector<uint32_t> rank = nonDominatedSort(rows, method);
+    std::vector<std::vector<size_t>> fronts(*std::max_element(rank.begin(), rank.end()) + 1);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        fronts[rank[i]].push_back(i);
+    }
     
-    int frontNumber = 0;
-    while (!currentFront.empty() && result.size() < targetSize) {
-        std::vector<size_t> nextFront;
-        
-        while (!currentFront.empty() && result.size() < targetSize) {
-            size_t current = currentFront.front();
-            currentFront.pop();
-            
-            if (result.size() < targetSize) {
-                result.push_back(population[current]);
-            }
-            
-            // Update domination counts for dominated solutions
-            for (size_t dominated : dominatedBy[current]) {
-                dominationCount[dominated]--;
-                if (dominationCount[dominated] == 0) {
-                    front[dominated] = frontNumber + 1;
-                    nextFront.push_back(dominated);
-                }
-            }
+    selected.reserve(std::min(targetSize, rows.size()));
+    for (const auto& front : fronts) {
+        size_t room = targetSize - selected.size();
+        if (front.size() <= room) {
+            selected.insert(selected.end(), front.begin(), front.end());
+            if (front.size() == room) break;
+            continue;
         }
         
-        // Add remaining solutions from current front if space available
-        if (result.size() < targetSize) {
-            // Calculate crowding distance and sort
-            std::vector<std::pair<double, size_t>> crowdingPairs;
-            for (size_t i = 0; i < population.size(); ++i) {
-                if (front[i] == frontNumber) {
-                    crowdingPairs.push_back({crowdingDistance[i], i});
-                }
-            }
-            
-            std::sort(crowdingPairs.rbegin(), crowdingPairs.rend());
-            
-            for (const auto& pair : crowdingPairs) {
-                if (result.size() < targetSize) {
-                    result.push_back(population[pair.second]);
-                }
-            }
+        // Last front only partly fits: most isolated points first
+        std::vector<double> distance = crowdingDistances(rows, front);
+        std::vector<size_t> order(front.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::partial_sort(order.begin(), order.begin() + room, order.end(), [&](size_t a, size_t b) {
+            return distance[a] != distance[b] ? distance[a] > distance[b] : a < b;
+        });
+        for (size_t k = 0; k < room; ++k) {
+            selected.push_back(front[order[k]]);
         }
-        
-        // Move to next front
-        for (size_t idx : nextFront) {
-            currentFront.push(idx);
+        break;
+    }
+    return selected;
+}
+
+// HypervolumeIndicator implementation
+HypervolumeIndicator::HypervolumeIndicator() : HypervolumeIndicator(Options{}) {
+}
+
+HypervolumeIndicator::HypervolumeIndicator(const Options& options) : options_(options) {
+}
+
+HypervolumeIndicator::Estimate HypervolumeIndicator::compute(const std::vector<Point>& front) const {
+    if (front.size() > options_.exactLimit && options_.monteCarloSamples > 0) {
+        return estimateMonteCarlo(front);
+    }
+    
+    Estimate estimate;
+    estimate.value = estimate.lower = estimate.upper = computeExact(front);
+    return estimate;
+}
+
+double HypervolumeIndicator::computeExact(const std::vector<Point>& front) const {
+    std::vector<Point> points = prepareFront(front, options_.reference);
+    return wfg(points, kObjectives);
+}
+
+HypervolumeIndicator::Estimate HypervolumeIndicator::estimateMonteCarlo(const std::vector<Point>& front) const {
+    Estimate estimate;
+    std::vector<Point> points = prepareFront(front, options_.reference);
+    const size_t samples = options_.monteCarloSamples;
+    if (points.empty() || samples == 0) return estimate;
+    
+    // Sample the bounding box of the front
+    Point upper{};
+    for (const auto& point : points) {
+        for (size_t m = 0; m < kObjectives; ++m) upper[m] = std::max(upper[m], point[m]);
+    }
+    double box = 1.0;
+    for (double extent : upper) box *= extent;
+    
+    std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) { return a[0] > b[0]; });
+    double fraction = static_cast<double>(sampleHits(points, upper, samples, options_.seed)) / samples;
+    
+    estimate.value = box * fraction;
+    estimate.standardError = box * std::sqrt(fraction * (1.0 - fraction) / samples);
+    estimate.lower = std::max(0.0, estimate.value - options_.zScore * estimate.standardError);
+    estimate.upper = std::min(box, estimate.value + options_.zScore * estimate.standardError);
+    estimate.samples = samples;
+    estimate.exact = false;
+    return estimate;
+}
+
+double HypervolumeIndicator::add(const Point& point) {
+    Point translated;
+    if (!translate(point, options_.reference, translated)) return 0.0;
+    for (const auto& member : front_) {
+        if (covers(member, point, kObjectives)) return 0.0;
+    }
+    
+    // Exclusive contribution: the point's box minus its overlap with the
+    // front, which is the front clipped to that box
+    std::vector<Point> overlap;
+    overlap.reserve(front_.size());
+    for (const auto& member : front_) {
+        Point clipped;
+        for (size_t m = 0; m < kObjectives; ++m) {
+            clipped[m] = std::min(translated[m], member[m] - options_.reference[m]);
         }
-        frontNumber++;
+        overlap.push_back(clipped);
+    }
+    removeCovered(overlap, kObjectives);
+    
+    double box = 1.0;
+    for (double extent : translated) box *= extent;
+    
+    double contribution;
+    if (overlap.size() <= options_.exactLimit || options_.monteCarloSamples == 0) {
+        contribution = box - wfg(overlap, kObjectives);
+    } else {
+        // Samples in the box that the rest of the front misses
+        std::sort(overlap.begin(), overlap.end(), [](const auto& a, const auto& b) { return a[0] > b[0]; });
+        const size_t samples = options_.monteCarloSamples;
+        size_t hits = sampleHits(overlap, translated, samples, options_.seed + static_cast<unsigned>(front_.size()));
+        contribution = box * static_cast<double>(samples - hits) / samples;
+        exact_ = false;
     }
     
-    return result;
+    front_.erase(std::remove_if(front_.begin(), front_.end(),
+                                [&](const Point& member) { return covers(point, member, kObjectives); }),
+                 front_.end());
+    front_.push_back(point);
+    value_ += contribution;
+    return contribution;
+}
+
+void HypervolumeIndicator::reset() {
+    front_.clear();
+    value_ = 0.0;
+    exact_ = true;
+}
+
+// CandidatePruner implementation
+CandidatePruner::CandidatePruner() : CandidatePruner(Options{}) {
+}
+
+CandidatePruner::CandidatePruner(const Options& options) : options_(options) {
+}
+
+CandidatePruner::Verdict CandidatePruner::check(const AudioStats& stats, const AudioConstraints& constraints,
+                                                const MOOOptimizer::EvalMetrics* partial) const {
+    // Final: these counts and peaks never shrink as the render goes on
+    if (stats.nonFiniteSamples > 0) return Verdict::NON_FINITE;
+    if (constraints.noHardClips && stats.clippedSamples > 0) return Verdict::HARD_CLIP;
+    if (stats.truePeakDb() > constraints.truePeakLimit) return Verdict::TRUE_PEAK;
+    
+    // Heuristic: a stable patch this far off is not coming back
+    if (stats.variance > options_.runawayVariance) return Verdict::RUNAWAY_GAIN;
+    
+    const double seconds = stats.samples / stats.sampleRate;
+    if (seconds >= options_.loudnessSeconds
+        && std::abs(stats.integratedLoudness - constraints.lufsTarget) > 3.0 + options_.loudnessMargin) {
+        return Verdict::LOUDNESS;
+    }
+    
+    if (options_.pruneDominated && partial && seconds >= options_.dominanceSeconds) {
+        if (isDominated(MOOOptimizer::objectiveRow(partial->objectives))) return Verdict::DOMINATED;
+    }
+    return Verdict::CONTINUE;
+}
+
+bool CandidatePruner::isDominated(const Point& objectives) const {
+    for (const auto& member : front_) {
+        bool covered = true;
+        bool clearlyBetter = false;
+        for (size_t m = 0; m < kObjectives && covered; ++m) {
+            covered = member[m] >= objectives[m];
+            clearlyBetter |= member[m] >= objectives[m] + options_.dominanceMargin;
+        }
+        if (covered && clearlyBetter) return true;
+    }
+    return false;
+}
+
+void CandidatePruner::addToFront(const Point& objectives) {
+    for (const auto& member : front_) {
+        if (member == objectives || dominatesRow(member, objectives)) return;
+    }
+    front_.erase(std::remove_if(front_.begin(), front_.end(),
+                                [&](const Point& member) { return dominatesRow(objectives, member); }),
+                 front_.end());
+    front_.push_back(objectives);
+}
+
+std::string CandidatePruner::verdictName(Verdict verdict) {
+    switch (verdict) {
+        case Verdict::CONTINUE: return "continue";
+        case Verdict::NON_FINITE: return "non_finite";
+        case Verdict::HARD_CLIP: return "hard_clip";
+        case Verdict::TRUE_PEAK: return "true_peak";
+        case Verdict::RUNAWAY_GAIN: return "runaway_gain";
+        case Verdict::LOUDNESS: return "loudness";
+        case Verdict::DOMINATED: return "dominated";
+    }
+    return "unknown";
 }
 
 double MOOOptimizer::bradleyTerryWinProb(const Trace& traceA, const Trace& traceB) const {
@@ -244,7 +669,7 @@ double MOOOptimizer::bradleyTerryWinProb(const Trace& traceA, const Trace& trace
     return expA / (expA + expB);
 }
 
-double MOOOptimizer::calculateSemanticMatch(const AudioBuffer& audio, 
+double MOOOptimizer::calculateSemanticMatch(const AudioStats& stats, 
                                            const std::string& query, 
                                            Role role) const {
     // Placeholder implementation
@@ -286,8 +711,8 @@ double MOOOptimizer::calculateSemanticMatch(const AudioBuffer& audio,
     }
     
     // Audio feature-based matching
-    double spectralCentroid = calculateSpectralCentroid(audio);
-    double lufs = calculateLUFS(audio);
+    double spectralCentroid = calculateSpectralCentroid(stats);
+    double lufs = calculateLUFS(stats);
     
     // Match spectral characteristics
     if (role == Role::BASS && spectralCentroid < 200.0) score += 0.2;
@@ -300,24 +725,24 @@ double MOOOptimizer::calculateSemanticMatch(const AudioBuffer& audio,
     return std::min(1.0, score);
 }
 
-double MOOOptimizer::calculateMixReadiness(const AudioBuffer& audio, 
+double MOOOptimizer::calculateMixReadiness(const AudioStats& stats, 
                                           Role role, 
                                           const AudioConstraints& constraints) const {
     double score = 0.0;
     
     // LUFS target compliance
-    double lufs = calculateLUFS(audio);
+    double lufs = calculateLUFS(stats);
     double lufsError = std::abs(lufs - constraints.lufsTarget);
     if (lufsError < 1.0) score += 0.3;
     else if (lufsError < 3.0) score += 0.2;
     
     // True peak compliance
-    double truePeak = calculateTruePeak(audio);
+    double truePeak = calculateTruePeak(stats);
     if (truePeak <= constraints.truePeakLimit) score += 0.3;
     else if (truePeak <= constraints.truePeakLimit + 1.0) score += 0.2;
     
     // Crest factor compliance
-    double crestFactor = calculateCrestFactor(audio);
+    double crestFactor = calculateCrestFactor(stats);
     if (crestFactor >= constraints.crestFactorMin && crestFactor <= constraints.crestFactorMax) {
         score += 0.4;
     }
@@ -325,99 +750,65 @@ double MOOOptimizer::calculateMixReadiness(const AudioBuffer& audio,
     return std::min(1.0, score);
 }
 
-double MOOOptimizer::calculatePerceptualQuality(const AudioBuffer& audio) const {
+double MOOOptimizer::calculatePerceptualQuality(const AudioStats& stats) const {
     // Placeholder for perceptual quality calculation
     // Would include multiresolution STFT loss, spectral centroid bounds, etc.
     
     double score = 0.0;
     
     // Check for clipping
-    bool clipped = false;
-    for (double sample : audio) {
-        if (std::abs(sample) >= 1.0) {
-            clipped = true;
-            break;
-        }
-    }
-    if (!clipped) score += 0.3;
+    if (stats.clippedSamples == 0) score += 0.3;
     
     // Check for DC offset
-    double dcOffset = std::accumulate(audio.begin(), audio.end(), 0.0) / audio.size();
-    if (std::abs(dcOffset) < 0.001) score += 0.2;
+    if (std::abs(stats.dcOffset) < 0.001) score += 0.2;
     
     // Check for silence
-    double rms = 0.0;
-    for (double sample : audio) {
-        rms += sample * sample;
-    }
-    rms = std::sqrt(rms / audio.size());
-    if (rms > 0.001) score += 0.3;
+    if (stats.rms > 0.001) score += 0.3;
     
     // Spectral quality (simplified)
-    double spectralCentroid = calculateSpectralCentroid(audio);
+    double spectralCentroid = calculateSpectralCentroid(stats);
     if (spectralCentroid > 0.0 && spectralCentroid < 20000.0) score += 0.2;
     
     return std::min(1.0, score);
 }
 
-double MOOOptimizer::calculateStability(const AudioBuffer& audio) const {
+double MOOOptimizer::calculateStability(const AudioStats& stats) const {
     double score = 0.0;
     
     // Check for xruns (simplified - would need real-time monitoring)
     score += 0.3; // Assume no xruns for now
     
-    // Check for denormals (simplified)
-    bool hasDenormals = false;
-    for (double sample : audio) {
-        if (std::fpclassify(sample) == FP_SUBNORMAL) {
-            hasDenormals = true;
-            break;
-        }
-    }
-    if (!hasDenormals) score += 0.3;
+    // Denormals and NaN/inf both point at an unstable recursion
+    if (stats.denormalSamples == 0 && stats.nonFiniteSamples == 0) score += 0.3;
     
     // Check DC offset
-    double dcOffset = std::accumulate(audio.begin(), audio.end(), 0.0) / audio.size();
-    if (std::abs(dcOffset) < 0.001) score += 0.2;
+    if (std::abs(stats.dcOffset) < 0.001) score += 0.2;
     
     // Check for stability over time (variance)
-    double mean = dcOffset;
-    double variance = 0.0;
-    for (double sample : audio) {
-        double diff = sample - mean;
-        variance += diff * diff;
-    }
-    variance /= audio.size();
-    
-    if (variance > 0.0 && variance < 1.0) score += 0.2;
+    if (stats.variance > 0.0 && stats.variance < 1.0) score += 0.2;
     
     return std::min(1.0, score);
 }
 
 std::vector<MOOOptimizer::ConstraintViolation> MOOOptimizer::checkConstraints(
-    const AudioBuffer& audio,
+    const AudioStats& stats,
     const AudioConstraints& constraints) const {
     
     std::vector<ConstraintViolation> violations;
     
     // Check for hard clips
-    if (constraints.noHardClips) {
-        for (double sample : audio) {
-            if (std::abs(sample) >= 1.0) {
-                violations.push_back({"hard_clip", std::abs(sample), 1.0});
-                break;
-            }
-        }
+    if (constraints.noHardClips && stats.clippedSamples > 0) {
+        violations.push_back({"hard_clip", stats.peak, 1.0});
     }
     
     // Check true peak limit
-    double truePeak = calculateTruePeak(audio);
+    double truePeak = calculateTruePeak(stats);
     if (truePeak > constraints.truePeakLimit) {
         violations.push_back({"true_peak", truePeak, constraints.truePeakLimit});
     }
     
     // Check LUFS target
-    double lufs = calculateLUFS(audio);
+    double lufs = calculateLUFS(stats);
     if (std::abs(lufs - constraints.lufsTarget) > 3.0) {
         violations.push_back({"lufs_target", lufs, constraints.lufsTarget});
     }
@@ -425,59 +816,33 @@ std::vector<MOOOptimizer::ConstraintViolation> MOOOptimizer::checkConstraints(
     return violations;
 }
 
-double MOOOptimizer::calculateLUFS(const AudioBuffer& audio) const {
-    // Simplified LUFS calculation
-    // In practice, this would use proper K-weighting and gating
-    
-    double sum = 0.0;
-    for (double sample : audio) {
-        sum += sample * sample;
-    }
-    double rms = std::sqrt(sum / audio.size());
-    
-    // Convert to LUFS (simplified)
-    return 20.0 * std::log10(std::max(rms, 1e-10)) - 23.0;
+double MOOOptimizer::calculateLUFS(const AudioStats& stats) const {
+    // BS.1770 gated integrated loudness
+    return stats.integratedLoudness;
 }
 
-double MOOOptimizer::calculateTruePeak(const AudioBuffer& audio) const {
-    double maxPeak = 0.0;
-    for (double sample : audio) {
-        maxPeak = std::max(maxPeak, std::abs(sample));
-    }
-    return 20.0 * std::log10(std::max(maxPeak, 1e-10));
+double MOOOptimizer::calculateTruePeak(const AudioStats& stats) const {
+    return stats.truePeakDb();
 }
 
-double MOOOptimizer::calculateCrestFactor(const AudioBuffer& audio) const {
-    double sum = 0.0;
-    double maxPeak = 0.0;
-    
-    for (double sample : audio) {
-        sum += sample * sample;
-        maxPeak = std::max(maxPeak, std::abs(sample));
-    }
-    
-    double rms = std::sqrt(sum / audio.size());
-    if (rms < 1e-10) return 0.0;
-    
-    return 20.0 * std::log10(maxPeak / rms);
+double MOOOptimizer::calculateCrestFactor(const AudioStats& stats) const {
+    return stats.crestFactorDb;
 }
 
-double MOOOptimizer::calculateSpectralCentroid(const AudioBuffer& audio) const {
-    // Simplified spectral centroid calculation
-    // In practice, this would use FFT
-    
-    double weightedSum = 0.0;
-    double magnitudeSum = 0.0;
-    
-    for (size_t i = 0; i < audio.size(); ++i) {
-        double magnitude = std::abs(audio[i]);
-        double frequency = static_cast<double>(i) * 44100.0 / audio.size();
-        
-        weightedSum += frequency * magnitude;
-        magnitudeSum += magnitude;
-    }
-    
-    return magnitudeSum > 0.0 ? weightedSum / magnitudeSum : 0.0;
+double MOOOptimizer::calculateSpectralCentroid(const AudioStats& stats) const {
+    // STFT centroid from analyzeAudio
+    return stats.spectralCentroid;
+}
+
+double MOOOptimizer::multiresSTFTLoss(const AudioBuffer& reference, const AudioBuffer& generated) const {
+    return aiaudio::multiresSTFTLoss(SpectralAnalysis(reference), SpectralAnalysis(generated));
+}
+
+double MOOOptimizer::barkLoudnessError(const AudioBuffer& reference, const AudioBuffer& generated) const {
+    SpectralAnalysis::Options options;
+    options.fftSizes = {2048};
+    return aiaudio::barkLoudnessError(SpectralAnalysis(reference, 44100.0, options),
+                                      SpectralAnalysis(generated, 44100.0, options));
 }
 
-} // namespace aiaudio
\ No newline at end of file
+} // namespace aiaudio
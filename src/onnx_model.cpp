@@ -0,0 +1,236 @@
+#include "decision_heads.h"
+#include <algorithm>
+
+#if defined(AIAUDIO_HAS_ONNXRUNTIME)
+#include <onnxruntime_cxx_api.h>
+#include <array>
+#include <mutex>
+#endif
+
+namespace aiaudio {
+
+#if defined(AIAUDIO_HAS_ONNXRUNTIME)
+
+namespace {
+
+// One runtime environment per process, shared by every session
+Ort::Env& environment() {
+    static Ort::Env env(ORT_LOGGING_LEVEL_WARNING, "aiaudio");
+    return env;
+}
+
+void appendProvider(Ort::SessionOptions& options, const std::string& name) {
+    if (name == "cuda") {
+        OrtCUDAProviderOptions cuda{};
+        options.AppendExecutionProvider_CUDA(cuda);
+    } else if (name == "tensorrt") {
+        OrtTensorRTProviderOptions tensorRT{};
+        options.AppendExecutionProvider_TensorRT(tensorRT);
+    } else {
+        options.AppendExecutionProvider(name);
+    }
+}
+
+// (batch, features) of a rank-2 float tensor; batch is -1 when dynamic
+std::pair<int64_t, int64_t> matrixShape(const Ort::TypeInfo& info, const std::string& what) {
+    auto tensor = info.GetTensorTypeAndShapeInfo();
+    if (tensor.GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+        throw AIAudioException("ONNX model " + what + " must be a float tensor");
+    }
+    
+    std::vector<int64_t> shape = tensor.GetShape();
+    if (shape.size() != 2 || shape[1] <= 0) {
+        throw AIAudioException("ONNX model " + what + " must have shape [batch, features]");
+    }
+    return {shape[0], shape[1]};
+}
+
+} // namespace
+
+struct ONNXModel::Session {
+    Ort::Session session{nullptr};
+    Ort::MemoryInfo memory = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeDefault);
+    Ort::RunOptions runOptions;
+    std::string inputName;
+    std::string outputName;
+    int64_t inputBatch = 0;
+    int64_t inputFeatures = 0;
+    int64_t outputFeatures = 0;
+    
+    // Reused between calls, one per concurrent caller
+    std::mutex bindingMutex;
+    std::vector<std::unique_ptr<Ort::IoBinding>> freeBindings;
+    
+    std::unique_ptr<Ort::IoBinding> acquireBinding() {
+        std::lock_guard<std::mutex> lock(bindingMutex);
+        if (freeBindings.empty()) return std::make_unique<Ort::IoBinding>(session);
+        auto binding = std::move(freeBindings.back());
+        freeBindings.pop_back();
+        return binding;
+    }
+    
+    void releaseBinding(std::unique_ptr<Ort::IoBinding> binding) {
+        binding->ClearBoundInputs();
+        binding->ClearBoundOutputs();
+        std::lock_guard<std::mutex> lock(bindingMutex);
+        freeBindings.push_back(std::move(binding));
+    }
+    
+    // One Run over rows rows; the tensors wrap the caller's buffers
+    // (ONNX Runtime only reads the input)
+    void runRows(const float* inputs, size_t rows, float* outputs) {
+        std::array<int64_t, 2> inputShape{static_cast<int64_t>(rows), inputFeatures};
+        std::array<int64_t, 2> outputShape{static_cast<int64_t>(rows), outputFeatures};
+        Ort::Value input = Ort::Value::CreateTensor<float>(
+            memory, const_cast<float*>(inputs), rows * inputFeatures, inputShape.data(), inputShape.size());
+        Ort::Value output = Ort::Value::CreateTensor<float>(
+            memory, outputs, rows * outputFeatures, outputShape.data(), outputShape.size());
+        
+        auto binding = acquireBinding();
+        try {
+            binding->BindInput(inputName.c_str(), input);
+            binding->BindOutput(outputName.c_str(), output);
+            session.Run(runOptions, *binding);
+        } catch (const Ort::Exception& e) {
+            releaseBinding(std::move(binding));
+            throw AIAudioException(std::string("ONNX inference failed: ") + e.what());
+        }
+        releaseBinding(std::move(binding));
+    }
+    
+    void run(const float* inputs, size_t batchSize, float* outputs) {
+        if (inputBatch <= 0) {
+            runRows(inputs, batchSize, outputs);
+            return;
+        }
+        
+        // Fixed batch dimension: full chunks in place, the remainder padded
+        const size_t chunk = static_cast<size_t>(inputBatch);
+        size_t row = 0;
+        for (; row + chunk <= batchSize; row += chunk) {
+            runRows(inputs + row * inputFeatures, chunk, outputs + row * outputFeatures);
+        }
+        if (row < batchSize) {
+            size_t rest = batchSize - row;
+            std::vector<float> paddedInput(chunk * inputFeatures, 0.0f);
+            std::vector<float> paddedOutput(chunk * outputFeatures);
+            std::copy_n(inputs + row * inputFeatures, rest * inputFeatures, paddedInput.data());
+            runRows(paddedInput.data(), chunk, paddedOutput.data());
+            std::copy_n(paddedOutput.data(), rest * outputFeatures, outputs + row * outputFeatures);
+        }
+    }
+};
+
+#else
+
+// Built without ONNX Runtime: loadModel() refuses, so no session ever exists
+struct ONNXModel::Session {
+    int64_t inputBatch = 0;
+    int64_t inputFeatures = 0;
+    int64_t outputFeatures = 0;
+    
+    void run(const float* /*inputs*/, size_t /*batchSize*/, float* /*outputs*/) {}
+};
+
+#endif
+
+ONNXModel::ONNXModel() : ONNXModel(Options{}) {
+}
+
+ONNXModel::ONNXModel(const Options& options) : options_(options) {
+}
+
+ONNXModel::~ONNXModel() = default;
+ONNXModel::ONNXModel(ONNXModel&&) noexcept = default;
+ONNXModel& ONNXModel::operator=(ONNXModel&&) noexcept = default;
+
+bool ONNXModel::isAvailable() {
+#if defined(AIAUDIO_HAS_ONNXRUNTIME)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ONNXModel::loadModel(const std::string& modelPath) {
+#if defined(AIAUDIO_HAS_ONNXRUNTIME)
+    auto session = std::make_unique<Session>();
+    try {
+        Ort::SessionOptions sessionOptions;
+        sessionOptions.SetIntraOpNumThreads(options_.intraOpThreads);
+        sessionOptions.SetInterOpNumThreads(options_.interOpThreads);
+        sessionOptions.SetExecutionMode(options_.interOpThreads > 1 ? ExecutionMode::ORT_PARALLEL
+                                                                    : ExecutionMode::ORT_SEQUENTIAL);
+        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        for (const auto& provider : options_.executionProviders) {
+            appendProvider(sessionOptions, provider);
+        }
+
+#if defined(_WIN32)
+        std::wstring path(modelPath.begin(), modelPath.end());
+#else
+        const std::string& path = modelPath;
+#endif
+        session->session = Ort::Session(environment(), path.c_str(), sessionOptions);
+        
+        if (session->session.GetInputCount() != 1 || session->session.GetOutputCount() != 1) {
+            throw AIAudioException("ONNX model must have one input and one output: " + modelPath);
+        }
+        Ort::AllocatorWithDefaultOptions allocator;
+        session->inputName = session->session.GetInputNameAllocated(0, allocator).get();
+        session->outputName = session->session.GetOutputNameAllocated(0, allocator).get();
+        
+        auto [inputBatch, inputFeatures] = matrixShape(session->session.GetInputTypeInfo(0), "input");
+        auto [outputBatch, outputFeatures] = matrixShape(session->session.GetOutputTypeInfo(0), "output");
+        if (outputBatch != inputBatch) {
+            throw AIAudioException("ONNX model input and output batch dimensions differ: " + modelPath);
+        }
+        session->inputBatch = inputBatch;
+        session->inputFeatures = inputFeatures;
+        session->outputFeatures = outputFeatures;
+    } catch (const Ort::Exception& e) {
+        throw AIAudioException("Failed to load ONNX model " + modelPath + ": " + e.what());
+    }
+    session_ = std::move(session);
+#else
+    throw AIAudioException("Cannot load " + modelPath + ": built without ONNX Runtime (AIAUDIO_WITH_ONNXRUNTIME)");
+#endif
+}
+
+std::vector<double> ONNXModel::runInference(const std::vector<double>& input) const {
+    if (input.size() != getInputShape().second) {
+        throw AIAudioException("Input size mismatch");
+    }
+    
+    std::vector<float> in(input.begin(), input.end());
+    std::vector<float> out(getOutputShape().second);
+    runBatch(in.data(), 1, out.data());
+    return std::vector<double>(out.begin(), out.end());
+}
+
+void ONNXModel::runBatch(const float* inputs, size_t batchSize, float* outputs) const {
+    if (!session_) {
+        throw AIAudioException("ONNX model not loaded");
+    }
+    if (batchSize == 0) return;
+    session_->run(inputs, batchSize, outputs);
+}
+
+std::pair<size_t, size_t> ONNXModel::getInputShape() const {
+    if (!session_) return {0, 0};
+    return {static_cast<size_t>(std::max<int64_t>(session_->inputBatch, 0)),
+            static_cast<size_t>(session_->inputFeatures)};
+}
+
+std::pair<size_t, size_t> ONNXModel::getOutputShape() const {
+    if (!session_) return {0, 0};
+    return {static_cast<size_t>(std::max<int64_t>(session_->inputBatch, 0)),
+            static_cast<size_t>(session_->outputFeatures)};
+}
+
+void ONNXModel::quantize(int8_t /*targetPrecision*/) {
+    // Sessions cannot be re-quantized in place
+    throw AIAudioException("Quantize ONNX models offline (onnxruntime.quantization) before loading");
+}
+
+} // namespace aiaudio
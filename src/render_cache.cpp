@@ -0,0 +1,394 @@
+#include "render_cache.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <tuple>
+
+namespace aiaudio {
+
+namespace {
+
+constexpr uint64_t kFNVOffset = 0xcbf29ce484222325ull;
+constexpr uint64_t kFNVPrime = 0x100000001b3ull;
+
+// FNV-1a over a stream of fields; strings carry their length so adjacent
+// fields cannot run into each other
+class ContentHasher {
+public:
+    void bytes(const void* data, size_t size) {
+        const auto* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash_ = (hash_ ^ p[i]) * kFNVPrime;
+        }
+    }
+    
+    template<typename T>
+    void pod(T value) { bytes(&value, sizeof(value)); }
+    
+    void string(const std::string& value) {
+        pod(static_cast<uint64_t>(value.size()));
+        bytes(value.data(), value.size());
+    }
+    
+    void param(const ParamValue& value) {
+        pod(static_cast<uint8_t>(value.index()));
+        if (const auto* d = std::get_if<double>(&value)) {
+            pod(*d == 0.0 ? 0.0 : *d);  // -0.0 and 0.0 render the same
+        } else if (const auto* i = std::get_if<int>(&value)) {
+            pod(static_cast<int64_t>(*i));
+        } else if (const auto* b = std::get_if<bool>(&value)) {
+            pod(static_cast<uint8_t>(*b));
+        } else {
+            string(std::get<std::string>(value));
+        }
+    }
+    
+    uint64_t value() const { return hash_; }
+    
+private:
+    uint64_t hash_ = kFNVOffset;
+};
+
+// Spill file: a RIFF/WAVE file of 32-bit float mono audio. The results sit
+// in an "aicr" chunk ahead of the samples, which WAV readers skip:
+//   uint32 version, uint64 key, uint64 scoreKey, float64 qualityScore,
+//   uint32 meter count, per meter: name, float64 value,
+//   uint32 warning count, per warning: text
+// Strings are a uint32 length and the bytes; host byte order, which WAV
+// fixes as little-endian.
+static_assert(std::endian::native == std::endian::little, "spill files are little-endian");
+
+constexpr uint32_t kSpillVersion = 1;
+constexpr uint16_t kWaveFormatFloat = 3;
+
+class SpillWriter {
+public:
+    void put(const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        buffer_.insert(buffer_.end(), bytes, bytes + size);
+    }
+    
+    template<typename T>
+    void pod(T value) { put(&value, sizeof(value)); }
+    
+    void string(const std::string& value) {
+        pod(static_cast<uint32_t>(value.size()));
+        put(value.data(), value.size());
+    }
+    
+    void tag(const char (&id)[5]) { put(id, 4); }
+    
+    // Patch a uint32 written earlier
+    void patch(size_t offset, uint32_t value) { std::memcpy(buffer_.data() + offset, &value, sizeof(value)); }
+    
+    size_t size() const { return buffer_.size(); }
+    std::vector<uint8_t>& bytes() { return buffer_; }
+    
+private:
+    std::vector<uint8_t> buffer_;
+};
+
+// Bounds-checked reads; ok() turns false on the first overrun
+class SpillReader {
+public:
+    SpillReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+    
+    template<typename T>
+    T pod() {
+        T value{};
+        if (const uint8_t* p = take(sizeof(T))) std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+    
+    std::string string() {
+        uint32_t length = pod<uint32_t>();
+        const uint8_t* p = take(length);
+        return p ? std::string(reinterpret_cast<const char*>(p), length) : std::string();
+    }
+    
+    const uint8_t* take(size_t size) {
+        if (!ok_ || size > size_ - pos_) {
+            ok_ = false;
+            return nullptr;
+        }
+        const uint8_t* p = data_ + pos_;
+        pos_ += size;
+        return p;
+    }
+    
+    bool ok() const { return ok_; }
+    bool atEnd() const { return pos_ == size_; }
+    size_t remaining() const { return size_ - pos_; }
+    
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+} // namespace
+
+uint64_t graphContentHash(const DSPGraph& graph) {
+    ContentHasher hasher;
+    
+    std::vector<std::string> names = graph.getStageNames();
+    std::sort(names.begin(), names.end());
+    hasher.pod(static_cast<uint64_t>(names.size()));
+    for (const auto& name : names) {
+        const DSPStage* stage = graph.getStage(name);
+        hasher.string(name);
+        hasher.pod(static_cast<uint8_t>(stage->getType()));
+        const std::vector<std::string> params = stage->getParameterNames();
+        hasher.pod(static_cast<uint64_t>(params.size()));
+        for (const auto& param : params) {
+            hasher.string(param);
+            hasher.param(stage->getParameter(param));
+        }
+    }
+    
+    std::vector<Connection> connections = graph.getConnections();
+    std::sort(connections.begin(), connections.end(), [](const Connection& a, const Connection& b) {
+        return std::tie(a.source, a.destination, a.parameter, a.amount, a.enabled)
+             < std::tie(b.source, b.destination, b.parameter, b.amount, b.enabled);
+    });
+    hasher.pod(static_cast<uint64_t>(connections.size()));
+    for (const auto& connection : connections) {
+        hasher.string(connection.source);
+        hasher.string(connection.destination);
+        hasher.string(connection.parameter);
+        hasher.pod(connection.amount);
+        hasher.pod(static_cast<uint8_t>(connection.enabled));
+    }
+    
+    // The routing the plans run. Stages without audio connections chain in
+    // audio order, which follows the graph's map order and so insertion
+    const std::vector<std::string> order = graph.getAudioOrder();
+    const std::vector<std::vector<size_t>> sources = graph.getAudioSources();
+    hasher.pod(static_cast<uint64_t>(order.size()));
+    for (size_t i = 0; i < order.size(); ++i) {
+        hasher.string(order[i]);
+        hasher.pod(static_cast<uint64_t>(sources[i].size()));
+        for (size_t source : sources[i]) {
+            hasher.pod(static_cast<uint64_t>(source));
+        }
+    }
+    
+    hasher.pod(graph.getSampleRate());
+    hasher.pod(static_cast<uint64_t>(graph.getControlInterval()));
+    return hasher.value();
+}
+
+uint64_t renderCacheKey(uint64_t graphHash, uint32_t seed, size_t numSamples) {
+    ContentHasher hasher;
+    hasher.pod(graphHash);
+    hasher.pod(seed);
+    hasher.pod(static_cast<uint64_t>(numSamples));
+    return hasher.value();
+}
+
+uint64_t scoreCacheKey(const std::string& prompt, Role role, const MusicalContext& context,
+                       const AudioConstraints& constraints) {
+    ContentHasher hasher;
+    hasher.string(prompt);
+    hasher.pod(static_cast<int32_t>(role));
+    hasher.pod(context.tempo);
+    hasher.pod(static_cast<int32_t>(context.key));
+    hasher.string(context.scale);
+    hasher.pod(context.timeSignature);
+    hasher.pod(constraints.maxCPU);
+    hasher.pod(constraints.maxLatency);
+    hasher.pod(static_cast<uint8_t>(constraints.noHardClips));
+    hasher.pod(constraints.truePeakLimit);
+    hasher.pod(constraints.lufsTarget);
+    hasher.pod(constraints.crestFactorMin);
+    hasher.pod(constraints.crestFactorMax);
+    return hasher.value();
+}
+
+// RenderCache implementation
+RenderCache::RenderCache() : RenderCache(Options{}) {
+}
+
+RenderCache::RenderCache(const Options& options)
+    : options_(options), memory_(options.maxBytes) {
+}
+
+std::shared_ptr<const RenderCache::Entry> RenderCache::find(uint64_t key) {
+    if (auto cached = memory_.get(key)) {
+        return *cached;
+    }
+    if (options_.spillDirectory.empty()) return nullptr;
+    
+    std::shared_ptr<const Entry> entry = readSpill(key);
+    if (entry) {
+        memory_.put(key, entry, entry->audio.size() * sizeof(Sample));
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        ++spillHits_;
+    }
+    return entry;
+}
+
+std::shared_ptr<const RenderCache::Entry> RenderCache::store(uint64_t key, Entry entry) {
+    auto shared = std::make_shared<const Entry>(std::move(entry));
+    memory_.put(key, shared, shared->audio.size() * sizeof(Sample));
+    
+    if (!options_.spillDirectory.empty()) {
+        bool written = writeSpill(key, *shared);
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        ++(written ? spillWrites_ : spillErrors_);
+    }
+    return shared;
+}
+
+RenderCache::Stats RenderCache::getStats() const {
+    Stats stats;
+    stats.memory = memory_.getStats();
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats.spillHits = spillHits_;
+    stats.spillWrites = spillWrites_;
+    stats.spillErrors = spillErrors_;
+    return stats;
+}
+
+std::string RenderCache::spillPath(uint64_t key) const {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.wav", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(options_.spillDirectory) / name).string();
+}
+
+bool RenderCache::writeSpill(uint64_t key, const Entry& entry) const {
+    SpillWriter out;
+    out.tag("RIFF");
+    out.pod(uint32_t(0));
+    out.tag("WAVE");
+    
+    out.tag("fmt ");
+    out.pod(uint32_t(18));
+    out.pod(kWaveFormatFloat);
+    out.pod(uint16_t(1));                                              // Channels
+    out.pod(static_cast<uint32_t>(entry.sampleRate));
+    out.pod(static_cast<uint32_t>(entry.sampleRate * sizeof(float)));  // Byte rate
+    out.pod(static_cast<uint16_t>(sizeof(float)));                      // Block align
+    out.pod(uint16_t(32));                                             // Bits per sample
+    out.pod(uint16_t(0));                                              // No extension
+    
+    out.tag("aicr");
+    const size_t sizeOffset = out.size();
+    out.pod(uint32_t(0));
+    const size_t chunkStart = out.size();
+    out.pod(kSpillVersion);
+    out.pod(key);
+    out.pod(entry.scoreKey);
+    out.pod(entry.qualityScore);
+    out.pod(static_cast<uint32_t>(entry.meters.size()));
+    for (const auto& [name, value] : entry.meters) {
+        out.string(name);
+        out.pod(value);
+    }
+    out.pod(static_cast<uint32_t>(entry.warnings.size()));
+    for (const auto& warning : entry.warnings) {
+        out.string(warning);
+    }
+    out.patch(sizeOffset, static_cast<uint32_t>(out.size() - chunkStart));
+    if ((out.size() - chunkStart) % 2) out.pod(uint8_t(0));  // RIFF chunks are word-aligned
+    
+    static_assert(sizeof(Sample) == sizeof(float));
+    out.tag("data");
+    out.pod(static_cast<uint32_t>(entry.audio.size() * sizeof(float)));
+    out.put(entry.audio.data(), entry.audio.size() * sizeof(float));
+    out.patch(4, static_cast<uint32_t>(out.size() - 8));
+    
+    // Write aside and rename; the temporary name is per thread, so two
+    // workers storing the same key cannot interleave
+    std::error_code error;
+    std::filesystem::create_directories(options_.spillDirectory, error);
+    const std::string path = spillPath(key);
+    const std::string tempPath = path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+        file.write(reinterpret_cast<const char*>(out.bytes().data()), out.size());
+        if (!file) {
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<RenderCache::Entry> RenderCache::readSpill(uint64_t key) {
+    std::ifstream file(spillPath(key), std::ios::binary);
+    if (!file.is_open()) return nullptr;
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    
+    auto countError = [this]() -> std::shared_ptr<Entry> {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        ++spillErrors_;
+        return nullptr;
+    };
+    
+    SpillReader in(bytes.data(), bytes.size());
+    const uint8_t* riff = in.take(12);
+    if (!riff || std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0) {
+        return countError();
+    }
+    
+    auto entry = std::make_shared<Entry>();
+    bool haveFormat = false, haveResults = false, haveData = false;
+    while (in.ok() && !in.atEnd()) {
+        const uint8_t* id = in.take(4);
+        const uint32_t size = in.pod<uint32_t>();
+        // Padded in size_t: 0xFFFFFFFF + 1 must not wrap to an empty take
+        if (!in.ok() || size > in.remaining()) break;
+        const uint8_t* body = in.take(size_t(size) + (size & 1));
+        if (!body) break;
+        SpillReader chunk(body, size);
+        
+        if (std::memcmp(id, "fmt ", 4) == 0) {
+            const uint16_t format = chunk.pod<uint16_t>();
+            const uint16_t channels = chunk.pod<uint16_t>();
+            entry->sampleRate = chunk.pod<uint32_t>();
+            chunk.take(6);
+            const uint16_t bits = chunk.pod<uint16_t>();
+            haveFormat = chunk.ok() && format == kWaveFormatFloat && channels == 1 && bits == 32;
+        } else if (std::memcmp(id, "aicr", 4) == 0) {
+            const uint32_t version = chunk.pod<uint32_t>();
+            const uint64_t storedKey = chunk.pod<uint64_t>();
+            entry->scoreKey = chunk.pod<uint64_t>();
+            entry->qualityScore = chunk.pod<double>();
+            const uint32_t meters = chunk.pod<uint32_t>();
+            for (uint32_t i = 0; i < meters && chunk.ok(); ++i) {
+                std::string name = chunk.string();
+                entry->meters[name] = chunk.pod<double>();
+            }
+            const uint32_t warnings = chunk.pod<uint32_t>();
+            for (uint32_t i = 0; i < warnings && chunk.ok(); ++i) {
+                entry->warnings.push_back(chunk.string());
+            }
+            haveResults = chunk.ok() && chunk.atEnd() && version == kSpillVersion && storedKey == key;
+        } else if (std::memcmp(id, "data", 4) == 0) {
+            if (size % sizeof(float)) break;
+            entry->audio.resize(size / sizeof(float));
+            std::memcpy(entry->audio.data(), body, size);
+            haveData = true;
+        }
+    }
+    
+    if (!in.ok() || !haveFormat || !haveResults || !haveData) {
+        return countError();
+    }
+    return entry;
+}
+
+} // namespace aiaudio
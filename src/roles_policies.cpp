@@ -6,6 +6,89 @@
 
 namespace aiaudio {
 
+namespace {
+
+constexpr uint64_t kFNVOffset = 0xcbf29ce484222325ull;
+constexpr uint64_t kFNVPrime = 0x100000001b3ull;
+
+void hashBytes(uint64_t& hash, const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * kFNVPrime;
+    }
+}
+
+// Candidates scored together: their parameter rows stay in L1 while every
+// constraint row runs over the block
+constexpr size_t kScoreBlock = 64;
+
+// The bound stages of a graph (const or not); throws when its topology has
+// changed
+template<typename Graph>
+auto boundStages(const CompiledPolicy& policy, Graph& graph) {
+    std::vector<decltype(graph.getStage(std::string()))> stages;
+    stages.reserve(policy.stageNames.size());
+    for (const auto& name : policy.stageNames) {
+        auto* stage = graph.getStage(name);
+        if (!stage) {
+            throw AIAudioException("Graph does not match the compiled policy: no stage " + name);
+        }
+        stages.push_back(stage);
+    }
+    return stages;
+}
+
+void checkParameterCount(const CompiledPolicy& policy, size_t size) {
+    if (size < policy.numParameters()) {
+        throw AIAudioException("Parameter vector has " + std::to_string(size) + " values, the policy needs " +
+                               std::to_string(policy.numParameters()));
+    }
+}
+
+} // namespace
+
+// CompiledPolicy implementation
+void CompiledPolicy::gatherParameters(const DSPGraph& graph, std::span<double> parameters) const {
+    checkParameterCount(*this, parameters.size());
+    auto stages = boundStages(*this, graph);
+    for (size_t s = 0; s < stages.size(); ++s) {
+        for (uint32_t p = parameterOffsets[s]; p < parameterOffsets[s + 1]; ++p) {
+            parameters[p] = stages[s]->getParameterValue(static_cast<int>(p - parameterOffsets[s]));
+        }
+    }
+}
+
+std::vector<double> CompiledPolicy::gatherParameters(const DSPGraph& graph) const {
+    std::vector<double> parameters(numParameters());
+    gatherParameters(graph, parameters);
+    return parameters;
+}
+
+void CompiledPolicy::scatterParameters(DSPGraph& graph, std::span<const double> parameters) const {
+    checkParameterCount(*this, parameters.size());
+    auto stages = boundStages(*this, graph);
+    for (size_t s = 0; s < stages.size(); ++s) {
+        DSPStage* stage = stages[s];
+        for (uint32_t p = parameterOffsets[s]; p < parameterOffsets[s + 1]; ++p) {
+            stage->setParameterValue(static_cast<int>(p - parameterOffsets[s]), parameters[p]);
+        }
+    }
+}
+
+uint64_t graphTopologyHash(const DSPGraph& graph) {
+    uint64_t hash = kFNVOffset;
+    for (const auto& name : graph.getTopologicalOrder()) {
+        const DSPStage* stage = graph.getStage(name);
+        if (!stage) continue;
+        const auto type = static_cast<uint32_t>(stage->getType());
+        const auto numParameters = static_cast<uint32_t>(stage->getParameterNames().size());
+        hashBytes(hash, name.data(), name.size() + 1);
+        hashBytes(hash, &type, sizeof(type));
+        hashBytes(hash, &numParameters, sizeof(numParameters));
+    }
+    return hash;
+}
+
 // PolicyCompiler implementation
 RolePolicy PolicyCompiler::loadPolicy(const std::string& yamlContent, Role role) {
     YAML::Node root = YAML::Load(yamlContent);
@@ -104,6 +187,47 @@ std::map<std::string, std::pair<double, double>> PolicyCompiler::compileConstrai
     return ranges;
 }
 
+CompiledPolicy PolicyCompiler::compileForGraph(const RolePolicy& policy, const DSPGraph& graph) const {
+    CompiledPolicy compiled;
+    compiled.role = policy.role;
+    compiled.topologyHash = graphTopologyHash(graph);
+    compiled.parameterOffsets.push_back(0);
+    
+    for (const auto& stageName : graph.getTopologicalOrder()) {
+        const DSPStage* stage = graph.getStage(stageName);
+        if (!stage) continue;
+        
+        const auto stageIndex = static_cast<uint32_t>(compiled.stageNames.size());
+        const uint32_t offset = compiled.parameterOffsets.back();
+        for (const auto& [paramName, constraint] : policy.constraints) {
+            // Only numeric parameters the stage declares are constrained
+            int index = stage->getParameterIndex(paramName);
+            if (index < 0 || !std::holds_alternative<double>(stage->getParameter(paramName))) continue;
+            const auto parameter = static_cast<uint32_t>(index);
+            
+            if (constraint.type == ConstraintType::RANGE && constraint.range.size() >= 2) {
+                const double minVal = constraint.range[0];
+                const double maxVal = constraint.range[1];
+                compiled.stage.push_back(stageIndex);
+                compiled.parameter.push_back(parameter);
+                compiled.slot.push_back(offset + parameter);
+                compiled.minValue.push_back(minVal);
+                compiled.maxValue.push_back(maxVal);
+                compiled.penaltyScale.push_back(maxVal > minVal ? constraint.weight / (maxVal - minVal)
+                                                                : constraint.weight);
+            } else if (constraint.type == ConstraintType::CUSTOM && constraint.customValidator) {
+                compiled.customRows.push_back({stageIndex, parameter, offset + parameter,
+                                               constraint.weight, constraint.customValidator});
+            }
+        }
+        
+        compiled.stageNames.push_back(stageName);
+        compiled.parameterOffsets.push_back(offset + static_cast<uint32_t>(stage->getParameterNames().size()));
+    }
+    
+    return compiled;
+}
+
 RolePolicy PolicyCompiler::resolveConflicts(const std::vector<RolePolicy>& policies) const {
     if (policies.empty()) {
         throw AIAudioException("Cannot resolve conflicts: no policies provided");
@@ -208,13 +332,17 @@ std::map<std::string, double> PolicyCompiler::parsePenalties(const YAML::Node& n
 // PolicyEngine implementation
 void PolicyEngine::applyPolicy(DSPGraph& graph, const RolePolicy& policy, 
                               const MusicalContext& context) const {
-    // Apply constraints to all stages
+    // Ranges clamp through the compiled rows, the other kinds go by name
+    applyPolicy(graph, PolicyCompiler().compileForGraph(policy, graph));
+    
     auto stageNames = graph.getStageNames();
     for (const auto& stageName : stageNames) {
         auto* stage = graph.getStage(stageName);
         if (stage) {
             for (const auto& [paramName, constraint] : policy.constraints) {
-                applyConstraint(*stage, constraint);
+                if (constraint.type != ConstraintType::RANGE) {
+                    applyConstraint(*stage, constraint);
+                }
             }
         }
     }
@@ -230,26 +358,7 @@ void PolicyEngine::applyPolicy(DSPGraph& graph, const RolePolicy& policy,
 
 std::vector<std::string> PolicyEngine::checkCompliance(const DSPGraph& graph, 
                                                       const RolePolicy& policy) const {
-    std::vector<std::string> violations;
-    
-    auto stageNames = graph.getStageNames();
-    for (const auto& stageName : stageNames) {
-        auto* stage = graph.getStage(stageName);
-        if (stage) {
-            for (const auto& [paramName, constraint] : policy.constraints) {
-                auto paramValue = stage->getParameter(paramName);
-                if (std::holds_alternative<double>(paramValue)) {
-                    double value = std::get<double>(paramValue);
-                    if (!validateConstraint(constraint, value)) {
-                        violations.push_back("Stage " + stageName + " parameter " + 
-                                           paramName + " violates constraint");
-                    }
-                }
-            }
-        }
-    }
-    
-    return violations;
+    return checkCompliance(graph, PolicyCompiler().compileForGraph(policy, graph));
 }
 
 void PolicyEngine::applyRoleTransformations(DSPGraph& graph, Role role, 
@@ -282,24 +391,108 @@ void PolicyEngine::applyRoleTransformations(DSPGraph& graph, Role role,
 }
 
 double PolicyEngine::computePolicyScore(const DSPGraph& graph, const RolePolicy& policy) const {
-    double score = 1.0;
+    CompiledPolicy compiled = PolicyCompiler().compileForGraph(policy, graph);
+    return computePolicyScore(compiled, compiled.gatherParameters(graph));
+}
+
+void PolicyEngine::applyPolicy(DSPGraph& graph, const CompiledPolicy& policy) const {
+    auto stages = boundStages(policy, graph);
+    for (size_t r = 0; r < policy.numRangeRows(); ++r) {
+        DSPStage* stage = stages[policy.stage[r]];
+        const int parameter = static_cast<int>(policy.parameter[r]);
+        double value = stage->getParameterValue(parameter);
+        double clampedValue = std::clamp(value, policy.minValue[r], policy.maxValue[r]);
+        if (clampedValue != value) {
+            stage->setParameterValue(parameter, clampedValue);
+        }
+    }
+}
+
+std::vector<std::string> PolicyEngine::checkCompliance(const DSPGraph& graph,
+                                                      const CompiledPolicy& policy) const {
+    std::vector<std::string> violations;
+    std::vector<double> values = policy.gatherParameters(graph);
+    
+    auto report = [&](uint32_t stage, uint32_t parameter) {
+        auto names = graph.getStage(policy.stageNames[stage])->getParameterNames();
+        violations.push_back("Stage " + policy.stageNames[stage] + " parameter " +
+                             names[parameter] + " violates constraint");
+    };
+    for (size_t r = 0; r < policy.numRangeRows(); ++r) {
+        double value = values[policy.slot[r]];
+        if (value < policy.minValue[r] || value > policy.maxValue[r]) {
+            report(policy.stage[r], policy.parameter[r]);
+        }
+    }
+    for (const auto& row : policy.customRows) {
+        if (!row.validator(values[row.slot])) {
+            report(row.stage, row.parameter);
+        }
+    }
     
-    auto stageNames = graph.getStageNames();
-    for (const auto& stageName : stageNames) {
-        auto* stage = graph.getStage(stageName);
-        if (stage) {
-            for (const auto& [paramName, constraint] : policy.constraints) {
-                auto paramValue = stage->getParameter(paramName);
-                if (std::holds_alternative<double>(paramValue)) {
-                    double value = std::get<double>(paramValue);
-                    double penalty = computeViolationPenalty(constraint, value);
-                    score *= (1.0 - penalty * constraint.weight);
-                }
+    return violations;
+}
+
+double PolicyEngine::computePolicyScore(const CompiledPolicy& policy, std::span<const double> parameters) const {
+    checkParameterCount(policy, parameters.size());
+    double score = 0.0;
+    computePolicyScores(policy, parameters.first(policy.numParameters()), std::span<double>(&score, 1));
+    return score;
+}
+
+void PolicyEngine::clampParameters(const CompiledPolicy& policy, std::span<double> parameters) const {
+    checkParameterCount(policy, parameters.size());
+    double* values = parameters.data();
+    for (size_t r = 0; r < policy.numRangeRows(); ++r) {
+        values[policy.slot[r]] = std::clamp(values[policy.slot[r]], policy.minValue[r], policy.maxValue[r]);
+    }
+}
+
+void PolicyEngine::computePolicyScores(const CompiledPolicy& policy, std::span<const double> candidates,
+                                       std::span<double> scores) const {
+    const size_t stride = policy.numParameters();
+    if (candidates.size() != scores.size() * stride) {
+        throw AIAudioException("Candidate buffer holds " + std::to_string(candidates.size()) +
+                               " values, expected " + std::to_string(scores.size()) + " x " +
+                               std::to_string(stride));
+    }
+    
+    const size_t numRows = policy.numRangeRows();
+    for (size_t begin = 0; begin < scores.size(); begin += kScoreBlock) {
+        const size_t count = std::min(kScoreBlock, scores.size() - begin);
+        const double* rows = candidates.data() + begin * stride;
+        double* out = scores.data() + begin;
+        std::fill(out, out + count, 1.0);
+        
+        // One constraint across the block per pass: no branches, and the
+        // candidates are independent, so the inner loop vectorizes
+        for (size_t r = 0; r < numRows; ++r) {
+            const double* values = rows + policy.slot[r];
+            const double minVal = policy.minValue[r];
+            const double maxVal = policy.maxValue[r];
+            const double scale = policy.penaltyScale[r];
+            for (size_t c = 0; c < count; ++c) {
+                double value = values[c * stride];
+                double excess = std::max(minVal - value, 0.0) + std::max(value - maxVal, 0.0);
+                out[c] *= std::max(0.0, 1.0 - excess * scale);
+            }
+        }
+        
+        for (const auto& row : policy.customRows) {
+            const double factor = std::max(0.0, 1.0 - row.weight);
+            for (size_t c = 0; c < count; ++c) {
+                if (!row.validator(rows[c * stride + row.slot])) out[c] *= factor;
             }
         }
     }
-    
-    return std::max(0.0, score);
+}
+
+std::vector<double> PolicyEngine::computePolicyScores(const CompiledPolicy& policy,
+                                                      std::span<const double> candidates) const {
+    const size_t stride = policy.numParameters();
+    std::vector<double> scores(stride == 0 ? 0 : candidates.size() / stride);
+    computePolicyScores(policy, candidates, scores);
+    return scores;
 }
 
 std::vector<std::string> PolicyEngine::getRecommendations(const DSPGraph& graph, 
@@ -356,7 +549,7 @@ void PolicyEngine::applyBassTransformations(DSPGraph& graph, const MusicalContex
         auto* stage = graph.getStage(stageName);
         if (stage) {
             // Set bass-appropriate parameters
-            if (stage->getType() == StageType::OSCILLATOR) {
+            if (isOscillatorType(stage->getType())) {
                 stage->setParameter("frequency", 100.0);
                 stage->setParameter("amplitude", 0.8);
             }
@@ -375,7 +568,7 @@ void PolicyEngine::applyLeadTransformations(DSPGraph& graph, const MusicalContex
         auto* stage = graph.getStage(stageName);
         if (stage) {
             // Set lead-appropriate parameters
-            if (stage->getType() == StageType::OSCILLATOR) {
+            if (isOscillatorType(stage->getType())) {
                 stage->setParameter("frequency", 1000.0);
                 stage->setParameter("amplitude", 0.9);
             }
@@ -507,7 +700,7 @@ void PolicyEngine::adjustForKey(DSPGraph& graph, const MusicalContext& context)
     for (const auto& stageName : stageNames) {
         auto* stage = graph.getStage(stageName);
         if (stage) {
-            if (stage->getType() == StageType::OSCILLATOR) {
+            if (isOscillatorType(stage->getType())) {
                 auto freq = stage->getParameter("frequency");
                 if (std::holds_alternative<double>(freq)) {
                     double currentFreq = std::get<double>(freq);
@@ -578,6 +771,21 @@ const RolePolicy* PolicyManager::getPolicy(Role role) const {
     return (it != policies_.end()) ? &it->second : nullptr;
 }
 
+std::shared_ptr<const CompiledPolicy> PolicyManager::getCompiledPolicy(Role role, const DSPGraph& graph) const {
+    auto it = policies_.find(role);
+    if (it == policies_.end()) return nullptr;
+    
+    uint64_t key = graphTopologyHash(graph);
+    hashBytes(key, &role, sizeof(role));
+    if (auto cached = compiled_.get(key)) {
+        return *cached;
+    }
+    
+    auto compiled = std::make_shared<const CompiledPolicy>(compiler_.compileForGraph(it->second, graph));
+    compiled_.put(key, compiled);
+    return compiled;
+}
+
 std::vector<RolePolicy> PolicyManager::getAllPolicies() const {
     std::vector<RolePolicy> result;
     for (const auto& [role, policy] : policies_) {
@@ -588,10 +796,12 @@ std::vector<RolePolicy> PolicyManager::getAllPolicies() const {
 
 void PolicyManager::updatePolicy(const RolePolicy& policy) {
     policies_[policy.role] = policy;
+    compiled_.clear();
 }
 
 void PolicyManager::removePolicy(Role role) {
     policies_.erase(role);
+    compiled_.clear();
 }
 
 std::vector<std::string> PolicyManager::getConflicts() const {
@@ -618,6 +828,7 @@ void PolicyManager::resolveAllConflicts() {
     for (const auto& policy : allPolicies) {
         policies_[policy.role] = resolved;
     }
+    compiled_.clear();
 }
 
 std::string PolicyManager::exportPoliciesToYAML() const {
@@ -1,8 +1,16 @@
 #include "semantic_fusion.h"
+#include "simd_kernels.h"
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <iomanip>
 #include <random>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <cstdio>
+#include <cctype>
 
 namespace aiaudio {
 
@@ -216,9 +224,8 @@ EmbeddingVector SemanticFusionEngine::averageEmbeddings(const std::vector<Embedd
 }
 
 double SemanticFusionEngine::computeIDF(const std::string& tag) const {
-    // Simplified IDF computation
-    // In practice, would need document frequency statistics
-    return 1.0;
+    if (!termStatistics_) return 1.0;
+    return termStatistics_->idf(InvertedIndex::normalizeTag(tag), InvertedIndex::Field::TAG);
 }
 
 std::vector<std::string> SemanticFusionEngine::tokenize(const std::string& text) const {
@@ -282,28 +289,218 @@ EmbeddingVector EntryVectorBuilder::processForRole(const EmbeddingVector& vector
 }
 
 // SemanticSearchEngine implementation
+namespace {
+
+// Unit-length float copy of v in out[0, dimension), zero-padded
+void toUnitFloats(const EmbeddingVector& v, float* out, size_t dimension) {
+    size_t n = std::min(v.size(), dimension);
+    double norm = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        norm += v[i] * v[i];
+    }
+    double scale = norm > 0.0 ? 1.0 / std::sqrt(norm) : 0.0;
+    
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<float>(v[i] * scale);
+    }
+    std::fill(out + n, out + dimension, 0.0f);
+}
+
+// On-disk index, version 1, host byte order (little-endian on every
+// supported target):
+//   IndexFileHeader
+//   vectors     rows x dimension float32, 64-byte aligned for direct use
+//   roles       rows x uint8
+//   partitions  per role: uint64 count, count x uint32 row
+//   records     per row: key, entry id, description, tags, metadata
+// Strings are a uint32 length and the bytes. The checksum covers every byte
+// after the header.
+static_assert(std::endian::native == std::endian::little, "index files are little-endian");
+
+constexpr char kIndexMagic[8] = {'A', 'I', 'A', 'I', 'D', 'X', '\0', '\0'};
+constexpr uint32_t kIndexVersion = 1;
+constexpr size_t kVectorAlignment = 64;
+constexpr size_t kNumRoles = static_cast<size_t>(Role::UNKNOWN) + 1;
+
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dimension;
+    uint64_t rows;
+    uint64_t fileSize;
+    uint64_t checksum;
+    uint64_t vectorsOffset;
+    uint64_t rolesOffset;
+    uint64_t partitionsOffset;
+    uint64_t recordsOffset;
+    char modelId[64];
+};
+static_assert(std::is_trivially_copyable_v<IndexFileHeader>);
+
+// FNV-1a over 64-bit words: fast enough to verify a large file at open
+uint64_t indexChecksum(const uint8_t* data, size_t size) {
+    constexpr uint64_t kPrime = 0x100000001b3ull;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * kPrime;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * kPrime;
+    }
+    return hash;
+}
+
+class IndexWriter {
+public:
+    void put(const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        buffer_.insert(buffer_.end(), bytes, bytes + size);
+    }
+    
+    template<typename T>
+    void pod(T value) { put(&value, sizeof(value)); }
+    
+    void string(const std::string& value) {
+        pod(static_cast<uint32_t>(value.size()));
+        put(value.data(), value.size());
+    }
+    
+    void align(size_t alignment) {
+        buffer_.resize((buffer_.size() + alignment - 1) / alignment * alignment, 0);
+    }
+    
+    size_t size() const { return buffer_.size(); }
+    std::vector<uint8_t>& bytes() { return buffer_; }
+    
+private:
+    std::vector<uint8_t> buffer_;
+};
+
+// Lower case, single spaces, no leading or trailing whitespace
+std::string normalizeText(const std::string& text) {
+    std::string result;
+    result.reserve(text.size());
+    bool pendingSpace = false;
+    for (unsigned char c : text) {
+        if (std::isspace(c)) {
+            pendingSpace = !result.empty();
+            continue;
+        }
+        if (pendingSpace) result.push_back(' ');
+        pendingSpace = false;
+        result.push_back(static_cast<char>(std::tolower(c)));
+    }
+    return result;
+}
+
+std::vector<std::string> normalizeTags(const std::vector<std::string>& tags) {
+    std::vector<std::string> result;
+    result.reserve(tags.size());
+    for (const auto& tag : tags) {
+        result.push_back(normalizeText(tag));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+[[noreturn]] void rejectIndex(const std::string& path, const std::string& reason) {
+    throw AIAudioException("Invalid index file " + path + ": " + reason);
+}
+
+// Bounds-checked reads from the mapped file
+class IndexReader {
+public:
+    IndexReader(const MappedFile& file, uint64_t offset)
+        : file_(file), pos_(offset) {
+        if (offset > file.size()) rejectIndex(file.getPath(), "section offset out of range");
+    }
+    
+    template<typename T>
+    T pod() {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+    
+    std::string string() {
+        uint32_t length = pod<uint32_t>();
+        const uint8_t* data = take(length);
+        return std::string(reinterpret_cast<const char*>(data), length);
+    }
+    
+private:
+    const MappedFile& file_;
+    uint64_t pos_;
+    
+    const uint8_t* take(size_t size) {
+        if (size > file_.size() - pos_) rejectIndex(file_.getPath(), "truncated section");
+        const uint8_t* data = file_.data() + pos_;
+        pos_ += size;
+        return data;
+    }
+};
+
+} // namespace
+
+// CanonicalQuery implementation
+CanonicalQuery CanonicalQuery::make(const std::string& prompt,
+                                    Role role,
+                                    const std::vector<std::string>& positiveTags,
+                                    const std::vector<std::string>& negativeTags) {
+    CanonicalQuery query;
+    query.prompt = normalizeText(prompt);
+    query.role = role;
+    query.positiveTags = normalizeTags(positiveTags);
+    query.negativeTags = normalizeTags(negativeTags);
+    return query;
+}
+
+std::string CanonicalQuery::hash() const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](const std::string& text) {
+        for (unsigned char c : text) {
+            hash = (hash ^ c) * 0x100000001b3ull;
+        }
+        // Separator, so field boundaries cannot shift
+        hash = (hash ^ 0x1f) * 0x100000001b3ull;
+    };
+    
+    mix(prompt);
+    mix(std::to_string(static_cast<int>(role)));
+    for (const auto& tag : positiveTags) mix("+" + tag);
+    for (const auto& tag : negativeTags) mix("-" + tag);
+    
+    char digits[17];
+    std::snprintf(digits, sizeof(digits), "%016llx", static_cast<unsigned long long>(hash));
+    return digits;
+}
+
+std::string computeQueryHash(const std::string& prompt,
+                             Role role,
+                             const std::vector<std::string>& positiveTags,
+                             const std::vector<std::string>& negativeTags) {
+    return CanonicalQuery::make(prompt, role, positiveTags, negativeTags).hash();
+}
+
 SemanticSearchEngine::SemanticSearchEngine(std::unique_ptr<SemanticFusionEngine> engine)
-    : fusionEngine_(std::move(engine)) {
+    : fusionEngine_(std::move(engine)),
+      dimension_(fusionEngine_->getEmbedding().getDimension()) {
+    fusionEngine_->setTermStatistics(&keywordIndex_);
 }
 
 void SemanticSearchEngine::addEntry(const EntryVectorBuilder::EntryData& data) {
     entries_[data.id] = data;
-    entryVectors_[data.id] = fusionEngine_->processEntry(data.tags, data.description);
+    keywordIndex_.add(data.id, data.role, data.tags, data.description);
+    storeRow(data.id, data.role, fusionEngine_->processEntry(data.tags, data.description));
 }
 
 std::vector<SemanticSearchEngine::SearchResult> SemanticSearchEngine::search(const std::string& query,
                                                                             Role role,
                                                                             size_t maxResults) const {
-    EmbeddingVector queryVec = fusionEngine_->embedding_->encode(query);
-    
-    std::vector<std::string> entryIds;
-    for (const auto& [id, data] : entries_) {
-        if (role == Role::UNKNOWN || data.role == role) {
-            entryIds.push_back(id);
-        }
-    }
-    
-    return rankResults(entryIds, queryVec, role);
+    return searchCanonical(CanonicalQuery::make(query, role), maxResults);
 }
 
 std::vector<SemanticSearchEngine::SearchResult> SemanticSearchEngine::searchContrastive(
@@ -313,16 +510,66 @@ std::vector<SemanticSearchEngine::SearchResult> SemanticSearchEngine::searchCont
     Role role,
     size_t maxResults) const {
     
-    EmbeddingVector queryVec = fusionEngine_->composeContrastive(query, positiveTags, negativeTags);
+    return searchCanonical(CanonicalQuery::make(query, role, positiveTags, negativeTags), maxResults);
+}
+
+std::vector<SemanticSearchEngine::SearchResult> SemanticSearchEngine::searchCanonical(
+    const CanonicalQuery& query,
+    size_t maxResults) const {
     
-    std::vector<std::string> entryIds;
-    for (const auto& [id, data] : entries_) {
-        if (role == Role::UNKNOWN || data.role == role) {
-            entryIds.push_back(id);
-        }
+    // Result lists depend on role and k and are only valid for the index
+    // generation they were ranked against
+    std::string resultKey = query.hash() + "/" + std::to_string(maxResults);
+    const uint64_t generation = generation_;
+    auto cached = resultCache_.getIf(resultKey, [generation](const CachedResults& entry) {
+        return entry.generation == generation;
+    });
+    if (cached) return std::move(cached->results);
+    
+    auto results = rankResults(queryVector(query), query.role, maxResults);
+    resultCache_.put(resultKey, CachedResults{generation, results});
+    return results;
+}
+
+EmbeddingVector SemanticSearchEngine::queryVector(const CanonicalQuery& query) const {
+    // The query vector depends on neither role nor k
+    CanonicalQuery vectorQuery = query;
+    vectorQuery.role = Role::UNKNOWN;
+    std::string vectorKey = vectorQuery.hash();
+    
+    if (auto cachedVector = vectorCache_.get(vectorKey)) {
+        return std::move(*cachedVector);
+    }
+    bool contrastive = !query.positiveTags.empty() || !query.negativeTags.empty();
+    EmbeddingVector queryVec = contrastive
+        ? fusionEngine_->composeContrastive(query.prompt, query.positiveTags, query.negativeTags)
+        : fusionEngine_->getEmbedding().encode(query.prompt);
+    vectorCache_.put(vectorKey, queryVec);
+    return queryVec;
+}
+
+std::vector<SemanticSearchEngine::SearchResult> SemanticSearchEngine::searchFiltered(
+    const std::string& query,
+    const InvertedIndex::Query& filter,
+    size_t maxResults) const {
+    
+    // Filtered lists are not cached: the prefilter is cheaper than keying them
+    std::vector<InvertedIndex::DocId> docs;
+    keywordIndex_.match(filter, docs);
+    if (docs.empty() || maxResults == 0) return {};
+    
+    std::vector<size_t> rows;
+    rows.reserve(docs.size());
+    for (InvertedIndex::DocId doc : docs) {
+        auto it = rowOf_.find(keywordIndex_.key(doc));
+        if (it != rowOf_.end()) rows.push_back(it->second);
     }
     
-    return rankResults(entryIds, queryVec, role);
+    return rankResults(queryVector(CanonicalQuery::make(query, filter.role)), filter.role, maxResults, &rows);
+}
+
+std::vector<std::string> SemanticSearchEngine::searchKeywords(const std::string& text, Role role) const {
+    return keywordIndex_.searchText(text, role);
 }
 
 std::string SemanticSearchEngine::explainResult(const SearchResult& result) const {
@@ -341,55 +588,382 @@ std::string SemanticSearchEngine::explainResult(const SearchResult& result) cons
 
 void SemanticSearchEngine::updateEntry(const std::string& entryId, const EntryVectorBuilder::EntryData& data) {
     entries_[entryId] = data;
-    entryVectors_[entryId] = fusionEngine_->processEntry(data.tags, data.description);
+    keywordIndex_.add(entryId, data.role, data.tags, data.description);
+    storeRow(entryId, data.role, fusionEngine_->processEntry(data.tags, data.description));
 }
 
 void SemanticSearchEngine::removeEntry(const std::string& entryId) {
     entries_.erase(entryId);
-    entryVectors_.erase(entryId);
+    keywordIndex_.remove(entryId);
+    eraseRow(entryId);
 }
 
 void SemanticSearchEngine::clear() {
     entries_.clear();
-    entryVectors_.clear();
+    keywordIndex_.clear();
+    vectors_.clear();
+    mapped_.reset();
+    mappedVectors_ = nullptr;
+    rowIds_.clear();
+    rowRoles_.clear();
+    rowOf_.clear();
+    rolePartitions_.clear();
+    if (annIndex_) annIndex_->clear();
+    ++generation_;
 }
 
 size_t SemanticSearchEngine::getEntryCount() const {
     return entries_.size();
 }
 
+void SemanticSearchEngine::saveIndex(const std::string& path) const {
+    const std::string modelId = fusionEngine_->getEmbedding().getModelId();
+    if (modelId.size() >= sizeof(IndexFileHeader::modelId)) {
+        throw AIAudioException("Embedding model id too long for index file: " + modelId);
+    }
+    if (rowIds_.size() > UINT32_MAX) {
+        throw AIAudioException("Too many entries for index file: " + std::to_string(rowIds_.size()));
+    }
+    
+    IndexFileHeader header{};
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    std::memcpy(header.modelId, modelId.data(), modelId.size());
+    header.version = kIndexVersion;
+    header.dimension = static_cast<uint32_t>(dimension_);
+    header.rows = rowIds_.size();
+    
+    IndexWriter out;
+    out.put(&header, sizeof(header));
+    
+    out.align(kVectorAlignment);
+    header.vectorsOffset = out.size();
+    out.put(rowData(), rowIds_.size() * dimension_ * sizeof(float));
+    
+    header.rolesOffset = out.size();
+    for (Role role : rowRoles_) {
+        out.pod(static_cast<uint8_t>(role));
+    }
+    
+    header.partitionsOffset = out.size();
+    for (size_t r = 0; r < kNumRoles; ++r) {
+        auto it = rolePartitions_.find(static_cast<Role>(r));
+        uint64_t count = it != rolePartitions_.end() ? it->second.size() : 0;
+        out.pod(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            out.pod(static_cast<uint32_t>(it->second[i]));
+        }
+    }
+    
+    header.recordsOffset = out.size();
+    for (const auto& rowId : rowIds_) {
+        const auto& data = entries_.at(rowId);
+        out.string(rowId);
+        out.string(data.id);
+        out.string(data.description);
+        out.pod(static_cast<uint32_t>(data.tags.size()));
+        for (const auto& tag : data.tags) {
+            out.string(tag);
+        }
+        out.pod(static_cast<uint32_t>(data.metadata.size()));
+        for (const auto& [key, value] : data.metadata) {
+            out.string(key);
+            out.pod(value);
+        }
+    }
+    
+    header.fileSize = out.size();
+    header.checksum = indexChecksum(out.bytes().data() + sizeof(header), out.size() - sizeof(header));
+    std::memcpy(out.bytes().data(), &header, sizeof(header));
+    
+    // Write aside and rename, so processes still mapping the old file keep
+    // a consistent view
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw AIAudioException("Could not write index file: " + tempPath);
+        }
+        file.write(reinterpret_cast<const char*>(out.bytes().data()), out.size());
+        if (!file) {
+            throw AIAudioException("Could not write index file: " + tempPath);
+        }
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        throw AIAudioException("Could not replace index file: " + path);
+    }
+}
+
+void SemanticSearchEngine::loadIndex(const std::string& path) {
+    auto file = std::make_unique<MappedFile>(path);
+    
+    IndexFileHeader header;
+    if (file->size() < sizeof(header)) rejectIndex(path, "truncated header");
+    std::memcpy(&header, file->data(), sizeof(header));
+    
+    if (std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+        rejectIndex(path, "not an index file");
+    }
+    if (header.version != kIndexVersion) {
+        rejectIndex(path, "unsupported version " + std::to_string(header.version));
+    }
+    
+    // A different model or dimension would load fine and score badly
+    std::string modelId(header.modelId, strnlen(header.modelId, sizeof(header.modelId)));
+    std::string expectedModel = fusionEngine_->getEmbedding().getModelId();
+    if (modelId != expectedModel) {
+        rejectIndex(path, "built with embedding model '" + modelId + "', expected '" + expectedModel + "'");
+    }
+    if (header.dimension != dimension_) {
+        rejectIndex(path, "dimension " + std::to_string(header.dimension) +
+                    ", expected " + std::to_string(dimension_));
+    }
+    
+    if (header.fileSize != file->size()) rejectIndex(path, "size mismatch");
+    if (indexChecksum(file->data() + sizeof(header), file->size() - sizeof(header)) != header.checksum) {
+        rejectIndex(path, "checksum mismatch");
+    }
+    
+    const size_t rows = header.rows;
+    const size_t rowBytes = dimension_ * sizeof(float);
+    if (header.vectorsOffset % kVectorAlignment != 0 ||
+        header.vectorsOffset > file->size() ||
+        (rowBytes > 0 && rows > (file->size() - header.vectorsOffset) / rowBytes)) {
+        rejectIndex(path, "vector section out of range");
+    }
+    
+    // Parse into locals so a bad file leaves the current index untouched
+    std::vector<Role> roles(rows);
+    IndexReader roleReader(*file, header.rolesOffset);
+    for (auto& role : roles) {
+        uint8_t value = roleReader.pod<uint8_t>();
+        if (value >= kNumRoles) rejectIndex(path, "invalid role");
+        role = static_cast<Role>(value);
+    }
+    
+    std::map<Role, std::vector<size_t>> partitions;
+    IndexReader partitionReader(*file, header.partitionsOffset);
+    for (size_t r = 0; r < kNumRoles; ++r) {
+        uint64_t count = partitionReader.pod<uint64_t>();
+        if (count > rows) rejectIndex(path, "invalid role partition");
+        if (count == 0) continue;
+        
+        auto& partition = partitions[static_cast<Role>(r)];
+        partition.resize(count);
+        for (auto& row : partition) {
+            row = partitionReader.pod<uint32_t>();
+            if (row >= rows || roles[row] != static_cast<Role>(r)) {
+                rejectIndex(path, "invalid role partition");
+            }
+        }
+    }
+    
+    std::vector<std::string> ids(rows);
+    std::unordered_map<std::string, size_t> rowOf;
+    std::map<std::string, EntryVectorBuilder::EntryData> entries;
+    IndexReader recordReader(*file, header.recordsOffset);
+    for (size_t row = 0; row < rows; ++row) {
+        ids[row] = recordReader.string();
+        if (!rowOf.emplace(ids[row], row).second) rejectIndex(path, "duplicate entry " + ids[row]);
+        
+        EntryVectorBuilder::EntryData data;
+        data.id = recordReader.string();
+        data.description = recordReader.string();
+        data.role = roles[row];
+        data.tags.resize(recordReader.pod<uint32_t>());
+        for (auto& tag : data.tags) {
+            tag = recordReader.string();
+        }
+        uint32_t metadataCount = recordReader.pod<uint32_t>();
+        for (uint32_t i = 0; i < metadataCount; ++i) {
+            std::string key = recordReader.string();
+            data.metadata[key] = recordReader.pod<double>();
+        }
+        entries.emplace(ids[row], std::move(data));
+    }
+    
+    clear();
+    entries_ = std::move(entries);
+    for (const auto& [id, data] : entries_) {
+        keywordIndex_.add(id, data.role, data.tags, data.description);
+    }
+    rowIds_ = std::move(ids);
+    rowRoles_ = std::move(roles);
+    rowOf_ = std::move(rowOf);
+    rolePartitions_ = std::move(partitions);
+    mappedVectors_ = reinterpret_cast<const float*>(file->data() + header.vectorsOffset);
+    mapped_ = std::move(file);
+    
+    if (annIndex_) annIndex_->rebuild(matrixView());
+}
+
+void SemanticSearchEngine::setANNIndex(std::unique_ptr<ANNIndex> index) {
+    annIndex_ = std::move(index);
+    if (annIndex_) annIndex_->rebuild(matrixView());
+    ++generation_;
+}
+
+void SemanticSearchEngine::tuneANNIndex(const std::function<void(ANNIndex&)>& tune) {
+    if (!annIndex_) return;
+    tune(*annIndex_);
+    ++generation_;
+}
+
+void SemanticSearchEngine::setQueryCacheCapacity(size_t capacity) {
+    vectorCache_.setCapacity(capacity);
+    resultCache_.setCapacity(capacity);
+}
+
+void SemanticSearchEngine::clearQueryCache() {
+    vectorCache_.clear();
+    resultCache_.clear();
+}
+
+VectorMatrixView SemanticSearchEngine::matrixView() const {
+    return VectorMatrixView{rowData(), rowRoles_.data(), rowIds_.size(), dimension_};
+}
+
+void SemanticSearchEngine::detachMapping() {
+    if (!mapped_) return;
+    
+    // Copy-on-write: the mapping is read-only and shared with other processes
+    vectors_.assign(mappedVectors_, mappedVectors_ + rowIds_.size() * dimension_);
+    mapped_.reset();
+    mappedVectors_ = nullptr;
+}
+
+void SemanticSearchEngine::storeRow(const std::string& entryId, Role role, const EmbeddingVector& vector) {
+    detachMapping();
+    
+    auto it = rowOf_.find(entryId);
+    if (it != rowOf_.end() && rowRoles_[it->second] != role) {
+        // Role changed: move the entry to its new partition
+        eraseRow(entryId);
+        it = rowOf_.end();
+    }
+    
+    size_t row;
+    if (it == rowOf_.end()) {
+        row = rowIds_.size();
+        rowIds_.push_back(entryId);
+        rowRoles_.push_back(role);
+        vectors_.resize(vectors_.size() + dimension_);
+        rowOf_[entryId] = row;
+        rolePartitions_[role].push_back(row);
+    } else {
+        row = it->second;
+    }
+    
+    // Stored normalised so scoring needs no norms
+    toUnitFloats(vector, vectors_.data() + row * dimension_, dimension_);
+    if (annIndex_) annIndex_->insert(matrixView(), row);
+    ++generation_;
+}
+
+void SemanticSearchEngine::eraseRow(const std::string& entryId) {
+    auto it = rowOf_.find(entryId);
+    if (it == rowOf_.end()) return;
+    detachMapping();
+    
+    size_t row = it->second;
+    size_t last = rowIds_.size() - 1;
+    rowOf_.erase(it);
+    
+    auto& partition = rolePartitions_[rowRoles_[row]];
+    partition.erase(std::find(partition.begin(), partition.end(), row));
+    if (annIndex_) annIndex_->erase(row);
+    
+    // Fill the hole with the last row to keep the matrix dense
+    if (row != last) {
+        std::copy_n(vectors_.data() + last * dimension_, dimension_, vectors_.data() + row * dimension_);
+        rowIds_[row] = std::move(rowIds_[last]);
+        rowRoles_[row] = rowRoles_[last];
+        rowOf_[rowIds_[row]] = row;
+        
+        auto& moved = rolePartitions_[rowRoles_[row]];
+        *std::find(moved.begin(), moved.end(), last) = row;
+        if (annIndex_) annIndex_->renumber(last, row);
+    }
+    
+    rowIds_.pop_back();
+    rowRoles_.pop_back();
+    vectors_.resize(last * dimension_);
+    ++generation_;
+}
+
 std::vector<SemanticSearchEngine::SearchResult> SemanticSearchEngine::rankResults(
-    const std::vector<std::string>& entryIds,
     const EmbeddingVector& queryVector,
-    Role role) const {
+    Role role,
+    size_t maxResults,
+    const std::vector<size_t>* rows) const {
     
-    std::vector<SearchResult> results;
+    if (maxResults == 0 || rowIds_.empty()) return {};
     
-    for (const auto& entryId : entryIds) {
-        auto it = entryVectors_.find(entryId);
-        if (it != entryVectors_.end()) {
-            SearchResult result;
-            result.entryId = entryId;
-            result.score = fusionEngine_->semanticScore(queryVector, it->second);
-            result.confidence = result.score; // Simplified
-            result.matchingTags = {}; // Would be populated with actual matching tags
-            result.explanation = generateExplanation(result, queryVector);
-            
-            results.push_back(result);
+    const std::vector<size_t>* partition = rows;
+    if (!partition && role != Role::UNKNOWN) {
+        auto it = rolePartitions_.find(role);
+        if (it == rolePartitions_.end()) return {};
+        partition = &it->second;
+    }
+    
+    std::vector<float> query(dimension_);
+    toUnitFloats(queryVector, query.data(), dimension_);
+    const auto dot = getActiveKernels().dotProduct;
+    
+    // The ANN backend only narrows the rows to score
+    std::vector<size_t> candidates;
+    if (annIndex_ && !rows) {
+        annIndex_->collectCandidates(matrixView(), query.data(), role, maxResults, candidates);
+        partition = &candidates;
+    }
+    
+    // Higher score first, ties by id so results are deterministic
+    using Hit = std::pair<float, size_t>;
+    auto better = [this](const Hit& a, const Hit& b) {
+        if (a.first != b.first) return a.first > b.first;
+        return rowIds_[a.second] < rowIds_[b.second];
+    };
+    
+    // Bounded heap of the best maxResults hits, worst on top
+    std::vector<Hit> heap;
+    heap.reserve(std::min(maxResults, rowIds_.size()));
+    auto score = [&](size_t row) {
+        float similarity = dot(query.data(), rowData() + row * dimension_, dimension_);
+        Hit hit{std::clamp(similarity, 0.0f, 1.0f), row};
+        if (heap.size() < maxResults) {
+            heap.push_back(hit);
+            std::push_heap(heap.begin(), heap.end(), better);
+        } else if (better(hit, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = hit;
+            std::push_heap(heap.begin(), heap.end(), better);
         }
+    };
+    
+    if (partition) {
+        for (size_t row : *partition) score(row);
+    } else {
+        for (size_t row = 0; row < rowIds_.size(); ++row) score(row);
     }
+    std::sort_heap(heap.begin(), heap.end(), better);
     
-    // Sort by score (descending)
-    std::sort(results.begin(), results.end(),
-              [](const SearchResult& a, const SearchResult& b) {
-                  return a.score > b.score;
-              });
+    // Explanations only for the hits that are returned
+    std::vector<SearchResult> results;
+    results.reserve(heap.size());
+    for (const auto& [similarity, row] : heap) {
+        SearchResult result;
+        result.entryId = rowIds_[row];
+        result.score = similarity;
+        result.confidence = result.score; // Simplified
+        result.matchingTags = {}; // Would be populated with actual matching tags
+        result.explanation = generateExplanation(result);
+        results.push_back(std::move(result));
+    }
     
     return results;
 }
 
-std::string SemanticSearchEngine::generateExplanation(const SearchResult& result,
-                                                     const EmbeddingVector& queryVector) const {
+std::string SemanticSearchEngine::generateExplanation(const SearchResult& result) const {
     // Generate human-readable explanation
     std::stringstream explanation;
     explanation << "This entry matches your query with a semantic similarity of " 
@@ -443,6 +1017,10 @@ double AdvancedSemanticFeatures::computeIDFWeight(const std::string& term,
     return std::log(static_cast<double>(totalDocuments) / docFreq);
 }
 
+double AdvancedSemanticFeatures::computeIDFWeight(const std::string& term, const InvertedIndex& index) {
+    return index.idf(InvertedIndex::normalizeTag(term), InvertedIndex::Field::TERM);
+}
+
 std::vector<std::vector<std::string>> AdvancedSemanticFeatures::clusterTags(
     const std::vector<std::string>& tags,
     const SemanticEmbedding& embedding,
@@ -533,7 +1111,7 @@ bool SemanticTester::testSemanticConsistency(const SemanticFusionEngine& engine)
     
     std::vector<EmbeddingVector> queryVectors;
     for (const auto& query : similarQueries) {
-        queryVectors.push_back(engine.embedding_->encode(query));
+        queryVectors.push_back(engine.getEmbedding().encode(query));
     }
     
     double consistency = computeSemanticConsistency(queryVectors);
@@ -0,0 +1,1034 @@
+#include "simd_kernels.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AIAUDIO_SIMD_X86 1
+#include <immintrin.h>
+#define AIAUDIO_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define AIAUDIO_TARGET_AVXVNNI __attribute__((target("avx2,fma,avxvnni")))
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define AIAUDIO_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace aiaudio {
+
+namespace {
+
+constexpr double kTwoPi = 2.0 * M_PI;
+constexpr float kPiF = static_cast<float>(M_PI);
+
+// Taylor coefficients for sin(x), x in [0, pi/2]
+constexpr float kSinC3 = -1.0f / 6.0f;
+constexpr float kSinC5 = 1.0f / 120.0f;
+constexpr float kSinC7 = -1.0f / 5040.0f;
+constexpr float kSinC9 = 1.0f / 362880.0f;
+
+// IEEE-754 single precision fields for the sampleStats bit tests
+constexpr uint32_t kFloatExponentMask = 0x7f800000u;
+constexpr uint32_t kFloatMagnitudeMask = 0x7fffffffu;
+
+// Samples between flushes of the vector kernels' 32-bit lane counters
+constexpr size_t kStatsCountChunk = size_t(1) << 24;
+
+double wrapPhase(double phase) {
+    return phase - kTwoPi * std::floor(phase / kTwoPi);
+}
+
+// Wrap to [-pi, pi); vector kernels add lane offsets to this base
+double wrapSigned(double phase) {
+    return phase - kTwoPi * std::floor((phase + M_PI) / kTwoPi);
+}
+
+// sin(x) for x in [-pi, pi] via sin(x) = sign(x) * sin(min(|x|, pi - |x|))
+float polySin(float x) {
+    float a = std::fabs(x);
+    a = std::min(a, kPiF - a);
+    float a2 = a * a;
+    float p = a * (1.0f + a2 * (kSinC3 + a2 * (kSinC5 + a2 * (kSinC7 + a2 * kSinC9))));
+    return std::copysign(p, x);
+}
+
+// Polynomial tail shared by the vector kernels so every lane matches
+void sineTail(const Sample* in, Sample* out, size_t n,
+              double& phase, double increment, double phaseOffset, double amplitude) {
+    for (size_t i = 0; i < n; ++i) {
+        float x = static_cast<float>(wrapSigned(phase + phaseOffset));
+        out[i] = static_cast<Sample>(amplitude * polySin(x)) + in[i];
+        phase = wrapPhase(phase + increment);
+    }
+}
+
+void biquadScalarChannel(const Sample* in, Sample* out, size_t n,
+                         const BiquadCoefficients& k, BiquadState& s) {
+    for (size_t i = 0; i < n; ++i) {
+        double x = in[i];
+        double y = k.b0 * x + k.b1 * s.x1 + k.b2 * s.x2 - k.a1 * s.y1 - k.a2 * s.y2;
+        s.x2 = s.x1;
+        s.x1 = x;
+        s.y2 = s.y1;
+        s.y1 = y;
+        out[i] = static_cast<Sample>(y);
+    }
+}
+
+// ---------------------------------------------------------------- scalar
+
+void sineOscillatorScalar(const Sample* in, Sample* out, size_t n,
+                          double& phase, double increment,
+                          double phaseOffset, double amplitude) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<Sample>(amplitude * std::sin(phase + phaseOffset)) + in[i];
+        phase += increment;
+        if (phase >= kTwoPi) phase -= kTwoPi;
+    }
+}
+
+void biquadScalar(const Sample* const* in, Sample* const* out,
+                  size_t numChannels, size_t n,
+                  const BiquadCoefficients& k, BiquadState* state) {
+    for (size_t ch = 0; ch < numChannels; ++ch) {
+        biquadScalarChannel(in[ch], out[ch], n, k, state[ch]);
+    }
+}
+
+void applyGainScalar(Sample* data, size_t n, Sample gain) {
+    for (size_t i = 0; i < n; ++i) data[i] *= gain;
+}
+
+void clampSymmetricScalar(Sample* data, size_t n, Sample limit) {
+    for (size_t i = 0; i < n; ++i) data[i] = std::clamp(data[i], -limit, limit);
+}
+
+Sample peakAbsScalar(const Sample* data, size_t n) {
+    Sample peak = 0.0f;
+    for (size_t i = 0; i < n; ++i) peak = std::max(peak, std::fabs(data[i]));
+    return peak;
+}
+
+double sumSquaresScalar(const Sample* data, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) sum += static_cast<double>(data[i]) * data[i];
+    return sum;
+}
+
+// Adds data[begin, end) to out. Indices count from data, so vector kernels
+// can finish their tail here; the first crossing test looks at data[begin - 1].
+// Non-finite samples count as zero for the crossing test.
+void sampleStatsRange(const Sample* data, size_t begin, size_t end,
+                      Sample silenceThreshold, SampleStats& out) {
+    auto isFinite = [](uint32_t bits) { return (bits & kFloatExponentMask) != kFloatExponentMask; };
+    bool previousNegative = begin > 0 && isFinite(std::bit_cast<uint32_t>(data[begin - 1]))
+                            && data[begin - 1] < 0.0f;
+    
+    for (size_t i = begin; i < end; ++i) {
+        uint32_t bits = std::bit_cast<uint32_t>(data[i]);
+        bool finite = isFinite(bits);
+        out.denormals += (bits & kFloatExponentMask) == 0 && (bits & kFloatMagnitudeMask) != 0;
+        out.nonFinite += !finite;
+        
+        Sample x = finite ? data[i] : 0.0f;
+        Sample a = std::fabs(x);
+        double xd = x;
+        out.sum += xd;
+        out.sumSquares += xd * xd;
+        out.sumAbs += a;
+        out.peak = std::max(out.peak, a);
+        out.clipped += a >= 1.0f;
+        out.silent += finite && a < silenceThreshold;
+        
+        bool negative = x < 0.0f;
+        if (i > 0) out.zeroCrossings += negative != previousNegative;
+        previousNegative = negative;
+    }
+}
+
+void sampleStatsScalar(const Sample* data, size_t n, Sample silenceThreshold, SampleStats& out) {
+    out = SampleStats{};
+    sampleStatsRange(data, 0, n, silenceThreshold, out);
+}
+
+float dotProductScalar(const float* a, const float* b, size_t n) {
+    // Four partial sums break the add dependency chain
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+int32_t dotProductInt8Scalar(const int8_t* a, const int8_t* b, size_t n) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += static_cast<int32_t>(a[i]) * b[i];
+    return sum;
+}
+
+// Block built from single dot products, for tables without a fused one
+template<typename T, typename Acc, Acc (*Dot)(const T*, const T*, size_t)>
+void dotBlockFromDot(const T* a, size_t aStride, const T* b, size_t bStride, size_t n, Acc* out) {
+    for (size_t r = 0; r < kDotBlockRows; ++r) {
+        for (size_t c = 0; c < kDotBlockCols; ++c) {
+            out[r * kDotBlockCols + c] = Dot(a + r * aStride, b + c * bStride, n);
+        }
+    }
+}
+
+#if defined(AIAUDIO_SIMD_X86)
+
+// ---------------------------------------------------------------- SSE2
+
+__m128 polySinSSE2(__m128 x) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 sign = _mm_and_ps(x, signMask);
+    __m128 a = _mm_andnot_ps(signMask, x);
+    a = _mm_min_ps(a, _mm_sub_ps(_mm_set1_ps(kPiF), a));
+    __m128 a2 = _mm_mul_ps(a, a);
+    __m128 p = _mm_set1_ps(kSinC9);
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(kSinC7));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(kSinC5));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(kSinC3));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(1.0f));
+    return _mm_xor_ps(_mm_mul_ps(p, a), sign);
+}
+
+void sineOscillatorSSE2(const Sample* in, Sample* out, size_t n,
+                        double& phase, double increment,
+                        double phaseOffset, double amplitude) {
+    const float inc = static_cast<float>(increment);
+    const __m128 laneOffsets = _mm_set_ps(3.0f * inc, 2.0f * inc, inc, 0.0f);
+    const __m128 twoPi = _mm_set1_ps(static_cast<float>(kTwoPi));
+    const __m128 invTwoPi = _mm_set1_ps(static_cast<float>(1.0 / kTwoPi));
+    const __m128 amp = _mm_set1_ps(static_cast<float>(amplitude));
+    
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_add_ps(_mm_set1_ps(static_cast<float>(wrapSigned(phase + phaseOffset))),
+                              laneOffsets);
+        __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, invTwoPi)));
+        x = _mm_sub_ps(x, _mm_mul_ps(turns, twoPi));
+        __m128 y = _mm_add_ps(_mm_mul_ps(polySinSSE2(x), amp), _mm_loadu_ps(in + i));
+        _mm_storeu_ps(out + i, y);
+        phase = wrapPhase(phase + 4.0 * increment);
+    }
+    sineTail(in + i, out + i, n - i, phase, increment, phaseOffset, amplitude);
+}
+
+// Two channels per __m128d
+void biquadPairSSE2(const Sample* in0, const Sample* in1, Sample* out0, Sample* out1,
+                    size_t n, const BiquadCoefficients& k, BiquadState& s0, BiquadState& s1) {
+    const __m128d b0 = _mm_set1_pd(k.b0), b1 = _mm_set1_pd(k.b1), b2 = _mm_set1_pd(k.b2);
+    const __m128d a1 = _mm_set1_pd(k.a1), a2 = _mm_set1_pd(k.a2);
+    __m128d x1 = _mm_set_pd(s1.x1, s0.x1), x2 = _mm_set_pd(s1.x2, s0.x2);
+    __m128d y1 = _mm_set_pd(s1.y1, s0.y1), y2 = _mm_set_pd(s1.y2, s0.y2);
+    
+    for (size_t i = 0; i < n; ++i) {
+        __m128d x = _mm_set_pd(in1[i], in0[i]);
+        __m128d y = _mm_add_pd(_mm_mul_pd(b0, x), _mm_mul_pd(b1, x1));
+        y = _mm_add_pd(y, _mm_mul_pd(b2, x2));
+        y = _mm_sub_pd(y, _mm_mul_pd(a1, y1));
+        y = _mm_sub_pd(y, _mm_mul_pd(a2, y2));
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        out0[i] = static_cast<Sample>(_mm_cvtsd_f64(y));
+        out1[i] = static_cast<Sample>(_mm_cvtsd_f64(_mm_unpackhi_pd(y, y)));
+    }
+    
+    double lanes[2];
+    _mm_storeu_pd(lanes, x1); s0.x1 = lanes[0]; s1.x1 = lanes[1];
+    _mm_storeu_pd(lanes, x2); s0.x2 = lanes[0]; s1.x2 = lanes[1];
+    _mm_storeu_pd(lanes, y1); s0.y1 = lanes[0]; s1.y1 = lanes[1];
+    _mm_storeu_pd(lanes, y2); s0.y2 = lanes[0]; s1.y2 = lanes[1];
+}
+
+void biquadSSE2(const Sample* const* in, Sample* const* out,
+                size_t numChannels, size_t n,
+                const BiquadCoefficients& k, BiquadState* state) {
+    size_t ch = 0;
+    for (; ch + 2 <= numChannels; ch += 2) {
+        biquadPairSSE2(in[ch], in[ch + 1], out[ch], out[ch + 1], n, k, state[ch], state[ch + 1]);
+    }
+    if (ch < numChannels) {
+        biquadScalarChannel(in[ch], out[ch], n, k, state[ch]);
+    }
+}
+
+void applyGainSSE2(Sample* data, size_t n, Sample gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g));
+    }
+    applyGainScalar(data + i, n - i, gain);
+}
+
+void clampSymmetricSSE2(Sample* data, size_t n, Sample limit) {
+    const __m128 hi = _mm_set1_ps(limit);
+    const __m128 lo = _mm_set1_ps(-limit);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(data + i, _mm_max_ps(lo, _mm_min_ps(hi, _mm_loadu_ps(data + i))));
+    }
+    clampSymmetricScalar(data + i, n - i, limit);
+}
+
+Sample peakAbsSSE2(const Sample* data, size_t n) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 peak = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        peak = _mm_max_ps(peak, _mm_andnot_ps(signMask, _mm_loadu_ps(data + i)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, peak);
+    Sample result = std::max({lanes[0], lanes[1], lanes[2], lanes[3]});
+    return std::max(result, peakAbsScalar(data + i, n - i));
+}
+
+double sumSquaresSSE2(const Sample* data, size_t n) {
+    __m128d sumLo = _mm_setzero_pd();
+    __m128d sumHi = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(data + i);
+        __m128d lo = _mm_cvtps_pd(v);
+        __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+        sumLo = _mm_add_pd(sumLo, _mm_mul_pd(lo, lo));
+        sumHi = _mm_add_pd(sumHi, _mm_mul_pd(hi, hi));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sumLo, sumHi));
+    return lanes[0] + lanes[1] + sumSquaresScalar(data + i, n - i);
+}
+
+float dotProductSSE2(const float* a, const float* b, size_t n) {
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_add_ps(sum0, sum1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dotProductScalar(a + i, b + i, n - i);
+}
+
+// Sign-extend bytes to 16 bits and multiply-add pairs into 32-bit lanes;
+// exact (no saturation) for n up to 2^17
+int32_t dotProductInt8SSE2(const int8_t* a, const int8_t* b, size_t n) {
+    __m128i sum = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i aLo = _mm_srai_epi16(_mm_unpacklo_epi8(va, va), 8);
+        __m128i aHi = _mm_srai_epi16(_mm_unpackhi_epi8(va, va), 8);
+        __m128i bLo = _mm_srai_epi16(_mm_unpacklo_epi8(vb, vb), 8);
+        __m128i bHi = _mm_srai_epi16(_mm_unpackhi_epi8(vb, vb), 8);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(aLo, bLo));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(aHi, bHi));
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dotProductInt8Scalar(a + i, b + i, n - i);
+}
+
+// ---------------------------------------------------------------- AVX2
+
+AIAUDIO_TARGET_AVX2 __m256 polySinAVX2(__m256 x) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 sign = _mm256_and_ps(x, signMask);
+    __m256 a = _mm256_andnot_ps(signMask, x);
+    a = _mm256_min_ps(a, _mm256_sub_ps(_mm256_set1_ps(kPiF), a));
+    __m256 a2 = _mm256_mul_ps(a, a);
+    __m256 p = _mm256_set1_ps(kSinC9);
+    p = _mm256_fmadd_ps(p, a2, _mm256_set1_ps(kSinC7));
+    p = _mm256_fmadd_ps(p, a2, _mm256_set1_ps(kSinC5));
+    p = _mm256_fmadd_ps(p, a2, _mm256_set1_ps(kSinC3));
+    p = _mm256_fmadd_ps(p, a2, _mm256_set1_ps(1.0f));
+    return _mm256_xor_ps(_mm256_mul_ps(p, a), sign);
+}
+
+AIAUDIO_TARGET_AVX2 void sineOscillatorAVX2(const Sample* in, Sample* out, size_t n,
+                                            double& phase, double increment,
+                                            double phaseOffset, double amplitude) {
+    const float inc = static_cast<float>(increment);
+    const __m256 laneOffsets = _mm256_set_ps(7.0f * inc, 6.0f * inc, 5.0f * inc, 4.0f * inc,
+                                             3.0f * inc, 2.0f * inc, inc, 0.0f);
+    const __m256 twoPi = _mm256_set1_ps(static_cast<float>(kTwoPi));
+    const __m256 invTwoPi = _mm256_set1_ps(static_cast<float>(1.0 / kTwoPi));
+    const __m256 amp = _mm256_set1_ps(static_cast<float>(amplitude));
+    
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(wrapSigned(phase + phaseOffset))),
+                                 laneOffsets);
+        __m256 turns = _mm256_round_ps(_mm256_mul_ps(x, invTwoPi),
+                                       _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        x = _mm256_fnmadd_ps(turns, twoPi, x);
+        __m256 y = _mm256_fmadd_ps(polySinAVX2(x), amp, _mm256_loadu_ps(in + i));
+        _mm256_storeu_ps(out + i, y);
+        phase = wrapPhase(phase + 8.0 * increment);
+    }
+    sineTail(in + i, out + i, n - i, phase, increment, phaseOffset, amplitude);
+}
+
+// Four channels per __m256d
+AIAUDIO_TARGET_AVX2 void biquadQuadAVX2(const Sample* const* in, Sample* const* out, size_t n,
+                                        const BiquadCoefficients& k, BiquadState* s) {
+    const __m256d b0 = _mm256_set1_pd(k.b0), b1 = _mm256_set1_pd(k.b1), b2 = _mm256_set1_pd(k.b2);
+    const __m256d a1 = _mm256_set1_pd(k.a1), a2 = _mm256_set1_pd(k.a2);
+    __m256d x1 = _mm256_set_pd(s[3].x1, s[2].x1, s[1].x1, s[0].x1);
+    __m256d x2 = _mm256_set_pd(s[3].x2, s[2].x2, s[1].x2, s[0].x2);
+    __m256d y1 = _mm256_set_pd(s[3].y1, s[2].y1, s[1].y1, s[0].y1);
+    __m256d y2 = _mm256_set_pd(s[3].y2, s[2].y2, s[1].y2, s[0].y2);
+    
+    double lanes[4];
+    for (size_t i = 0; i < n; ++i) {
+        __m256d x = _mm256_set_pd(in[3][i], in[2][i], in[1][i], in[0][i]);
+        __m256d y = _mm256_mul_pd(b0, x);
+        y = _mm256_fmadd_pd(b1, x1, y);
+        y = _mm256_fmadd_pd(b2, x2, y);
+        y = _mm256_fnmadd_pd(a1, y1, y);
+        y = _mm256_fnmadd_pd(a2, y2, y);
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        _mm256_storeu_pd(lanes, y);
+        for (size_t lane = 0; lane < 4; ++lane) {
+            out[lane][i] = static_cast<Sample>(lanes[lane]);
+        }
+    }
+    
+    _mm256_storeu_pd(lanes, x1);
+    for (size_t lane = 0; lane < 4; ++lane) s[lane].x1 = lanes[lane];
+    _mm256_storeu_pd(lanes, x2);
+    for (size_t lane = 0; lane < 4; ++lane) s[lane].x2 = lanes[lane];
+    _mm256_storeu_pd(lanes, y1);
+    for (size_t lane = 0; lane < 4; ++lane) s[lane].y1 = lanes[lane];
+    _mm256_storeu_pd(lanes, y2);
+    for (size_t lane = 0; lane < 4; ++lane) s[lane].y2 = lanes[lane];
+}
+
+AIAUDIO_TARGET_AVX2 void biquadAVX2(const Sample* const* in, Sample* const* out,
+                                    size_t numChannels, size_t n,
+                                    const BiquadCoefficients& k, BiquadState* state) {
+    size_t ch = 0;
+    for (; ch + 4 <= numChannels; ch += 4) {
+        biquadQuadAVX2(in + ch, out + ch, n, k, state + ch);
+    }
+    biquadSSE2(in + ch, out + ch, numChannels - ch, n, k, state + ch);
+}
+
+AIAUDIO_TARGET_AVX2 void applyGainAVX2(Sample* data, size_t n, Sample gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), g));
+    }
+    applyGainScalar(data + i, n - i, gain);
+}
+
+AIAUDIO_TARGET_AVX2 void clampSymmetricAVX2(Sample* data, size_t n, Sample limit) {
+    const __m256 hi = _mm256_set1_ps(limit);
+    const __m256 lo = _mm256_set1_ps(-limit);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(data + i, _mm256_max_ps(lo, _mm256_min_ps(hi, _mm256_loadu_ps(data + i))));
+    }
+    clampSymmetricScalar(data + i, n - i, limit);
+}
+
+AIAUDIO_TARGET_AVX2 Sample peakAbsAVX2(const Sample* data, size_t n) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 peak = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        peak = _mm256_max_ps(peak, _mm256_andnot_ps(signMask, _mm256_loadu_ps(data + i)));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, peak);
+    Sample result = *std::max_element(lanes, lanes + 8);
+    return std::max(result, peakAbsScalar(data + i, n - i));
+}
+
+AIAUDIO_TARGET_AVX2 double sumSquaresAVX2(const Sample* data, size_t n) {
+    __m256d sumLo = _mm256_setzero_pd();
+    __m256d sumHi = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d lo = _mm256_cvtps_pd(_mm_loadu_ps(data + i));
+        __m256d hi = _mm256_cvtps_pd(_mm_loadu_ps(data + i + 4));
+        sumLo = _mm256_fmadd_pd(lo, lo, sumLo);
+        sumHi = _mm256_fmadd_pd(hi, hi, sumHi);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sumLo, sumHi));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumSquaresScalar(data + i, n - i);
+}
+
+AIAUDIO_TARGET_AVX2 float dotProductAVX2(const float* a, const float* b, size_t n) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    __m256 sum = _mm256_add_ps(sum0, sum1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    float lanes[4];
+    _mm_storeu_ps(lanes, half);
+    
+    // Tail stays in VEX code; calling the SSE scalar kernel with dirty
+    // upper lanes costs a state transition on every call
+    float tail = 0.0f;
+    for (; i < n; ++i) tail += a[i] * b[i];
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + tail;
+}
+
+AIAUDIO_TARGET_AVX2 float horizontalSumAVX2(__m256 v) {
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+}
+
+AIAUDIO_TARGET_AVX2 int32_t horizontalSumAVX2(__m256i v) {
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtsi128_si32(_mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1))));
+}
+
+AIAUDIO_TARGET_AVX2 double horizontalSumAVX2(__m256d v) {
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+// Masks become counts by subtracting them (all-ones == -1) from 32-bit
+// lanes, which are flushed every kStatsCountChunk samples. Each lane's
+// zero-crossing test reads its left neighbour with an unaligned load.
+AIAUDIO_TARGET_AVX2 void sampleStatsAVX2(const Sample* data, size_t n,
+                                         Sample silenceThreshold, SampleStats& out) {
+    out = SampleStats{};
+    if (n == 0) return;
+    sampleStatsRange(data, 0, 1, silenceThreshold, out);
+    
+    const __m256i exponentMask = _mm256_set1_epi32(kFloatExponentMask);
+    const __m256i magnitudeMask = _mm256_set1_epi32(kFloatMagnitudeMask);
+    const __m256i zeroBits = _mm256_setzero_si256();
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 threshold = _mm256_set1_ps(silenceThreshold);
+    
+    __m256d sum = _mm256_setzero_pd();
+    __m256d sumAbs = _mm256_setzero_pd();
+    __m256d squaresLo = _mm256_setzero_pd();
+    __m256d squaresHi = _mm256_setzero_pd();
+    __m256 peak = _mm256_setzero_ps();
+    
+    size_t i = 1;
+    while (i + 8 <= n) {
+        __m256i clipped = _mm256_setzero_si256();
+        __m256i denormals = _mm256_setzero_si256();
+        __m256i nonFinite = _mm256_setzero_si256();
+        __m256i silent = _mm256_setzero_si256();
+        __m256i crossings = _mm256_setzero_si256();
+        
+        const size_t end = std::min(n, i + kStatsCountChunk);
+        for (; i + 8 <= end; i += 8) {
+            __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i exponent = _mm256_and_si256(bits, exponentMask);
+            __m256i infOrNaN = _mm256_cmpeq_epi32(exponent, exponentMask);
+            __m256i denormal = _mm256_andnot_si256(
+                _mm256_cmpeq_epi32(_mm256_and_si256(bits, magnitudeMask), zeroBits),
+                _mm256_cmpeq_epi32(exponent, zeroBits));
+            __m256 x = _mm256_andnot_ps(_mm256_castsi256_ps(infOrNaN), _mm256_castsi256_ps(bits));
+            __m256 a = _mm256_andnot_ps(signMask, x);
+            
+            __m256i previousBits = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i - 1));
+            __m256i previousInfOrNaN = _mm256_cmpeq_epi32(_mm256_and_si256(previousBits, exponentMask),
+                                                          exponentMask);
+            __m256 previous = _mm256_andnot_ps(_mm256_castsi256_ps(previousInfOrNaN),
+                                               _mm256_castsi256_ps(previousBits));
+            __m256 crossing = _mm256_xor_ps(_mm256_cmp_ps(x, zero, _CMP_LT_OQ),
+                                            _mm256_cmp_ps(previous, zero, _CMP_LT_OQ));
+            __m256 quiet = _mm256_andnot_ps(_mm256_castsi256_ps(infOrNaN),
+                                            _mm256_cmp_ps(a, threshold, _CMP_LT_OQ));
+            
+            clipped = _mm256_sub_epi32(clipped, _mm256_castps_si256(_mm256_cmp_ps(a, one, _CMP_GE_OQ)));
+            denormals = _mm256_sub_epi32(denormals, denormal);
+            nonFinite = _mm256_sub_epi32(nonFinite, infOrNaN);
+            silent = _mm256_sub_epi32(silent, _mm256_castps_si256(quiet));
+            crossings = _mm256_sub_epi32(crossings, _mm256_castps_si256(crossing));
+            peak = _mm256_max_ps(peak, a);
+            
+            __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(x));
+            __m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1));
+            __m256d absLo = _mm256_cvtps_pd(_mm256_castps256_ps128(a));
+            __m256d absHi = _mm256_cvtps_pd(_mm256_extractf128_ps(a, 1));
+            sum = _mm256_add_pd(sum, _mm256_add_pd(lo, hi));
+            sumAbs = _mm256_add_pd(sumAbs, _mm256_add_pd(absLo, absHi));
+            squaresLo = _mm256_fmadd_pd(lo, lo, squaresLo);
+            squaresHi = _mm256_fmadd_pd(hi, hi, squaresHi);
+        }
+        
+        out.clipped += horizontalSumAVX2(clipped);
+        out.denormals += horizontalSumAVX2(denormals);
+        out.nonFinite += horizontalSumAVX2(nonFinite);
+        out.silent += horizontalSumAVX2(silent);
+        out.zeroCrossings += horizontalSumAVX2(crossings);
+    }
+    
+    out.sum += horizontalSumAVX2(sum);
+    out.sumAbs += horizontalSumAVX2(sumAbs);
+    out.sumSquares += horizontalSumAVX2(_mm256_add_pd(squaresLo, squaresHi));
+    float lanes[8];
+    _mm256_storeu_ps(lanes, peak);
+    out.peak = std::max(out.peak, *std::max_element(lanes, lanes + 8));
+    
+    sampleStatsRange(data, i, n, silenceThreshold, out);
+}
+
+// 4x2 register block: six loads feed eight FMAs, so the loop is bound by
+// FMA throughput instead of loads
+AIAUDIO_TARGET_AVX2 void dotProductBlockAVX2(const float* a, size_t aStride,
+                                             const float* b, size_t bStride,
+                                             size_t n, float* out) {
+    const float* b0 = b;
+    const float* b1 = b + bStride;
+    __m256 sum[kDotBlockRows][kDotBlockCols];
+    for (auto& row : sum) row[0] = row[1] = _mm256_setzero_ps();
+    
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vb0 = _mm256_loadu_ps(b0 + i);
+        __m256 vb1 = _mm256_loadu_ps(b1 + i);
+        for (size_t r = 0; r < kDotBlockRows; ++r) {
+            __m256 va = _mm256_loadu_ps(a + r * aStride + i);
+            sum[r][0] = _mm256_fmadd_ps(va, vb0, sum[r][0]);
+            sum[r][1] = _mm256_fmadd_ps(va, vb1, sum[r][1]);
+        }
+    }
+    
+    for (size_t r = 0; r < kDotBlockRows; ++r) {
+        const float* ar = a + r * aStride;
+        for (size_t c = 0; c < kDotBlockCols; ++c) {
+            const float* bc = b + c * bStride;
+            float tail = 0.0f;
+            for (size_t j = i; j < n; ++j) tail += ar[j] * bc[j];
+            out[r * kDotBlockCols + c] = horizontalSumAVX2(sum[r][c]) + tail;
+        }
+    }
+}
+
+AIAUDIO_TARGET_AVX2 void dotProductInt8BlockAVX2(const int8_t* a, size_t aStride,
+                                                 const int8_t* b, size_t bStride,
+                                                 size_t n, int32_t* out) {
+    const int8_t* b0 = b;
+    const int8_t* b1 = b + bStride;
+    __m256i sum[kDotBlockRows][kDotBlockCols];
+    for (auto& row : sum) row[0] = row[1] = _mm256_setzero_si256();
+    
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i vb0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b0 + i)));
+        __m256i vb1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b1 + i)));
+        for (size_t r = 0; r < kDotBlockRows; ++r) {
+            __m256i va = _mm256_cvtepi8_epi16(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + r * aStride + i)));
+            sum[r][0] = _mm256_add_epi32(sum[r][0], _mm256_madd_epi16(va, vb0));
+            sum[r][1] = _mm256_add_epi32(sum[r][1], _mm256_madd_epi16(va, vb1));
+        }
+    }
+    
+    for (size_t r = 0; r < kDotBlockRows; ++r) {
+        const int8_t* ar = a + r * aStride;
+        for (size_t c = 0; c < kDotBlockCols; ++c) {
+            const int8_t* bc = b + c * bStride;
+            int32_t tail = 0;
+            for (size_t j = i; j < n; ++j) tail += static_cast<int32_t>(ar[j]) * bc[j];
+            out[r * kDotBlockCols + c] = horizontalSumAVX2(sum[r][c]) + tail;
+        }
+    }
+}
+
+AIAUDIO_TARGET_AVX2 int32_t dotProductInt8AVX2(const int8_t* a, const int8_t* b, size_t n) {
+    __m256i sum0 = _mm256_setzero_si256();
+    __m256i sum1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i a0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i b0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        __m256i a1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16)));
+        __m256i b1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 16)));
+        sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(a0, b0));
+        sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(a1, b1));
+    }
+    __m256i sum = _mm256_add_epi32(sum0, sum1);
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), half);
+    
+    int32_t tail = 0;
+    for (; i < n; ++i) tail += static_cast<int32_t>(a[i]) * b[i];
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + tail;
+}
+
+// ---------------------------------------------------------------- AVX-VNNI
+
+// vpdpbusd multiplies unsigned by signed bytes, four pairs per 32-bit lane.
+// a's sign is moved onto b so |a| can be used as the unsigned side; exact
+// because both operands stay in [-127, 127].
+AIAUDIO_TARGET_AVXVNNI int32_t dotProductInt8VNNI(const int8_t* a, const int8_t* b, size_t n) {
+    __m256i sum = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        sum = _mm256_dpbusd_avx_epi32(sum, _mm256_abs_epi8(va), _mm256_sign_epi8(vb, va));
+    }
+    
+    int32_t tail = 0;
+    for (; i < n; ++i) tail += static_cast<int32_t>(a[i]) * b[i];
+    return horizontalSumAVX2(sum) + tail;
+}
+
+AIAUDIO_TARGET_AVXVNNI void dotProductInt8BlockVNNI(const int8_t* a, size_t aStride,
+                                                    const int8_t* b, size_t bStride,
+                                                    size_t n, int32_t* out) {
+    const int8_t* b0 = b;
+    const int8_t* b1 = b + bStride;
+    __m256i sum[kDotBlockRows][kDotBlockCols];
+    for (auto& row : sum) row[0] = row[1] = _mm256_setzero_si256();
+    
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i vb0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b0 + i));
+        __m256i vb1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b1 + i));
+        for (size_t r = 0; r < kDotBlockRows; ++r) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + r * aStride + i));
+            __m256i magnitude = _mm256_abs_epi8(va);
+            sum[r][0] = _mm256_dpbusd_avx_epi32(sum[r][0], magnitude, _mm256_sign_epi8(vb0, va));
+            sum[r][1] = _mm256_dpbusd_avx_epi32(sum[r][1], magnitude, _mm256_sign_epi8(vb1, va));
+        }
+    }
+    
+    for (size_t r = 0; r < kDotBlockRows; ++r) {
+        const int8_t* ar = a + r * aStride;
+        for (size_t c = 0; c < kDotBlockCols; ++c) {
+            const int8_t* bc = b + c * bStride;
+            int32_t tail = 0;
+            for (size_t j = i; j < n; ++j) tail += static_cast<int32_t>(ar[j]) * bc[j];
+            out[r * kDotBlockCols + c] = horizontalSumAVX2(sum[r][c]) + tail;
+        }
+    }
+}
+
+#endif // AIAUDIO_SIMD_X86
+
+#if defined(AIAUDIO_SIMD_NEON)
+
+// ---------------------------------------------------------------- NEON
+
+float32x4_t polySinNEON(float32x4_t x) {
+    const uint32x4_t signMask = vdupq_n_u32(0x80000000u);
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(x), signMask);
+    float32x4_t a = vabsq_f32(x);
+    a = vminq_f32(a, vsubq_f32(vdupq_n_f32(kPiF), a));
+    float32x4_t a2 = vmulq_f32(a, a);
+    float32x4_t p = vdupq_n_f32(kSinC9);
+    p = vfmaq_f32(vdupq_n_f32(kSinC7), p, a2);
+    p = vfmaq_f32(vdupq_n_f32(kSinC5), p, a2);
+    p = vfmaq_f32(vdupq_n_f32(kSinC3), p, a2);
+    p = vfmaq_f32(vdupq_n_f32(1.0f), p, a2);
+    p = vmulq_f32(p, a);
+    return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(p), sign));
+}
+
+void sineOscillatorNEON(const Sample* in, Sample* out, size_t n,
+                        double& phase, double increment,
+                        double phaseOffset, double amplitude) {
+    const float inc = static_cast<float>(increment);
+    const float offsets[4] = {0.0f, inc, 2.0f * inc, 3.0f * inc};
+    const float32x4_t laneOffsets = vld1q_f32(offsets);
+    const float32x4_t twoPi = vdupq_n_f32(static_cast<float>(kTwoPi));
+    const float32x4_t invTwoPi = vdupq_n_f32(static_cast<float>(1.0 / kTwoPi));
+    const float32x4_t amp = vdupq_n_f32(static_cast<float>(amplitude));
+    
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x = vaddq_f32(vdupq_n_f32(static_cast<float>(wrapSigned(phase + phaseOffset))),
+                                  laneOffsets);
+        float32x4_t turns = vrndnq_f32(vmulq_f32(x, invTwoPi));
+        x = vfmsq_f32(x, turns, twoPi);
+        vst1q_f32(out + i, vfmaq_f32(vld1q_f32(in + i), polySinNEON(x), amp));
+        phase = wrapPhase(phase + 4.0 * increment);
+    }
+    sineTail(in + i, out + i, n - i, phase, increment, phaseOffset, amplitude);
+}
+
+void biquadNEON(const Sample* const* in, Sample* const* out,
+                size_t numChannels, size_t n,
+                const BiquadCoefficients& k, BiquadState* state) {
+    const float64x2_t b0 = vdupq_n_f64(k.b0), b1 = vdupq_n_f64(k.b1), b2 = vdupq_n_f64(k.b2);
+    const float64x2_t a1 = vdupq_n_f64(k.a1), a2 = vdupq_n_f64(k.a2);
+    
+    size_t ch = 0;
+    for (; ch + 2 <= numChannels; ch += 2) {
+        BiquadState& s0 = state[ch];
+        BiquadState& s1 = state[ch + 1];
+        const Sample* in0 = in[ch];
+        const Sample* in1 = in[ch + 1];
+        double lanes[2];
+        
+        lanes[0] = s0.x1; lanes[1] = s1.x1; float64x2_t x1 = vld1q_f64(lanes);
+        lanes[0] = s0.x2; lanes[1] = s1.x2; float64x2_t x2 = vld1q_f64(lanes);
+        lanes[0] = s0.y1; lanes[1] = s1.y1; float64x2_t y1 = vld1q_f64(lanes);
+        lanes[0] = s0.y2; lanes[1] = s1.y2; float64x2_t y2 = vld1q_f64(lanes);
+        
+        for (size_t i = 0; i < n; ++i) {
+            lanes[0] = in0[i];
+            lanes[1] = in1[i];
+            float64x2_t x = vld1q_f64(lanes);
+            float64x2_t y = vmulq_f64(b0, x);
+            y = vfmaq_f64(y, b1, x1);
+            y = vfmaq_f64(y, b2, x2);
+            y = vfmsq_f64(y, a1, y1);
+            y = vfmsq_f64(y, a2, y2);
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            out[ch][i] = static_cast<Sample>(vgetq_lane_f64(y, 0));
+            out[ch + 1][i] = static_cast<Sample>(vgetq_lane_f64(y, 1));
+        }
+        
+        s0.x1 = vgetq_lane_f64(x1, 0); s1.x1 = vgetq_lane_f64(x1, 1);
+        s0.x2 = vgetq_lane_f64(x2, 0); s1.x2 = vgetq_lane_f64(x2, 1);
+        s0.y1 = vgetq_lane_f64(y1, 0); s1.y1 = vgetq_lane_f64(y1, 1);
+        s0.y2 = vgetq_lane_f64(y2, 0); s1.y2 = vgetq_lane_f64(y2, 1);
+    }
+    if (ch < numChannels) {
+        biquadScalarChannel(in[ch], out[ch], n, k, state[ch]);
+    }
+}
+
+void applyGainNEON(Sample* data, size_t n, Sample gain) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(data + i, vmulq_n_f32(vld1q_f32(data + i), gain));
+    }
+    applyGainScalar(data + i, n - i, gain);
+}
+
+void clampSymmetricNEON(Sample* data, size_t n, Sample limit) {
+    const float32x4_t hi = vdupq_n_f32(limit);
+    const float32x4_t lo = vdupq_n_f32(-limit);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(data + i, vmaxq_f32(lo, vminq_f32(hi, vld1q_f32(data + i))));
+    }
+    clampSymmetricScalar(data + i, n - i, limit);
+}
+
+Sample peakAbsNEON(const Sample* data, size_t n) {
+    float32x4_t peak = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        peak = vmaxq_f32(peak, vabsq_f32(vld1q_f32(data + i)));
+    }
+    return std::max(vmaxvq_f32(peak), peakAbsScalar(data + i, n - i));
+}
+
+double sumSquaresNEON(const Sample* data, size_t n) {
+    float64x2_t sumLo = vdupq_n_f64(0.0);
+    float64x2_t sumHi = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t v = vld1q_f32(data + i);
+        float64x2_t lo = vcvt_f64_f32(vget_low_f32(v));
+        float64x2_t hi = vcvt_high_f64_f32(v);
+        sumLo = vfmaq_f64(sumLo, lo, lo);
+        sumHi = vfmaq_f64(sumHi, hi, hi);
+    }
+    return vaddvq_f64(vaddq_f64(sumLo, sumHi)) + sumSquaresScalar(data + i, n - i);
+}
+
+float dotProductNEON(const float* a, const float* b, size_t n) {
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        sum0 = vfmaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        sum1 = vfmaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    return vaddvq_f32(vaddq_f32(sum0, sum1)) + dotProductScalar(a + i, b + i, n - i);
+}
+
+int32_t dotProductInt8NEON(const int8_t* a, const int8_t* b, size_t n) {
+    int32x4_t sum = vdupq_n_s32(0);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        int16x8_t lo = vmull_s8(vget_low_s8(va), vget_low_s8(vb));
+        int16x8_t hi = vmull_s8(vget_high_s8(va), vget_high_s8(vb));
+        sum = vpadalq_s16(sum, lo);
+        sum = vpadalq_s16(sum, hi);
+    }
+    return vaddvq_s32(sum) + dotProductInt8Scalar(a + i, b + i, n - i);
+}
+
+void dotProductBlockNEON(const float* a, size_t aStride,
+                         const float* b, size_t bStride,
+                         size_t n, float* out) {
+    const float* b0 = b;
+    const float* b1 = b + bStride;
+    float32x4_t sum[kDotBlockRows][kDotBlockCols];
+    for (auto& row : sum) row[0] = row[1] = vdupq_n_f32(0.0f);
+    
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t vb0 = vld1q_f32(b0 + i);
+        float32x4_t vb1 = vld1q_f32(b1 + i);
+        for (size_t r = 0; r < kDotBlockRows; ++r) {
+            float32x4_t va = vld1q_f32(a + r * aStride + i);
+            sum[r][0] = vfmaq_f32(sum[r][0], va, vb0);
+            sum[r][1] = vfmaq_f32(sum[r][1], va, vb1);
+        }
+    }
+    
+    for (size_t r = 0; r < kDotBlockRows; ++r) {
+        for (size_t c = 0; c < kDotBlockCols; ++c) {
+            out[r * kDotBlockCols + c] = vaddvq_f32(sum[r][c])
+                + dotProductScalar(a + r * aStride + i, b + c * bStride + i, n - i);
+        }
+    }
+}
+
+#endif // AIAUDIO_SIMD_NEON
+
+const SIMDKernels kScalarKernels = {
+    SIMDLevel::SCALAR,
+    sineOscillatorScalar, biquadScalar,
+    applyGainScalar, clampSymmetricScalar,
+    peakAbsScalar, sumSquaresScalar, sampleStatsScalar,
+    dotProductScalar, dotProductInt8Scalar,
+    dotBlockFromDot<float, float, dotProductScalar>,
+    dotBlockFromDot<int8_t, int32_t, dotProductInt8Scalar>
+};
+
+#if defined(AIAUDIO_SIMD_X86)
+const SIMDKernels kSSE2Kernels = {
+    SIMDLevel::SSE2,
+    sineOscillatorSSE2, biquadSSE2,
+    applyGainSSE2, clampSymmetricSSE2,
+    peakAbsSSE2, sumSquaresSSE2, sampleStatsScalar,
+    dotProductSSE2, dotProductInt8SSE2,
+    dotBlockFromDot<float, float, dotProductSSE2>,
+    dotBlockFromDot<int8_t, int32_t, dotProductInt8SSE2>
+};
+
+const SIMDKernels kAVX2Kernels = {
+    SIMDLevel::AVX2,
+    sineOscillatorAVX2, biquadAVX2,
+    applyGainAVX2, clampSymmetricAVX2,
+    peakAbsAVX2, sumSquaresAVX2, sampleStatsAVX2,
+    dotProductAVX2, dotProductInt8AVX2,
+    dotProductBlockAVX2, dotProductInt8BlockAVX2
+};
+
+// AVX2 table with the int8 kernels on AVX-VNNI
+const SIMDKernels kAVX2VNNIKernels = {
+    SIMDLevel::AVX2,
+    sineOscillatorAVX2, biquadAVX2,
+    applyGainAVX2, clampSymmetricAVX2,
+    peakAbsAVX2, sumSquaresAVX2, sampleStatsAVX2,
+    dotProductAVX2, dotProductInt8VNNI,
+    dotProductBlockAVX2, dotProductInt8BlockVNNI
+};
+
+bool hasAVXVNNI() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avxvnni");
+}
+#endif
+
+#if defined(AIAUDIO_SIMD_NEON)
+const SIMDKernels kNEONKernels = {
+    SIMDLevel::NEON,
+    sineOscillatorNEON, biquadNEON,
+    applyGainNEON, clampSymmetricNEON,
+    peakAbsNEON, sumSquaresNEON, sampleStatsScalar,
+    dotProductNEON, dotProductInt8NEON,
+    dotProductBlockNEON,
+    dotBlockFromDot<int8_t, int32_t, dotProductInt8NEON>
+};
+#endif
+
+} // namespace
+
+SIMDLevel detectSIMDLevel() {
+#if defined(AIAUDIO_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SIMDLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SIMDLevel::SSE2;
+    }
+    return SIMDLevel::SCALAR;
+#elif defined(AIAUDIO_SIMD_NEON)
+    return SIMDLevel::NEON;
+#else
+    return SIMDLevel::SCALAR;
+#endif
+}
+
+const SIMDKernels& getSIMDKernels(SIMDLevel level) {
+    SIMDLevel supported = detectSIMDLevel();
+    
+    switch (level) {
+#if defined(AIAUDIO_SIMD_X86)
+        case SIMDLevel::AVX2:
+            if (supported == SIMDLevel::AVX2) return hasAVXVNNI() ? kAVX2VNNIKernels : kAVX2Kernels;
+            return supported == SIMDLevel::SSE2 ? kSSE2Kernels : kScalarKernels;
+        case SIMDLevel::SSE2:
+            return supported != SIMDLevel::SCALAR ? kSSE2Kernels : kScalarKernels;
+#endif
+#if defined(AIAUDIO_SIMD_NEON)
+        case SIMDLevel::NEON:
+            return kNEONKernels;
+#endif
+        default:
+            return kScalarKernels;
+    }
+}
+
+const SIMDKernels& getActiveKernels() {
+    static const SIMDKernels& active = getSIMDKernels(detectSIMDLevel());
+    return active;
+}
+
+std::string simdLevelName(SIMDLevel level) {
+    switch (level) {
+        case SIMDLevel::SSE2: return "sse2";
+        case SIMDLevel::AVX2: return "avx2";
+        case SIMDLevel::NEON: return "neon";
+        default: return "scalar";
+    }
+}
+
+} // namespace aiaudio
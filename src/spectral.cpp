@@ -0,0 +1,273 @@
+#include "spectral.h"
+#include "normalization.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+namespace aiaudio {
+
+namespace {
+
+// Frames per parallel task
+constexpr size_t kFramesPerTask = 16;
+
+// Log-magnitude floor of the STFT loss
+constexpr float kMagnitudeFloor = 1e-7f;
+
+// Zwicker's specific loudness exponent
+constexpr double kLoudnessExponent = 0.23;
+
+// Plain complex multiply: std::complex's operator* carries inf/NaN recovery
+// that blocks vectorisation without -ffast-math
+inline std::complex<float> multiply(std::complex<float> a, std::complex<float> b) {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+const Spectrogram& largest(const std::vector<Spectrogram>& resolutions) {
+    return *std::max_element(resolutions.begin(), resolutions.end(),
+                             [](const Spectrogram& a, const Spectrogram& b) { return a.fftSize < b.fftSize; });
+}
+
+} // namespace
+
+// FFTPlan implementation
+FFTPlan::FFTPlan(size_t size) : size_(size) {
+    if (size < 4 || !std::has_single_bit(size)) {
+        throw AIAudioException("FFT size must be a power of two of at least 4");
+    }
+    
+    const size_t half = size / 2;
+    const int bits = std::countr_zero(half);
+    bitReverse_.resize(half);
+    for (size_t i = 0; i < half; ++i) {
+        uint32_t reversed = 0;
+        for (int b = 0; b < bits; ++b) reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+        bitReverse_[i] = reversed;
+    }
+    
+    twiddles_.resize(half - 1);
+    for (size_t h = 1; h < half; h <<= 1) {
+        for (size_t j = 0; j < h; ++j) {
+            double angle = -M_PI * j / h;
+            twiddles_[h - 1 + j] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+        }
+    }
+    
+    splitTwiddles_.resize(half);
+    for (size_t k = 0; k < half; ++k) {
+        double angle = -2.0 * M_PI * k / size;
+        splitTwiddles_[k] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+    }
+    
+    window_.resize(size);
+    for (size_t n = 0; n < size; ++n) {
+        window_[n] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * M_PI * n / size));
+    }
+}
+
+std::shared_ptr<const FFTPlan> FFTPlan::get(size_t size) {
+    static std::mutex mutex;
+    static std::map<size_t, std::shared_ptr<const FFTPlan>> plans;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& plan = plans[size];
+    if (!plan) plan = std::make_shared<const FFTPlan>(size);
+    return plan;
+}
+
+void FFTPlan::forward(const float* input, std::complex<float>* output) const {
+    const size_t half = size_ / 2;
+    
+    // z[n] = x[2n] + i x[2n + 1], loaded in bit-reversed order
+    for (size_t i = 0; i < half; ++i) {
+        const float* pair = input + 2 * bitReverse_[i];
+        output[i] = {pair[0], pair[1]};
+    }
+    
+    // Radix-2 decimation in time over the first half of output
+    for (size_t h = 1; h < half; h <<= 1) {
+        const std::complex<float>* w = twiddles_.data() + h - 1;
+        for (size_t start = 0; start < half; start += 2 * h) {
+            std::complex<float>* a = output + start;
+            std::complex<float>* b = a + h;
+            for (size_t j = 0; j < h; ++j) {
+                std::complex<float> t = multiply(b[j], w[j]);
+                b[j] = a[j] - t;
+                a[j] += t;
+            }
+        }
+    }
+    
+    // Split Z into the spectra of the even and odd samples and recombine:
+    // X[k] = E + W^k O and X[half - k] = conj(E - W^k O), where
+    // E = (Z[k] + conj(Z[half - k])) / 2 and O = -i (Z[k] - conj(Z[half - k])) / 2
+    const std::complex<float> z0 = output[0];
+    output[0] = {z0.real() + z0.imag(), 0.0f};
+    output[half] = {z0.real() - z0.imag(), 0.0f};
+    for (size_t k = 1; k <= half / 2; ++k) {
+        const std::complex<float> a = output[k];
+        const std::complex<float> b = std::conj(output[half - k]);
+        const std::complex<float> even = 0.5f * (a + b);
+        const std::complex<float> difference = 0.5f * (a - b);
+        const std::complex<float> odd = multiply(splitTwiddles_[k], {difference.imag(), -difference.real()});
+        output[k] = even + odd;
+        output[half - k] = std::conj(even - odd);
+    }
+}
+
+// Spectrogram
+Spectrogram computeSpectrogram(const AudioBuffer& audio, double sampleRate,
+                               size_t fftSize, size_t hopSize, bool parallel) {
+    if (sampleRate <= 0.0) {
+        throw AIAudioException("Sample rate must be positive");
+    }
+    if (hopSize == 0) {
+        throw AIAudioException("STFT hop size must be positive");
+    }
+    
+    auto plan = FFTPlan::get(fftSize);
+    Spectrogram spectrogram;
+    spectrogram.fftSize = fftSize;
+    spectrogram.hopSize = hopSize;
+    spectrogram.bins = plan->bins();
+    spectrogram.sampleRate = sampleRate;
+    
+    const size_t n = audio.size();
+    if (n == 0) return spectrogram;
+    spectrogram.frames = n <= fftSize ? 1 : 1 + (n - fftSize + hopSize - 1) / hopSize;
+    spectrogram.magnitude.resize(spectrogram.frames * spectrogram.bins);
+    
+    const size_t tasks = (spectrogram.frames + kFramesPerTask - 1) / kFramesPerTask;
+    auto runTask = [&](size_t task) {
+        std::vector<float> frame(fftSize);
+        std::vector<std::complex<float>> spectrum(plan->bins());
+        const std::vector<float>& window = plan->window();
+        
+        size_t end = std::min(spectrogram.frames, (task + 1) * kFramesPerTask);
+        for (size_t f = task * kFramesPerTask; f < end; ++f) {
+            const size_t start = f * hopSize;
+            const size_t available = std::min(fftSize, n - start);
+            for (size_t i = 0; i < available; ++i) frame[i] = audio[start + i] * window[i];
+            std::fill(frame.begin() + available, frame.end(), 0.0f);
+            
+            plan->forward(frame.data(), spectrum.data());
+            float* magnitude = spectrogram.magnitude.data() + f * spectrogram.bins;
+            for (size_t k = 0; k < spectrogram.bins; ++k) {
+                magnitude[k] = std::sqrt(spectrum[k].real() * spectrum[k].real()
+                                         + spectrum[k].imag() * spectrum[k].imag());
+            }
+        }
+    };
+    
+    if (parallel && tasks > 1) {
+        ThreadPool::shared()->parallelFor(tasks, runTask);
+    } else {
+        for (size_t task = 0; task < tasks; ++task) runTask(task);
+    }
+    return spectrogram;
+}
+
+// SpectralAnalysis implementation
+SpectralAnalysis::SpectralAnalysis(const AudioBuffer& audio, double sampleRate)
+    : SpectralAnalysis(audio, sampleRate, Options{}) {
+}
+
+SpectralAnalysis::SpectralAnalysis(const AudioBuffer& audio, double sampleRate, const Options& options)
+    : sampleRate_(sampleRate) {
+    if (options.fftSizes.empty()) {
+        throw AIAudioException("Spectral analysis needs at least one FFT size");
+    }
+    
+    resolutions_.reserve(options.fftSizes.size());
+    for (size_t fftSize : options.fftSizes) {
+        size_t hop = std::max<size_t>(1, fftSize / std::max<size_t>(1, options.hopDivisor));
+        resolutions_.push_back(computeSpectrogram(audio, sampleRate, fftSize, hop, options.parallel));
+    }
+    analyzeFinest();
+}
+
+size_t SpectralAnalysis::getBarkFrames() const {
+    return barkEnergy_.size() / kBarkBands;
+}
+
+void SpectralAnalysis::analyzeFinest() {
+    const Spectrogram& spectrogram = largest(resolutions_);
+    
+    std::vector<uint8_t> band(spectrogram.bins);
+    for (size_t k = 0; k < spectrogram.bins; ++k) {
+        double bark = PerceptualMapper::hzToBark(Hz{spectrogram.binFrequency(k)});
+        band[k] = static_cast<uint8_t>(std::min<double>(kBarkBands - 1, std::floor(bark)));
+    }
+    
+    double weighted = 0.0;
+    double total = 0.0;
+    barkEnergy_.assign(spectrogram.frames * kBarkBands, 0.0f);
+    for (size_t f = 0; f < spectrogram.frames; ++f) {
+        const float* magnitude = spectrogram.frame(f);
+        float* energy = barkEnergy_.data() + f * kBarkBands;
+        for (size_t k = 0; k < spectrogram.bins; ++k) {
+            weighted += magnitude[k] * spectrogram.binFrequency(k);
+            total += magnitude[k];
+            energy[band[k]] += magnitude[k] * magnitude[k];
+        }
+    }
+    centroid_ = total > 0.0 ? weighted / total : 0.0;
+}
+
+// Losses
+double multiresSTFTLoss(const SpectralAnalysis& reference, const SpectralAnalysis& generated) {
+    const auto& ref = reference.getResolutions();
+    const auto& gen = generated.getResolutions();
+    if (ref.size() != gen.size() || reference.getSampleRate() != generated.getSampleRate()) {
+        throw AIAudioException("STFT loss needs analyses at the same resolutions");
+    }
+    
+    double loss = 0.0;
+    for (size_t r = 0; r < ref.size(); ++r) {
+        if (ref[r].fftSize != gen[r].fftSize || ref[r].hopSize != gen[r].hopSize) {
+            throw AIAudioException("STFT loss needs analyses at the same resolutions");
+        }
+        
+        const size_t values = std::min(ref[r].frames, gen[r].frames) * ref[r].bins;
+        if (values == 0) continue;
+        const float* a = ref[r].magnitude.data();
+        const float* b = gen[r].magnitude.data();
+        
+        double difference = 0.0;
+        double norm = 0.0;
+        double logDifference = 0.0;
+        for (size_t i = 0; i < values; ++i) {
+            double d = a[i] - b[i];
+            difference += d * d;
+            norm += static_cast<double>(a[i]) * a[i];
+            logDifference += std::abs(std::log(std::max(a[i], kMagnitudeFloor)
+                                               / std::max(b[i], kMagnitudeFloor)));
+        }
+        
+        double convergence = norm > 0.0 ? std::sqrt(difference / norm) : (difference > 0.0 ? 1.0 : 0.0);
+        loss += convergence + logDifference / values;
+    }
+    return loss / ref.size();
+}
+
+double barkLoudnessError(const SpectralAnalysis& reference, const SpectralAnalysis& generated) {
+    const auto& a = reference.getBarkEnergy();
+    const auto& b = generated.getBarkEnergy();
+    const size_t values = std::min(a.size(), b.size());
+    
+    double difference = 0.0;
+    double total = 0.0;
+    for (size_t i = 0; i < values; ++i) {
+        double la = std::pow(static_cast<double>(a[i]), kLoudnessExponent);
+        double lb = std::pow(static_cast<double>(b[i]), kLoudnessExponent);
+        difference += std::abs(la - lb);
+        total += la;
+    }
+    if (total > 0.0) return difference / total;
+    return difference > 0.0 ? 1.0 : 0.0;
+}
+
+} // namespace aiaudio
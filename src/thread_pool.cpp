@@ -0,0 +1,186 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace aiaudio {
+
+namespace {
+
+// Worker identity, so tasks submitted from a worker land on its own queue
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+// Idle iterations before a worker parks on the condition variable
+constexpr int kSpinLimit = 256;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    for (size_t i = 0; i < numThreads; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+        workers_.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stop_ = true;
+    }
+    sleepCv_.notify_all();
+    
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::shared() {
+    static std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>();
+    return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    size_t target = currentPool == this ? currentWorker
+                                        : nextQueue_.fetch_add(1) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    pendingTasks_.fetch_add(1);
+    
+    // Lock pairs with the predicate check so a parking worker cannot miss it
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+    }
+    sleepCv_.notify_one();
+}
+
+bool ThreadPool::popTask(size_t self, std::function<void()>& task) {
+    // Own queue first (newest task, still warm in cache)
+    {
+        WorkQueue& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pendingTasks_.fetch_sub(1);
+            return true;
+        }
+    }
+    
+    // Then steal the oldest task from another worker
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        WorkQueue& victim = *queues_[(self + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pendingTasks_.fetch_sub(1);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    
+    int idleSpins = 0;
+    while (!stop_) {
+        if (jobActive_) {
+            helpParallel();
+            idleSpins = 0;
+            continue;
+        }
+        
+        std::function<void()> task;
+        if (pendingTasks_ > 0 && popTask(index, task)) {
+            task();
+            idleSpins = 0;
+            continue;
+        }
+        
+        if (++idleSpins < kSpinLimit) {
+            std::this_thread::yield();
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepCv_.wait(lock, [this]() {
+            return stop_ || jobActive_ || pendingTasks_ > 0;
+        });
+        idleSpins = 0;
+    }
+}
+
+void ThreadPool::runParallel(size_t count, IndexFn fn, void* context) {
+    if (count == 0) return;
+    
+    // Slot taken (concurrent or nested call) or nothing to share: run inline
+    if (count == 1 || jobBusy_.exchange(true)) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(context, i);
+        }
+        return;
+    }
+    
+    jobFn_ = fn;
+    jobContext_ = context;
+    jobCount_ = count;
+    jobError_ = nullptr;
+    jobFailed_ = false;
+    jobNext_ = 0;
+    jobDone_ = 0;
+    jobActive_ = true;
+    
+    // Wakes parked workers without taking the lock; a missed wakeup only
+    // means the caller does more of the work itself
+    sleepCv_.notify_all();
+    
+    helpParallel();
+    while (jobDone_ < count) {
+        std::this_thread::yield();
+    }
+    
+    // No worker may still be reading the job fields when the slot is reused
+    jobActive_ = false;
+    while (jobHelpers_ > 0) {
+        std::this_thread::yield();
+    }
+    
+    std::exception_ptr error = jobError_;
+    jobBusy_ = false;
+    
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::helpParallel() {
+    jobHelpers_.fetch_add(1);
+    
+    if (jobActive_) {
+        size_t index;
+        while ((index = jobNext_.fetch_add(1)) < jobCount_) {
+            try {
+                jobFn_(jobContext_, index);
+            } catch (...) {
+                if (!jobFailed_.exchange(true)) {
+                    jobError_ = std::current_exception();
+                }
+            }
+            jobDone_.fetch_add(1);
+        }
+    }
+    
+    jobHelpers_.fetch_sub(1);
+}
+
+} // namespace aiaudio
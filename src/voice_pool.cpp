@@ -0,0 +1,347 @@
+#include "voice_pool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace aiaudio {
+
+namespace {
+
+constexpr double kMaxFrequency = 20000.0;  // OscillatorStage frequency range
+constexpr double kMinFrequency = 20.0;
+
+double noteFrequency(int note) {
+    return 440.0 * std::pow(2.0, (note - 69) / 12.0);
+}
+
+} // namespace
+
+// VoicePool implementation
+VoicePool::VoicePool(const DSPGraph& patch) : VoicePool(patch, Options{}) {
+}
+
+VoicePool::VoicePool(const DSPGraph& patch, const Options& options)
+    : maxVoices_(options.maxVoices),
+      maxBlockSize_(options.maxBlockSize),
+      sampleRate_(patch.getSampleRate()),
+      kernels_(options.kernels ? options.kernels : &getActiveKernels()) {
+    if (maxVoices_ == 0 || maxBlockSize_ == 0) {
+        throw AIAudioException("Voice pool needs at least one voice and a positive block size");
+    }
+    
+    // Voices run the stages as one chain, in the graph's plan order
+    if (!patch.isChain()) {
+        throw AIAudioException("Voice patch must be a single chain of stages");
+    }
+    
+    double root = 0.0;
+    for (const auto& name : patch.getAudioOrder()) {
+        const DSPStage* stage = patch.getStage(name);
+        if (!stage) continue;
+        
+        switch (stage->getType()) {
+            case StageType::OSCILLATOR:
+            case StageType::WAVETABLE: {
+                // WavetableStage uses the same parameter indices
+                double frequency = stage->getParameterValue(OscillatorStage::FREQUENCY);
+                if (root == 0.0) root = frequency;
+                const auto waveform = static_cast<Waveform>(std::lround(stage->getParameterValue(OscillatorStage::WAVE_TYPE)));
+                oscillators_.push_back({
+                    waveform, true, frequency / root,
+                    stage->getParameterValue(OscillatorStage::AMPLITUDE),
+                    stage->getParameterValue(OscillatorStage::PHASE) * 2.0 * M_PI,
+                    stage->getType() == StageType::WAVETABLE ? sharedWavetable(waveform) : nullptr});
+                program_.push_back({StageType::OSCILLATOR, oscillators_.size() - 1});
+                break;
+            }
+            case StageType::LFO:
+                oscillators_.push_back({
+                    static_cast<Waveform>(std::lround(stage->getParameterValue(LFOStage::WAVE_TYPE))),
+                    false, stage->getParameterValue(LFOStage::RATE),
+                    stage->getParameterValue(LFOStage::DEPTH), 0.0, nullptr});
+                program_.push_back({StageType::OSCILLATOR, oscillators_.size() - 1});
+                break;
+            case StageType::FILTER: {
+                const auto* filter = dynamic_cast<const FilterStage*>(stage);
+                if (!filter) {
+                    throw AIAudioException("Unsupported filter in voice patch: " + stage->getDescription());
+                }
+                filters_.push_back(filter->computeCoefficients());
+                program_.push_back({StageType::FILTER, filters_.size() - 1});
+                break;
+            }
+            case StageType::ENVELOPE: {
+                double sustain = stage->getParameterValue(EnvelopeStage::SUSTAIN);
+                envelopes_.push_back({
+                    1.0 / (stage->getParameterValue(EnvelopeStage::ATTACK) * sampleRate_),
+                    (1.0 - sustain) / (stage->getParameterValue(EnvelopeStage::DECAY) * sampleRate_),
+                    sustain,
+                    1.0 / (stage->getParameterValue(EnvelopeStage::RELEASE) * sampleRate_)});
+                program_.push_back({StageType::ENVELOPE, envelopes_.size() - 1});
+                break;
+            }
+            case StageType::SPATIAL:
+                // Voices are mono, where panning passes through
+                break;
+            default:
+                throw AIAudioException("Unsupported stage in voice patch: " + stage->getDescription());
+        }
+    }
+    if (root == 0.0) {
+        throw AIAudioException("Voice patch needs an oscillator stage");
+    }
+    
+    phase_.assign(oscillators_.size() * maxVoices_, 0.0);
+    increment_.assign(oscillators_.size() * maxVoices_, 0.0);
+    biquad_.assign(filters_.size() * maxVoices_, BiquadState{});
+    envPhase_.assign(envelopes_.size() * maxVoices_, EnvPhase::IDLE);
+    envLevel_.assign(envelopes_.size() * maxVoices_, 0.0);
+    
+    note_.assign(maxVoices_, -1);
+    velocity_.assign(maxVoices_, 0.0f);
+    started_.assign(maxVoices_, 0);
+    releasing_.assign(maxVoices_, 0);
+    slot_.assign(maxVoices_, kInactive);
+    active_.reserve(maxVoices_);
+    free_.reserve(maxVoices_);
+    for (size_t v = maxVoices_; v-- > 0;) free_.push_back(static_cast<uint32_t>(v));
+    
+    voiceBuffers_.assign(maxVoices_ * maxBlockSize_, 0.0f);
+    lanes_.assign(maxVoices_, nullptr);
+    laneState_.assign(maxVoices_, BiquadState{});
+}
+
+size_t VoicePool::noteOn(int note, double velocity) {
+    if (note < 0 || note > 127) {
+        throw AIAudioException("MIDI note out of range: " + std::to_string(note));
+    }
+    if (velocity < 0.0 || velocity > 1.0) {
+        throw AIAudioException("Velocity out of range: " + std::to_string(velocity));
+    }
+    
+    size_t voice = claimVoice();
+    startVoice(voice, note, velocity);
+    return voice;
+}
+
+void VoicePool::noteOff(int note) {
+    // Backwards, since releasing may free a voice out of active_
+    for (size_t i = active_.size(); i-- > 0;) {
+        uint32_t voice = active_[i];
+        if (note_[voice] == note && !releasing_[voice]) releaseVoice(voice);
+    }
+}
+
+void VoicePool::allNotesOff() {
+    for (size_t i = active_.size(); i-- > 0;) {
+        if (!releasing_[active_[i]]) releaseVoice(active_[i]);
+    }
+}
+
+void VoicePool::process(Sample* output, size_t n) {
+    for (size_t offset = 0; offset < n; offset += maxBlockSize_) {
+        processBlock(output + offset, std::min(maxBlockSize_, n - offset));
+    }
+}
+
+void VoicePool::reset() {
+    active_.clear();
+    free_.clear();
+    for (size_t v = maxVoices_; v-- > 0;) free_.push_back(static_cast<uint32_t>(v));
+    std::fill(slot_.begin(), slot_.end(), kInactive);
+    std::fill(releasing_.begin(), releasing_.end(), 0);
+    std::fill(note_.begin(), note_.end(), -1);
+}
+
+size_t VoicePool::claimVoice() {
+    if (!free_.empty()) {
+        uint32_t voice = free_.back();
+        free_.pop_back();
+        slot_[voice] = static_cast<uint32_t>(active_.size());
+        active_.push_back(voice);
+        return voice;
+    }
+    
+    // Steal the oldest releasing voice, else the oldest; it stays active
+    uint32_t victim = active_.front();
+    for (uint32_t voice : active_) {
+        if (releasing_[voice] != releasing_[victim]) {
+            if (releasing_[voice]) victim = voice;
+        } else if (started_[voice] < started_[victim]) {
+            victim = voice;
+        }
+    }
+    ++stolen_;
+    return victim;
+}
+
+void VoicePool::startVoice(size_t voice, int note, double velocity) {
+    note_[voice] = note;
+    velocity_[voice] = static_cast<Sample>(velocity);
+    started_[voice] = noteCounter_++;
+    releasing_[voice] = 0;
+    
+    const double pitch = noteFrequency(note);
+    for (size_t o = 0; o < oscillators_.size(); ++o) {
+        const OscillatorParams& osc = oscillators_[o];
+        double frequency = osc.keyed
+            ? std::clamp(pitch * osc.frequency, kMinFrequency, kMaxFrequency)
+            : osc.frequency;
+        phase_[o * maxVoices_ + voice] = 0.0;
+        increment_[o * maxVoices_ + voice] = 2.0 * M_PI * frequency / sampleRate_;
+    }
+    for (size_t f = 0; f < filters_.size(); ++f) {
+        biquad_[f * maxVoices_ + voice] = BiquadState{};
+    }
+    for (size_t e = 0; e < envelopes_.size(); ++e) {
+        envPhase_[e * maxVoices_ + voice] = EnvPhase::ATTACK;
+        envLevel_[e * maxVoices_ + voice] = 0.0;
+    }
+}
+
+void VoicePool::releaseVoice(size_t voice) {
+    if (envelopes_.empty()) {
+        freeVoice(voice);
+        return;
+    }
+    
+    releasing_[voice] = 1;
+    for (size_t e = 0; e < envelopes_.size(); ++e) {
+        EnvPhase& phase = envPhase_[e * maxVoices_ + voice];
+        if (phase != EnvPhase::IDLE) phase = EnvPhase::RELEASE;
+    }
+}
+
+void VoicePool::freeVoice(size_t voice) {
+    // Swap with the last active voice so active_ stays dense
+    const uint32_t position = slot_[voice];
+    const uint32_t last = active_.back();
+    active_[position] = last;
+    slot_[last] = position;
+    active_.pop_back();
+    
+    slot_[voice] = kInactive;
+    releasing_[voice] = 0;
+    note_[voice] = -1;
+    free_.push_back(static_cast<uint32_t>(voice));
+}
+
+bool VoicePool::finished(size_t voice) const {
+    if (!releasing_[voice]) return false;
+    for (size_t e = 0; e < envelopes_.size(); ++e) {
+        if (envPhase_[e * maxVoices_ + voice] != EnvPhase::IDLE) return false;
+    }
+    return true;
+}
+
+void VoicePool::processBlock(Sample* output, size_t n) {
+    std::fill_n(output, n, 0.0f);
+    const size_t count = active_.size();
+    if (count == 0) return;
+    
+    for (size_t i = 0; i < count; ++i) {
+        lanes_[i] = voiceBuffers_.data() + active_[i] * maxBlockSize_;
+        std::fill_n(lanes_[i], n, 0.0f);
+    }
+    
+    for (const Operation& op : program_) {
+        const size_t row = op.index * maxVoices_;
+        switch (op.type) {
+            case StageType::OSCILLATOR: {
+                const OscillatorParams& osc = oscillators_[op.index];
+                for (size_t i = 0; i < count; ++i) {
+                    const size_t state = row + active_[i];
+                    if (osc.table) {
+                        renderWavetable(*osc.table, lanes_[i], lanes_[i], n, phase_[state],
+                                        increment_[state], osc.phaseOffset, osc.gain);
+                    } else {
+                        renderOscillator(osc.waveform, lanes_[i], lanes_[i], n, phase_[state],
+                                         increment_[state], osc.phaseOffset, osc.gain, kernels_);
+                    }
+                }
+                break;
+            }
+            case StageType::FILTER:
+                // Shared coefficients, one voice per vector lane
+                for (size_t i = 0; i < count; ++i) laneState_[i] = biquad_[row + active_[i]];
+                kernels_->biquad(lanes_.data(), lanes_.data(), count, n, filters_[op.index], laneState_.data());
+                for (size_t i = 0; i < count; ++i) biquad_[row + active_[i]] = laneState_[i];
+                break;
+            case StageType::ENVELOPE:
+                for (size_t i = 0; i < count; ++i) {
+                    const size_t state = row + active_[i];
+                    applyEnvelope(envelopes_[op.index], envPhase_[state], envLevel_[state], lanes_[i], n);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        const Sample gain = velocity_[active_[i]];
+        const Sample* voice = lanes_[i];
+        for (size_t j = 0; j < n; ++j) output[j] += gain * voice[j];
+    }
+    
+    // Retire voices whose release has run out
+    for (size_t i = count; i-- > 0;) {
+        if (finished(active_[i])) freeVoice(active_[i]);
+    }
+}
+
+void VoicePool::applyEnvelope(const EnvelopeParams& envelope, EnvPhase& phase, double& level,
+                              Sample* data, size_t n) const {
+    // Same segments as EnvelopeStage, gated by the note
+    size_t i = 0;
+    while (i < n) {
+        switch (phase) {
+            case EnvPhase::ATTACK:
+                while (i < n && phase == EnvPhase::ATTACK) {
+                    level += envelope.attackRate;
+                    if (level >= 1.0) {
+                        level = 1.0;
+                        phase = EnvPhase::DECAY;
+                    }
+                    data[i++] *= static_cast<Sample>(level);
+                }
+                break;
+            
+            case EnvPhase::DECAY:
+                while (i < n && phase == EnvPhase::DECAY) {
+                    level -= envelope.decayRate;
+                    if (level <= envelope.sustain) {
+                        level = envelope.sustain;
+                        phase = EnvPhase::SUSTAIN;
+                    }
+                    data[i++] *= static_cast<Sample>(level);
+                }
+                break;
+            
+            case EnvPhase::SUSTAIN:
+                // Note-off lands between blocks, so the rest of the block is flat
+                level = envelope.sustain;
+                kernels_->applyGain(data + i, n - i, static_cast<Sample>(level));
+                i = n;
+                break;
+            
+            case EnvPhase::RELEASE:
+                while (i < n && phase == EnvPhase::RELEASE) {
+                    level -= envelope.releaseRate;
+                    if (level <= 0.0) {
+                        level = 0.0;
+                        phase = EnvPhase::IDLE;
+                    }
+                    data[i++] *= static_cast<Sample>(level);
+                }
+                break;
+            
+            case EnvPhase::IDLE:
+                level = 0.0;
+                std::fill(data + i, data + n, 0.0f);
+                i = n;
+                break;
+        }
+    }
+}
+
+} // namespace aiaudio
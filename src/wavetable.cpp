@@ -0,0 +1,321 @@
+#include "wavetable.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <mutex>
+
+namespace aiaudio {
+
+namespace {
+
+constexpr size_t kNumWaveforms = static_cast<size_t>(Waveform::TRIANGLE) + 1;
+constexpr double kTwoPi = 2.0 * M_PI;
+
+// Parameter names in Param enum order, the same as OscillatorStage's
+constexpr std::string_view kParameters[] = {"frequency", "amplitude", "phase", "waveType"};
+
+// Fourier series of the oscillator shapes, in the phase convention of
+// renderOscillator (saw rises from -1, square is high for the first half
+// cycle, triangle starts at -1 and peaks half way)
+std::shared_ptr<const Wavetable> buildWavetable(Waveform waveform) {
+    std::vector<double> sine(Wavetable::kMaxHarmonics, 0.0), cosine(Wavetable::kMaxHarmonics, 0.0);
+    for (size_t h = 0; h < Wavetable::kMaxHarmonics; ++h) {
+        const double k = static_cast<double>(h + 1);
+        switch (waveform) {
+            case Waveform::SINE:
+                if (h == 0) sine[h] = 1.0;
+                break;
+            case Waveform::SAW:
+                sine[h] = -2.0 / (M_PI * k);
+                break;
+            case Waveform::SQUARE:
+                if (h % 2 == 0) sine[h] = 4.0 / (M_PI * k);
+                break;
+            case Waveform::TRIANGLE:
+                if (h % 2 == 0) cosine[h] = -8.0 / (M_PI * M_PI * k * k);
+                break;
+        }
+    }
+    return Wavetable::fromHarmonics(sine, cosine);
+}
+
+struct WavetableCache {
+    std::mutex mutex;
+    std::array<std::shared_ptr<const Wavetable>, kNumWaveforms> tables;
+};
+
+WavetableCache& wavetableCache() {
+    static WavetableCache cache;
+    return cache;
+}
+
+// Radians to the 32-bit fixed-point phase of Wavetable::lookup
+uint32_t fixedPhase(double radians) {
+    double cycles = radians / kTwoPi;
+    cycles -= std::floor(cycles);
+    return static_cast<uint32_t>(static_cast<uint64_t>(cycles * 4294967296.0) & 0xffffffffu);
+}
+
+Waveform waveformFromIndex(double value) {
+    int ordinal = static_cast<int>(std::lround(value));
+    if (ordinal < 0 || ordinal > static_cast<int>(Waveform::TRIANGLE)) {
+        throw AIAudioException("Waveform index out of range: " + std::to_string(ordinal));
+    }
+    return static_cast<Waveform>(ordinal);
+}
+
+} // namespace
+
+// Wavetable implementation
+std::shared_ptr<const Wavetable> Wavetable::fromHarmonics(const std::vector<double>& sineAmplitudes,
+                                                          const std::vector<double>& cosineAmplitudes) {
+    // One cycle of sin; harmonic k at sample n reads it at (k * n) mod N
+    std::vector<double> sinTable(kTableSize);
+    for (size_t n = 0; n < kTableSize; ++n) {
+        sinTable[n] = std::sin(kTwoPi * n / kTableSize);
+    }
+    
+    const size_t harmonics = std::min(kMaxHarmonics, std::max(sineAmplitudes.size(), cosineAmplitudes.size()));
+    auto amplitude = [](const std::vector<double>& amplitudes, size_t h) {
+        return h < amplitudes.size() ? amplitudes[h] : 0.0;
+    };
+    
+    auto table = std::shared_ptr<Wavetable>(new Wavetable());
+    table->samples_.resize(kLevels * kLevelStride);
+    std::vector<double> cycle(kTableSize);
+    
+    // Coarsest level first; each finer level adds the next band of harmonics
+    size_t summed = 0;
+    for (size_t m = kLevels; m-- > 0;) {
+        const size_t levelHarmonics = std::min(harmonics, kMaxHarmonics >> m);
+        for (; summed < levelHarmonics; ++summed) {
+            const double a = amplitude(sineAmplitudes, summed), b = amplitude(cosineAmplitudes, summed);
+            if (a == 0.0 && b == 0.0) continue;
+            const size_t k = summed + 1;
+            for (size_t n = 0; n < kTableSize; ++n) {
+                const size_t index = (k * n) & (kTableSize - 1);
+                cycle[n] += a * sinTable[index] + b * sinTable[(index + kTableSize / 4) & (kTableSize - 1)];
+            }
+        }
+        
+        float* out = table->samples_.data() + m * kLevelStride;
+        for (size_t n = 0; n < kTableSize; ++n) {
+            out[n] = static_cast<float>(cycle[n]);
+        }
+        out[kTableSize] = out[0];
+    }
+    return table;
+}
+
+size_t Wavetable::levelFor(double cyclesPerSample) {
+    // Level m tops out at kMaxHarmonics >> m, which must stay below Nyquist:
+    // (kMaxHarmonics >> m) * cyclesPerSample < 0.5
+    const double x = 2.0 * kMaxHarmonics * std::abs(cyclesPerSample);
+    if (!(x >= 1.0)) return 0;
+    return std::min(static_cast<size_t>(std::ilogb(x)) + 1, kLevels - 1);
+}
+
+std::shared_ptr<const Wavetable> sharedWavetable(Waveform waveform) {
+    WavetableCache& cache = wavetableCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto& table = cache.tables[static_cast<size_t>(waveform)];
+    if (!table) table = buildWavetable(waveform);
+    return table;
+}
+
+size_t trimWavetableCache() {
+    WavetableCache& cache = wavetableCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    size_t freed = 0;
+    for (auto& table : cache.tables) {
+        if (table && table.use_count() == 1) {
+            freed += table->memoryBytes();
+            table.reset();
+        }
+    }
+    return freed;
+}
+
+size_t wavetableCacheBytes() {
+    WavetableCache& cache = wavetableCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    size_t bytes = 0;
+    for (const auto& table : cache.tables) {
+        if (table) bytes += table->memoryBytes();
+    }
+    return bytes;
+}
+
+void renderWavetable(const Wavetable& table, const Sample* input, Sample* output, size_t n,
+                     double& phase, double increment, double phaseOffset, double gain,
+                     double gainStep) {
+    const float* samples = table.level(Wavetable::levelFor(increment / kTwoPi));
+    uint32_t position = fixedPhase(phase + phaseOffset);
+    const uint32_t step = fixedPhase(increment);
+    
+    if (gainStep == 0.0) {
+        const float scale = static_cast<float>(gain);
+        for (size_t i = 0; i < n; ++i) {
+            output[i] = Wavetable::lookup(samples, position) * scale + input[i];
+            position += step;    // Wraps at one cycle
+        }
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            output[i] = Wavetable::lookup(samples, position) * static_cast<float>(gain) + input[i];
+            position += step;
+            gain += gainStep;
+        }
+    }
+    
+    // The radian accumulator advances exactly as renderOscillator's does
+    phase += increment * static_cast<double>(n);
+    phase -= kTwoPi * std::floor(phase / kTwoPi);
+}
+
+// WavetableStage implementation
+WavetableStage::WavetableStage() : table_(sharedWavetable(Waveform::SINE)) {
+}
+
+WavetableStage::WavetableStage(const OscillatorStage& oscillator) : WavetableStage() {
+    frequency_.setValue(oscillator.getParameterValue(OscillatorStage::FREQUENCY));
+    amplitude_.setValue(oscillator.getParameterValue(OscillatorStage::AMPLITUDE));
+    phase_.setValue(oscillator.getParameterValue(OscillatorStage::PHASE));
+    setWaveform(waveformFromIndex(oscillator.getParameterValue(OscillatorStage::WAVE_TYPE)));
+}
+
+void WavetableStage::setWaveform(Waveform waveform) {
+    if (waveform == waveform_ && table_) return;
+    table_ = sharedWavetable(waveform);
+    waveform_ = waveform;
+}
+
+void WavetableStage::render(const Sample* input, Sample* output, size_t n, double& phase, double increment,
+                            double phaseOffset) {
+    size_t done = 0;
+    if (rampRemaining_ > 0) {
+        done = std::min(n, rampRemaining_);
+        const double step = (amplitude_.value - rampGain_) / static_cast<double>(rampRemaining_);
+        renderWavetable(*table_, input, output, done, phase, increment, phaseOffset, rampGain_ + step, step);
+    }
+    renderWavetable(*table_, input + done, output + done, n - done, phase, increment, phaseOffset,
+                    amplitude_.value);
+}
+
+void WavetableStage::process(const AudioBuffer& input, AudioBuffer& output) {
+    output.resize(input.size());
+    
+    double phaseIncrement = 2.0 * M_PI * frequency_.value / sampleRate_;
+    double phaseOffset = phase_.value * 2.0 * M_PI;
+    render(input.data(), output.data(), input.size(), phaseAccumulator_, phaseIncrement, phaseOffset);
+    advanceRamp(input.size());
+}
+
+void WavetableStage::processChannels(const PlanarBuffer& input, PlanarBuffer& output) {
+    output.resize(input.size());
+    const size_t numFrames = input.empty() ? 0 : input[0].size();
+    
+    double phaseIncrement = 2.0 * M_PI * frequency_.value / sampleRate_;
+    double phaseOffset = phase_.value * 2.0 * M_PI;
+    
+    // Every channel starts from the same phase and gain
+    const double startPhase = phaseAccumulator_;
+    for (size_t c = 0; c < input.size(); ++c) {
+        output[c].resize(numFrames);
+        phaseAccumulator_ = startPhase;
+        render(input[c].data(), output[c].data(), numFrames, phaseAccumulator_, phaseIncrement, phaseOffset);
+    }
+    advanceRamp(numFrames);
+}
+
+void WavetableStage::advanceRamp(size_t n) {
+    if (n == 0) return;
+    if (n < rampRemaining_) {
+        rampGain_ += (amplitude_.value - rampGain_) / static_cast<double>(rampRemaining_) * static_cast<double>(n);
+        rampRemaining_ -= n;
+    } else {
+        rampGain_ = amplitude_.value;
+        rampRemaining_ = 0;
+    }
+    hasGain_ = true;
+}
+
+void WavetableStage::setParameter(const std::string& name, const ParamValue& value) {
+    if (name == "frequency") {
+        frequency_.setValue(std::get<double>(value));
+    } else if (name == "amplitude") {
+        amplitude_.setValue(std::get<double>(value));
+    } else if (name == "phase") {
+        phase_.setValue(std::get<double>(value));
+    } else if (name == "waveType") {
+        setWaveform(parseWaveform(std::get<std::string>(value)));
+    }
+}
+
+ParamValue WavetableStage::getParameter(const std::string& name) const {
+    if (name == "frequency") return frequency_.value;
+    if (name == "amplitude") return amplitude_.value;
+    if (name == "phase") return phase_.value;
+    if (name == "waveType") return waveformName(waveform_);
+    return 0.0;
+}
+
+void WavetableStage::setParameterValue(int index, double value) {
+    switch (index) {
+        case FREQUENCY: frequency_.setValue(value); break;
+        case AMPLITUDE: amplitude_.setValue(value); break;
+        case PHASE: phase_.setValue(value); break;
+        case WAVE_TYPE: setWaveform(waveformFromIndex(value)); break;
+        default: DSPStage::setParameterValue(index, value);
+    }
+}
+
+double WavetableStage::getParameterValue(int index) const {
+    switch (index) {
+        case FREQUENCY: return frequency_.value;
+        case AMPLITUDE: return amplitude_.value;
+        case PHASE: return phase_.value;
+        case WAVE_TYPE: return static_cast<double>(waveform_);
+        default: return DSPStage::getParameterValue(index);
+    }
+}
+
+ParamRange WavetableStage::getParameterRange(int index) const {
+    switch (index) {
+        case FREQUENCY: return {frequency_.min, frequency_.max};
+        case AMPLITUDE: return {amplitude_.min, amplitude_.max};
+        case PHASE: return {phase_.min, phase_.max};
+        case WAVE_TYPE: return {0.0, static_cast<double>(Waveform::TRIANGLE)};
+        default: return DSPStage::getParameterRange(index);
+    }
+}
+
+void WavetableStage::setParameterTarget(int index, double value, size_t frames) {
+    if (index != AMPLITUDE || frames == 0) {
+        setParameterValue(index, value);
+        return;
+    }
+    if (!hasGain_) rampGain_ = amplitude_.value;
+    amplitude_.setValue(value);
+    rampRemaining_ = rampGain_ == value ? 0 : frames;
+}
+
+std::vector<std::string> WavetableStage::getParameterNames() const {
+    return std::vector<std::string>(std::begin(kParameters), std::end(kParameters));
+}
+
+int WavetableStage::getParameterIndex(const std::string& name) const {
+    return findParameterIndex(kParameters, name);
+}
+
+void WavetableStage::reset() {
+    phaseAccumulator_ = 0.0;
+    rampRemaining_ = 0;
+    hasGain_ = false;
+}
+
+std::string WavetableStage::getDescription() const {
+    return "Wavetable: band-limited " + waveformName(waveform_) + " wave at " +
+           std::to_string(frequency_.value) + " Hz";
+}
+
+} // namespace aiaudio
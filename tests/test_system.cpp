@@ -1,7 +1,25 @@
 #include "main_app.h"
+#include "compiled_preset.h"
+#include "metrics.h"
+#include "render_cache.h"
+#include "spectral.h"
+#include "thread_pool.h"
+#include "voice_pool.h"
+#include "wavetable.h"
 #include <gtest/gtest.h>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <type_traits>
 
 using namespace aiaudio;
 
@@ -331,6 +349,2127 @@ TEST_F(AIAudioGeneratorTest, MemoryManagement) {
     EXPECT_TRUE(status.initialized);
 }
 
+// Test compiled execution plan
+TEST(DSPGraphTest, ExecutionPlanInvalidation) {
+    DSPGraph graph;
+    graph.addStage("osc1", std::make_unique<OscillatorStage>());
+    graph.addStage("filter1", std::make_unique<FilterStage>());
+    graph.addConnection({"osc1", "filter1"});
+    
+    EXPECT_EQ(graph.getExecutionPlan().getStages().size(), 2);
+    EXPECT_EQ(graph.getExecutionPlan().getStages().front(), graph.getStage("osc1"));
+    
+    // Plan is cached until the topology changes
+    ExecutionPlan* plan = &graph.getExecutionPlan();
+    EXPECT_EQ(&graph.getExecutionPlan(), plan);
+    
+    graph.removeStage("filter1");
+    EXPECT_EQ(graph.getExecutionPlan().getStages().size(), 1);
+    
+    // Repeated blocks reuse prepared buffers
+    graph.prepare(256);
+    AudioBuffer input(256, 0.0f);
+    AudioBuffer output;
+    graph.process(input, output);
+    graph.process(input, output);
+    EXPECT_EQ(output.size(), 256);
+    EXPECT_GE(graph.getExecutionPlan().getMaxBlockSize(), 256);
+}
+
+// Test block streaming
+TEST(StreamingRendererTest, BlocksMatchOfflineRender) {
+    auto makeGraph = [] {
+        DSPGraph graph;
+        graph.addStage("osc1", std::make_unique<OscillatorStage>());
+        graph.addStage("filter1", std::make_unique<FilterStage>());
+        graph.addConnection({"osc1", "filter1"});
+        return graph;
+    };
+    
+    DSPGraph offlineGraph = makeGraph();
+    AudioBuffer silence(1000, 0.0f);
+    AudioBuffer offline;
+    offlineGraph.process(silence, offline);
+    
+    // Stage state carries across blocks, so the streamed result is identical
+    DSPGraph streamGraph = makeGraph();
+    StreamingRenderer renderer(streamGraph, 128);
+    AudioBuffer streamed;
+    size_t blocks = 0;
+    size_t rendered = renderer.render(1000, [&](const AudioBuffer& block) {
+        EXPECT_LE(block.size(), 128);
+        streamed.insert(streamed.end(), block.begin(), block.end());
+        blocks++;
+        return true;
+    });
+    
+    EXPECT_EQ(rendered, 1000);
+    EXPECT_EQ(blocks, 8);
+    ASSERT_EQ(streamed.size(), offline.size());
+    for (size_t i = 0; i < offline.size(); ++i) {
+        EXPECT_FLOAT_EQ(streamed[i], offline[i]);
+    }
+}
+
+// Test planar stereo processing
+TEST(DSPGraphTest, StereoPanInOnePass) {
+    DSPGraph graph;
+    graph.addStage("osc1", std::make_unique<OscillatorStage>());
+    auto spatial = std::make_unique<SpatialStage>();
+    spatial->setParameter("pan", -1.0);
+    graph.addStage("pan1", std::move(spatial));
+    graph.addConnection({"osc1", "pan1"});
+    graph.prepare(256, 2);
+    
+    PlanarBuffer input(2, AudioBuffer(256, 0.0f));
+    PlanarBuffer output;
+    graph.process(input, output);
+    
+    ASSERT_EQ(output.size(), 2);
+    ASSERT_EQ(output[0].size(), 256);
+    
+    // Hard left: all energy in channel 0
+    double energyL = 0.0, energyR = 0.0;
+    for (size_t i = 0; i < 256; ++i) {
+        energyL += output[0][i] * output[0][i];
+        energyR += output[1][i] * output[1][i];
+    }
+    EXPECT_GT(energyL, 0.0);
+    EXPECT_NEAR(energyR, 0.0, 1e-6);
+}
+
+// Test SIMD-compiled graph against the scalar path
+TEST(IRCompilerTest, SIMDMatchesScalar) {
+    DSPGraph graph;
+    graph.addStage("osc1", std::make_unique<OscillatorStage>());
+    graph.addStage("filter1", std::make_unique<FilterStage>());
+    graph.addConnection({"osc1", "filter1"});
+    
+    IRCompiler compiler;
+    IRCompiler::CompileOptions options;
+    options.enableSIMD = true;
+    auto compiled = compiler.compile(graph, options);
+    ASSERT_EQ(compiled->getStageNames().size(), 2);
+    
+    PlanarBuffer input(2, AudioBuffer(1000, 0.0f));
+    PlanarBuffer scalarOut, simdOut;
+    graph.process(input, scalarOut);
+    compiled->process(input, simdOut);
+    
+    ASSERT_EQ(simdOut.size(), 2);
+    for (size_t c = 0; c < 2; ++c) {
+        ASSERT_EQ(simdOut[c].size(), 1000);
+        for (size_t i = 0; i < 1000; ++i) {
+            EXPECT_NEAR(simdOut[c][i], scalarOut[c][i], 1e-4);
+        }
+    }
+}
+
+// Test indexed parameter access and enum-backed waveform selection
+TEST(DSPStageTest, IndexedParameters) {
+    OscillatorStage osc;
+    int amplitude = osc.getParameterIndex("amplitude");
+    EXPECT_EQ(amplitude, OscillatorStage::AMPLITUDE);
+    EXPECT_EQ(osc.getParameterIndex("missing"), -1);
+    
+    osc.setParameterValue(amplitude, 0.25);
+    EXPECT_DOUBLE_EQ(std::get<double>(osc.getParameter("amplitude")), 0.25);
+    
+    osc.setParameterValue(OscillatorStage::WAVE_TYPE, static_cast<double>(Waveform::SAW));
+    EXPECT_EQ(std::get<std::string>(osc.getParameter("waveType")), "saw");
+    EXPECT_THROW(osc.setParameter("waveType", std::string("noise")), AIAudioException);
+    EXPECT_THROW(osc.setParameterValue(42, 1.0), AIAudioException);
+    
+    // Highpass rejects DC once settled
+    FilterStage filter;
+    filter.setParameter("filterType", std::string("highpass"));
+    filter.setParameter("resonance", 0.7);
+    AudioBuffer dc(4096, 1.0f), out;
+    filter.process(dc, out);
+    EXPECT_NEAR(out.back(), 0.0, 1e-3);
+}
+
+// Test that independent branches run level-parallel with deterministic output
+TEST(DSPGraphTest, ParallelBranchesMatchSerial) {
+    auto buildGraph = []() {
+        DSPGraph graph;
+        for (int branch = 0; branch < 3; ++branch) {
+            std::string id = std::to_string(branch);
+            auto osc = std::make_unique<OscillatorStage>();
+            osc->setParameter("frequency", 220.0 * (branch + 1));
+            graph.addStage("osc" + id, std::move(osc));
+            graph.addStage("filter" + id, std::make_unique<FilterStage>());
+            graph.addConnection({"osc" + id, "filter" + id});
+        }
+        return graph;
+    };
+    
+    DSPGraph serial = buildGraph();
+    serial.setThreadPool(std::make_shared<ThreadPool>(1));
+    DSPGraph parallel = buildGraph();
+    parallel.setThreadPool(std::make_shared<ThreadPool>(4));
+    
+    const auto& levels = parallel.getParallelPlan().getLevels();
+    ASSERT_EQ(levels.size(), 2);
+    EXPECT_EQ(levels[0].size(), 3);
+    EXPECT_EQ(levels[1].size(), 3);
+    
+    AudioBuffer input(512, 0.0f), serialOut, parallelOut;
+    for (int block = 0; block < 8; ++block) {
+        serial.process(input, serialOut);
+        parallel.process(input, parallelOut);
+        ASSERT_EQ(serialOut, parallelOut);
+    }
+}
+
+TEST(DSPGraphTest, SequentialAndParallelPlansRouteAlike) {
+    // Two oscillator -> filter branches mixed into one envelope
+    auto buildGraph = []() {
+        DSPGraph graph;
+        for (int branch = 0; branch < 2; ++branch) {
+            std::string id = std::to_string(branch);
+            auto osc = std::make_unique<OscillatorStage>();
+            osc->setParameter("frequency", 220.0 * (branch + 1));
+            osc->setParameter("amplitude", 0.4);
+            graph.addStage("osc" + id, std::move(osc));
+            auto filter = std::make_unique<FilterStage>();
+            filter->setParameter("cutoff", 800.0 * (branch + 1));
+            graph.addStage("filter" + id, std::move(filter));
+            graph.addConnection({"osc" + id, "filter" + id});
+            graph.addConnection({"filter" + id, "env"});
+        }
+        graph.addStage("env", std::make_unique<EnvelopeStage>());
+        return graph;
+    };
+    
+    DSPGraph sequential = buildGraph();
+    DSPGraph parallel = buildGraph();
+    parallel.setThreadPool(std::make_shared<ThreadPool>(4));
+    EXPECT_FALSE(sequential.isChain());
+    EXPECT_FALSE(sequential.getExecutionPlan().isChain());
+    ASSERT_EQ(parallel.getParallelPlan().getLevels().size(), 3u);
+    
+    // The same routing by hand: the envelope reads the sum of the filters
+    OscillatorStage osc0, osc1;
+    osc0.setParameter("frequency", 220.0);
+    osc1.setParameter("frequency", 440.0);
+    osc0.setParameter("amplitude", 0.4);
+    osc1.setParameter("amplitude", 0.4);
+    FilterStage filter0, filter1;
+    filter0.setParameter("cutoff", 800.0);
+    filter1.setParameter("cutoff", 1600.0);
+    EnvelopeStage env;
+    
+    AudioBuffer input(256, 0.0f), sequentialOut, parallelOut;
+    AudioBuffer a, b, branch0, branch1, expected;
+    for (int block = 0; block < 4; ++block) {
+        sequential.process(input, sequentialOut);
+        parallel.process(input, parallelOut);
+        ASSERT_EQ(sequentialOut, parallelOut);
+        
+        osc0.process(input, a);
+        filter0.process(a, branch0);
+        osc1.process(input, b);
+        filter1.process(b, branch1);
+        for (size_t i = 0; i < branch0.size(); ++i) {
+            branch0[i] += branch1[i];
+        }
+        env.process(branch0, expected);
+        ASSERT_EQ(sequentialOut, expected);
+    }
+    
+    // Multichannel blocks route the same way
+    PlanarBuffer planar(2, AudioBuffer(128, 0.0f)), sequentialPlanar, parallelPlanar;
+    sequential.process(planar, sequentialPlanar);
+    parallel.process(planar, parallelPlanar);
+    EXPECT_EQ(sequentialPlanar, parallelPlanar);
+    
+    // Without audio connections a graph still chains its stages in order
+    DSPGraph unconnected;
+    unconnected.addStage("osc", std::make_unique<OscillatorStage>());
+    unconnected.addStage("filter", std::make_unique<FilterStage>());
+    EXPECT_TRUE(unconnected.isChain());
+    EXPECT_TRUE(unconnected.getExecutionPlan().isChain());
+}
+
+// Test batch generation against sequential calls
+TEST_F(AIAudioGeneratorTest, GenerateBatchMatchesSequential) {
+    std::vector<AIAudioGenerator::GenerationRequest> requests;
+    for (auto role : {Role::PAD, Role::BASS, Role::LEAD, Role::PAD, Role::BASS, Role::LEAD}) {
+        AIAudioGenerator::GenerationRequest request;
+        request.prompt = "batch sound";
+        request.role = role;
+        request.context.tempo = 120.0;
+        request.durationSeconds = 0.5;
+        requests.push_back(request);
+    }
+    
+    generator->setThreadPool(std::make_shared<ThreadPool>(4));
+    std::vector<size_t> completed;
+    auto results = generator->generateBatch(requests,
+        [&completed](size_t index, const AIAudioGenerator::GenerationResult& result) {
+            EXPECT_GT(result.audio.size(), 0);
+            completed.push_back(index);
+        });
+    
+    ASSERT_EQ(results.size(), requests.size());
+    std::sort(completed.begin(), completed.end());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        EXPECT_EQ(completed[i], i);
+        
+        auto expected = generator->generate(requests[i]);
+        EXPECT_EQ(results[i].audio, expected.audio);
+        EXPECT_DOUBLE_EQ(results[i].qualityScore, expected.qualityScore);
+    }
+}
+
+// Test flat-index top-k search against a brute-force ranking
+TEST(SemanticSearchTest, TopKMatchesBruteForce) {
+    SemanticSearchEngine engine(std::make_unique<SemanticFusionEngine>(std::make_unique<SimpleEmbedding>(64)));
+    SemanticFusionEngine reference(std::make_unique<SimpleEmbedding>(64));
+    
+    std::vector<EntryVectorBuilder::EntryData> entries;
+    for (int i = 0; i < 40; ++i) {
+        EntryVectorBuilder::EntryData data;
+        data.id = "entry" + std::to_string(i);
+        data.tags = {"tag" + std::to_string(i % 7), "tag" + std::to_string(i % 3)};
+        data.description = "preset " + std::to_string(i);
+        data.role = i % 2 ? Role::BASS : Role::PAD;
+        entries.push_back(data);
+        engine.addEntry(data);
+    }
+    for (int i = 0; i < 40; i += 5) {
+        engine.removeEntry("entry" + std::to_string(i));
+    }
+    
+    auto expected = [&](const std::string& query, Role role, size_t k) {
+        EmbeddingVector queryVec = reference.getEmbedding().encode(query);
+        std::vector<std::pair<double, std::string>> scored;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (i % 5 == 0 || (role != Role::UNKNOWN && entries[i].role != role)) continue;
+            EmbeddingVector entryVec = reference.processEntry(entries[i].tags, entries[i].description);
+            scored.push_back({-reference.semanticScore(queryVec, entryVec), entries[i].id});
+        }
+        std::sort(scored.begin(), scored.end());
+        scored.resize(std::min(k, scored.size()));
+        return scored;
+    };
+    
+    for (Role role : {Role::UNKNOWN, Role::BASS, Role::PAD, Role::LEAD}) {
+        auto results = engine.search("warm analog", role, 5);
+        auto brute = expected("warm analog", role, 5);
+        ASSERT_EQ(results.size(), brute.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            EXPECT_NEAR(results[i].score, -brute[i].first, 1e-5);
+            EXPECT_FALSE(results[i].explanation.empty());
+        }
+    }
+    
+    EXPECT_EQ(engine.search("warm analog", Role::UNKNOWN, 100).size(), 32);
+    EXPECT_TRUE(engine.search("warm analog", Role::UNKNOWN, 0).empty());
+}
+
+// Test the IVF backend against exact search
+TEST(SemanticSearchTest, IVFIndexMatchesExactAtFullProbe) {
+    auto makeEngine = []() {
+        return std::make_unique<SemanticSearchEngine>(
+            std::make_unique<SemanticFusionEngine>(std::make_unique<SimpleEmbedding>(32)));
+    };
+    auto exact = makeEngine();
+    auto approx = makeEngine();
+    
+    IVFIndex::Params params;
+    params.minTrainSize = 64;
+    params.nlist = 8;
+    approx->setANNIndex(std::make_unique<IVFIndex>(params));
+    auto setNProbe = [&](size_t nprobe) {
+        approx->tuneANNIndex([&](ANNIndex& index) {
+            static_cast<IVFIndex&>(index).setNProbe(nprobe);
+        });
+    };
+    auto* ivf = static_cast<const IVFIndex*>(approx->getANNIndex());
+    
+    // Few LEAD entries, so a role-filtered probe would starve without widening
+    for (int i = 0; i < 300; ++i) {
+        EntryVectorBuilder::EntryData data;
+        data.id = "entry" + std::to_string(i);
+        data.tags = {"tag" + std::to_string(i)};
+        data.description = "preset " + std::to_string(i);
+        data.role = i % 50 == 0 ? Role::LEAD : (i % 2 ? Role::BASS : Role::PAD);
+        exact->addEntry(data);
+        approx->addEntry(data);
+    }
+    for (int i = 0; i < 300; i += 7) {
+        exact->removeEntry("entry" + std::to_string(i));
+        approx->removeEntry("entry" + std::to_string(i));
+    }
+    ASSERT_TRUE(ivf->isTrained());
+    
+    setNProbe(1);
+    EXPECT_EQ(approx->search("bright lead", Role::LEAD, 5).size(),
+              exact->search("bright lead", Role::LEAD, 5).size());
+    
+    setNProbe(ivf->getListCount());
+    for (Role role : {Role::UNKNOWN, Role::PAD, Role::LEAD}) {
+        auto expected = exact->search("bright lead", role, 10);
+        auto results = approx->search("bright lead", role, 10);
+        ASSERT_EQ(results.size(), expected.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            EXPECT_EQ(results[i].entryId, expected[i].entryId);
+        }
+    }
+}
+
+// Test that retuning the ANN backend drops result lists ranked under the old settings
+TEST(SemanticSearchTest, RetuningANNIndexInvalidatesCachedResults) {
+    auto makeEngine = [] {
+        return std::make_unique<SemanticSearchEngine>(
+            std::make_unique<SemanticFusionEngine>(std::make_unique<SimpleEmbedding>(32)));
+    };
+    auto exact = makeEngine();
+    auto approx = makeEngine();
+    
+    IVFIndex::Params params;
+    params.minTrainSize = 64;
+    params.nlist = 8;
+    approx->setANNIndex(std::make_unique<IVFIndex>(params));
+    for (int i = 0; i < 300; ++i) {
+        EntryVectorBuilder::EntryData data;
+        data.id = "entry" + std::to_string(i);
+        data.tags = {"tag" + std::to_string(i)};
+        data.description = "preset " + std::to_string(i);
+        data.role = i % 2 ? Role::BASS : Role::PAD;
+        exact->addEntry(data);
+        approx->addEntry(data);
+    }
+    auto* ivf = static_cast<const IVFIndex*>(approx->getANNIndex());
+    ASSERT_TRUE(ivf->isTrained());
+    
+    approx->tuneANNIndex([](ANNIndex& index) { static_cast<IVFIndex&>(index).setNProbe(1); });
+    approx->search("warm pad", Role::UNKNOWN, 10);
+    approx->search("warm pad", Role::UNKNOWN, 10);
+    CacheStats before = approx->getResultCacheStats();
+    EXPECT_EQ(before.hits, 1u);
+    
+    const uint64_t generation = approx->getGeneration();
+    approx->tuneANNIndex([&](ANNIndex& index) {
+        static_cast<IVFIndex&>(index).setNProbe(ivf->getListCount());
+    });
+    EXPECT_GT(approx->getGeneration(), generation);
+    EXPECT_EQ(ivf->getNProbe(), ivf->getListCount());
+    
+    auto expected = exact->search("warm pad", Role::UNKNOWN, 10);
+    auto results = approx->search("warm pad", Role::UNKNOWN, 10);
+    EXPECT_EQ(approx->getResultCacheStats().hits, before.hits);
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_EQ(results[i].entryId, expected[i].entryId);
+    }
+    
+    // Without a backend there is nothing to tune
+    exact->tuneANNIndex([](ANNIndex&) { ADD_FAILURE(); });
+}
+
+// Test saving and mapping the search index
+TEST(SemanticSearchTest, MappedIndexRoundTrip) {
+    auto makeEngine = [](size_t dimension) {
+        return std::make_unique<SemanticSearchEngine>(
+            std::make_unique<SemanticFusionEngine>(std::make_unique<SimpleEmbedding>(dimension)));
+    };
+    auto original = makeEngine(32);
+    for (int i = 0; i < 50; ++i) {
+        EntryVectorBuilder::EntryData data;
+        data.id = "entry" + std::to_string(i);
+        data.tags = {"tag" + std::to_string(i % 5)};
+        data.description = "preset " + std::to_string(i);
+        data.metadata["brightness"] = i * 0.01;
+        data.role = i % 3 ? Role::PAD : Role::BASS;
+        original->addEntry(data);
+    }
+    original->removeEntry("entry7");
+    
+    const std::string path = ::testing::TempDir() + "aiaudio_index.bin";
+    original->saveIndex(path);
+    
+    auto loaded = makeEngine(32);
+    loaded->loadIndex(path);
+    EXPECT_TRUE(loaded->isMapped());
+    EXPECT_EQ(loaded->getEntryCount(), original->getEntryCount());
+    for (Role role : {Role::UNKNOWN, Role::BASS}) {
+        auto expected = original->search("soft pad", role, 8);
+        auto results = loaded->search("soft pad", role, 8);
+        ASSERT_EQ(results.size(), expected.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            EXPECT_EQ(results[i].entryId, expected[i].entryId);
+            EXPECT_EQ(results[i].score, expected[i].score);
+        }
+    }
+    
+    // First modification copies the vectors out of the mapping
+    loaded->removeEntry("entry0");
+    EXPECT_FALSE(loaded->isMapped());
+    EXPECT_EQ(loaded->getEntryCount(), original->getEntryCount() - 1);
+    
+    // Indexes from another model shape are rejected
+    EXPECT_THROW(makeEngine(64)->loadIndex(path), AIAudioException);
+    
+    // So are corrupted files
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(200);
+        file.put('\x7f');
+    }
+    EXPECT_THROW(makeEngine(32)->loadIndex(path), AIAudioException);
+    std::remove(path.c_str());
+}
+
+// Test the query-vector and result caches
+TEST(SemanticSearchTest, QueryCacheHitsAndInvalidation) {
+    SemanticSearchEngine engine(std::make_unique<SemanticFusionEngine>(std::make_unique<SimpleEmbedding>(32)));
+    for (int i = 0; i < 20; ++i) {
+        EntryVectorBuilder::EntryData data;
+        data.id = "entry" + std::to_string(i);
+        data.tags = {"tag" + std::to_string(i % 4)};
+        data.description = "preset " + std::to_string(i);
+        data.role = i % 2 ? Role::PAD : Role::BASS;
+        engine.addEntry(data);
+    }
+    
+    // Equivalent prompts share a hash; role and tags are part of it
+    EXPECT_EQ(computeQueryHash("  Dreamy   Atmospheric pad ", Role::PAD),
+              computeQueryHash("dreamy atmospheric pad", Role::PAD));
+    EXPECT_EQ(computeQueryHash("pad", Role::PAD, {"b", "a"}), computeQueryHash("pad", Role::PAD, {"a", "b"}));
+    EXPECT_NE(computeQueryHash("pad", Role::PAD), computeQueryHash("pad", Role::BASS));
+    EXPECT_NE(computeQueryHash("pad", Role::PAD, {"a"}), computeQueryHash("pad", Role::PAD, {}, {"a"}));
+    EXPECT_EQ(computeQueryHash("pad", Role::PAD).size(), 16);
+    
+    auto first = engine.search("Dreamy pad", Role::PAD, 5);
+    auto second = engine.search("dreamy  pad", Role::PAD, 5);
+    ASSERT_EQ(second.size(), first.size());
+    for (size_t i = 0; i < first.size(); ++i) {
+        EXPECT_EQ(second[i].entryId, first[i].entryId);
+    }
+    EXPECT_EQ(engine.getResultCacheStats().hits, 1);
+    EXPECT_EQ(engine.getResultCacheStats().misses, 1);
+    
+    // Another role re-ranks but reuses the query vector
+    engine.search("dreamy pad", Role::BASS, 5);
+    EXPECT_EQ(engine.getVectorCacheStats().hits, 1);
+    
+    // Index changes invalidate result lists
+    EntryVectorBuilder::EntryData extra;
+    extra.id = "extra";
+    extra.description = "dreamy pad";
+    extra.role = Role::PAD;
+    engine.addEntry(extra);
+    auto refreshed = engine.search("dreamy pad", Role::PAD, 5);
+    EXPECT_EQ(engine.getResultCacheStats().misses, 3);
+    EXPECT_TRUE(std::any_of(refreshed.begin(), refreshed.end(), [](const auto& r) {
+        return r.entryId == "extra";
+    }));
+    
+    // Capacity 0 disables caching
+    engine.setQueryCacheCapacity(0);
+    engine.search("dreamy pad", Role::PAD, 5);
+    EXPECT_EQ(engine.getResultCacheStats().size, 0);
+}
+
+// Test batched and int8 MLP inference against the single-row path
+TEST(DecisionMLPTest, BatchAndInt8MatchForward) {
+    DecisionMLP model(40, {32, 16}, 8);
+    const size_t batch = 70;
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> inputs(batch * model.getInputSize());
+    for (float& value : inputs) value = dist(gen);
+    
+    std::vector<float> outputs(batch * model.getOutputSize());
+    model.forwardBatch(inputs.data(), batch, outputs.data());
+    std::vector<std::vector<double>> expected;
+    for (size_t b = 0; b < batch; ++b) {
+        const float* row = inputs.data() + b * model.getInputSize();
+        expected.push_back(model.forward(std::vector<double>(row, row + model.getInputSize())));
+        for (size_t o = 0; o < model.getOutputSize(); ++o) {
+            EXPECT_NEAR(outputs[b * model.getOutputSize() + o], expected[b][o], 1e-5);
+        }
+    }
+    
+    // Quantized outputs stay close to the float model
+    model.quantizeToInt8();
+    EXPECT_TRUE(model.isQuantized());
+    model.forwardBatch(inputs.data(), batch, outputs.data());
+    for (size_t b = 0; b < batch; ++b) {
+        for (size_t o = 0; o < model.getOutputSize(); ++o) {
+            EXPECT_NEAR(outputs[b * model.getOutputSize() + o], expected[b][o], 0.02);
+        }
+    }
+    
+    // Batched heads agree with per-context inference
+    DecisionHeads heads(std::make_unique<DecisionMLP>(30, std::vector<size_t>{16}, 6));
+    std::vector<DecisionContext> contexts(5);
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        contexts[i].queryVector.assign(19, 0.1 * i);
+        contexts[i].role = static_cast<Role>(i);
+        contexts[i].tempo = 120.0;
+        contexts[i].key = static_cast<int>(i);
+    }
+    auto batched = heads.inferBatch(contexts);
+    ASSERT_EQ(batched.size(), contexts.size());
+    for (size_t i = 0; i < contexts.size(); ++i) {
+        // Blocked and single-row kernels may sum in a different order
+        auto single = heads.infer(contexts[i]).values;
+        ASSERT_EQ(batched[i].values.size(), single.size());
+        for (size_t v = 0; v < single.size(); ++v) {
+            EXPECT_NEAR(batched[i].values[v], single[v], 1e-6);
+        }
+    }
+    contexts[0].queryVector.push_back(0.0);
+    EXPECT_THROW(heads.inferBatch(contexts), AIAudioException);
+}
+
+// Test ONNX loading failures leave the packed MLP in charge
+TEST(DecisionMLPTest, ONNXLoadFailureKeepsPackedModel) {
+    ONNXModel model;
+    EXPECT_FALSE(model.isLoaded());
+    EXPECT_THROW(model.runInference(std::vector<double>(4)), AIAudioException);
+    EXPECT_THROW(model.loadModel(::testing::TempDir() + "missing_model.onnx"), AIAudioException);
+    
+    DecisionMLP mlp(4, {3}, 2);
+    EXPECT_THROW(mlp.loadFromONNX(::testing::TempDir() + "missing_model.onnx"), AIAudioException);
+    EXPECT_THROW(mlp.setONNXModel(std::make_shared<ONNXModel>()), AIAudioException);
+    EXPECT_FALSE(mlp.usesONNX());
+    EXPECT_EQ(mlp.forward({0.1, 0.2, 0.3, 0.4}).size(), 2);
+}
+
+// Test decision application through the per-topology parameter bindings
+TEST(DecisionHeadsTest, AppliesDecisionsThroughCachedBindings) {
+    DecisionHeads heads(std::make_unique<DecisionMLP>(8, std::vector<size_t>{8}, 4));
+    auto makeGraph = [] {
+        DSPGraph graph;
+        graph.addStage("osc", std::make_unique<OscillatorStage>());
+        graph.addStage("filter", std::make_unique<FilterStage>());
+        graph.addConnection({"osc", "filter"});
+        return graph;
+    };
+    DecisionOutput decisions;
+    decisions.parameterValues = {{"cutoff", 30000.0}, {"frequency", 330.0}, {"missing", 1.0}};
+    
+    // Values land on the stage that has them, clamped to its range
+    DSPGraph first = makeGraph();
+    heads.applyDecisions(first, decisions);
+    EXPECT_EQ(first.getStage("filter")->getParameterValue(FilterStage::CUTOFF), 20000.0);
+    EXPECT_EQ(first.getStage("osc")->getParameterValue(OscillatorStage::FREQUENCY), 330.0);
+    
+    // Another graph of the same topology reuses the bindings
+    DSPGraph second = makeGraph();
+    decisions.parameterValues["frequency"] = 550.0;
+    heads.applyDecisions(second, decisions);
+    EXPECT_EQ(second.getStage("osc")->getParameterValue(OscillatorStage::FREQUENCY), 550.0);
+    EXPECT_EQ(heads.getBindingCacheStats().hits, 1u);
+    EXPECT_EQ(heads.getBindingCacheStats().misses, 1u);
+    
+    // A new topology binds again
+    DSPGraph filterOnly;
+    filterOnly.addStage("filter", std::make_unique<FilterStage>());
+    heads.applyDecisions(filterOnly, decisions);
+    EXPECT_EQ(filterOnly.getStage("filter")->getParameterValue(FilterStage::CUTOFF), 20000.0);
+    EXPECT_EQ(heads.getBindingCacheStats().misses, 2u);
+    
+    // Built-in stages resolve every name to its position in the table
+    std::vector<std::unique_ptr<DSPStage>> stages;
+    stages.push_back(std::make_unique<OscillatorStage>());
+    stages.push_back(std::make_unique<WavetableStage>());
+    stages.push_back(std::make_unique<FilterStage>());
+    stages.push_back(std::make_unique<EnvelopeStage>());
+    stages.push_back(std::make_unique<LFOStage>());
+    stages.push_back(std::make_unique<SpatialStage>());
+    for (const auto& stage : stages) {
+        const auto names = stage->getParameterNames();
+        for (size_t i = 0; i < names.size(); ++i) {
+            EXPECT_EQ(stage->getParameterIndex(names[i]), static_cast<int>(i)) << names[i];
+        }
+        EXPECT_EQ(stage->getParameterIndex("bogus"), -1);
+    }
+}
+
+// Test minibatch backprop on a target that needs the hidden layer
+TEST(DecisionTrainerTest, MinibatchBackpropLearnsStream) {
+    // Sign of x0 * x1 (not linearly separable) plus a linear output
+    class XorStream : public TrainingSampleStream {
+    public:
+        size_t getInputSize() const override { return 4; }
+        size_t getTargetSize() const override { return 2; }
+        size_t read(size_t count, float* inputs, float* targets, float* weights) override {
+            size_t rows = std::min<size_t>(count, 512 - produced_);
+            std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+            for (size_t r = 0; r < rows; ++r) {
+                float* x = inputs + r * 4;
+                for (size_t i = 0; i < 4; ++i) x[i] = dist(gen_);
+                targets[r * 2] = x[0] * x[1] > 0.0f ? 0.9f : 0.1f;
+                targets[r * 2 + 1] = 0.5f + 0.4f * x[2];
+                weights[r] = 1.0f;
+            }
+            produced_ += rows;
+            return rows;
+        }
+        void rewind() override {
+            gen_.seed(11);
+            produced_ = 0;
+        }
+        
+    private:
+        std::mt19937 gen_{11};
+        size_t produced_ = 0;
+    };
+    
+    DecisionMLP model(4, {32}, 2);
+    model.quantizeToInt8();
+    DecisionTrainer trainer;
+    XorStream samples;
+    double initial = trainer.evaluateLoss(model, samples);
+    
+    DecisionTrainer::Options options;
+    options.epochs = 300;
+    options.batchSize = 64;
+    options.learningRate = 0.5;
+    options.logInterval = 0;
+    auto losses = trainer.trainModel(model, samples, options);
+    ASSERT_EQ(losses.size(), options.epochs);
+    EXPECT_FALSE(model.isQuantized());
+    EXPECT_LT(losses.back(), losses.front());
+    EXPECT_LT(trainer.evaluateLoss(model, samples), 0.25 * initial);
+    
+    // Rule samples stream straight into the model's input layout
+    RuleSampleStream rules(Role::BASS, 100, 16, 0.05);
+    DecisionMLP ruleModel(rules.getInputSize(), {8}, rules.getTargetSize());
+    options.epochs = 2;
+    EXPECT_EQ(trainer.trainModel(ruleModel, rules, options).size(), 2);
+    
+    DecisionMLP wrongSize(rules.getInputSize() + 1, {8}, rules.getTargetSize());
+    EXPECT_THROW(trainer.trainModel(wrongSize, rules, options), AIAudioException);
+}
+
+// Test both non-dominated sorts against the front definition
+TEST(MOOOptimizerTest, NonDominatedSortAndSelection) {
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> level(0, 6);  // Coarse values force ties
+    std::vector<MOOOptimizer::ObjectiveRow> rows(300);
+    for (auto& row : rows) {
+        for (double& value : row) value = level(gen) / 6.0;
+    }
+    rows[1] = rows[0];  // Duplicates share a front
+    
+    auto dominates = [](const MOOOptimizer::ObjectiveRow& a, const MOOOptimizer::ObjectiveRow& b) {
+        bool better = false;
+        for (size_t m = 0; m < a.size(); ++m) {
+            if (a[m] < b[m]) return false;
+            better |= a[m] > b[m];
+        }
+        return better;
+    };
+    
+    auto ranks = MOOOptimizer::nonDominatedSort(rows, MOOOptimizer::SortMethod::EFFICIENT);
+    EXPECT_EQ(ranks, MOOOptimizer::nonDominatedSort(rows, MOOOptimizer::SortMethod::DOMINANCE));
+    EXPECT_EQ(ranks[0], ranks[1]);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        bool dominatedFromPrevious = ranks[i] == 0;
+        for (size_t j = 0; j < rows.size(); ++j) {
+            if (ranks[j] == ranks[i]) {
+                EXPECT_FALSE(dominates(rows[j], rows[i]));
+            }
+            if (ranks[j] + 1 == ranks[i] && dominates(rows[j], rows[i])) dominatedFromPrevious = true;
+        }
+        EXPECT_TRUE(dominatedFromPrevious);
+    }
+    
+    // Selection keeps whole better fronts and cuts only the last one
+    auto selected = MOOOptimizer::nsga2SelectIndices(rows, 100);
+    ASSERT_EQ(selected.size(), 100);
+    uint32_t cut = 0;
+    for (size_t index : selected) cut = std::max(cut, ranks[index]);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (ranks[i] < cut) {
+            EXPECT_NE(std::find(selected.begin(), selected.end(), i), selected.end());
+        }
+    }
+    
+    std::vector<size_t> front;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (ranks[i] == 0) front.push_back(i);
+    }
+    auto distances = MOOOptimizer::crowdingDistances(rows, front);
+    ASSERT_EQ(distances.size(), front.size());
+    EXPECT_TRUE(std::any_of(distances.begin(), distances.end(), [](double d) { return std::isinf(d); }));
+}
+
+// Test exact, sampled and incremental hypervolume agree
+TEST(MOOOptimizerTest, HypervolumeExactSampledAndIncremental) {
+    HypervolumeIndicator indicator;
+    EXPECT_DOUBLE_EQ(indicator.computeExact({{0.5, 0.5, 0.5, 0.5, 0.5}}), std::pow(0.5, 5));
+    
+    // Two boxes overlapping in half of each
+    std::vector<HypervolumeIndicator::Point> pair = {{1.0, 1.0, 1.0, 1.0, 0.5}, {0.5, 1.0, 1.0, 1.0, 1.0}};
+    EXPECT_NEAR(indicator.computeExact(pair), 0.75, 1e-12);
+    pair.push_back({0.4, 0.4, 0.4, 0.4, 0.4});  // Dominated: adds nothing
+    EXPECT_NEAR(indicator.computeExact(pair), 0.75, 1e-12);
+    
+    std::mt19937 gen(9);
+    std::uniform_real_distribution<double> dist(0.1, 1.0);
+    std::vector<HypervolumeIndicator::Point> front(40);
+    for (auto& point : front) {
+        for (double& value : point) value = dist(gen);
+    }
+    double exact = indicator.computeExact(front);
+    
+    // Adding points one by one sums their exclusive contributions
+    for (const auto& point : front) indicator.add(point);
+    EXPECT_TRUE(indicator.isExact());
+    EXPECT_NEAR(indicator.getValue(), exact, 1e-9);
+    EXPECT_LE(indicator.getFront().size(), front.size());
+    EXPECT_DOUBLE_EQ(indicator.add(front[0]), 0.0);
+    
+    // Above exactLimit the estimate is sampled and brackets the exact value
+    HypervolumeIndicator::Options options;
+    options.exactLimit = 8;
+    options.monteCarloSamples = 200000;
+    auto estimate = HypervolumeIndicator(options).compute(front);
+    EXPECT_FALSE(estimate.exact);
+    EXPECT_EQ(estimate.samples, options.monteCarloSamples);
+    EXPECT_GT(estimate.standardError, 0.0);
+    EXPECT_NEAR(estimate.value, exact, 4.0 * estimate.standardError);
+    EXPECT_LE(estimate.lower, estimate.value);
+    EXPECT_GE(estimate.upper, estimate.value);
+    EXPECT_EQ(estimate.value, HypervolumeIndicator(options).compute(front).value);
+}
+
+TEST(AudioStatsTest, FusedPassMatchesReference) {
+    std::mt19937 gen(17);
+    std::uniform_real_distribution<float> dist(-0.6f, 0.6f);
+    AudioBuffer audio(44100 + 37);
+    for (auto& sample : audio) sample = dist(gen) + 0.01f;
+    audio[5] = 1.5f;
+    audio[100] = -1.0f;
+    audio[200] = std::numeric_limits<float>::denorm_min();
+    audio[300] = std::numeric_limits<float>::quiet_NaN();
+    audio[301] = -std::numeric_limits<float>::infinity();
+    std::fill(audio.begin() + 1000, audio.begin() + 1100, 0.0f);
+    
+    // Vector kernel against the scalar one
+    SampleStats scalar, active;
+    getSIMDKernels(SIMDLevel::SCALAR).sampleStats(audio.data(), audio.size(), kSilenceThreshold, scalar);
+    getActiveKernels().sampleStats(audio.data(), audio.size(), kSilenceThreshold, active);
+    EXPECT_EQ(active.clipped, 2u);
+    EXPECT_EQ(active.denormals, 1u);
+    EXPECT_EQ(active.nonFinite, 2u);
+    EXPECT_EQ(active.silent, scalar.silent);
+    EXPECT_GE(active.silent, 101u);
+    EXPECT_EQ(active.zeroCrossings, scalar.zeroCrossings);
+    EXPECT_FLOAT_EQ(active.peak, 1.5f);
+    EXPECT_NEAR(active.sum, scalar.sum, 1e-9 * audio.size());
+    EXPECT_NEAR(active.sumSquares, scalar.sumSquares, 1e-9 * audio.size());
+    EXPECT_NEAR(active.sumAbs, scalar.sumAbs, 1e-9 * audio.size());
+    
+    // Against a naive pass with the non-finite samples zeroed
+    AudioBuffer finite = audio;
+    finite[300] = finite[301] = 0.0f;
+    double sum = 0.0, sumSquares = 0.0;
+    size_t crossings = 0;
+    for (size_t i = 0; i < finite.size(); ++i) {
+        sum += finite[i];
+        sumSquares += static_cast<double>(finite[i]) * finite[i];
+        if (i > 0) crossings += (finite[i] < 0.0f) != (finite[i - 1] < 0.0f);
+    }
+    AudioStats stats = analyzeAudio(audio);
+    EXPECT_EQ(stats.zeroCrossings, crossings);
+    EXPECT_NEAR(stats.dcOffset, sum / audio.size(), 1e-9);
+    EXPECT_NEAR(stats.rms, std::sqrt(sumSquares / audio.size()), 1e-9);
+    EXPECT_NEAR(stats.crestFactorDb, 20.0 * std::log10(1.5 / stats.rms), 1e-9);
+    
+    // Lane-parallel K-weighting against one serial pass
+    const double sampleRate = 48000.0;
+    AudioBuffer sine(2 * 48000);
+    for (size_t i = 0; i < sine.size(); ++i) {
+        sine[i] = static_cast<Sample>(0.5 * std::sin(2.0 * M_PI * 997.0 * i / sampleRate));
+    }
+    stats = analyzeAudio(sine, sampleRate);
+    
+    AudioBuffer weighted(sine.size());
+    const Sample* in[] = {sine.data()};
+    Sample* out[] = {weighted.data()};
+    BiquadState shelf, highPass;
+    auto filters = kWeightingFilter(sampleRate);
+    getSIMDKernels(SIMDLevel::SCALAR).biquad(in, out, 1, sine.size(), filters[0], &shelf);
+    getSIMDKernels(SIMDLevel::SCALAR).biquad(out, out, 1, sine.size(), filters[1], &highPass);
+    
+    ASSERT_EQ(stats.loudnessBlocks.size(), 20u);
+    for (size_t b = 0; b < stats.loudnessBlocks.size(); ++b) {
+        double reference = 0.0;
+        for (size_t i = b * 4800; i < (b + 1) * 4800; ++i) reference += static_cast<double>(weighted[i]) * weighted[i];
+        EXPECT_NEAR(stats.loudnessBlocks[b], reference / 4800, 1e-5 * stats.loudnessBlocks[b]);
+    }
+    
+    // BS.1770: a full-scale 997 Hz sine reads -3.01 LUFS, this one is 6 dB down
+    EXPECT_NEAR(stats.integratedLoudness, -9.03, 0.05);
+    EXPECT_DOUBLE_EQ(analyzeAudio(AudioBuffer(48000, 0.0f), sampleRate).integratedLoudness, kLoudnessFloor);
+}
+
+TEST(MetersTest, StreamingLoudnessAndTruePeak) {
+    // 3 s at -9 LUFS, then 3 s 40 dB down, which the relative gate drops
+    const double sampleRate = 48000.0;
+    AudioBuffer audio(6 * 48000);
+    for (size_t i = 0; i < audio.size(); ++i) {
+        double amplitude = i < audio.size() / 2 ? 0.5 : 0.005;
+        audio[i] = static_cast<Sample>(amplitude * std::sin(2.0 * M_PI * 997.0 * i / sampleRate));
+    }
+    
+    LoudnessMeter meter(sampleRate);
+    for (size_t i = 0; i < audio.size(); i += 333) {
+        meter.process(audio.data() + i, std::min<size_t>(333, audio.size() - i));
+    }
+    EXPECT_EQ(meter.getSamplesProcessed(), audio.size());
+    EXPECT_NEAR(meter.getMomentary(), -49.03, 0.1);
+    EXPECT_NEAR(meter.getShortTerm(), -49.03, 0.5);  // Includes the step transient
+    EXPECT_NEAR(meter.getIntegrated(), -9.03, 0.3);
+    EXPECT_NEAR(meter.getIntegrated(), analyzeAudio(audio, sampleRate).integratedLoudness, 0.1);
+    
+    meter.reset();
+    EXPECT_DOUBLE_EQ(meter.getIntegrated(), kLoudnessFloor);
+    
+    // A quarter-rate sine sampled 45 degrees off its crests: the sample
+    // peak is 3 dB below the true peak
+    AudioBuffer quarter(4800);
+    for (size_t i = 0; i < quarter.size(); ++i) {
+        quarter[i] = static_cast<Sample>(0.5 * std::sin(M_PI / 2.0 * i + M_PI / 4.0));
+    }
+    TruePeakMeter whole, blocks;
+    whole.process(quarter);
+    for (size_t i = 0; i < quarter.size(); i += 100) {
+        blocks.process(quarter.data() + i, 100);
+    }
+    EXPECT_NEAR(whole.getTruePeakDb(), 20.0 * std::log10(0.5), 0.2);
+    EXPECT_FLOAT_EQ(blocks.getTruePeak(), whole.getTruePeak());
+    EXPECT_GT(analyzeAudio(quarter, sampleRate).truePeakDb(), analyzeAudio(quarter, sampleRate).peakDb() + 2.5);
+}
+
+TEST(SpectralTest, FFTFramesAndLosses) {
+    // Real FFT against a direct DFT
+    const size_t size = 64;
+    std::mt19937 gen(19);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> input(size);
+    for (auto& x : input) x = dist(gen);
+    std::vector<std::complex<float>> spectrum(size / 2 + 1);
+    FFTPlan::get(size)->forward(input.data(), spectrum.data());
+    for (size_t k = 0; k <= size / 2; ++k) {
+        std::complex<double> expected = 0.0;
+        for (size_t n = 0; n < size; ++n) {
+            expected += static_cast<double>(input[n]) * std::polar(1.0, -2.0 * M_PI * k * n / size);
+        }
+        EXPECT_NEAR(spectrum[k].real(), expected.real(), 1e-4);
+        EXPECT_NEAR(spectrum[k].imag(), expected.imag(), 1e-4);
+    }
+    EXPECT_THROW(FFTPlan(48), AIAudioException);
+    
+    // A 1 kHz tone: centroid (window leakage pulls it up a little) and Bark band
+    const double sampleRate = 44100.0;
+    AudioBuffer tone(sampleRate);
+    for (size_t i = 0; i < tone.size(); ++i) {
+        tone[i] = 0.5f * static_cast<float>(std::sin(2.0 * M_PI * 1000.0 * i / sampleRate));
+    }
+    SpectralAnalysis analysis(tone, sampleRate);
+    ASSERT_EQ(analysis.getResolutions().size(), 3u);
+    EXPECT_NEAR(analysis.spectralCentroid(), 1000.0, 40.0);
+    EXPECT_NEAR(analyzeAudio(tone, sampleRate).spectralCentroid, 1000.0, 40.0);
+    
+    const auto& bark = analysis.getBarkEnergy();
+    const float* middle = bark.data() + analysis.getBarkFrames() / 2 * SpectralAnalysis::kBarkBands;
+    EXPECT_EQ(std::max_element(middle, middle + SpectralAnalysis::kBarkBands) - middle, 8);
+    
+    // Parallel frames match the serial pass
+    Spectrogram serial = computeSpectrogram(tone, sampleRate, 512, 128, false);
+    Spectrogram parallel = computeSpectrogram(tone, sampleRate, 512, 128, true);
+    EXPECT_EQ(serial.frames, 1 + (tone.size() - 512 + 127) / 128);
+    EXPECT_EQ(serial.magnitude, parallel.magnitude);
+    
+    // Losses: zero against itself, known values for a 6 dB drop (bins at the
+    // log-magnitude floor in both pull the log term slightly under log 2)
+    AudioBuffer quieter = tone;
+    for (auto& x : quieter) x *= 0.5f;
+    SpectralAnalysis half(quieter, sampleRate);
+    EXPECT_NEAR(multiresSTFTLoss(analysis, analysis), 0.0, 1e-6);
+    EXPECT_NEAR(barkLoudnessError(analysis, analysis), 0.0, 1e-6);
+    EXPECT_NEAR(multiresSTFTLoss(analysis, half), 0.5 + std::log(2.0), 0.03);
+    EXPECT_NEAR(barkLoudnessError(analysis, half), 1.0 - std::pow(0.25, 0.23), 0.01);
+    
+    SpectralAnalysis::Options coarse;
+    coarse.fftSizes = {1024};
+    EXPECT_THROW(multiresSTFTLoss(analysis, SpectralAnalysis(tone, sampleRate, coarse)), AIAudioException);
+}
+
+TEST(CandidatePruningTest, StreamingAnalysisAndVerdicts) {
+    // Block-by-block analysis against one analyzeAudio pass
+    const double sampleRate = 44100.0;
+    std::mt19937 gen(20);
+    std::uniform_real_distribution<float> dist(-0.3f, 0.3f);
+    AudioBuffer audio(kCentroidFFTSize * 40);
+    for (size_t i = 0; i < audio.size(); ++i) {
+        audio[i] = 0.4f * static_cast<float>(std::sin(2.0 * M_PI * 500.0 * i / sampleRate)) + dist(gen);
+    }
+    StreamingAnalyzer analyzer(sampleRate);
+    for (size_t i = 0; i < audio.size(); i += 300) {
+        analyzer.process(audio.data() + i, std::min<size_t>(300, audio.size() - i));
+    }
+    AudioStats streamed = analyzer.snapshot();
+    AudioStats whole = analyzeAudio(audio, sampleRate);
+    EXPECT_EQ(streamed.samples, whole.samples);
+    EXPECT_EQ(streamed.zeroCrossings, whole.zeroCrossings);
+    EXPECT_EQ(streamed.silentSamples, whole.silentSamples);
+    EXPECT_NEAR(streamed.rms, whole.rms, 1e-9);
+    EXPECT_NEAR(streamed.dcOffset, whole.dcOffset, 1e-9);
+    EXPECT_DOUBLE_EQ(streamed.peak, whole.peak);
+    EXPECT_NEAR(streamed.truePeak, whole.truePeak, 1e-6);
+    EXPECT_NEAR(streamed.spectralCentroid, whole.spectralCentroid, 1e-3 * whole.spectralCentroid);
+    EXPECT_NEAR(streamed.integratedLoudness, whole.integratedLoudness, 0.1);
+    
+    // Final verdicts fire at once, the heuristic ones after their windows
+    CandidatePruner pruner;
+    AudioConstraints constraints;
+    AudioStats partial = streamed;
+    partial.truePeak = 0.5;
+    partial.integratedLoudness = constraints.lufsTarget;
+    EXPECT_EQ(pruner.check(partial, constraints), CandidatePruner::Verdict::CONTINUE);
+    
+    AudioStats clipped = partial;
+    clipped.clippedSamples = 1;
+    EXPECT_EQ(pruner.check(clipped, constraints), CandidatePruner::Verdict::HARD_CLIP);
+    AudioStats broken = partial;
+    broken.nonFiniteSamples = 3;
+    EXPECT_EQ(pruner.check(broken, constraints), CandidatePruner::Verdict::NON_FINITE);
+    AudioStats hot = partial;
+    hot.truePeak = 1.0;
+    EXPECT_EQ(pruner.check(hot, constraints), CandidatePruner::Verdict::TRUE_PEAK);
+    
+    AudioStats quiet = partial;
+    quiet.integratedLoudness = -50.0;
+    quiet.samples = static_cast<size_t>(2.0 * sampleRate);
+    EXPECT_EQ(pruner.check(quiet, constraints), CandidatePruner::Verdict::CONTINUE);
+    quiet.samples = static_cast<size_t>(3.0 * sampleRate);
+    EXPECT_EQ(pruner.check(quiet, constraints), CandidatePruner::Verdict::LOUDNESS);
+    
+    // Dominance needs a clear lead on some objective and no loss elsewhere
+    MOOOptimizer::EvalMetrics weak;
+    weak.objectives = {0.5, 0.5, 0.5, 0.5, 0.5};
+    EXPECT_EQ(pruner.check(partial, constraints, &weak), CandidatePruner::Verdict::CONTINUE);
+    pruner.addToFront({0.5, 0.65, 0.5, 0.5, 0.5});
+    pruner.addToFront({0.55, 0.55, 0.5, 0.5, 0.5});
+    EXPECT_EQ(pruner.getFront().size(), 2u);
+    EXPECT_EQ(pruner.check(partial, constraints, &weak), CandidatePruner::Verdict::DOMINATED);
+    EXPECT_FALSE(pruner.isDominated({0.5, 0.6, 0.5, 0.5, 0.5}));
+    pruner.addToFront({0.6, 0.7, 0.5, 0.5, 0.5});
+    EXPECT_EQ(pruner.getFront().size(), 1u);
+    
+    AudioStats early = partial;
+    early.samples = static_cast<size_t>(0.5 * sampleRate);
+    EXPECT_EQ(pruner.check(early, constraints, &weak), CandidatePruner::Verdict::CONTINUE);
+}
+
+TEST(CandidatePruningTest, PipelineStopsHopelessRendersEarly) {
+    const std::string configPath = "pipeline_metrics.yaml";
+    std::ofstream(configPath) << "# defaults\n";
+    MOOOptimizer optimizer(configPath);
+    std::remove(configPath.c_str());
+    
+    auto makeCandidate = [](double amplitude, const std::string& waveType) {
+        DSPGraph graph;
+        auto osc = std::make_unique<OscillatorStage>();
+        osc->setParameter("frequency", 440.0);
+        osc->setParameter("amplitude", amplitude);
+        osc->setParameter("waveType", waveType);
+        graph.addStage("osc1", std::move(osc));
+        return graph;
+    };
+    auto makeCandidates = [&] {
+        std::vector<DSPGraph> candidates;
+        candidates.push_back(makeCandidate(0.18, "sine"));    // Near the -18 LUFS target
+        candidates.push_back(makeCandidate(1.0, "square"));   // Full-scale square: clips
+        candidates.push_back(makeCandidate(0.005, "sine"));   // About -50 LUFS
+        return candidates;
+    };
+    
+    CandidatePipeline::Options options;
+    options.durationSeconds = 4.0;
+    CandidatePipeline pipeline(optimizer, options);
+    auto candidates = makeCandidates();
+    auto results = pipeline.evaluate(candidates, Role::PAD, MusicalContext{}, AudioConstraints{});
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_FALSE(results[0].pruned());
+    EXPECT_DOUBLE_EQ(results[0].secondsRendered, 4.0);
+    EXPECT_EQ(results[1].verdict, CandidatePruner::Verdict::HARD_CLIP);
+    EXPECT_DOUBLE_EQ(results[1].secondsRendered, options.chunkSeconds);
+    // The quiet one loses to the first on mix readiness before its loudness
+    // window closes
+    EXPECT_EQ(results[2].verdict, CandidatePruner::Verdict::DOMINATED);
+    EXPECT_DOUBLE_EQ(results[2].secondsRendered, options.pruner.dominanceSeconds);
+    
+    const auto& stats = pipeline.getLastRunStats();
+    EXPECT_EQ(stats.candidates, 3u);
+    EXPECT_EQ(stats.pruned, 2u);
+    EXPECT_EQ(stats.verdicts.at("hard_clip"), 1u);
+    EXPECT_GT(stats.candidatesPerSecond, 0.0);
+    
+    // Without pruning every candidate renders in full and scores the same
+    options.enablePruning = false;
+    CandidatePipeline baseline(optimizer, options);
+    auto fresh = makeCandidates();
+    auto full = baseline.evaluate(fresh, Role::PAD, MusicalContext{}, AudioConstraints{});
+    EXPECT_EQ(baseline.getLastRunStats().pruned, 0u);
+    EXPECT_DOUBLE_EQ(baseline.getLastRunStats().audioSeconds, 12.0);
+    EXPECT_DOUBLE_EQ(full[0].metrics.overallScore, results[0].metrics.overallScore);
+    EXPECT_FALSE(full[1].metrics.feasible);
+}
+
+// Test the polyphonic voice pool against per-note graphs
+TEST(VoicePoolTest, VoicesMatchGraphsAndSteal) {
+    DSPGraph patch;
+    patch.addStage("osc1", std::make_unique<OscillatorStage>());
+    patch.addStage("filter1", std::make_unique<FilterStage>());
+    patch.addConnection({"osc1", "filter1"});
+    
+    // A4 at full velocity is the patch itself
+    VoicePool::Options options;
+    options.maxVoices = 4;
+    options.maxBlockSize = 256;
+    VoicePool single(patch, options);
+    single.noteOn(69);
+    AudioBuffer silence(1000, 0.0f), reference, voiced(1000);
+    patch.process(silence, reference);
+    single.process(voiced);
+    for (size_t i = 0; i < voiced.size(); ++i) {
+        EXPECT_NEAR(voiced[i], reference[i], 1e-4);
+    }
+    
+    // A chord is the sum of its notes, the second oscillator keeps its ratio
+    auto fifth = std::make_unique<OscillatorStage>();
+    fifth->setParameter("frequency", 660.0);
+    patch.addStage("osc2", std::move(fifth));
+    patch.addConnection({"osc2", "osc1"});
+    VoicePool chord(patch, options);
+    AudioBuffer mixed(1000, 0.0f), summed(1000, 0.0f), one(1000);
+    for (int note : {60, 64, 67}) {
+        chord.noteOn(note, 0.5);
+        VoicePool alone(patch, options);
+        alone.noteOn(note, 0.5);
+        alone.process(one);
+        for (size_t i = 0; i < one.size(); ++i) summed[i] += one[i];
+    }
+    EXPECT_EQ(chord.getActiveVoices(), 3u);
+    chord.process(mixed);
+    for (size_t i = 0; i < mixed.size(); ++i) {
+        EXPECT_NEAR(mixed[i], summed[i], 1e-5);
+    }
+    
+    // Envelopes gate on the note and free the voice after the release
+    auto envelope = std::make_unique<EnvelopeStage>();
+    envelope->setParameter("attack", 0.001);
+    envelope->setParameter("release", 0.01);
+    patch.addStage("env1", std::move(envelope));
+    patch.addConnection({"filter1", "env1"});
+    options.maxVoices = 2;
+    VoicePool pool(patch, options);
+    AudioBuffer block(512);
+    size_t c4 = pool.noteOn(60);
+    pool.noteOn(64);
+    pool.process(block);
+    EXPECT_GT(*std::max_element(block.begin(), block.end()), 0.01f);
+    
+    // Full pool: a releasing voice goes first, then the oldest
+    pool.noteOff(60);
+    EXPECT_EQ(pool.noteOn(67), c4);
+    EXPECT_EQ(pool.getStolenVoices(), 1u);
+    size_t stolen = pool.noteOn(72);
+    EXPECT_NE(stolen, c4);
+    EXPECT_EQ(pool.getNote(stolen), 72);
+    EXPECT_EQ(pool.getActiveVoices(), 2u);
+    
+    pool.allNotesOff();
+    pool.process(block);
+    pool.process(block);
+    EXPECT_EQ(pool.getActiveVoices(), 0u);
+    pool.process(block);
+    EXPECT_EQ(*std::max_element(block.begin(), block.end()), 0.0f);
+    
+    EXPECT_THROW(pool.noteOn(128), AIAudioException);
+    DSPGraph empty;
+    EXPECT_THROW(VoicePool{empty}, AIAudioException);
+}
+
+// Test compiled presets and the cached parallel library loader
+TEST(CompiledPresetTest, RoundTripAndLibraryCache) {
+    const std::string json = R"({
+        "stages": {
+            "osc1": {"type": "oscillator", "parameters": {"frequency": 220.0, "amplitude": 0.4, "waveType": "saw"}},
+            "filter1": {"type": "filter", "parameters": {"cutoff": 1800.0, "filterType": "bandpass"}},
+            "env1": {"type": "envelope", "parameters": {"attack": 0.02, "sustain": 0.5}}
+        },
+        "connections": [
+            {"source": "osc1", "destination": "filter1"},
+            {"source": "filter1", "destination": "env1", "amount": 0.8}
+        ]
+    })";
+    
+    // The compiled graph renders exactly like the parsed one
+    IRParser parser;
+    auto parsed = parser.parsePreset(json);
+    auto bytes = compilePresetJSON(json);
+    auto loaded = loadCompiledPreset(bytes.data(), bytes.size());
+    EXPECT_EQ(loaded->getStageNames().size(), 3u);
+    EXPECT_EQ(std::get<std::string>(loaded->getStage("osc1")->getParameter("waveType")), "saw");
+    EXPECT_EQ(loaded->getConnections().size(), 2u);
+    AudioBuffer silence(2048, 0.0f), expected, actual;
+    parsed->process(silence, expected);
+    loaded->process(silence, actual);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+        EXPECT_EQ(actual[i], expected[i]);
+    }
+    
+    // Damaged bytes are rejected, and so are graphs that fail validation
+    auto corrupt = bytes;
+    corrupt.back() ^= 0x40;
+    EXPECT_THROW(loadCompiledPreset(corrupt.data(), corrupt.size()), AIAudioException);
+    EXPECT_THROW(loadCompiledPreset(bytes.data(), bytes.size() - 1), AIAudioException);
+    DSPGraph loop;
+    loop.addStage("a", std::make_unique<FilterStage>());
+    loop.addStage("b", std::make_unique<FilterStage>());
+    loop.addConnection({"a", "b"});
+    loop.addConnection({"b", "a"});
+    EXPECT_THROW(compilePreset(loop), AIAudioException);
+    
+    // A directory of presets: the first load compiles, the second reads the cache
+    namespace fs = std::filesystem;
+    const fs::path directory = fs::temp_directory_path() / "aiaudio_preset_library_test";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    for (const char* name : {"bass", "lead", "pad"}) {
+        std::ofstream(directory / (std::string(name) + ".json")) << json;
+    }
+    std::ofstream(directory / "broken.json") << "{ not json";
+    
+    PresetLibrary library;
+    auto first = library.loadDirectory(directory.string());
+    ASSERT_EQ(first.size(), 4u);
+    EXPECT_FALSE(first[1].ok());  // Sorted: bass, broken, lead, pad
+    EXPECT_EQ(library.getLastLoadStats().compiled, 3u);
+    EXPECT_EQ(library.getLastLoadStats().failed, 1u);
+    EXPECT_EQ(library.getLastLoadStats().errors.size(), 1u);
+    
+    auto second = library.loadDirectory(directory.string());
+    EXPECT_EQ(library.getLastLoadStats().fromCache, 3u);
+    EXPECT_TRUE(second[0].fromCache);
+    AudioBuffer cached;
+    second[0].graph->process(silence, cached);
+    EXPECT_EQ(cached, expected);
+    
+    // Editing a source recompiles just that preset
+    std::string edited = json;
+    edited.replace(edited.find("220.0"), 5, "330.0");
+    std::ofstream(directory / "lead.json") << edited;
+    library.loadDirectory(directory.string());
+    EXPECT_EQ(library.getLastLoadStats().compiled, 1u);
+    EXPECT_EQ(library.getLastLoadStats().fromCache, 2u);
+    
+    auto compiledFile = directory / ".preset_cache" / (std::string("pad") + kCompiledPresetExtension);
+    EXPECT_EQ(loadPresetFile(compiledFile.string())->getStageNames().size(), 3u);
+    fs::remove_all(directory);
+}
+
+TEST(RenderCacheTest, ContentHashEvictionAndSpill) {
+    // Insertion order does not change the hash; parameters and sample rate do
+    auto makeGraph = [](bool reversed, double cutoff) {
+        DSPGraph graph;
+        auto osc = std::make_unique<OscillatorStage>();
+        osc->setParameter("frequency", 220.0);
+        auto filter = std::make_unique<FilterStage>();
+        filter->setParameter("cutoff", cutoff);
+        if (reversed) {
+            graph.addStage("filter", std::move(filter));
+            graph.addStage("osc", std::move(osc));
+        } else {
+            graph.addStage("osc", std::move(osc));
+            graph.addStage("filter", std::move(filter));
+        }
+        graph.addConnection({"osc", "filter"});
+        return graph;
+    };
+    DSPGraph graph = makeGraph(false, 1200.0);
+    const uint64_t hash = graphContentHash(graph);
+    EXPECT_EQ(graphContentHash(makeGraph(true, 1200.0)), hash);
+    EXPECT_NE(graphContentHash(makeGraph(false, 1300.0)), hash);
+    DSPGraph resampled = makeGraph(false, 1200.0);
+    resampled.setSampleRate(48000.0);
+    EXPECT_NE(graphContentHash(resampled), hash);
+    AudioBuffer silence(4096, 0.0f), rendered;
+    graph.process(silence, rendered);
+    EXPECT_EQ(graphContentHash(graph), hash);  // Stage state does not enter
+    
+    // Without connections the stages chain in audio order, which follows
+    // insertion; graphs that render differently must not share a key
+    auto makeChain = [](bool reversed) {
+        DSPGraph chain;
+        std::vector<std::string> names = {"osc", "filter", "env"};
+        if (reversed) std::reverse(names.begin(), names.end());
+        for (const auto& name : names) {
+            if (name == "osc") chain.addStage(name, std::make_unique<OscillatorStage>());
+            if (name == "filter") chain.addStage(name, std::make_unique<FilterStage>());
+            if (name == "env") chain.addStage(name, std::make_unique<EnvelopeStage>());
+        }
+        return chain;
+    };
+    DSPGraph forward = makeChain(false), backward = makeChain(true);
+    AudioBuffer forwardOut, backwardOut;
+    forward.process(silence, forwardOut);
+    backward.process(silence, backwardOut);
+    EXPECT_EQ(graphContentHash(forward) == graphContentHash(backward),
+              forward.getAudioOrder() == backward.getAudioOrder());
+    if (graphContentHash(forward) == graphContentHash(backward)) {
+        EXPECT_EQ(forwardOut, backwardOut);
+    }
+    EXPECT_NE(renderCacheKey(hash, 1, 4096), renderCacheKey(hash, 2, 4096));
+    
+    // Memory is bounded in audio bytes, least recently used out first
+    RenderCache::Options options;
+    options.maxBytes = 2 * rendered.size() * sizeof(Sample);
+    RenderCache memory(options);
+    RenderCache::Entry entry;
+    entry.audio = rendered;
+    entry.meters = {{"lufs", -20.5}, {"tp", -3.0}};
+    entry.warnings = {"Audio is too quiet"};
+    entry.qualityScore = 0.75;
+    entry.scoreKey = 42;
+    for (uint64_t key : {1, 2, 3}) memory.store(key, entry);
+    EXPECT_EQ(memory.find(1), nullptr);
+    ASSERT_NE(memory.find(3), nullptr);
+    EXPECT_EQ(memory.find(3)->audio, rendered);
+    EXPECT_EQ(memory.getStats().memory.evictions, 1u);
+    
+    // Spilled entries are WAV files that a second cache reloads
+    namespace fs = std::filesystem;
+    const fs::path directory = fs::temp_directory_path() / "aiaudio_render_cache_test";
+    fs::remove_all(directory);
+    options.spillDirectory = directory.string();
+    RenderCache writer(options);
+    writer.store(7, entry);
+    EXPECT_EQ(writer.getStats().spillWrites, 1u);
+    char riff[12] = {};
+    std::ifstream(writer.spillPath(7), std::ios::binary).read(riff, sizeof(riff));
+    EXPECT_EQ(std::string(riff, 4), "RIFF");
+    EXPECT_EQ(std::string(riff + 8, 4), "WAVE");
+    
+    RenderCache reader(options);
+    auto reloaded = reader.find(7);
+    ASSERT_NE(reloaded, nullptr);
+    EXPECT_EQ(reloaded->audio, rendered);
+    EXPECT_EQ(reloaded->meters, entry.meters);
+    EXPECT_EQ(reloaded->warnings, entry.warnings);
+    EXPECT_EQ(reloaded->qualityScore, 0.75);
+    EXPECT_EQ(reloaded->scoreKey, 42u);
+    EXPECT_EQ(reader.getStats().spillHits, 1u);
+    EXPECT_EQ(reader.find(8), nullptr);
+    
+    // A damaged file is a miss, not an error
+    fs::copy_file(writer.spillPath(7), writer.spillPath(9));
+    fs::resize_file(writer.spillPath(9), 100);
+    EXPECT_EQ(reader.find(9), nullptr);
+    EXPECT_EQ(reader.getStats().spillErrors, 1u);
+    
+    // So is a chunk claiming 4 GiB: its size must not wrap to an empty read
+    // that leaves the first meter name free to run past the file
+    std::ifstream spilled(writer.spillPath(7), std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(spilled)), std::istreambuf_iterator<char>());
+    const size_t results = std::string(bytes.begin(), bytes.end()).find("aicr");
+    ASSERT_NE(results, std::string::npos);
+    const uint32_t corruptSize = 0xFFFFFFFF, nameLength = 1 << 20;
+    std::memcpy(&bytes[results + 4], &corruptSize, sizeof(corruptSize));
+    std::memcpy(&bytes[results + 40], &nameLength, sizeof(nameLength));  // After version, keys, score, count
+    std::ofstream(writer.spillPath(10), std::ios::binary).write(bytes.data(), bytes.size());
+    EXPECT_EQ(reader.find(10), nullptr);
+    EXPECT_EQ(reader.getStats().spillErrors, 2u);
+    fs::remove_all(directory);
+}
+
+TEST_F(AIAudioGeneratorTest, RenderCacheReplaysRepeatedRequests) {
+    AIAudioGenerator::GenerationRequest request;
+    request.prompt = "warm pad";
+    request.role = Role::PAD;
+    request.durationSeconds = 1.0;
+    
+    auto first = generator->generate(request);
+    auto second = generator->generate(request);
+    ASSERT_EQ(first.audio.size(), 44100u);
+    EXPECT_FALSE(first.fromCache);
+    EXPECT_TRUE(second.fromCache);
+    EXPECT_EQ(second.audio, first.audio);
+    EXPECT_EQ(second.trace.meters, first.trace.meters);
+    EXPECT_EQ(second.qualityScore, first.qualityScore);
+    
+    // Other scoring inputs reuse the audio but are scored again
+    request.constraints.lufsTarget = -14.0;
+    auto rescored = generator->generate(request);
+    EXPECT_TRUE(rescored.fromCache);
+    EXPECT_EQ(rescored.audio, first.audio);
+    
+    request.useRenderCache = false;
+    EXPECT_FALSE(generator->generate(request).fromCache);
+    EXPECT_EQ(generator->getRenderCache()->getStats().memory.hits, 2u);
+}
+
+TEST_F(AIAudioGeneratorTest, PipelineTransformsOneGraphInPlace) {
+    // Graphs cannot be copied, so no pipeline step can clone one implicitly
+    static_assert(!std::is_copy_constructible_v<DSPGraph>);
+    static_assert(std::is_nothrow_move_constructible_v<DSPGraph>);
+    
+    AIAudioGenerator::GenerationRequest request;
+    request.prompt = "dark bass";
+    request.role = Role::BASS;
+    request.durationSeconds = 0.5;
+    request.useRenderCache = false;
+    
+    for (bool semantic : {true, false}) {
+        request.useSemanticSearch = semantic;
+        auto first = generator->generate(request);
+        auto second = generator->generate(request);
+        for (const auto& warning : first.warnings) {
+            EXPECT_EQ(warning.find("Generation error"), std::string::npos) << warning;
+        }
+        EXPECT_EQ(first.audio.size(), 22050u);
+        EXPECT_EQ(second.audio, first.audio);
+        EXPECT_FALSE(first.explanation.empty());
+    }
+}
+
+TEST_F(AIAudioGeneratorTest, GenerateMeasuresAtTheGraphRate) {
+    namespace fs = std::filesystem;
+    const fs::path directory = fs::temp_directory_path() / "aiaudio_generate_rate_test";
+    fs::remove_all(directory);
+    RenderCache::Options options;
+    options.spillDirectory = directory.string();
+    generator->setRenderCache(std::make_shared<RenderCache>(options));
+    
+    AIAudioGenerator::GenerationRequest request;
+    request.prompt = "bright lead";
+    request.role = Role::LEAD;
+    request.durationSeconds = 0.5;
+    request.sampleRate = 48000.0;
+    
+    // Length, meters and the spilled WAV header all use the graph's rate
+    auto first = generator->generate(request);
+    ASSERT_EQ(first.audio.size(), 24000u);
+    const AudioStats stats = analyzeAudio(first.audio, 48000.0);
+    EXPECT_DOUBLE_EQ(first.trace.meters.at("lufs"), stats.integratedLoudness);
+    EXPECT_NE(first.trace.meters.at("lufs"), analyzeAudio(first.audio).integratedLoudness);
+    
+    std::vector<fs::path> spilled(fs::directory_iterator(directory), fs::directory_iterator{});
+    ASSERT_EQ(spilled.size(), 1u);
+    RenderCache reader(options);
+    auto reloaded = reader.find(std::stoull(spilled[0].stem().string(), nullptr, 16));
+    ASSERT_NE(reloaded, nullptr);
+    EXPECT_EQ(reloaded->sampleRate, 48000.0);
+    
+    // A replay rescored for other constraints matches a fresh render
+    request.constraints.lufsTarget = -14.0;
+    auto rescored = generator->generate(request);
+    EXPECT_TRUE(rescored.fromCache);
+    request.useRenderCache = false;
+    auto fresh = generator->generate(request);
+    EXPECT_EQ(fresh.audio, first.audio);
+    EXPECT_DOUBLE_EQ(rescored.qualityScore, fresh.qualityScore);
+    fs::remove_all(directory);
+    
+    // Candidate renders run for their duration at the graph's rate
+    const std::string configPath = "rate_metrics.yaml";
+    std::ofstream(configPath) << "# defaults\n";
+    MOOOptimizer optimizer(configPath);
+    std::remove(configPath.c_str());
+    CandidatePipeline::Options pipelineOptions;
+    pipelineOptions.durationSeconds = 1.0;
+    pipelineOptions.enablePruning = false;
+    CandidatePipeline pipeline(optimizer, pipelineOptions);
+    std::vector<DSPGraph> candidates(1);
+    auto tone = std::make_unique<OscillatorStage>();
+    tone->setParameter("frequency", 3000.0);    // Above the lead's 2 kHz centroid bonus
+    candidates[0].addStage("osc1", std::move(tone));
+    candidates[0].setSampleRate(96000.0);
+    auto reference = candidates[0].clone();
+    auto results = pipeline.evaluate(candidates, Role::LEAD, MusicalContext{}, AudioConstraints{}, "lead");
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_DOUBLE_EQ(results[0].secondsRendered, 1.0);
+    AudioBuffer silence(96000, 0.0f), rendered;
+    reference->process(silence, rendered);
+    auto expected = optimizer.evaluate(analyzeAudio(rendered, 96000.0), Role::LEAD, MusicalContext{},
+                                       AudioConstraints{}, "lead");
+    EXPECT_NEAR(results[0].metrics.objectives.semMatch, expected.objectives.semMatch, 1e-9);
+    auto misread = optimizer.evaluate(analyzeAudio(rendered), Role::LEAD, MusicalContext{}, AudioConstraints{}, "lead");
+    EXPECT_LT(misread.objectives.semMatch, expected.objectives.semMatch);
+}
+
+TEST(MetricsTest, ShardedHistogramsSamplingAndExport) {
+    // Every value falls inside its bucket's edges
+    EXPECT_EQ(LatencyHistogram::bucketFor(100), 0u);
+    EXPECT_EQ(LatencyHistogram::bucketFor(256), 1u);
+    EXPECT_EQ(LatencyHistogram::bucketFor(uint64_t(1) << 62), LatencyHistogram::kBuckets - 1);
+    for (uint64_t ns : {300ull, 1000ull, 10000ull, 123456ull, 5000000000ull}) {
+        size_t bucket = LatencyHistogram::bucketFor(ns);
+        EXPECT_GE(ns * 1e-9, LatencyHistogram::bucketUpperBound(bucket - 1) * (1 - 1e-12));
+        EXPECT_LT(ns * 1e-9, LatencyHistogram::bucketUpperBound(bucket));
+    }
+    
+    // Records from several threads are merged on read
+    MetricsRegistry registry;
+    LatencyHistogram& latency = registry.histogram("test_latency_seconds", "Test latency", {{"phase", "a"}});
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&latency] {
+            for (int i = 0; i < 1000; ++i) latency.record(10000);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    
+    auto snapshot = latency.snapshot();
+    EXPECT_EQ(snapshot.count, 4000u);
+    EXPECT_NEAR(snapshot.sum, 0.04, 1e-9);
+    EXPECT_NEAR(snapshot.mean(), 10e-6, 1e-12);
+    EXPECT_GE(snapshot.quantile(0.5), 8.192e-6);
+    EXPECT_LT(snapshot.quantile(0.5), 10.24e-6);
+    EXPECT_EQ(&registry.histogram("test_latency_seconds", "", {{"phase", "a"}}), &latency);
+    EXPECT_THROW(registry.counter("test_latency_seconds", "Clash"), AIAudioException);
+    
+    registry.counter("test_events", "Test events").add(3);
+    std::string text = registry.exportOpenMetrics();
+    EXPECT_NE(text.find("# TYPE test_latency_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(text.find("# UNIT test_latency_seconds seconds\n"), std::string::npos);
+    EXPECT_NE(text.find("test_latency_seconds_bucket{phase=\"a\",le=\"+Inf\"} 4000\n"), std::string::npos);
+    EXPECT_NE(text.find("test_latency_seconds_count{phase=\"a\"} 4000\n"), std::string::npos);
+    EXPECT_NE(text.find("test_events_total 3\n"), std::string::npos);
+    EXPECT_EQ(text.substr(text.size() - 6), "# EOF\n");
+    
+    // Bucket lines are cumulative
+    std::istringstream lines(text);
+    std::string line;
+    uint64_t previous = 0;
+    size_t buckets = 0;
+    while (std::getline(lines, line)) {
+        if (line.rfind("test_latency_seconds_bucket", 0) != 0) continue;
+        uint64_t cumulative = std::stoull(line.substr(line.rfind(' ') + 1));
+        EXPECT_GE(cumulative, previous);
+        previous = cumulative;
+        ++buckets;
+    }
+    EXPECT_EQ(buckets, LatencyHistogram::kOctaves + 2);
+    
+    registry.reset();
+    EXPECT_EQ(latency.snapshot().count, 0u);
+    
+    // Sampling: every Nth timed scope on a thread is measured
+    MetricsRegistry& global = MetricsRegistry::global();
+    LatencyHistogram& sampled = registry.histogram("test_sampled_seconds", "Sampled scopes");
+    global.setSamplingRate(0.25);
+    EXPECT_DOUBLE_EQ(global.getSamplingRate(), 0.25);
+    for (int i = 0; i < 100; ++i) {
+        ScopedTimer timer(sampled);
+    }
+    EXPECT_EQ(sampled.snapshot().count, 25u);
+    global.setSamplingRate(0.0);
+    for (int i = 0; i < 100; ++i) {
+        ScopedTimer timer(sampled);
+    }
+    EXPECT_EQ(sampled.snapshot().count, 25u);
+    global.setSamplingRate(1.0);
+}
+
+#ifndef AIAUDIO_NO_METRICS
+TEST_F(AIAudioGeneratorTest, GenerateRecordsPipelineMetrics) {
+    MetricsRegistry& registry = MetricsRegistry::global();
+    registry.reset();
+    
+    AIAudioGenerator::GenerationRequest request;
+    request.prompt = "bright lead";
+    request.role = Role::LEAD;
+    request.durationSeconds = 0.5;
+    request.useRenderCache = false;
+    generator->generate(request);
+    
+    for (const char* phase : {"search", "decisions", "policies", "render", "scoring"}) {
+        EXPECT_EQ(registry.histogram("aiaudio_generate_phase_seconds", "", {{"phase", phase}}).snapshot().count, 1u) << phase;
+    }
+    EXPECT_GT(registry.histogram("aiaudio_stage_process_seconds", "", {{"stage", "oscillator"}}).snapshot().count, 0u);
+    
+    // Realtime renders count blocks and xruns
+    DSPGraph graph;
+    graph.addStage("osc", std::make_unique<OscillatorStage>());
+    AudioRenderer renderer;
+    renderer.renderRealtime(graph, 44100, 10.0);
+    auto stats = renderer.getLastRenderStats();
+    EXPECT_EQ(registry.counter("aiaudio_realtime_blocks", "").value(), stats.blocksRendered);
+    EXPECT_EQ(registry.counter("aiaudio_realtime_deadline_misses", "").value(), stats.deadlineMisses);
+    EXPECT_GT(stats.cpuUsage, 0.0);
+    
+    SystemMonitor monitor;
+    auto metrics = monitor.getMetrics();
+    EXPECT_EQ(metrics.totalRenders, 1u);
+    EXPECT_EQ(metrics.successfulRenders, 1u);
+    EXPECT_GT(metrics.averageLatency, 0.0);
+    EXPECT_GT(metrics.memoryUsage, 0.0);
+    EXPECT_GE(metrics.activeThreads, 1u);
+    
+    std::string text = monitor.exportMetrics();
+    EXPECT_NE(text.find("aiaudio_generate_phase_seconds_count{phase=\"render\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("aiaudio_generations_total 1\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE aiaudio_process_resident_memory_bytes gauge\n"), std::string::npos);
+    EXPECT_EQ(text.substr(text.size() - 6), "# EOF\n");
+}
+#endif
+
+TEST(PolicyTest, CompiledConstraintTablesAndBatchScores) {
+    auto makeGraph = [] {
+        DSPGraph graph;
+        auto osc = std::make_unique<OscillatorStage>();
+        osc->setParameter("frequency", 600.0);
+        osc->setParameter("amplitude", 0.9);
+        graph.addStage("osc", std::move(osc));
+        auto filter = std::make_unique<FilterStage>();
+        filter->setParameter("cutoff", 1200.0);
+        graph.addStage("filter", std::move(filter));
+        graph.addStage("env", std::make_unique<EnvelopeStage>());
+        graph.addConnection({"osc", "filter"});
+        graph.addConnection({"filter", "env"});
+        return graph;
+    };
+    auto range = [](const std::string& name, double minVal, double maxVal, double weight) {
+        PolicyConstraint constraint;
+        constraint.type = ConstraintType::RANGE;
+        constraint.parameter = name;
+        constraint.range = {minVal, maxVal};
+        constraint.weight = weight;
+        return constraint;
+    };
+    
+    RolePolicy policy;
+    policy.role = Role::BASS;
+    policy.constraints["frequency"] = range("frequency", 20.0, 500.0, 1.0);
+    policy.constraints["cutoff"] = range("cutoff", 50.0, 1000.0, 0.5);
+    policy.constraints["attack"] = range("attack", 0.001, 0.1, 1.0);
+    PolicyConstraint loud;
+    loud.type = ConstraintType::CUSTOM;
+    loud.parameter = "amplitude";
+    loud.customValidator = [](double value) { return value <= 0.8; };
+    loud.weight = 0.25;
+    policy.constraints["amplitude"] = loud;
+    PolicyConstraint wave;
+    wave.type = ConstraintType::ENUM;
+    wave.parameter = "waveType";
+    wave.options = {"saw"};
+    policy.constraints["waveType"] = wave;
+    
+    // One row per stage that declares the parameter, in execution order
+    DSPGraph graph = makeGraph();
+    CompiledPolicy compiled = PolicyCompiler().compileForGraph(policy, graph);
+    EXPECT_EQ(compiled.stageNames, (std::vector<std::string>{"osc", "filter", "env"}));
+    EXPECT_EQ(compiled.numParameters(), 11u);
+    EXPECT_EQ(compiled.numRangeRows(), 3u);
+    EXPECT_EQ(compiled.customRows.size(), 1u);
+    EXPECT_EQ(compiled.topologyHash, graphTopologyHash(makeGraph()));
+    
+    PolicyEngine engine;
+    std::vector<double> parameters = compiled.gatherParameters(graph);
+    double expected = (1.0 - 100.0 / 480.0) * (1.0 - 0.5 * 200.0 / 950.0) * 0.75;
+    EXPECT_NEAR(engine.computePolicyScore(compiled, parameters), expected, 1e-12);
+    EXPECT_NEAR(engine.computePolicyScore(graph, policy), expected, 1e-12);
+    EXPECT_EQ(engine.checkCompliance(graph, policy).size(), 3u);
+    
+    // Batch scores match one candidate at a time
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> jitter(0.5, 2.0);
+    const size_t numCandidates = 1000;
+    std::vector<double> candidates;
+    for (size_t c = 0; c < numCandidates; ++c) {
+        for (double value : parameters) candidates.push_back(value * jitter(rng));
+    }
+    std::vector<double> scores = engine.computePolicyScores(compiled, candidates);
+    ASSERT_EQ(scores.size(), numCandidates);
+    for (size_t c = 0; c < numCandidates; ++c) {
+        std::span<const double> row(candidates.data() + c * parameters.size(), parameters.size());
+        EXPECT_NEAR(scores[c], engine.computePolicyScore(compiled, row), 1e-12);
+        EXPECT_GE(scores[c], 0.0);
+        EXPECT_LE(scores[c], 1.0);
+    }
+    EXPECT_THROW(engine.computePolicyScores(compiled, std::span<const double>(candidates).first(5)), AIAudioException);
+    
+    // Clamping leaves only the custom rejection
+    engine.clampParameters(compiled, parameters);
+    EXPECT_DOUBLE_EQ(parameters[0], 500.0);
+    EXPECT_DOUBLE_EQ(engine.computePolicyScore(compiled, parameters), 0.75);
+    engine.applyPolicy(graph, compiled);
+    EXPECT_EQ(std::get<double>(graph.getStage("osc")->getParameter("frequency")), 500.0);
+    EXPECT_EQ(std::get<double>(graph.getStage("filter")->getParameter("cutoff")), 1000.0);
+    auto violations = engine.checkCompliance(graph, compiled);
+    ASSERT_EQ(violations.size(), 1u);
+    EXPECT_EQ(violations[0], "Stage osc parameter amplitude violates constraint");
+    
+    // The manager caches one compiled form per (role, topology)
+    PolicyManager manager;
+    EXPECT_EQ(manager.getCompiledPolicy(Role::BASS, graph), nullptr);
+    manager.updatePolicy(policy);
+    auto first = manager.getCompiledPolicy(Role::BASS, graph);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(manager.getCompiledPolicy(Role::BASS, makeGraph()), first);
+    EXPECT_EQ(manager.getCompiledPolicy(Role::PAD, graph), nullptr);
+    manager.updatePolicy(policy);
+    EXPECT_NE(manager.getCompiledPolicy(Role::BASS, graph), first);
+}
+
+// Test the keyword index against a linear scan through adds, re-adds and removals
+TEST(InvertedIndexTest, IncrementalPostingsMatchLinearScan) {
+    const std::vector<std::string> words = {"warm", "warmth", "bright", "dark", "analog", "glassy", "pad", "pluck"};
+    const std::vector<std::string> tagNames = {"Warm-Pad", "lofi", "ambient", "bass"};
+    struct Entry {
+        Role role;
+        std::vector<std::string> tags;
+        std::string text;
+    };
+    std::map<std::string, Entry> live;
+    InvertedIndex index;
+    
+    std::mt19937 rng(11);
+    auto pick = [&](size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(rng); };
+    for (int step = 0; step < 600; ++step) {
+        const std::string key = "preset" + std::to_string(pick(200));
+        if (step % 4 == 3) {
+            EXPECT_EQ(index.remove(key), live.erase(key) == 1);
+            continue;
+        }
+        Entry entry{static_cast<Role>(pick(3)), {tagNames[pick(4)]}, words[pick(8)] + ", " + words[pick(8)]};
+        index.add(key, entry.role, entry.tags, entry.text);
+        live[key] = entry;
+    }
+    ASSERT_EQ(index.size(), live.size());
+    
+    // Token words of the text and tags, and the normalised tags
+    auto wordsOf = [](const Entry& entry) {
+        auto tokens = InvertedIndex::tokenize(entry.text);
+        for (const auto& tag : entry.tags) {
+            for (auto& token : InvertedIndex::tokenize(tag)) tokens.push_back(token);
+        }
+        return tokens;
+    };
+    auto scan = [&](const InvertedIndex::Query& query) {
+        std::vector<std::string> keys;
+        for (const auto& [key, entry] : live) {
+            if (query.role != Role::UNKNOWN && entry.role != query.role) continue;
+            auto tokens = wordsOf(entry);
+            bool ok = std::all_of(query.terms.begin(), query.terms.end(), [&](const std::string& term) {
+                return std::any_of(tokens.begin(), tokens.end(), [&](const std::string& token) {
+                    return query.prefixTerms ? token.rfind(term, 0) == 0 : token == term;
+                });
+            });
+            auto hasTag = [&](const std::string& tag) {
+                return InvertedIndex::normalizeTag(entry.tags[0]) == tag;
+            };
+            ok = ok && std::all_of(query.tags.begin(), query.tags.end(), hasTag);
+            ok = ok && std::none_of(query.excludedTags.begin(), query.excludedTags.end(), hasTag);
+            if (ok) keys.push_back(key);
+        }
+        return keys;
+    };
+    
+    for (Role role : {Role::UNKNOWN, Role::PAD, Role::BASS, Role::LEAD}) {
+        for (bool prefix : {false, true}) {
+            InvertedIndex::Query query;
+            query.role = role;
+            query.prefixTerms = prefix;
+            EXPECT_EQ(index.search(query), scan(query));
+            query.terms = {"warm"};
+            EXPECT_EQ(index.search(query), scan(query));
+            query.terms = {"warm", "pad"};
+            EXPECT_EQ(index.search(query), scan(query));
+            query.tags = {"warm-pad"};
+            EXPECT_EQ(index.search(query), scan(query));
+            query.terms = {"dark"};
+            query.tags = {};
+            query.excludedTags = {"lofi"};
+            EXPECT_EQ(index.search(query), scan(query));
+            query.terms = {"missing"};
+            EXPECT_TRUE(index.search(query).empty());
+        }
+        EXPECT_EQ(index.roleCount(role),
+                  role == Role::UNKNOWN ? live.size()
+                                        : std::count_if(live.begin(), live.end(), [&](const auto& e) {
+                                              return e.second.role == role;
+                                          }));
+    }
+    
+    // Document frequencies give the same IDF as counting the library
+    std::map<std::string, int> frequencies;
+    for (const auto& [key, entry] : live) {
+        auto tokens = wordsOf(entry);
+        std::sort(tokens.begin(), tokens.end());
+        tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+        for (const auto& token : tokens) ++frequencies[token];
+    }
+    for (const auto& word : {"warm", "Glassy", "lofi", "missing"}) {
+        EXPECT_NEAR(AdvancedSemanticFeatures::computeIDFWeight(word, index),
+                    AdvancedSemanticFeatures::computeIDFWeight(InvertedIndex::normalizeTag(word), frequencies,
+                                                               static_cast<int>(live.size())), 1e-12);
+    }
+    
+    // Preset search goes through the index: case-insensitive word prefixes
+    PresetManager presets;
+    PresetManager::PresetMetadata metadata;
+    metadata.name = "Warm Strings";
+    metadata.description = "Slow analog pad";
+    metadata.role = Role::PAD;
+    metadata.tags = {"Cinematic"};
+    presets.setMetadata("a.json", metadata);
+    metadata.name = "Acid Line";
+    metadata.description = "Squelchy analog bass";
+    metadata.role = Role::BASS;
+    metadata.tags = {};
+    presets.setMetadata("b.json", metadata);
+    EXPECT_EQ(presets.searchPresets("analog"), (std::vector<std::string>{"a.json", "b.json"}));
+    EXPECT_EQ(presets.searchPresets("ANALOG", Role::BASS), std::vector<std::string>{"b.json"});
+    EXPECT_EQ(presets.searchPresets("warm str"), std::vector<std::string>{"a.json"});
+    EXPECT_EQ(presets.searchPresets("cinema"), std::vector<std::string>{"a.json"});
+    presets.removeMetadata("a.json");
+    EXPECT_EQ(presets.searchPresets("analog"), std::vector<std::string>{"b.json"});
+    
+    // A keyword prefilter ranks the same as filtering the full ranking
+    SemanticSearchEngine engine(std::make_unique<SemanticFusionEngine>(std::make_unique<SimpleEmbedding>(32)));
+    for (const auto& [key, entry] : live) {
+        EntryVectorBuilder::EntryData data;
+        data.id = key;
+        data.tags = entry.tags;
+        data.description = entry.text;
+        data.role = entry.role;
+        engine.addEntry(data);
+    }
+    engine.removeEntry(live.begin()->first);
+    live.erase(live.begin());
+    
+    InvertedIndex::Query filter;
+    filter.terms = {"warm"};
+    filter.role = Role::PAD;
+    filter.prefixTerms = true;
+    const auto allowed = scan(filter);
+    auto ranked = engine.search("soft evolving", Role::PAD, 1000);
+    ranked.erase(std::remove_if(ranked.begin(), ranked.end(), [&](const auto& r) {
+        return !std::binary_search(allowed.begin(), allowed.end(), r.entryId);
+    }), ranked.end());
+    auto filtered = engine.searchFiltered("soft evolving", filter, 5);
+    ASSERT_EQ(filtered.size(), std::min<size_t>(5, ranked.size()));
+    for (size_t i = 0; i < filtered.size(); ++i) {
+        EXPECT_EQ(filtered[i].entryId, ranked[i].entryId);
+    }
+    EXPECT_EQ(engine.searchKeywords("warm", Role::PAD), allowed);
+}
+
+// Test the band-limited wavetables: sharing, accuracy, aliasing and integration
+TEST(WavetableTest, SharedBandLimitedTablesWithoutAliasing) {
+    std::weak_ptr<const Wavetable> sawTable;
+    {
+        // One table per waveform for every stage, clone and voice
+        WavetableStage saw;
+        saw.setParameter("waveType", std::string("saw"));
+        auto copy = saw.clone();
+        sawTable = sharedWavetable(Waveform::SAW);
+        EXPECT_EQ(&saw.getTable(), sawTable.lock().get());
+        EXPECT_EQ(&static_cast<const WavetableStage&>(*copy).getTable(), &saw.getTable());
+        EXPECT_NE(&WavetableStage().getTable(), &saw.getTable());
+        EXPECT_GE(wavetableCacheBytes(), 2 * Wavetable::kLevels * Wavetable::kLevelStride * sizeof(float));
+        
+        // The chosen level's top harmonic is below Nyquist, the next finer one's is not
+        for (double frequency : {20.0, 110.0, 440.0, 3000.0, 15000.0}) {
+            const double increment = frequency / 44100.0;
+            const size_t level = Wavetable::levelFor(increment);
+            EXPECT_LT((Wavetable::kMaxHarmonics >> level) * increment, 0.5);
+            if (level > 0) {
+                EXPECT_GE((Wavetable::kMaxHarmonics >> (level - 1)) * increment, 0.5);
+            }
+        }
+        
+        // The sine table tracks std::sin
+        OscillatorStage sine;
+        sine.setParameter("frequency", 440.0);
+        sine.setParameter("phase", 0.25);
+        WavetableStage tableSine(sine);
+        AudioBuffer silence(4096, 0.0f), reference, output;
+        sine.process(silence, reference);
+        tableSine.process(silence, output);
+        for (size_t i = 0; i < output.size(); ++i) {
+            ASSERT_NEAR(output[i], reference[i], 1e-5) << i;
+        }
+        
+        // A 3 kHz saw: the naive one folds its 8th-10th harmonics back to
+        // 20.1, 17.1 and 14.1 kHz; the table has no energy there
+        OscillatorStage naive;
+        naive.setParameter("waveType", std::string("saw"));
+        naive.setParameter("frequency", 3000.0);
+        naive.setParameter("amplitude", 1.0);
+        WavetableStage bandLimited(naive);
+        AudioBuffer second(44100, 0.0f), naiveOut, bandOut;
+        naive.process(second, naiveOut);
+        bandLimited.process(second, bandOut);
+        auto magnitude = [](const AudioBuffer& x, double hz) {
+            double re = 0.0, im = 0.0;
+            for (size_t n = 0; n < x.size(); ++n) {
+                re += x[n] * std::cos(2.0 * M_PI * hz * n / 44100.0);
+                im -= x[n] * std::sin(2.0 * M_PI * hz * n / 44100.0);
+            }
+            return std::sqrt(re * re + im * im) / x.size();
+        };
+        const double fundamental = magnitude(bandOut, 3000.0);
+        EXPECT_NEAR(fundamental, magnitude(naiveOut, 3000.0), 0.02 * fundamental);
+        for (double alias : {20100.0, 17100.0, 14100.0}) {
+            EXPECT_GT(magnitude(naiveOut, alias), 0.05 * fundamental) << alias;
+            EXPECT_LT(magnitude(bandOut, alias), 1e-3 * fundamental) << alias;
+        }
+        
+        // The compile pass swaps oscillators for wavetables in place
+        DSPGraph graph;
+        graph.addStage("osc", naive.clone());
+        graph.addStage("filter", std::make_unique<FilterStage>());
+        graph.addConnection({"osc", "filter"});
+        IRCompiler::CompileOptions options;
+        options.bandLimitedOscillators = true;
+        auto compiled = IRCompiler().compile(graph, options);
+        ASSERT_EQ(compiled->getStage("osc")->getType(), StageType::WAVETABLE);
+        EXPECT_EQ(std::get<double>(compiled->getStage("osc")->getParameter("frequency")), 3000.0);
+        EXPECT_EQ(std::get<std::string>(compiled->getStage("osc")->getParameter("waveType")), "saw");
+        EXPECT_EQ(compiled->getConnections().size(), 1u);
+        EXPECT_TRUE(isOscillatorType(compiled->getStage("osc")->getType()));
+        
+        // Voices render the shared table like the stage does
+        compiled->getStage("osc")->setParameter("frequency", 440.0);
+        VoicePool pool(*compiled, VoicePool::Options{});
+        pool.noteOn(69);
+        AudioBuffer voiced(512), direct;
+        pool.process(voiced);
+        compiled->process(AudioBuffer(512, 0.0f), direct);
+        for (size_t i = 0; i < voiced.size(); ++i) {
+            ASSERT_NEAR(voiced[i], direct[i], 1e-4) << i;
+        }
+    }
+    
+    // Tables nothing holds any more can be released
+    trimWavetableCache();
+    EXPECT_TRUE(sawTable.expired());
+}
+
+TEST(ModulationTest, ControlRateRoutesAndPerGraphSampleRate) {
+    // Stages run at the graph's rate, including ones added later
+    DSPGraph rated;
+    auto env = std::make_unique<EnvelopeStage>();
+    env->setParameter("attack", 0.01);
+    rated.addStage("env", std::move(env));
+    rated.setSampleRate(48000.0);
+    auto tone = std::make_unique<OscillatorStage>();
+    tone->setParameter("frequency", 480.0);
+    rated.addStage("osc", std::move(tone));
+    AudioBuffer ones(960, 1.0f), silence(960, 0.0f), out;
+    rated.getStage("env")->process(ones, out);
+    EXPECT_NEAR(out[239], 0.5, 1e-6);    // 480 samples of attack at 48 kHz
+    EXPECT_NEAR(out[479], 1.0, 1e-6);
+    rated.getStage("osc")->process(silence, out);
+    EXPECT_NEAR(out[25], 0.5, 1e-6);     // A quarter of a 100-sample period
+    EXPECT_EQ(rated.clone()->getSampleRate(), 48000.0);
+    EXPECT_THROW(rated.setSampleRate(0.0), AIAudioException);
+    EXPECT_THROW(rated.setControlInterval(0), AIAudioException);
+    
+    // An LFO and an envelope both move the filter cutoff
+    DSPGraph graph;
+    auto osc = std::make_unique<OscillatorStage>();
+    osc->setParameter("waveType", std::string("saw"));
+    osc->setParameter("frequency", 110.0);
+    graph.addStage("osc", std::move(osc));
+    auto filter = std::make_unique<FilterStage>();
+    filter->setParameter("cutoff", 1500.0);
+    filter->setParameter("resonance", 0.5);
+    graph.addStage("filter", std::move(filter));
+    auto lfo = std::make_unique<LFOStage>();
+    lfo->setParameter("rate", 3.0);
+    lfo->setParameter("depth", 0.8);
+    graph.addStage("lfo", std::move(lfo));
+    graph.addStage("env", std::make_unique<EnvelopeStage>());
+    graph.addConnection({"osc", "filter"});
+    graph.addConnection({"lfo", "filter", "cutoff", 1000.0});
+    graph.addConnection({"env", "filter", "cutoff", 2000.0});
+    
+    // The sources leave the audio path; both routes feed one target
+    EXPECT_EQ(graph.getAudioOrder(), (std::vector<std::string>{"osc", "filter"}));
+    EXPECT_EQ(graph.getExecutionPlan().getStages().size(), 2u);
+    ASSERT_EQ(graph.getModulationBus().getTargets().size(), 1u);
+    EXPECT_EQ(graph.getModulationBus().getRoutes().size(), 2u);
+    
+    // Independent copies driven tick by tick give the same audio
+    auto osc2 = graph.getStage("osc")->clone();
+    auto filter2 = graph.getStage("filter")->clone();
+    auto lfo2 = graph.getStage("lfo")->clone();
+    auto env2 = graph.getStage("env")->clone();
+    AudioBuffer block(512, 0.0f), rendered, reference;
+    for (int b = 0; b < 8; ++b) {
+        graph.process(block, out);
+        rendered.insert(rendered.end(), out.begin(), out.end());
+    }
+    AudioBuffer tick(32, 0.0f), raw, filtered;
+    while (reference.size() < rendered.size()) {
+        double cutoff = 1500.0 + 1000.0 * lfo2->advanceControl(32, true) + 2000.0 * env2->advanceControl(32, true);
+        filter2->setParameterTarget(FilterStage::CUTOFF, std::clamp(cutoff, 20.0, 20000.0), 32);
+        osc2->process(tick, raw);
+        filter2->process(raw, filtered);
+        reference.insert(reference.end(), filtered.begin(), filtered.end());
+    }
+    for (size_t i = 0; i < rendered.size(); ++i) {
+        ASSERT_EQ(rendered[i], reference[i]) << i;
+    }
+    EXPECT_EQ(graph.getStage("filter")->getParameterValue(FilterStage::CUTOFF), 1500.0);  // Base restored
+    
+    // A closed gate holds the envelope at zero
+    auto gated = graph.clone();
+    gated->removeStage("lfo");
+    gated->setGate(false);
+    gated->reset();
+    DSPGraph plain;
+    plain.addStage("osc", gated->getStage("osc")->clone());
+    plain.addStage("filter", gated->getStage("filter")->clone());
+    plain.addConnection({"osc", "filter"});
+    AudioBuffer gatedOut, plainOut;
+    gated->process(block, gatedOut);
+    plain.process(block, plainOut);
+    EXPECT_EQ(gatedOut, plainOut);
+    
+    // A ramped cutoff starts where the old coefficients were; a step jumps
+    FilterStage still, stepped, ramped;
+    AudioBuffer noise(256);
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (auto& x : noise) x = dist(rng);
+    for (FilterStage* f : {&still, &stepped, &ramped}) {
+        f->setParameter("cutoff", 500.0);
+        f->process(noise, out);
+    }
+    stepped.setParameterValue(FilterStage::CUTOFF, 5000.0);
+    ramped.setParameterTarget(FilterStage::CUTOFF, 5000.0, 32);
+    AudioBuffer stillOut, steppedOut, rampedOut;
+    still.process(noise, stillOut);
+    stepped.process(noise, steppedOut);
+    ramped.process(noise, rampedOut);
+    EXPECT_LT(std::abs(rampedOut[0] - stillOut[0]), 0.1 * std::abs(steppedOut[0] - stillOut[0]));
+    
+    // Oscillator gain ramps linearly across the tick
+    OscillatorStage slow;
+    slow.setParameter("frequency", 20.0);
+    slow.setParameter("amplitude", 0.2);
+    AudioBuffer first(64, 0.0f), unit, second(32, 0.0f), ramp;
+    slow.process(first, out);
+    OscillatorStage unitGain = slow;
+    unitGain.setParameter("amplitude", 1.0);
+    slow.setParameterTarget(OscillatorStage::AMPLITUDE, 0.6, 32);
+    slow.process(second, ramp);
+    unitGain.process(second, unit);
+    for (size_t i = 0; i < ramp.size(); ++i) {
+        ASSERT_NEAR(ramp[i], unit[i] * (0.2 + 0.4 * (i + 1) / 32.0), 1e-6) << i;
+    }
+    
+    // Settings survive presets and enter the content hash; bad routes throw
+    auto parsed = IRParser().parsePreset(R"({"sampleRate": 96000, "controlInterval": 64,
+        "stages": {"osc": {"type": "oscillator"}, "lfo": {"type": "lfo"}, "filter": {"type": "filter"}},
+        "connections": [{"source": "osc", "destination": "filter"},
+                        {"source": "lfo", "destination": "filter", "parameter": "cutoff", "amount": 100000}]})");
+    EXPECT_EQ(parsed->getSampleRate(), 96000.0);
+    const std::vector<uint8_t> bytes = compilePreset(*parsed);
+    auto loaded = loadCompiledPreset(bytes.data(), bytes.size());
+    EXPECT_EQ(loaded->getSampleRate(), 96000.0);
+    EXPECT_EQ(loaded->getControlInterval(), 64u);
+    const uint64_t hash = graphContentHash(*loaded);
+    loaded->setControlInterval(32);
+    EXPECT_NE(graphContentHash(*loaded), hash);
+    EXPECT_NO_THROW(loaded->process(block, out));    // Clamped to the cutoff range
+    
+    // Bad routes are rejected when added, never while rendering
+    EXPECT_THROW(loaded->addConnection({"filter", "lfo", "rate"}), AIAudioException);
+    EXPECT_THROW(loaded->addConnection({"lfo", "filter", "brightness"}), AIAudioException);
+    EXPECT_THROW(loaded->addConnection({"lfo", "missing", "cutoff"}), AIAudioException);
+    EXPECT_EQ(loaded->getConnections().size(), 2u);
+    EXPECT_THROW(IRParser().parsePreset(R"({"stages": {"osc": {"type": "oscillator"}, "filter": {"type": "filter"}},
+        "connections": [{"source": "osc", "destination": "filter", "parameter": "cutoff"}]})"), AIAudioException);
+    
+    // A route left stale by replacing its source is skipped and reported
+    loaded->addStage("lfo", std::make_unique<OscillatorStage>());
+    EXPECT_TRUE(loaded->getModulationBus().empty());
+    EXPECT_NO_THROW(loaded->process(block, out));
+    auto issues = loaded->validate();
+    EXPECT_NE(std::find(issues.begin(), issues.end(), "Modulation source is not an LFO or envelope: lfo"),
+              issues.end());
+}
+
+TEST(ModulationTest, AudioPathSourceAdvancesOncePerBlock) {
+    // The envelope shapes the audio and also opens the filter
+    DSPGraph graph;
+    auto osc = std::make_unique<OscillatorStage>();
+    osc->setParameter("waveType", std::string("saw"));
+    osc->setParameter("frequency", 220.0);
+    graph.addStage("osc", std::move(osc));
+    auto filter = std::make_unique<FilterStage>();
+    filter->setParameter("cutoff", 800.0);
+    graph.addStage("filter", std::move(filter));
+    auto env = std::make_unique<EnvelopeStage>();
+    env->setParameter("attack", 0.005);
+    env->setParameter("decay", 0.02);
+    graph.addStage("env", std::move(env));
+    graph.addConnection({"osc", "filter"});
+    graph.addConnection({"filter", "env"});
+    graph.addConnection({"env", "filter", "cutoff", 4000.0});
+    
+    EXPECT_EQ(graph.getAudioOrder(), (std::vector<std::string>{"osc", "filter", "env"}));
+    EXPECT_FALSE(graph.hasCycles());    // The route back to the filter carries no audio
+    const auto& sources = graph.getModulationBus().getSources();
+    ASSERT_EQ(sources.size(), 1u);
+    EXPECT_TRUE(sources[0].onAudioPath);
+    
+    // Only the envelope's process() moves it; each tick reads its level
+    auto osc2 = graph.getStage("osc")->clone();
+    auto filter2 = graph.getStage("filter")->clone();
+    auto env2 = graph.getStage("env")->clone();
+    AudioBuffer block(512, 0.0f), out, rendered, reference;
+    for (int b = 0; b < 4; ++b) {
+        graph.process(block, out);
+        rendered.insert(rendered.end(), out.begin(), out.end());
+    }
+    AudioBuffer tick(32, 0.0f), raw, filtered, shaped;
+    while (reference.size() < rendered.size()) {
+        const double level = env2->advanceControl(0, true);
+        filter2->setParameterTarget(FilterStage::CUTOFF, std::clamp(800.0 + 4000.0 * level, 20.0, 20000.0), 32);
+        osc2->process(tick, raw);
+        filter2->process(raw, filtered);
+        env2->process(filtered, shaped);
+        reference.insert(reference.end(), shaped.begin(), shaped.end());
+    }
+    for (size_t i = 0; i < rendered.size(); ++i) {
+        ASSERT_EQ(rendered[i], reference[i]) << i;
+    }
+    EXPECT_EQ(graph.getStage("env")->advanceControl(0, true), env2->advanceControl(0, true));
+    
+    // The parallel plan shares the value the same way
+    auto parallel = graph.clone();
+    parallel->reset();
+    parallel->setThreadPool(std::make_shared<ThreadPool>(2));
+    AudioBuffer parallelOut;
+    graph.reset();
+    for (int b = 0; b < 4; ++b) {
+        graph.process(block, out);
+        parallel->process(block, parallelOut);
+        ASSERT_EQ(parallelOut, out) << b;
+    }
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();